@@ -4,6 +4,7 @@
 #include "CRenderpass.h"
 #include "Swapchain.h"
 #include "CPipeline.h"
+#include "PipelineCache.h"
 #include "Buffers.h"
 #include "CImage.h"
 #include "matrix.h"
@@ -99,6 +100,11 @@ int main(int argc, char *argv[]) {
     device.Create();                                                   // Create Logical device on selected gpu
     //-------------------------
 
+    //---- Pipeline cache ----
+    PipelineCache pipeline_cache;                      // saved on exit: the next run skips shader compiles
+    pipeline_cache.Init(*graphics_queue, "pipeline.cache");
+    //------------------------
+
     //---- Allocator ----
     CAllocator allocator;
     allocator.Init(instance, *graphics_queue);
@@ -212,7 +218,6 @@ int main(int argc, char *argv[]) {
 
     //--
     CPipeline pipeline(renderpass);
-    pipeline.shader.MaxDescriptorSets(32);
     pipeline.shader.LoadVertShader("shaders/spirv/shader_vert.spv");
     pipeline.shader.LoadFragShader("shaders/spirv/shader_frag.spv");
     pipeline.shader.Bind("ubo", ubo);
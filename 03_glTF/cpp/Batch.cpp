@@ -0,0 +1,217 @@
+#include "Batch.h"
+#include <string.h>
+
+#undef repeat
+#define repeat(COUNT) for(uint32_t i = 0; i < (COUNT); ++i)
+
+//---------------------------------CameraPath--------------------------------
+bool CameraPath::Load(const char* filename) {
+    FILE* file = fopen(filename, "r");
+    if(!file) { LOGE("CameraPath: File not found: %s\n", filename);  return false; }
+    keys.clear();
+    CameraKey key;
+    while(fscanf(file, "%f %f %f", &key.yaw, &key.pitch, &key.dist) == 3) keys.push_back(key);
+    fclose(file);
+    printf("CameraPath: %d keys loaded from %s\n", (int)keys.size(), filename);
+    return !keys.empty();
+}
+
+void CameraPath::Orbit(float pitch, float dist) {
+    keys = {{0, pitch, dist}, {360, pitch, dist}};
+}
+
+CameraKey CameraPath::Sample(float t) {
+    if(keys.empty())     return {};
+    if(keys.size() == 1) return keys[0];
+    float pos = std::clamp(t, 0.f, 1.f) * (keys.size() - 1);
+    uint32_t i = std::min((uint32_t)pos, (uint32_t)keys.size() - 2);
+    float f = pos - i;
+    CameraKey& a = keys[i];
+    CameraKey& b = keys[i + 1];
+    return {a.yaw + (b.yaw - a.yaw) * f, a.pitch + (b.pitch - a.pitch) * f, a.dist + (b.dist - a.dist) * f};
+}
+//---------------------------------------------------------------------------
+
+void StageTime::Print(const char* name) {
+    if(!count) return;
+    printf("  %-10s avg: %7.2f ms   max: %7.2f ms\n", name, total / count * 1000, max * 1000);
+}
+
+//--------------------------------FrameEncoder-------------------------------
+bool FrameEncoder::Start(const char* pattern, uint32_t width, uint32_t height, uint32_t worker_count) {
+    Finish();
+    this->pattern = pattern;
+    this->width   = width;
+    this->height  = height;
+    next_frame = 0;
+    encode_time = {};
+
+    const char* ext = strrchr(pattern, '.');
+    ext = ext ? ext : "";
+    format = IMAGE;
+    if(!strcmp(ext, ".hdr"))  format = HDR;
+    if(!strcmp(ext, ".y4m"))  format = Y4M;
+    if(!strcmp(ext, ".nv12")) format = NV12;
+
+    if(format == Y4M || format == NV12) {
+        stream = fopen(pattern, "wb");
+        if(!stream) { LOGE("FrameEncoder: Can't create file: %s\n", pattern);  return false; }
+        if(format == Y4M) fprintf(stream, "YUV4MPEG2 W%d H%d F30:1 Ip A1:1 C420jpeg\n", width, height);
+    }
+
+    quit = false;
+    max_jobs = worker_count * 2;
+    repeat(worker_count) workers.emplace_back(&FrameEncoder::Work, this);
+    printf("FrameEncoder: %s (%d workers)\n", pattern, worker_count);
+    return true;
+}
+
+void FrameEncoder::Push(CImage&& image, uint64_t frame) {
+    std::unique_lock<std::mutex> lock(mutex);
+    job_done.wait(lock, [&]{ return jobs.size() < max_jobs; });  // don't let the renderer run away from the encoder
+    jobs.push_back({std::move(image), frame});
+    job_ready.notify_one();
+}
+
+void FrameEncoder::Finish() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    job_ready.notify_all();
+    for(auto& worker : workers) worker.join();
+    workers.clear();
+    if(stream) {
+        if(!pending.empty()) LOGW("FrameEncoder: %d frames missing from the stream.\n", (int)pending.size());
+        pending.clear();
+        fclose(stream);
+        stream = 0;
+    }
+}
+
+void FrameEncoder::Work() {
+    while(true) {
+        std::unique_lock<std::mutex> lock(mutex);
+        job_ready.wait(lock, [&]{ return quit || !jobs.empty(); });
+        if(jobs.empty()) return;  // quit, and nothing left to do
+        Job job = std::move(jobs.front());
+        jobs.pop_front();
+        job_done.notify_all();
+        lock.unlock();
+
+        Timer timer;
+        Encode(job);
+        double span = timer.Span();
+        lock.lock();
+        encode_time.Add(span);
+    }
+}
+
+void FrameEncoder::Encode(Job& job) {
+    char filename[512];
+    snprintf(filename, sizeof(filename), pattern.c_str(), (int)job.frame);
+    std::vector<uint8_t> data;
+    switch(format) {
+        case IMAGE : job.image.Save(filename);  break;
+        case HDR   : { CImage32f hdr(job.image);  hdr.Save(filename);  break; }
+        case Y4M   : data.assign((const uint8_t*)"FRAME\n", (const uint8_t*)"FRAME\n" + 6);
+                     ToYUV420(job.image, data, false);
+                     WriteStream(job.frame, data);
+                     break;
+        case NV12  : ToYUV420(job.image, data, true);
+                     WriteStream(job.frame, data);
+                     break;
+    }
+}
+
+// Stream frames must be written in order. Frames that finish early wait in 'pending'.
+void FrameEncoder::WriteStream(uint64_t frame, std::vector<uint8_t>& data) {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending[frame].swap(data);
+    for(auto it = pending.find(next_frame); it != pending.end(); it = pending.find(next_frame)) {
+        fwrite(it->second.data(), 1, it->second.size(), stream);
+        pending.erase(it);
+        ++next_frame;
+    }
+}
+
+// Full-range BT.601 (JPEG) 4:2:0. Appends the Y plane, then either U and V planes (I420), or interleaved UV (NV12).
+void FrameEncoder::ToYUV420(const CImage& img, std::vector<uint8_t>& out, bool interleave_uv) {
+    int w  = img.Width();
+    int h  = img.Height();
+    int cw = (w + 1) / 2;
+    int ch = (h + 1) / 2;
+    size_t base = out.size();
+    out.resize(base + w * h + cw * ch * 2);
+    uint8_t* Y = &out[base];
+    uint8_t* U = Y + w * h;
+    uint8_t* V = interleave_uv ? U + 1 : U + cw * ch;
+    int uv_step = interleave_uv ? 2 : 1;
+    auto clamp8 = [](float v) { return (uint8_t)std::clamp(v + 0.5f, 0.f, 255.f); };
+    const RGBA* pix = img.Buffer();
+
+    for(int y = 0; y < h; ++y) {
+        for(int x = 0; x < w; ++x) {
+            const RGBA& p = pix[y * w + x];
+            Y[y * w + x] = clamp8(0.299f * p.R + 0.587f * p.G + 0.114f * p.B);
+        }
+    }
+    for(int y = 0; y < ch; ++y) {
+        for(int x = 0; x < cw; ++x) {
+            float r = 0, g = 0, b = 0;
+            for(int j = 0; j < 4; ++j) {  // 2x2 block (clamped at the edges)
+                int px = std::min(x * 2 + (j & 1), w - 1);
+                int py = std::min(y * 2 + (j >> 1), h - 1);
+                const RGBA& p = pix[py * w + px];
+                r += p.R;  g += p.G;  b += p.B;
+            }
+            r /= 4;  g /= 4;  b /= 4;
+            int i = (y * cw + x) * uv_step;
+            U[i] = clamp8(128 - 0.168736f * r - 0.331264f * g + 0.5f      * b);
+            V[i] = clamp8(128 + 0.5f      * r - 0.418688f * g - 0.081312f * b);
+        }
+    }
+}
+//---------------------------------------------------------------------------
+
+//--------------------------------BatchRender--------------------------------
+int BatchRender::Run(OffScreen& offscreen, std::function<void(CameraKey& key)> move_camera) {
+    if(path.keys.empty()) path.Orbit();
+    FBO& fbo = offscreen.fbo;
+    VkExtent2D ext = fbo.GetExtent();
+    uint32_t worker_count = workers ? workers : std::max(1u, std::thread::hardware_concurrency());
+    if(!encoder.Start(output.c_str(), ext.width, ext.height, worker_count)) return 1;
+    record_time   = {};
+    readback_time = {};
+
+    Timer clock;
+    std::vector<double> started(frames, 0);
+    fbo.ReadImageAsync([&](CImage& img, uint64_t frame) {  // (render thread)
+        if(frame < frames) readback_time.Add(clock.Span(false) - started[frame]);
+        CImage copy;
+        copy.SetSize(img.Width(), img.Height());
+        memcpy(copy.Buffer(), img.Buffer(), (size_t)img.Width() * img.Height() * sizeof(RGBA));
+        copy.colorspace = img.colorspace;
+        encoder.Push(std::move(copy), frame);
+    }, fbo.FramesInFlight() + 1);
+
+    printf("BatchRender: %d frames, %dx%d, %d frames in flight\n", frames, ext.width, ext.height, fbo.FramesInFlight());
+    repeat(frames) {
+        started[i] = clock.Span(false);
+        CameraKey key = path.Sample(frames > 1 ? (float)i / (frames - 1) : 0.f);
+        move_camera(key);
+        offscreen.Render();
+        record_time.Add(clock.Span(false) - started[i]);
+        if(i % 10 == 0) printf("Frame %d / %d \r", i, frames);
+    }
+    fbo.ReadImageAsync(nullptr);  // deliver the frames still in flight
+    encoder.Finish();
+    double total = clock.Span(false);
+
+    printf("BatchRender: %d frames in %.2fs = %.1f fps\n", frames, total, frames / total);
+    record_time.Print("Record");                // CPU time per frame
+    readback_time.Print("Latency");             // start of frame -> pixels on the host
+    encoder.encode_time.Print("Encode");        // per frame, per worker
+    return 0;
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,107 @@
+// Batch
+// Headless batch rendering: renders N frames along a camera path with OffScreen, and streams them to disk.
+// Frames are rendered with frames in flight (CAllocator::frames_in_flight), read back asynchronously
+// (FBO::ReadImageAsync), and encoded on a pool of worker threads. No window or present queue is needed,
+// so it also runs on a software ICD. (eg. lavapipe)
+//
+// The output format is picked by the file extension:
+//   frames/frame_%04d.png   one image per frame  (also .jpg .tga)
+//   frames/frame_%04d.hdr   one linear float image per frame
+//   out.y4m                 YUV 4:2:0 stream     (eg. "ffmpeg -i out.y4m out.mp4")
+//   out.nv12                raw NV12 stream
+//
+// Camera path file: one key per line: "yaw pitch distance" (degrees, degrees, units).
+// Keys are spread evenly over the frames, and linearly interpolated. Without a file, the camera orbits once.
+//
+// Usage:
+//   BatchRender batch;
+//   batch.frames = 120;
+//   batch.output = "out.y4m";
+//   batch.path.Load("path.txt");
+//   batch.Run(offscreen, [&](CameraKey& key) { ... });  // move the camera to the key
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "OffScreen.h"
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <functional>
+
+struct CameraKey {
+    float yaw   = 0;
+    float pitch = 0;
+    float dist  = 5;
+};
+
+struct CameraPath {
+    std::vector<CameraKey> keys;
+    bool Load(const char* filename);
+    void Orbit(float pitch = 0, float dist = 5);  // one revolution around the Y-axis
+    CameraKey Sample(float t);                    // t: 0..1
+};
+
+struct StageTime {            // per-stage latency (seconds)
+    double total = 0;
+    double max   = 0;
+    uint32_t count = 0;
+    void Add(double t) { total += t;  max = std::max(max, t);  ++count; }
+    void Print(const char* name);
+};
+
+//---Encoder---
+// Encodes frames on worker threads. Stream formats are written in frame order.
+class FrameEncoder {
+    enum Format {IMAGE, HDR, Y4M, NV12};
+    struct Job { CImage image; uint64_t frame; };
+
+    Format      format = IMAGE;
+    std::string pattern;
+    FILE*       stream = 0;
+    uint32_t    width  = 0;
+    uint32_t    height = 0;
+
+    std::vector<std::thread> workers;
+    std::deque<Job>          jobs;
+    std::mutex               mutex;
+    std::condition_variable  job_ready;
+    std::condition_variable  job_done;
+    bool                     quit = false;
+    size_t                   max_jobs = 0;  // back-pressure: Push blocks while this many jobs are queued
+
+    std::map<uint64_t, std::vector<uint8_t>> pending;  // encoded stream frames, waiting for their turn
+    uint64_t next_frame = 0;
+
+    void Work();
+    void Encode(Job& job);
+    void WriteStream(uint64_t frame, std::vector<uint8_t>& data);
+    static void ToYUV420(const CImage& img, std::vector<uint8_t>& out, bool interleave_uv);
+public:
+    StageTime encode_time;
+    ~FrameEncoder() { Finish(); }
+    bool Start(const char* pattern, uint32_t width, uint32_t height, uint32_t worker_count);
+    void Push(CImage&& image, uint64_t frame);
+    void Finish();  // wait for all jobs, and close the stream
+};
+//-------------
+
+class BatchRender {
+public:
+    uint32_t    frames  = 60;
+    uint32_t    workers = 0;                  // 0: one per hardware thread
+    std::string output  = "frame_%04d.png";
+    CameraPath  path;
+
+    StageTime record_time;                    // CPU: transform, record and submit
+    StageTime readback_time;                  // start of frame (before record) -> frame delivered to the host
+    FrameEncoder encoder;
+
+    int Run(OffScreen& offscreen, std::function<void(CameraKey& key)> move_camera);
+};
+
+#endif
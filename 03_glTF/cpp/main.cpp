@@ -4,7 +4,9 @@
 #include "vkWindow.h"
 #include "OnScreen.h"
 #include "OffScreen.h"
+#include "PipelineCache.h"
 #include "Scene.h"
+#include "Batch.h"
 
 //-- EVENT HANDLERS --
 class MainWindow : public vkWindow {
@@ -101,13 +103,75 @@ class MainWindow : public vkWindow {
     }
 };
 
+#ifndef ANDROID
+//--- Headless batch render: no window or present queue (runs on software ICDs, eg. lavapipe) ---
+int RunHeadless(int gpuid, BatchRender& batch, uint32_t width, uint32_t height, uint32_t in_flight) {
+    setvbuf(stdout, NULL, _IONBF, 0);
+    CInstance instance(true);
+    instance.DebugReport.SetFlags(14);
+    CPhysicalDevices gpus(instance);
+    CPhysicalDevice* gpu = &gpus[gpuid];
+    gpus.Print();
+    if (!gpu) return 1;
+    gpu->enable_features.sampleRateShading = VK_TRUE;
+    gpu->extensions.Add("VK_KHR_buffer_device_address");
+
+    CDevice device(*gpu);
+    CQueue* graphics_queue = device.AddQueue(VK_QUEUE_GRAPHICS_BIT);
+    device.Create();
+
+    PipelineCache pipeline_cache;
+    pipeline_cache.Init(*graphics_queue, "pipeline.cache");
+
+    CAllocator allocator;
+    allocator.Init(instance, *graphics_queue);
+    allocator.pack_normals = true;
+    allocator.frames_in_flight = in_flight;  // before the camera UBO and FBO are created
+
+    Scene scene;
+    scene.Init();
+    OffScreen offscreen;
+    offscreen.Init(*graphics_queue);
+    offscreen.fbo.SetExtent(width, height);
+    offscreen.Bind(scene.camera);
+    scene.root.Init_nodes();
+
+    return batch.Run(offscreen, [&](CameraKey& key) {
+        scene.camX.matrix.Clear();  scene.camX.matrix.RotateY(key.yaw);
+        scene.camY.matrix.Clear();  scene.camY.matrix.RotateX(key.pitch);
+        scene.camera.matrix.position().z = key.dist;
+    });
+}
+#endif
+
 int main(int argc, char *argv[]) {
     int gpuid = 0;
 #ifndef ANDROID
     argparse::ArgumentParser parser("glTF", "0.1");
     parser.add_argument("-g", "--gpu").help("Select GPU number to use").scan<'i', int>().default_value(0);
+    parser.add_argument("--headless").help("Batch render to disk, without a window").default_value(false).implicit_value(true);
+    parser.add_argument("-n", "--frames").help("Headless: number of frames").scan<'i', int>().default_value(60);
+    parser.add_argument("-o", "--output").help("Headless: output file (.png .jpg .tga .hdr: printf pattern,  .y4m .nv12: stream)").default_value(std::string("frame_%04d.png"));
+    parser.add_argument("--path").help("Headless: camera path file (\"yaw pitch distance\" per line). Default: orbit").default_value(std::string(""));
+    parser.add_argument("--width").help("Headless: image width").scan<'i', int>().default_value(512);
+    parser.add_argument("--height").help("Headless: image height").scan<'i', int>().default_value(512);
+    parser.add_argument("--inflight").help("Headless: frames in flight (1-3)").scan<'i', int>().default_value(3);
+    parser.add_argument("-j", "--jobs").help("Headless: encoder threads (0: all cores)").scan<'i', int>().default_value(0);
     parser.parse_args(argc, argv);
     gpuid = parser.get<int>("gpu");
+
+    if(parser.get<bool>("headless")) {
+        BatchRender batch;
+        batch.frames  = std::max(1, parser.get<int>("frames"));
+        batch.output  = parser.get<std::string>("output");
+        batch.workers = std::max(0, parser.get<int>("jobs"));
+        std::string path = parser.get<std::string>("path");
+        if(!path.empty() && !batch.path.Load(path.c_str())) return 1;
+        uint32_t w = std::max(1, parser.get<int>("width"));
+        uint32_t h = std::max(1, parser.get<int>("height"));
+        uint32_t in_flight = std::clamp(parser.get<int>("inflight"), 1, 3);
+        return RunHeadless(gpuid, batch, w, h, in_flight);
+    }
 #endif
 
     setvbuf(stdout, NULL, _IONBF, 0);                           // Prevent printf buffering in QtCreator
@@ -141,6 +205,11 @@ int main(int argc, char *argv[]) {
     device.Create();                                                           // Create Logical device on selected gpu
     //-------------------------
 
+    //---- Pipeline cache ----
+    PipelineCache pipeline_cache;                      // saved on exit: the next run skips shader compiles
+    pipeline_cache.Init(*graphics_queue, "pipeline.cache");
+    //------------------------
+
     //---- Allocator ----
     CAllocator allocator;
     allocator.Init(instance, *graphics_queue);
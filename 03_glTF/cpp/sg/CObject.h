@@ -32,7 +32,6 @@ public:
     bool visible = true;
     int hitGroup = -1;  // 0=miss 1=hit
 
-    static VkCommandBuffer commandBuffer;
     static CamUniform cam_uniform;
 
     CObject() {}
@@ -40,7 +39,7 @@ public:
 
     virtual void Init(){}
     virtual void Transform();
-    virtual void Draw(){}
+    virtual void Draw(VkCommandBuffer){}
 
     virtual CObject* Parent() { return (CObject*)(_parent); }
     CObject& GetRoot() { CObject* obj = this;  while(obj->Parent()) obj = obj->Parent(); return *obj; }
@@ -25,7 +25,7 @@ public:
 
     CBox(const char* name="box") : CObject(name) { type = "Box"; hitGroup = 0; }
     void Init();
-    void Draw();
+    void Draw(VkCommandBuffer cmd);
 };
 
 //---------------------------------------------------------
@@ -33,7 +33,7 @@ public:
 class CSkybox : public CBox {
 public: 
     CSkybox(const char* name="skybox") : CBox(name) { type = "Skybox"; flipped = true; }
-    void Draw();
+    void Draw(VkCommandBuffer cmd);
 };
 
 //---------------------------------------------------------
@@ -30,16 +30,16 @@ void CMesh::UpdateUBO() {  // (does NOT update textures)
     ubo.Set(&ubo_data, sizeof(ubo_data));
 }
 
-void CMesh::Draw() {
+void CMesh::Draw(VkCommandBuffer cmd) {
     if(!visible)return;
     UpdateUBO();
     Bind();
-    pipeline->Bind(commandBuffer, descriptorSets);
+    pipeline->Bind(cmd, descriptorSets);
 
     // Geometry
-    vkCmdBindVertexBuffer(commandBuffer, vbo);
-    vkCmdBindIndexBuffer (commandBuffer, ibo, 0, VK_INDEX_TYPE_UINT32);
-    vkCmdDrawIndexed     (commandBuffer, ibo.Count(), 1, 0, 0, 0);
+    vkCmdBindVertexBuffer(cmd, vbo);
+    vkCmdBindIndexBuffer (cmd, ibo, 0, VK_INDEX_TYPE_UINT32);
+    vkCmdDrawIndexed     (cmd, ibo.Count(), 1, 0, 0, 0);
 }
 //------------------------------------------------------------
 
@@ -22,13 +22,11 @@ void OffScreen::Init(CQueue& queue) {
 
     //--- Pipelines ---
     pbr_pipeline.Init(renderpass, 0);
-    pbr_pipeline.shader.MaxDescriptorSets(32);
     pbr_pipeline.shader.LoadVertShader("shaders/spirv/pbr_vert.spv");
     pbr_pipeline.shader.LoadFragShader("shaders/spirv/pbr_frag.spv");
     pbr_pipeline.CreateGraphicsPipeline();
 
     sky_pipeline.Init(renderpass, 0);
-    sky_pipeline.shader.MaxDescriptorSets(3);
     sky_pipeline.shader.LoadVertShader("shaders/spirv/sky_vert.spv");
     sky_pipeline.shader.LoadFragShader("shaders/spirv/sky_frag.spv");
     sky_pipeline.depthStencilState.depthWriteEnable = VK_FALSE;          // Skybox does not modify depth
@@ -64,11 +62,16 @@ void OffScreen::Render() {
     //camera->flags = window.flags;
 
     root.Transform_nodes();
-    VkCommandBuffer cmd = fbo.BeginFrame();
-        VkFence fence = fbo.CurrBuffer().fence;
+    fbo.AcquireNext();                      // waits for the frame slot being reused
+    VkFence fence = fbo.CurrBuffer().fence;
+    camera->Apply(fence);                   // writes the camera's next ring slot
+    pbr_pipeline.shader.Bind("camera", camera->cam_ubo);
+    sky_pipeline.shader.Bind("camera", camera->cam_ubo);
+
+    VkCommandBuffer cmd = fbo.BeginCmd();
+    fbo.BeginRenderpass();
         vkCmdSetViewport(cmd, 0, 1, &viewport);
         vkCmdSetScissor (cmd, 0, 1, &scissor);
-        camera->Apply(fence);
         root.Draw_nodes(cmd);
     fbo.EndFrame();
 
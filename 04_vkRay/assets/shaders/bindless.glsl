@@ -0,0 +1,37 @@
+// BINDLESS (see BindlessTable)
+#extension GL_EXT_nonuniform_qualifier : enable
+
+// MATERIAL
+struct Material {
+    vec4 albedo;
+    vec4 emission;
+    vec4 normal;
+    vec4 orm;
+    int  tex_albedo;    // index into textures[]  (-1 = none)
+    int  tex_emission;
+    int  tex_normal;
+    int  tex_orm;
+};
+
+// PER-DRAW STATE
+layout(push_constant) uniform Draw {
+    mat4 matrix;
+    int  material;
+} draw;
+
+// CAMERA UBO
+layout(set = 0, binding = 1) uniform Camera {
+    mat4 view;
+    mat4 proj;
+    mat4 viewInverse;
+    mat4 projInverse;
+    uint flags;
+} camera;
+
+// TEXTURES + MATERIALS
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+layout(set = 1, binding = 1) readonly buffer Materials { Material materials[]; };
+
+vec4 Texture(int id, vec2 tc) {  // white, if no texture
+    return (id < 0) ? vec4(1) : texture(textures[nonuniformEXT(id)], tc);
+}
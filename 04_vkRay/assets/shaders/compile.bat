@@ -3,6 +3,13 @@ echo Compiling shaders...
 del *.spv
 glslangValidator.exe -V pbr_shader.vert -o pbr_vert.spv
 glslangValidator.exe -V pbr_shader.frag -o pbr_frag.spv
+glslangValidator.exe -V pbr_shader.frag -DRAY_QUERY --target-env vulkan1.2 -o pbr_rq_frag.spv
+
+glslangValidator.exe -V pbr_bindless.vert --target-env vulkan1.2 -o pbr_bindless_vert.spv
+glslangValidator.exe -V pbr_bindless.frag --target-env vulkan1.2 -o pbr_bindless_frag.spv
+glslangValidator.exe -V pbr_bindless.frag -DRAY_QUERY --target-env vulkan1.2 -o pbr_bindless_rq_frag.spv
+glslangValidator.exe -V pbr_indirect.vert --target-env vulkan1.2 -o pbr_indirect_vert.spv
+glslangValidator.exe -V cull.comp -o cull_comp.spv
 
 glslangValidator.exe -V sky_shader.vert -o sky_vert.spv
 glslangValidator.exe -V sky_shader.frag -o sky_frag.spv
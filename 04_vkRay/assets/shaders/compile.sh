@@ -2,6 +2,18 @@
 echo "Compiling PBR shaders..."
 glslangValidator -V pbr_shader.vert -o spirv/pbr_vert.spv
 glslangValidator -V pbr_shader.frag -o spirv/pbr_frag.spv
+glslangValidator -V pbr_shader.frag -DRAY_QUERY --target-env vulkan1.2 -o spirv/pbr_rq_frag.spv
+echo
+
+echo "Compiling PBR bindless shaders..."
+glslangValidator -V pbr_bindless.vert --target-env vulkan1.2 -o spirv/pbr_bindless_vert.spv
+glslangValidator -V pbr_bindless.frag --target-env vulkan1.2 -o spirv/pbr_bindless_frag.spv
+glslangValidator -V pbr_bindless.frag -DRAY_QUERY --target-env vulkan1.2 -o spirv/pbr_bindless_rq_frag.spv
+echo
+
+echo "Compiling GPU-driven shaders..."
+glslangValidator -V pbr_indirect.vert --target-env vulkan1.2 -o spirv/pbr_indirect_vert.spv
+glslangValidator -V cull.comp                               -o spirv/cull_comp.spv
 echo
 
 echo "Compiling Sky shaders..."
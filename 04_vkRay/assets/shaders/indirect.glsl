@@ -0,0 +1,20 @@
+// GPU-DRIVEN DRAWS (see IndirectRenderer)
+
+// OBJECT (one per mesh in the geometry pool)
+struct Object {
+    mat4  matrix;         // world matrix
+    vec4  sphere;         // local-space bounds (xyz=center, w=radius). radius<0: hidden
+    int   material;       // index into materials[]
+    uint  index_count;
+    uint  first_index;
+    int   vertex_offset;
+};
+
+// VkDrawIndexedIndirectCommand
+struct DrawCommand {
+    uint  index_count;
+    uint  instance_count;
+    uint  first_index;
+    int   vertex_offset;
+    uint  first_instance;  // object index (gl_InstanceIndex in the vertex shader)
+};
@@ -0,0 +1,31 @@
+#version 460
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive    : enable
+#include "bindless.glsl"
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec2 inTC;
+
+layout(location = 0) out vec2 tc;
+layout(location = 1) out vec3 norm_vec;
+layout(location = 2) out vec3 eye_vec;
+layout(location = 3) out vec3 up;
+layout(location = 4) flat out int material;
+layout(location = 5) out vec3 world_pos;  // (for ray queries)
+
+void main() {
+    norm_vec = normalize(mat3(draw.matrix) * inNormal);
+    vec4 vrtPos = draw.matrix * vec4(inPosition, 1.0);
+
+    mat4 invView = camera.viewInverse;
+    vec3 camPos = invView[3].xyz / invView[3].w;
+    eye_vec = normalize(vrtPos.xyz - camPos);
+    world_pos = vrtPos.xyz;
+
+    up = normalize(-draw.matrix[1].xyz);            //  tangents
+
+    gl_Position = camera.proj * camera.view * vrtPos;
+    tc = inTC;
+    material = draw.material;
+}
@@ -0,0 +1,33 @@
+#version 460
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive    : enable
+#include "bindless.glsl"
+#include "indirect.glsl"
+
+layout(set = 2, binding = 0) readonly buffer Objects { Object objects[]; };
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec2 inTC;
+
+layout(location = 0) out vec2 tc;
+layout(location = 1) out vec3 norm_vec;
+layout(location = 2) out vec3 eye_vec;
+layout(location = 3) out vec3 up;
+layout(location = 4) flat out int material;
+
+void main() {
+    Object object = objects[gl_InstanceIndex];  // firstInstance is the object index
+    norm_vec = normalize(mat3(object.matrix) * inNormal);
+    vec4 vrtPos = object.matrix * vec4(inPosition, 1.0);
+
+    mat4 invView = camera.viewInverse;
+    vec3 camPos = invView[3].xyz / invView[3].w;
+    eye_vec = normalize(vrtPos.xyz - camPos);
+
+    up = normalize(-object.matrix[1].xyz);          //  tangents
+
+    gl_Position = camera.proj * camera.view * vrtPos;
+    tc = inTC;
+    material = object.material;
+}
@@ -1,6 +1,9 @@
 #version 460
 #extension GL_ARB_separate_shader_objects : enable
 #extension GL_GOOGLE_include_directive    : enable
+#ifdef RAY_QUERY
+#extension GL_EXT_ray_query               : require
+#endif
 #include "bindings.glsl"
 //precision mediump float;
 
@@ -15,6 +18,11 @@ layout(location = 1) in vec3 in_norm_vec;  // surface normal vector
 layout(location = 2) in vec3 in_eye_vec;   // camera-to-surface vector
 layout(location = 3) in vec3 up;           // model's up vector
 
+#ifdef RAY_QUERY
+layout(location = 5) in vec3 world_pos;    // world-space position
+#include "rayquery.glsl"
+#endif
+
 layout(location = 0) out vec4 outColor;
 
 void main() {
@@ -53,6 +61,13 @@ void main() {
          diffuse += textureLod(tex_cubemap, norm, levels-1);
          diffuse += textureLod(tex_cubemap, norm, levels-2);
     diffuse /=3.0;
+
+    // RAY QUERY: ray traced AO, and direct light with ray traced shadows
+#ifdef RAY_QUERY
+    AO *= Occlusion(world_pos, norm_vec);
+    float NdotL = max(dot(normalize(rq.light.xyz), norm), 0.0);
+    diffuse.rgb += rq.light_color.rgb * NdotL * Shadow(world_pos, norm_vec);
+#endif
     
     // SPECULAR LIGHT
     //float LOD = textureQueryLod(tex_cubemap, ref_vec).x;
@@ -11,6 +11,7 @@ layout(location = 0) out vec2 tc;
 layout(location = 1) out vec3 norm_vec;
 layout(location = 2) out vec3 eye_vec;
 layout(location = 3) out vec3 up;
+layout(location = 5) out vec3 world_pos;  // (for ray queries)
 
 void main() {
     norm_vec = normalize(mat3(model.matrix) * inNormal);
@@ -20,6 +21,7 @@ void main() {
     mat4 invView = camera.viewInverse;
     vec3 camPos = invView[3].xyz / invView[3].w;
     eye_vec = normalize(vrtPos.xyz - camPos);
+    world_pos = vrtPos.xyz;
     
     up = normalize(-model.matrix[1].xyz);           //  tangents
 
@@ -0,0 +1,73 @@
+// RAY QUERY (see RayQuerySet)
+// Shadow and ambient-occlusion rays, traced inline against the ray tracer's TLAS.
+// (needs "#extension GL_EXT_ray_query", before any declarations)
+
+#ifndef RQ_SET
+#define RQ_SET 1  // (2 after the bindless table)
+#endif
+
+layout(set = RQ_SET, binding = 0) uniform accelerationStructureEXT tlas;
+layout(set = RQ_SET, binding = 1) uniform RayQuery {
+    vec4  light;        // xyz: direction towards the light
+    vec4  light_color;
+    uint  shadow_rays;  // per pixel (0: no shadows)
+    uint  ao_rays;      // per pixel (0: no ray traced AO)
+    float ao_radius;    // occluders further away than this don't darken
+    float light_size;   // angular radius of the light (radians)
+} rq;
+
+const float RQ_BIAS = 0.002;  // rays start this far off the surface (the raster and BLAS triangles may not match exactly)
+
+bool Occluded(vec3 origin, vec3 dir, float tmax) {
+    rayQueryEXT query;
+    uint flags = gl_RayFlagsTerminateOnFirstHitEXT | gl_RayFlagsOpaqueEXT;
+    rayQueryInitializeEXT(query, tlas, flags, 0xFF, origin, 0.0, dir, tmax);
+    while(rayQueryProceedEXT(query)) {}
+    return rayQueryGetIntersectionTypeEXT(query, true) != gl_RayQueryCommittedIntersectionNoneEXT;
+}
+
+// Interleaved gradient noise: rotates each pixel's ray pattern, so a few rays give fine noise instead of banding.
+float PixelNoise() {
+    return fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+}
+
+mat3 Basis(vec3 n) {  // z-axis = n
+    vec3 t = normalize(cross(abs(n.z) < 0.999 ? vec3(0,0,1) : vec3(1,0,0), n));
+    return mat3(t, cross(n, t), n);
+}
+
+// Fraction of the light's disk that is visible from pos (1: fully lit).
+float Shadow(vec3 pos, vec3 normal) {
+    vec3 L = normalize(rq.light.xyz);
+    if(rq.shadow_rays == 0 || dot(L, normal) <= 0.0) return 1.0;  // (facing away: no direct light anyway)
+    vec3  origin = pos + normal * RQ_BIAS;
+    mat3  basis  = Basis(L);
+    float noise  = PixelNoise();
+    uint  lit    = 0;
+    for(uint i = 0; i < rq.shadow_rays; ++i) {
+        vec3 dir = L;
+        if(rq.shadow_rays > 1) {  // spiral over the light's disk
+            float r = sqrt((float(i) + 0.5) / float(rq.shadow_rays)) * rq.light_size;
+            float a = (float(i) + noise) * 2.39996323;  // golden angle
+            dir = normalize(basis * vec3(r * cos(a), r * sin(a), 1.0));
+        }
+        if(!Occluded(origin, dir, 1000.0)) ++lit;
+    }
+    return float(lit) / float(rq.shadow_rays);
+}
+
+// Fraction of cosine-weighted hemisphere rays that escape within ao_radius (1: unoccluded).
+float Occlusion(vec3 pos, vec3 normal) {
+    if(rq.ao_rays == 0) return 1.0;
+    vec3  origin = pos + normal * RQ_BIAS;
+    mat3  basis  = Basis(normal);
+    float noise  = PixelNoise();
+    uint  open   = 0;
+    for(uint i = 0; i < rq.ao_rays; ++i) {
+        float u = (float(i) + noise) / float(rq.ao_rays);          // stratified pitch
+        float a = 6.2831853 * fract(float(i) * 0.618034 + noise);  // heading
+        vec3 dir = basis * vec3(sqrt(u) * cos(a), sqrt(u) * sin(a), sqrt(1.0 - u));
+        if(!Occluded(origin, dir, rq.ao_radius)) ++open;
+    }
+    return float(open) / float(rq.ao_rays);
+}
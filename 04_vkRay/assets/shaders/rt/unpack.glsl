@@ -1,4 +1,5 @@
 #extension GL_EXT_nonuniform_qualifier : enable
+#extension GL_EXT_buffer_reference : require
 
 #define NORMAL_PACK
 
@@ -18,19 +19,30 @@ struct VertPack {  // only use 4-byte types, to prevent realignment
 };
 
 #ifndef NORMAL_PACK
-layout(binding = 4, set = 0) buffer  Vertices{ vec4 v[];     } vrtSets[];  // vbo
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer Vertices { vec4 v[];     };  // vbo
 #else
-layout(binding = 4, set = 0) buffer  Vertices{ VertPack v[]; } vrtSets[];  // vbo (packed)
+layout(buffer_reference, std430, buffer_reference_align = 4)  readonly buffer Vertices { VertPack v[]; };  // vbo (packed)
 #endif
-layout(binding = 5, set = 0) buffer  Indices { uint i[];     } inxSets[];  // ibo
+layout(buffer_reference, std430, buffer_reference_align = 4)  readonly buffer Indices  { uint i[];     };  // ibo
+layout(buffer_reference) buffer Models;  // model data: world matrix and material (declared by the hit shader)
+
+struct InstanceData {    // VKRay InstanceData (std430)
+    Vertices vertices;
+    Indices  indices;
+    Models   models;
+    int      material;  // bindless material id (-1: none)
+};
+
+layout(binding = 3, set = 0) readonly buffer SceneTable { InstanceData instances[]; };  // per-instance data, by custom index
+InstanceData Instance() { return instances[gl_InstanceCustomIndexEXT]; }
 
 
 #ifndef NORMAL_PACK
 // No pack (8 DWORD)
 Vertex unpackVertex(uint index) {
     uint vrtSize = 2;  // Number of vec4 values used to represent a vertex
-    vec4 d0 = vrtSets[gl_InstanceID].v[vrtSize * index + 0];
-    vec4 d1 = vrtSets[gl_InstanceID].v[vrtSize * index + 1];
+    vec4 d0 = Instance().vertices.v[vrtSize * index + 0];
+    vec4 d1 = Instance().vertices.v[vrtSize * index + 1];
     Vertex v;
     v.pos = d0.xyz;
     v.nrm = vec3(d0.w, d1.x, d1.y);
@@ -42,7 +54,7 @@ Vertex unpackVertex(uint index) {
 
 // pack (6 DWORD)
 Vertex unpackVertex(uint index) {  // with pack32 normal
-    VertPack p = vrtSets[gl_InstanceID].v[index];
+    VertPack p = Instance().vertices.v[index];
     Vertex v;
     v.pos = vec3(p.posx, p.posy, p.posz);
     int npack = floatBitsToInt(p.norm);
@@ -58,9 +70,10 @@ Vertex unpackVertex(uint index) {  // with pack32 normal
 Vertex[3] getTriangle() {
     Vertex v[3];
     uint primOffs = gl_PrimitiveID * 3;
-    v[0] = unpackVertex(inxSets[gl_InstanceID].i[primOffs + 0]);
-    v[1] = unpackVertex(inxSets[gl_InstanceID].i[primOffs + 1]);
-    v[2] = unpackVertex(inxSets[gl_InstanceID].i[primOffs + 2]);
+    Indices indices = Instance().indices;
+    v[0] = unpackVertex(indices.i[primOffs + 0]);
+    v[1] = unpackVertex(indices.i[primOffs + 1]);
+    v[2] = unpackVertex(indices.i[primOffs + 2]);
     return v;
 }
 
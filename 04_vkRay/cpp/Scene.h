@@ -18,11 +18,12 @@ struct Scene {
     //-----------------------
     //--- Shared textures ---
     CvkImage vk_skybox_texture;
+    CCubemap skybox_texture;   // cpu-side copy (only kept for the CPU raytracer)
     //-----------------------
-    void Init();
+    void Init(bool keep_skybox = false);
 };
 
-void Scene::Init() {
+void Scene::Init(bool keep_skybox) {
     //--- Scene graph structure ---
     root.Add(camX);
     camX.Add(camY);
@@ -35,7 +36,6 @@ void Scene::Init() {
     //-----------------------------
 
     //--- SKYBOX ---
-    CCubemap skybox_texture;
     skybox_texture.LoadPanorama("Skybox/rooitou_park_4k.hdr");
     vk_skybox_texture.Data(skybox_texture, VK_FORMAT_E5B9G9R9_UFLOAT_PACK32, true);
 
@@ -73,7 +73,7 @@ void Scene::Init() {
     light.color = flux * 64.f;
 #endif
 
-    skybox_texture.Clear();                                                        // delete cpu-side buffers
+    if(!keep_skybox) skybox_texture.Clear();                                       // delete cpu-side buffers
     //--------------
     model .cubemap = &vk_skybox_texture;
     skybox.cubemap = &vk_skybox_texture;
@@ -7,9 +7,11 @@
 #include "vkWindow.h"
 #include "OnScreen.h"
 #include "OffScreen.h"
+#include "PipelineCache.h"
 #include "rt.h"
 
 #include "Scene.h"
+#include "spirv_reflect.h"
 
 //-- EVENT HANDLERS --
 class MainWindow : public vkWindow {
@@ -112,11 +114,65 @@ class MainWindow : public vkWindow {
     }
 };
 
+// Returns false (and says which) if a SPIR-V file is missing, so an optional mode can be turned off,
+// instead of asserting in ShaderRegistry. (paths relative to the assets folder)
+static bool HasShaders(std::initializer_list<const char*> files) {
+    for(const char* file : files) {
+        FILE* f = fopen(file, "rb");
+        if(!f) {printf("Missing %s: rebuild the shaders (compile.sh).\n", file); return false;}
+        fclose(f);
+    }
+    return true;
+}
+
+// Returns false (and says so) if a shader doesn't write the output 'location'. (SPIR-V built before it was added)
+static bool WritesOutput(const char* file, uint32_t location) {
+    std::vector<char> spirv;
+    FILE* f = fopen(file, "rb");
+    if(f) {
+        fseek(f, 0, SEEK_END);
+        spirv.resize(ftell(f));
+        fseek(f, 0, SEEK_SET);
+        if(fread(spirv.data(), 1, spirv.size(), f) != spirv.size()) spirv.clear();
+        fclose(f);
+    }
+    bool found = false;
+    SpvReflectShaderModule module = {};
+    if(!spirv.empty() && spvReflectCreateShaderModule(spirv.size(), spirv.data(), &module) == SPV_REFLECT_RESULT_SUCCESS) {
+        uint32_t count = 0;
+        spvReflectEnumerateOutputVariables(&module, &count, nullptr);
+        std::vector<SpvReflectInterfaceVariable*> outputs(count);
+        spvReflectEnumerateOutputVariables(&module, &count, outputs.data());
+        for(auto var : outputs) found |= !(var->decoration_flags & SPV_REFLECT_DECORATION_BUILT_IN) && var->location == location;
+        spvReflectDestroyShaderModule(&module);
+    }
+    if(!found) printf("%s doesn't write location %d: rebuild the shaders (compile.sh).\n", file, location);
+    return found;
+}
+
 int main(int argc, char *argv[]) {
     argparse::ArgumentParser parser("vkRay", "0.1");
     parser.add_argument("-g", "--gpu").help("Select GPU number to use").scan<'i',int>().default_value(0);
+    parser.add_argument("-c", "--cpu").help("Raytrace on the CPU").default_value(false).implicit_value(true);
+    parser.add_argument("-b", "--bindless").help("Use a bindless texture/material table").default_value(false).implicit_value(true);
+    parser.add_argument("-i", "--indirect").help("GPU-driven rendering: compute culling + indirect draws (implies --bindless)").default_value(false).implicit_value(true);
+    parser.add_argument("-f", "--frames").help("Frames in flight (1-3)").scan<'i',int>().default_value(2);
+    parser.add_argument("-t", "--threads").help("Command recording threads (0: one per core)").scan<'i',int>().default_value(1);
+    parser.add_argument("-s", "--stats").help("Print CPU ray tracer stats each frame").default_value(false).implicit_value(true);
+    parser.add_argument("--reference").help("CPU ray tracer regression check: compare a frame with this image (saved if missing), and exit").default_value(std::string(""));
+    parser.add_argument("-q", "--rayquery").help("Hybrid: ray traced shadows and AO in the raster shader (ray query)").default_value(false).implicit_value(true);
+    parser.add_argument("--shadow-rays").help("Ray query shadow rays per pixel").scan<'i',int>().default_value(1);
+    parser.add_argument("--ao-rays").help("Ray query AO rays per pixel").scan<'i',int>().default_value(4);
     parser.parse_args(argc, argv);
-    int gpuid = parser.get<int>("gpu");
+    int  gpuid  = parser.get<int>("gpu");
+    bool use_cpu= parser.get<bool>("cpu");
+    bool use_indirect = parser.get<bool>("indirect");
+    bool use_bindless = parser.get<bool>("bindless") || use_indirect;
+    int  frames = std::clamp(parser.get<int>("frames"), 1, 3);
+    int  threads= std::max(parser.get<int>("threads"), 0);
+    bool use_rayquery = parser.get<bool>("rayquery");
+    std::string reference = parser.get<std::string>("reference");
+    if(!reference.empty()) use_cpu = true;
 
 
     setvbuf(stdout, NULL, _IONBF, 0);                           // Prevent printf buffering in QtCreator
@@ -137,11 +193,12 @@ int main(int argc, char *argv[]) {
 
     //gpu->enable_features.samplerAnisotropy = VK_TRUE;
     //gpu->enable_features.sampleRateShading = VK_TRUE;
+    gpu->enable_features.multiDrawIndirect = gpu->features.multiDrawIndirect;  // for --indirect
 
     gpu->extensions.Add({
         "VK_KHR_acceleration_structure",
         "VK_KHR_ray_tracing_pipeline",
-        //"VK_KHR_ray_query",
+        "VK_KHR_ray_query",
         "VK_KHR_deferred_host_operations",
         "VK_KHR_buffer_device_address",
         //"VK_KHR_vulkan_memory_model",
@@ -151,7 +208,8 @@ int main(int argc, char *argv[]) {
         //"VK_KHR_pipeline_library",
     });
     bool hasRTX=gpu->extensions.Has("VK_KHR_ray_tracing_pipeline");
-    if(!hasRTX) {printf("Raytracing not supported."); exit(1);}
+    if(!hasRTX) {printf("Raytracing not supported. Using CPU raytracer.\n"); use_cpu = true;}
+    if(use_rayquery && (use_cpu || !gpu->extensions.Has("VK_KHR_ray_query") || !gpu->features_RayQuery.rayQuery)) {printf("Ray query not supported.\n"); use_rayquery = false;}
 
     //--- Device and Queues ---
     CDevice device(*gpu);                                                      // Create Logical device on selected gpu
@@ -164,20 +222,51 @@ int main(int argc, char *argv[]) {
     device.Create();                                                           // Create Logical device on selected gpu
     //-------------------------
 
+    //---- Pipeline cache ----
+    PipelineCache pipeline_cache;                      // saved on exit: the next run skips shader compiles
+    pipeline_cache.Init(*graphics_queue, "pipeline.cache");
+    //------------------------
+
     //---- Allocator ----
     CAllocator allocator;
     allocator.Init(instance, *graphics_queue);
     //allocator.maxAnisotropy = 16.f;
     allocator.pack_normals = true;
-    allocator.useRTX = true;
+    allocator.useRTX = !use_cpu;
+    allocator.frames_in_flight = frames;  // before any UBO or FBO is created
     //-------------------
 
+    //---- Bindless ----
+    BindlessTable bindless;
+    if(use_bindless && !gpu->features_12.descriptorBindingPartiallyBound) {printf("Bindless not supported.\n"); use_bindless = use_indirect = false;}
+    if(use_bindless && !HasShaders({"shaders/spirv/pbr_bindless_vert.spv", "shaders/spirv/pbr_bindless_frag.spv"})) use_bindless = use_indirect = false;
+    if(use_indirect && !HasShaders({"shaders/spirv/pbr_indirect_vert.spv", "shaders/spirv/cull_comp.spv"})) use_indirect = false;
+    if(use_rayquery) {  // (the vertex shader must also write world_pos)
+        const char* vert = use_bindless ? "shaders/spirv/pbr_bindless_vert.spv"    : "shaders/spirv/pbr_vert.spv";
+        const char* frag = use_bindless ? "shaders/spirv/pbr_bindless_rq_frag.spv" : "shaders/spirv/pbr_rq_frag.spv";
+        if(!HasShaders({frag}) || !WritesOutput(vert, 5)) use_rayquery = false;
+    }
+    if(use_bindless) {
+        bindless.Init(device);
+        CObject::bindless = &bindless;  // glTF materials register here, while loading
+    }
+    //------------------
+
     Scene scene;
-    scene.Init();
+    scene.Init(use_cpu);
     window.scene = &scene;
+    RT rt;
 
     //----Onscreen----
     OnScreen onscreen;
+    if(use_rayquery) {
+        onscreen.hybrid = &rt.vkray;  // (TLAS built below, by rt.Init)
+        onscreen.rayquery.settings.shadow_rays = std::max(parser.get<int>("shadow-rays"), 0);
+        onscreen.rayquery.settings.ao_rays     = std::max(parser.get<int>("ao-rays"), 0);
+    }
+    onscreen.gpu_driven = use_indirect;
+    onscreen.parallel   = (threads != 1);
+    onscreen.swapchain.record_threads = threads;
     onscreen.Init(*present_queue, *graphics_queue, surface);
     onscreen.Bind(scene.camera);
     //----------------
@@ -186,6 +275,7 @@ int main(int argc, char *argv[]) {
     OffScreen offscreen;
     offscreen.Init(*graphics_queue);
     //-----------------
+    ShaderRegistry::Get().PrintStats();  // shared modules, and reflections read from sidecars
 
     //----Init scene nodes----
     scene.root.Init_nodes();
@@ -193,9 +283,15 @@ int main(int argc, char *argv[]) {
     //------------------------
 
     //----Raytrace-----
-    RT rt;
-    auto target = onscreen.swapchain.att_images[0].view;
-    rt.Init(*graphics_queue, scene.camera, target);
+    if(use_bindless) bindless.Update();
+    if(use_cpu) {
+        rt.InitCPU(*graphics_queue, scene.camera, scene.skybox_texture);
+        rt.cpu_stats = parser.get<bool>("stats");
+        if(!reference.empty()) return rt.CheckCPU(scene.camera, scene.light, reference.c_str()) ? 0 : 1;
+    } else {
+        auto target = onscreen.swapchain.att_images[0].view;
+        rt.Init(*graphics_queue, scene.camera, scene.skybox_texture, target);
+    }
     //-----------------
 
     //==============================================
@@ -204,8 +300,10 @@ int main(int argc, char *argv[]) {
     while (window.ProcessEvents()) {
         if(window.raytrace) {
             rt.Update();
-            rt.Render(scene.camera, onscreen.swapchain);
+            if(rt.cpu) rt.RenderCPU(scene.camera, scene.light, onscreen.swapchain);
+            else        rt.Render   (scene.camera, onscreen.swapchain);
         } else {
+            if(use_rayquery) rt.Update();  // instance transforms, for the TLAS
             onscreen.Bind(scene.camera);
             onscreen.Render();
         }
@@ -217,6 +315,14 @@ int main(int argc, char *argv[]) {
             attachment.Read().Save("frame.png");
         }
 
+        if(window.GetKeyState(KEY_P)) {  // 'P': print render queue stats
+            CObject::render_queue.stats.Print();
+        }
+
+        if(window.GetKeyState(KEY_G)) {  // 'G': print the frame graph's schedule (passes and barriers)
+            printf("%s", onscreen.graph.Dump().c_str());
+        }
+
         if(window.GetKeyState(KEY_F)) {  //'F': save image from FBO
             offscreen.Bind(scene.camera);
             offscreen.Render();
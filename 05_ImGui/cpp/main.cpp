@@ -4,6 +4,7 @@
 #include "vkWindow.h"
 #include "OnScreen.h"
 #include "OffScreen.h"
+#include "PipelineCache.h"
 #include "Scene.h"
 #ifdef ENABLE_IMGUI
 #include "DearImGui.h"
@@ -153,6 +154,11 @@ int main(int argc, char *argv[]) {
     device.Create();                                                           // Create Logical device on selected gpu
     //-------------------------
 
+    //---- Pipeline cache ----
+    PipelineCache pipeline_cache;                      // saved on exit: the next run skips shader compiles
+    pipeline_cache.Init(*graphics_queue, "pipeline.cache");
+    //------------------------
+
     //---- Allocator ----
     CAllocator allocator;
     allocator.Init(instance, *graphics_queue);
@@ -7,7 +7,6 @@ struct UseUTF8{UseUTF8(){SetConsoleOutputCP(CP_UTF8);}}utf8;
 #endif
 
 
-VkCommandBuffer CObject::commandBuffer = 0;
 CamUniform CObject::cam_uniform {};
 
 //---CObject---
@@ -52,8 +51,7 @@ void CObject::Init_nodes() {
 }
 
 void CObject::Draw_nodes(VkCommandBuffer cmd) {
-    commandBuffer = cmd;
-    recurse( [&](CObject& node){ node.Draw(); } );
+    recurse( [&](CObject& node){ node.Draw(cmd); } );
 }
 
 //-------------------------------------------------------------------
@@ -55,19 +55,19 @@ void CBox::Bind() {
     shader.UpdateDescriptorSets(descriptorSets);
 }
 
-void CBox::Draw() {
+void CBox::Draw(VkCommandBuffer cmd) {
     Bind();
-    pipeline->Bind(commandBuffer, descriptorSets);
+    pipeline->Bind(cmd, descriptorSets);
 
     // Geometry
-    vkCmdBindVertexBuffer(commandBuffer, vbo);
-    vkCmdBindIndexBuffer (commandBuffer, ibo, 0, VK_INDEX_TYPE_UINT32);
-    vkCmdDrawIndexed     (commandBuffer, ibo.Count(), 1, 0, 0, 0);
+    vkCmdBindVertexBuffer(cmd, vbo);
+    vkCmdBindIndexBuffer (cmd, ibo, 0, VK_INDEX_TYPE_UINT32);
+    vkCmdDrawIndexed     (cmd, ibo.Count(), 1, 0, 0, 0);
 }
 
 //--------------------------------------------------------------------
 
-void CSkybox::Draw() {
+void CSkybox::Draw(VkCommandBuffer cmd) {
     //float farplane = cam_uniform.proj.m23 / (cam_uniform.proj.m22 + 1.0);
     //worldMatrix.Clear();
     //worldMatrix.Scale(farplane/sqrtf(3));
@@ -75,7 +75,7 @@ void CSkybox::Draw() {
 
     vec4 cam_pos = cam_uniform.viewInverse.row.position4;
     worldMatrix.row.position4 = cam_pos; // center on camera location
-    CBox::Draw();
+    CBox::Draw(cmd);
 }
 
 //----------------------------------------------------------------------
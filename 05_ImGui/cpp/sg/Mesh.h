@@ -25,7 +25,7 @@ public:
 
     CMesh(const char* name="mesh") : CObject(name) { type = "Mesh"; hitGroup = 1; }
     void Init();
-    void Draw();
+    void Draw(VkCommandBuffer cmd);
 };
 //------------------------------------------------------------
 //----------------------------QUAD----------------------------
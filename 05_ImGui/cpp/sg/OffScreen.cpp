@@ -22,13 +22,11 @@ void OffScreen::Init(CQueue& queue) {
 
     //--- Pipelines ---
     pbr_pipeline.Init(renderpass, 0);
-    pbr_pipeline.shader.MaxDescriptorSets(32);
     pbr_pipeline.shader.LoadVertShader("shaders/spirv/pbr_vert.spv");
     pbr_pipeline.shader.LoadFragShader("shaders/spirv/pbr_frag.spv");
     pbr_pipeline.CreateGraphicsPipeline();
 
     sky_pipeline.Init(renderpass, 0);
-    sky_pipeline.shader.MaxDescriptorSets(3);
     sky_pipeline.shader.LoadVertShader("shaders/spirv/sky_vert.spv");
     sky_pipeline.shader.LoadFragShader("shaders/spirv/sky_frag.spv");
     sky_pipeline.depthStencilState.depthWriteEnable = VK_FALSE;          // Skybox does not modify depth
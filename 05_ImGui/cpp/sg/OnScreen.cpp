@@ -51,13 +51,11 @@ void OnScreen::Init(CQueue& present_queue, CQueue& graphics_queue, VkSurfaceKHR
 
     //--- Pipelines ---
     pbr_pipeline.Init(renderpass, 0);
-    pbr_pipeline.shader.MaxDescriptorSets(32);
     pbr_pipeline.shader.LoadVertShader("shaders/spirv/pbr_vert.spv");
     pbr_pipeline.shader.LoadFragShader("shaders/spirv/pbr_frag.spv");
     pbr_pipeline.CreateGraphicsPipeline();
 
     sky_pipeline.Init(renderpass, 0);
-    sky_pipeline.shader.MaxDescriptorSets(3);
     sky_pipeline.shader.LoadVertShader("shaders/spirv/sky_vert.spv");
     sky_pipeline.shader.LoadFragShader("shaders/spirv/sky_frag.spv");
     sky_pipeline.depthStencilState.depthWriteEnable = VK_FALSE;          // Skybox does not modify depth
@@ -69,7 +67,6 @@ void OnScreen::Init(CQueue& present_queue, CQueue& graphics_queue, VkSurfaceKHR
     //---- Subpass 1 ----
     printf("\nSubpass 1:\n");
     pipeline_sub1.Init(renderpass, 1);
-    pipeline_sub1.shader.MaxDescriptorSets(4);
     pipeline_sub1.shader.LoadVertShader("shaders/spirv/sub1_vert.spv");
     pipeline_sub1.shader.LoadFragShader("shaders/spirv/sub1_frag.spv");
     pipeline_sub1.CreateGraphicsPipeline();
@@ -4,6 +4,7 @@
 #include "CDevices.h"
 #include "Swapchain.h"
 #include "CRenderpass.h"
+#include "PipelineCache.h"
 #include "vkWindow.h"
 
 #include "imgui.h"
@@ -56,6 +57,7 @@ public:
         init_info.QueueFamily    = graphics_queue.family;
         init_info.Queue          = graphics_queue.queue;
         init_info.DescriptorPool = descriptorPool;
+        init_info.PipelineCache  = DefaultPipelineCache();
         init_info.Subpass        = 1;
         init_info.RenderPass     = renderpass;
         init_info.MinImageCount  = swapchain.surface_caps.minImageCount;  //2
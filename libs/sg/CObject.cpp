@@ -7,8 +7,9 @@ struct UseUTF8{UseUTF8(){SetConsoleOutputCP(CP_UTF8);}}utf8;
 #endif
 
 
-VkCommandBuffer CObject::commandBuffer = 0;
 CamUniform CObject::cam_uniform {};
+RenderQueue CObject::render_queue;
+BindlessTable* CObject::bindless = 0;
 
 //---CObject---
 void CObject::Transform() {
@@ -58,8 +59,17 @@ void CObject::Init_nodes() {
 }
 
 void CObject::Draw_nodes(VkCommandBuffer cmd) {
-    commandBuffer = cmd;
+    render_queue.Clear();
     recurse( [&](CObject& node){ node.Draw(); } );
+    render_queue.Submit(cmd);
+}
+
+// The renderpass must be begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.
+// setup() records the dynamic state (viewport, scissor) into each secondary buffer.
+void CObject::Draw_nodes(FBO& fbo, std::function<void(VkCommandBuffer cmd)> setup) {
+    render_queue.Clear();
+    recurse( [&](CObject& node){ node.Draw(); } );  // (single-threaded: updates UBOs and descriptor sets)
+    render_queue.Submit(fbo, setup);
 }
 
 //-------------------------------------------------------------------
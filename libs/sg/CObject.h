@@ -6,6 +6,7 @@
 #include "matrix.h"
 #include "CNode.h"
 #include "vkray.h"
+#include "RenderQueue.h"
 
 #define DOUBLE_PRECISION
 
@@ -34,8 +35,9 @@ public:
     bool visible = true;
     int hitGroup = -1;  // 0=miss 1=hit
 
-    static VkCommandBuffer commandBuffer;
     static CamUniform cam_uniform;
+    static RenderQueue render_queue;  // Draw() adds packets here. Draw_nodes sorts and submits them.
+    static BindlessTable* bindless;   // optional: global texture/material table (set before loading the scene)
 
     CObject() {}
     CObject(const char* name) : name(name) {}
@@ -63,7 +65,8 @@ public:
     void Visible_nodes(bool flag);                 // show/hide all nodes in branch
     void Transform_nodes();                        // transform all nodes in branch
     void Init_nodes();
-    void Draw_nodes(VkCommandBuffer cmd);
+    void Draw_nodes(VkCommandBuffer cmd);          // draw all nodes in branch, via render_queue
+    void Draw_nodes(FBO& fbo, std::function<void(VkCommandBuffer cmd)> setup);  // same, but recorded on the FBO's worker threads
     void Print();
     //------------------------------
 };
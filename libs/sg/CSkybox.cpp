@@ -49,20 +49,22 @@ void CBox::Bind() {
     // Update UBO
     ubo_data.matrix = worldMatrix;
     ubo.Set(&ubo_data, sizeof(ubo_data));
-    shader.Bind("model", ubo);
 
-    if(cubemap) shader.Bind("tex_cubemap", cubemap);
-    shader.UpdateDescriptorSets(descriptorSets);
+    if(slots.pipeline != pipeline) {  // resolve binding names to slots (once)
+        slots.pipeline = pipeline;
+        slots.model    = shader.Slot("model");
+        slots.cubemap  = shader.Slot("tex_cubemap");
+        if(slots.model<0) LOGE("CBox: '%s' pipeline has no \"model\" binding.\n", name.c_str());
+    }
+    shader.Bind(slots.model, ubo);
+    if(cubemap && slots.cubemap>=0) shader.Bind(slots.cubemap, cubemap);
+    shader.UpdateDescriptorSets(descriptorSets);  // only writes the descriptor set if a binding changed
 }
 
 void CBox::Draw() {
     Bind();
-    pipeline->Bind(commandBuffer, descriptorSets);
-
-    // Geometry
-    vkCmdBindVertexBuffer(commandBuffer, vbo);
-    vkCmdBindIndexBuffer (commandBuffer, ibo, 0, VK_INDEX_TYPE_UINT32);
-    vkCmdDrawIndexed     (commandBuffer, ibo.Count(), 1, 0, 0, 0);
+    float depth = -(cam_uniform.view * ubo_data.matrix.position()).z;  // view-space distance
+    render_queue.Add(pipeline, descriptorSets, vbo, ibo, cubemap, depth);
 }
 
 //--------------------------------------------------------------------
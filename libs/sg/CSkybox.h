@@ -17,6 +17,10 @@ protected:
     UBO ubo;
     VBO vbo;
     IBO ibo;
+    struct {                                   // shader binding slots, resolved once per pipeline
+        CPipeline* pipeline = 0;
+        int model, cubemap;
+    } slots;
     void Bind();
 public:
     CPipeline* pipeline=0;
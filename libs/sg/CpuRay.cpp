@@ -0,0 +1,510 @@
+#include "CpuRay.h"
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+#undef repeat
+#define repeat(COUNT) for(uint32_t i = 0; i < (COUNT); ++i)
+
+static const float pi2 = pi * 2.f;
+
+//---------------------------------helpers--------------------------------
+static vec3 vmin(const vec3& a, const vec3& b) { return {std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z)}; }
+static vec3 vmax(const vec3& a, const vec3& b) { return {std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z)}; }
+static vec3 vmin(const vec3& a, float f) { return {std::min(a.x, f), std::min(a.y, f), std::min(a.z, f)}; }
+static vec3 mix (const vec3& a, const vec3& b, float f) { return a + (b - a) * f; }
+static vec3 rgb (const vec4& v) { return {v.x, v.y, v.z}; }
+
+static vec3 rotate(const mat4& m, const vec3& v) {  // mat3(m) * v
+    return { m.m00*v.x + m.m01*v.y + m.m02*v.z,
+             m.m10*v.x + m.m11*v.y + m.m12*v.z,
+             m.m20*v.x + m.m21*v.y + m.m22*v.z };
+}
+
+struct mat3 {  // tangent space (columns)
+    vec3 x, y, z;
+    vec3 operator * (const vec3& v) const { return x*v.x + y*v.y + z*v.z; }
+};
+
+static mat3 look(vec3 v, vec3 up) {  // same as utils.glsl
+    vec3 zAxis = v.normalized();
+    vec3 xAxis = up.cross(zAxis);
+    xAxis = (xAxis.length() < 0.001f) ? vec3(1,0,0) : xAxis.normalized();
+    vec3 yAxis = zAxis.cross(xAxis).normalized();
+    return {xAxis, yAxis, zAxis};
+}
+
+static vec3 unpack_normal(uint32_t npack) {  // inverse of Pack32 (A2B10G10R10_SNORM)
+    int x = (int)(npack << 2 ) >> 22;
+    int y = (int)(npack << 12) >> 22;
+    int z = (int)(npack << 22) >> 22;
+    vec3 n((float)x, (float)y, (float)z);
+    float len = n.length();
+    return (len > 0) ? n / len : vec3(0,0,1);
+}
+
+static bool SlabTest(const BVHNode& node, const vec3& org, const vec3& inv, float tmin, float tmax) {
+    float tx0 = (node.bmin.x - org.x) * inv.x,  tx1 = (node.bmax.x - org.x) * inv.x;
+    float ty0 = (node.bmin.y - org.y) * inv.y,  ty1 = (node.bmax.y - org.y) * inv.y;
+    float tz0 = (node.bmin.z - org.z) * inv.z,  tz1 = (node.bmax.z - org.z) * inv.z;
+    float t0 = std::max({std::min(tx0, tx1), std::min(ty0, ty1), std::min(tz0, tz1), tmin});
+    float t1 = std::min({std::max(tx0, tx1), std::max(ty0, ty1), std::max(tz0, tz1), tmax});
+    return t0 <= t1;
+}
+//------------------------------------------------------------------------
+
+//---------------------------------Random---------------------------------
+struct CpuRay::Rand {  // pcg_hash, as in utils.glsl
+    uint32_t seed;
+    uint64_t rays = 0;  // rays traced by this worker
+    Rand(uint32_t s) : seed(s) {}
+    float operator()() {
+        seed = seed * 747796405u + 2891336453u;
+        uint32_t word = ((seed >> ((seed >> 28u) + 4u)) ^ seed) * 277803737u;
+        return (float)((word >> 22u) ^ word) / 4294967295.f;  // range 0 to 1
+    }
+    float s() { return (*this)() * 2.f - 1.f; }               // range -1 to 1
+    vec3 sphere() {                                           // uniformly distributed point on 3d sphere
+        float z = s();
+        float a = (*this)() * pi2;
+        float r = sqrtf(std::max(0.f, 1.f - z*z));
+        return {cosf(a) * r, sinf(a) * r, z};
+    }
+    vec3 diffuse(float pfrac) {  // see Diffuse() in raytrace.rchit
+        float pitch = asinf(sqrtf(pfrac));
+        float head  = (*this)() * pi2;
+        float sp = sinf(pitch);
+        return {sp * cosf(head), -sp * sinf(head), cosf(pitch)};
+    }
+};
+//------------------------------------------------------------------------
+
+//--------------------------------CpuMesh---------------------------------
+void CpuMesh::BuildBVH() {
+    uint32_t tri_cnt = (uint32_t)index.size() / 3;
+    std::vector<vec3> centroids(tri_cnt);
+    tris.resize(tri_cnt);
+    repeat(tri_cnt) {
+        tris[i] = i;
+        centroids[i] = (verts[index[i*3+0]].pos + verts[index[i*3+1]].pos + verts[index[i*3+2]].pos) / 3.f;
+    }
+    nodes.clear();
+    nodes.reserve(tri_cnt * 2);
+    nodes.push_back({{}, 0, {}, tri_cnt});
+    Split(0, centroids);
+}
+
+void CpuMesh::Split(uint32_t inx, std::vector<vec3>& centroids) {
+    const uint32_t LEAF_SIZE = 4;
+    BVHNode node = nodes[inx];
+
+    // bounds
+    vec3 bmin( 1e30f, 1e30f, 1e30f), cmin = bmin;
+    vec3 bmax(-1e30f,-1e30f,-1e30f), cmax = bmax;
+    for(uint32_t i = node.first; i < node.first + node.count; ++i) {
+        uint32_t t = tris[i];
+        repeat(3) { vec3& p = verts[index[t*3+i]].pos;  bmin = vmin(bmin, p);  bmax = vmax(bmax, p); }
+        cmin = vmin(cmin, centroids[t]);
+        cmax = vmax(cmax, centroids[t]);
+    }
+    nodes[inx].bmin = bmin;
+    nodes[inx].bmax = bmax;
+    if(node.count <= LEAF_SIZE) return;
+
+    // split at the median centroid, along the longest axis
+    vec3 ext = cmax - cmin;
+    int axis = (ext.x > ext.y && ext.x > ext.z) ? 0 : (ext.y > ext.z) ? 1 : 2;
+    if(((float*)ext)[axis] <= 0) return;  // all centroids coincide: keep as leaf
+    auto first = tris.begin() + node.first;
+    auto mid   = first + node.count / 2;
+    std::nth_element(first, mid, first + node.count, [&](uint32_t a, uint32_t b) {
+        return ((float*)centroids[a])[axis] < ((float*)centroids[b])[axis];
+    });
+
+    uint32_t left_cnt = node.count / 2;
+    uint32_t child = (uint32_t)nodes.size();
+    nodes.push_back({{}, node.first,            {}, left_cnt             });
+    nodes.push_back({{}, node.first + left_cnt, {}, node.count - left_cnt});
+    nodes[inx].first = child;
+    nodes[inx].count = 0;
+    Split(child + 0, centroids);
+    Split(child + 1, centroids);
+}
+
+bool CpuMesh::Intersect(vec3 world_org, vec3 world_dir, float tmin, CpuHit& hit, bool any_hit) const {
+    if(nodes.empty()) return false;
+    vec3 org = inverse * world_org;            // object-space ray
+    vec3 dir = rotate(inverse, world_dir);     // (not normalized, so t stays in world units)
+    vec3 inv(1.f / dir.x, 1.f / dir.y, 1.f / dir.z);
+
+    bool found = false;
+    uint32_t stack[64];
+    uint32_t sp = 0;
+    stack[sp++] = 0;
+    while(sp) {
+        const BVHNode& node = nodes[stack[--sp]];
+        if(!SlabTest(node, org, inv, tmin, hit.t)) continue;
+        if(node.count == 0) {
+            stack[sp++] = node.first;
+            stack[sp++] = node.first + 1;
+            continue;
+        }
+        for(uint32_t i = node.first; i < node.first + node.count; ++i) {  // Moller-Trumbore
+            uint32_t t = tris[i];
+            const vec3& v0 = verts[index[t*3+0]].pos;
+            vec3 e1 = verts[index[t*3+1]].pos - v0;
+            vec3 e2 = verts[index[t*3+2]].pos - v0;
+            vec3 p = dir.cross(e2);
+            float det = e1.dot(p);
+            if(fabsf(det) < 1e-12f) continue;  // no backface culling (FACING_CULL_DISABLE)
+            float idet = 1.f / det;
+            vec3 s = org - v0;
+            float u = s.dot(p) * idet;
+            if(u < 0.f || u > 1.f) continue;
+            vec3 q = s.cross(e1);
+            float v = dir.dot(q) * idet;
+            if(v < 0.f || u + v > 1.f) continue;
+            float d = e2.dot(q) * idet;
+            if(d < tmin || d >= hit.t) continue;
+            hit.t    = d;
+            hit.prim = t;
+            hit.bary = {u, v};
+            found = true;
+            if(any_hit) return true;
+        }
+    }
+    return found;
+}
+//------------------------------------------------------------------------
+
+//---------------------------------CpuRay---------------------------------
+void CpuRay::Clear() {
+    meshes.clear();
+    textures.clear();
+    for(auto& f : sky)      f.SetSize(0, 0);
+    for(auto& f : sky_blur) f.SetSize(0, 0);
+}
+
+void CpuRay::Init(VKRay& vkray, CCubemap& skybox) {
+    Clear();
+    Timer timer;
+    CAllocator& allocator = *default_allocator;
+
+    //--- Meshes ---
+    MeshList& mesh_list = vkray.blas.mesh_list;
+    meshes.resize(mesh_list.size());
+    std::vector<bool> used(vkray.Images().size(), false);
+    repeat((uint32_t)mesh_list.size()) {
+        const MeshObject& obj = mesh_list[i];
+        CpuMesh& mesh = meshes[i];
+
+        // vertices (packed or unpacked)
+        std::vector<char> vbuf((size_t)obj.vertexCount * obj.vertexStride);
+        allocator.ReadBuffer(obj.vertexBuffer, vbuf.size(), vbuf.data(), obj.vertexOffset);
+        mesh.verts.resize(obj.vertexCount);
+        struct VertPack {vec3 pos; uint32_t npack; vec2 tc;};
+        for(uint32_t v = 0; v < obj.vertexCount; ++v) {
+            char* src = &vbuf[(size_t)v * obj.vertexStride];
+            if(obj.vertexStride == sizeof(VertPack)) {
+                VertPack& p = *(VertPack*)src;
+                mesh.verts[v] = {p.pos, unpack_normal(p.npack), p.tc};
+            } else {
+                mesh.verts[v] = *(Vertex*)src;
+            }
+        }
+
+        // indices
+        mesh.index.resize(obj.indexCount);
+        allocator.ReadBuffer(obj.indexBuffer, obj.indexCount * sizeof(uint32_t), mesh.index.data(), obj.indexOffset);
+
+        // material
+        mesh.ubo = (const uboData&)vkray.scene.Model(i);  // (set by AddToBLAS)
+        for(int id : mesh.ubo.texid) if(id >= 0 && id < (int)used.size()) used[id] = true;
+
+        mesh.matrix  = mesh.ubo.matrix;
+        mesh.inverse = mesh.matrix.Inverse();
+        mesh.BuildBVH();
+    }
+
+    //--- Textures (only those referenced by materials) ---
+    textures.resize(vkray.Images().size());
+    repeat((uint32_t)textures.size()) {
+        if(!used[i]) continue;
+        CImage img = vkray.Images()[i]->Read();
+        textures[i] = CImage32f(img);  // to linear
+    }
+
+    //--- Skybox ---
+    repeat(6) {
+        CImage32f& face = skybox.face[i];
+        sky[i].SetSize(face.Width(), face.Height());
+        memcpy(sky[i].Buffer(), face.Buffer(), (size_t)face.Width() * face.Height() * sizeof(RGBA32f));
+        sky_blur[i] = face.Mipmap();
+        while(sky_blur[i].Width() > 8) sky_blur[i] = sky_blur[i].Mipmap();  // same as textureLod(levels-4)
+    }
+
+    LOGI("CpuRay: %d meshes, %d textures loaded in %.3fs\n", (int)meshes.size(), (int)textures.size(), timer.Span());
+}
+
+void CpuRay::Update(TLAS& tlas) {
+    uint32_t cnt = std::min((uint32_t)meshes.size(), tlas.count());
+    repeat(cnt) {
+        const VkTransformMatrixKHR& t = tlas[i].transform;  // 3x4 row-major
+        CpuMesh& mesh = meshes[i];
+        mat4& m = mesh.matrix;
+        m.m00 = t.matrix[0][0];  m.m01 = t.matrix[0][1];  m.m02 = t.matrix[0][2];  m.m03 = t.matrix[0][3];
+        m.m10 = t.matrix[1][0];  m.m11 = t.matrix[1][1];  m.m12 = t.matrix[1][2];  m.m13 = t.matrix[1][3];
+        m.m20 = t.matrix[2][0];  m.m21 = t.matrix[2][1];  m.m22 = t.matrix[2][2];  m.m23 = t.matrix[2][3];
+        m.m30 = 0;               m.m31 = 0;               m.m32 = 0;               m.m33 = 1;
+        mesh.inverse = m.Inverse();
+        mesh.visible = (tlas[i].mask != 0);
+    }
+}
+
+//--- Sampling ---
+vec4 CpuRay::Texture4(int id, vec2 tc) const {  // bilinear, wrap=repeat  (same memory layout as the GPU image)
+    const CImage32f& img = textures[id];
+    int w = img.Width();
+    int h = img.Height();
+    if(!w || !h) return {1,1,1,1};
+    float fx = tc.x * w - 0.5f;
+    float fy = tc.y * h - 0.5f;
+    float ix = floorf(fx);
+    float iy = floorf(fy);
+    fx -= ix;
+    fy -= iy;
+    auto wrap = [](int v, int n) { v %= n; return v < 0 ? v + n : v; };
+    int x0 = wrap((int)ix, w), x1 = wrap((int)ix + 1, w);
+    int y0 = wrap((int)iy, h), y1 = wrap((int)iy + 1, h);
+    const RGBA32f* buf = img.Buffer();
+    RGBA32f a = buf[x0 + y0*w], b = buf[x1 + y0*w];
+    RGBA32f c = buf[x0 + y1*w], d = buf[x1 + y1*w];
+    RGBA32f ab = a + (b - a) * fx;  ab.A = a.A + (b.A - a.A) * fx;
+    RGBA32f cd = c + (d - c) * fx;  cd.A = c.A + (d.A - c.A) * fx;
+    RGBA32f p  = ab + (cd - ab) * fy;
+    return {p.R, p.G, p.B, ab.A + (cd.A - ab.A) * fy};
+}
+
+vec3 CpuRay::Texture(int id, vec2 tc, vec3 fallback) const {
+    if(id < 0 || id >= (int)textures.size()) return fallback;
+    return rgb(Texture4(id, tc));
+}
+
+vec3 CpuRay::Sky(vec3 dir, bool blur) const {  // cubemap lookup (Vulkan face selection rules)
+    const CImage32f* faces = blur ? sky_blur : sky;
+    float ax = fabsf(dir.x), ay = fabsf(dir.y), az = fabsf(dir.z);
+    int face;  float sc, tc, ma;
+    if(ax >= ay && ax >= az) { ma = ax;  face = dir.x > 0 ? 0 : 1;  sc = dir.x > 0 ? -dir.z : dir.z;  tc = -dir.y; }
+    else if(ay >= az)        { ma = ay;  face = dir.y > 0 ? 2 : 3;  sc = dir.x;  tc = dir.y > 0 ? dir.z : -dir.z; }
+    else                     { ma = az;  face = dir.z > 0 ? 4 : 5;  sc = dir.z > 0 ? dir.x : -dir.x;  tc = -dir.y; }
+    const CImage32f& img = faces[face];
+    int w = img.Width();
+    int h = img.Height();
+    if(!w || !h || ma <= 0) return {0,0,0};
+    float fx = (sc / ma * 0.5f + 0.5f) * w - 0.5f;
+    float fy = (tc / ma * 0.5f + 0.5f) * h - 0.5f;
+    fx = std::min(std::max(fx, 0.f), w - 1.f);
+    fy = std::min(std::max(fy, 0.f), h - 1.f);
+    int x0 = (int)fx, x1 = std::min(x0 + 1, w - 1);
+    int y0 = (int)fy, y1 = std::min(y0 + 1, h - 1);
+    fx -= x0;
+    fy -= y0;
+    const RGBA32f* buf = img.Buffer();
+    RGBA32f ab = buf[x0 + y0*w] + (buf[x1 + y0*w] - buf[x0 + y0*w]) * fx;
+    RGBA32f cd = buf[x0 + y1*w] + (buf[x1 + y1*w] - buf[x0 + y1*w]) * fx;
+    RGBA32f p  = ab + (cd - ab) * fy;
+    return {p.R, p.G, p.B};
+}
+
+//--- Tracing ---
+bool CpuRay::Trace(vec3 org, vec3 dir, float tmin, float tmax, CpuHit& hit, bool any_hit) const {
+    hit.t    = tmax;
+    hit.mesh = -1;
+    repeat((uint32_t)meshes.size()) {
+        const CpuMesh& mesh = meshes[i];
+        if(!mesh.visible) continue;
+        if(mesh.Intersect(org, dir, tmin, hit, any_hit)) {
+            hit.mesh = (int)i;
+            if(any_hit) return true;
+        }
+    }
+    return hit.mesh >= 0;
+}
+
+vec3 CpuRay::TraceSecondary(vec3 org, vec3 dir, bool blur) const {  // hit group 1 / miss shader 0 or 1
+    CpuHit hit;
+    if(Trace(org, dir, 0.001f, 1000.f, hit)) return ShadeSecondary(hit);
+    return Sky(dir, blur);
+}
+
+vec3 CpuRay::ShadeSecondary(const CpuHit& hit) const {  // raytrace_2.rchit
+    const CpuMesh& mesh = meshes[hit.mesh];
+    const uboData& ubo  = mesh.ubo;
+    const Vertex* v[3] = {&mesh.verts[mesh.index[hit.prim*3+0]], &mesh.verts[mesh.index[hit.prim*3+1]], &mesh.verts[mesh.index[hit.prim*3+2]]};
+    vec3 bary(1.f - hit.bary.x - hit.bary.y, hit.bary.x, hit.bary.y);
+    vec2 tc = v[0]->tc * bary.x + v[1]->tc * bary.y + v[2]->tc * bary.z;
+    vec3 albedo   = rgb(ubo.color[0]) * Texture(ubo.texid[0], tc);
+    vec3 emission = rgb(ubo.color[1]) * Texture(ubo.texid[1], tc);
+    return albedo * 0.01f + emission;
+}
+
+vec3 CpuRay::ShadePrimary(const CpuHit& hit, vec3 ray_dir, const LightUniform& light, Rand& rnd) const {  // raytrace.rchit
+    const CpuMesh& mesh = meshes[hit.mesh];
+    const uboData& ubo  = mesh.ubo;
+    const mat4& m = mesh.matrix;
+    const Vertex* v[3] = {&mesh.verts[mesh.index[hit.prim*3+0]], &mesh.verts[mesh.index[hit.prim*3+1]], &mesh.verts[mesh.index[hit.prim*3+2]]};
+    vec3 bary(1.f - hit.bary.x - hit.bary.y, hit.bary.x, hit.bary.y);
+    vec3 normal = (v[0]->nrm * bary.x + v[1]->nrm * bary.y + v[2]->nrm * bary.z).normalized();
+    vec2 tc     =  v[0]->tc  * bary.x + v[1]->tc  * bary.y + v[2]->tc  * bary.z;
+    vec3 hitpos =  v[0]->pos * bary.x + v[1]->pos * bary.y + v[2]->pos * bary.z;
+
+    //---- Textures ----
+    vec3 albedo   = rgb(ubo.color[0]) * Texture(ubo.texid[0], tc);
+    vec3 emission = rgb(ubo.color[1]) * Texture(ubo.texid[1], tc);
+    vec3 orm      = rgb(ubo.color[3]) * Texture(ubo.texid[3], tc);
+    float roughness = orm.y * orm.y;
+    float metalness = orm.z;
+    //------------------
+
+    vec3 world_hitpos = m * hitpos;
+    vec3 world_normal = rotate(m, normal).normalized();
+    vec3 up = rotate(m, vec3(0,1,0));
+
+    //---- Normal Map ----
+    if(ubo.texid[2] >= 0) {
+        vec3 normap = Texture(ubo.texid[2], tc);
+        vec3 normalvec = (normap * 2.f - vec3(1,1,1)).normalized();
+        world_normal = (look(world_normal, up) * normalvec).normalized();
+    }
+    mat3 tangent_space = look(world_normal, up);
+    //--------------------
+
+    const float tmin = 0.001f;
+    const float tmax = 1000.f;
+    vec3 origin = world_hitpos + world_normal * tmin;
+
+    //---- Specular ----
+    vec3 specular_light(0,0,0);
+    vec3 reflect_vec = ray_dir.reflect(world_normal);
+    if(roughness < 0.02f) {  // for smooth surfaces, use only one specular ray
+        specular_light = TraceSecondary(origin, reflect_vec, false);
+        rnd.rays++;
+    } else if(spec_rays) {
+        repeat(spec_rays) {
+            float pfrac = float(i+1) / (spec_rays+2);
+            vec3 diffuse_vec  = tangent_space * rnd.diffuse(pfrac);
+            vec3 specular_vec = mix(reflect_vec, diffuse_vec, roughness);
+            specular_light += vmin(TraceSecondary(origin, specular_vec, false), 16.f);  // reduce fireflies
+        }
+        specular_light /= (float)spec_rays;
+        rnd.rays += spec_rays;
+    }
+    //------------------
+
+    //---- Diffuse ----
+    vec3 diffuse_light(0,0,0);
+    repeat(dif_rays) {
+        float pfrac = float(i+1) / (dif_rays+2);
+        vec3 diffuse_vec = tangent_space * rnd.diffuse(pfrac);
+        diffuse_light += vmin(TraceSecondary(origin, diffuse_vec, true), 8.f);  // reduce fireflies
+    }
+    if(dif_rays) diffuse_light /= (float)dif_rays;
+    rnd.rays += dif_rays;
+    //-----------------
+
+    //---- Light + Shadow ----
+    vec3 light_vec = rgb(light.position).normalized();
+    light_vec += rnd.sphere() * sinf(0.57f * toRad);  // jitter by sun solid angle
+    vec3 illum(0.02f, 0.02f, 0.02f);                  // ambient light
+    float dotp = light_vec.dot(world_normal);
+    if(dotp > 0) {
+        CpuHit shadow;
+        rnd.rays++;
+        if(!Trace(origin, light_vec, tmin, tmax, shadow, true)) illum += rgb(light.color) * dotp;
+    }
+    diffuse_light = (diffuse_light * (float)dif_rays + illum) / (float)(dif_rays + 1);
+    //-----------------------
+
+    //---- Fresnel ----
+    float cosTheta = ray_dir.dot(-world_normal);
+    float fresnel = powf(std::max(0.f, 1.f - cosTheta), 5.f);
+    float kS = 0.04f;
+    float kD = 1.f - kS;
+    kS += kD * fresnel;
+    //-----------------
+
+    vec3 white(1,1,1);
+    vec3 metal     = mix(albedo, white, fresnel) * specular_light;
+    vec3 non_metal = mix(albedo * diffuse_light, specular_light, kS);
+    return mix(non_metal, metal, metalness) + emission;
+}
+
+//--- Render ---
+uint64_t CpuRay::RenderTile(uint32_t tile, const CamUniform& cam, const LightUniform& light, CImage32f& target) {
+    uint32_t w = target.Width();
+    uint32_t h = target.Height();
+    uint32_t tiles_x = (w + tile_size - 1) / tile_size;
+    uint32_t x0 = (tile % tiles_x) * tile_size;
+    uint32_t y0 = (tile / tiles_x) * tile_size;
+    uint32_t x1 = std::min(x0 + tile_size, w);
+    uint32_t y1 = std::min(y0 + tile_size, h);
+
+    const mat4& proj = cam.proj;
+    float tmin = proj.m23 / (proj.m22 - 1.f);  // nearplane
+    float tmax = proj.m23 / (proj.m22 + 1.f);  // farplane
+    vec3 origin = cam.viewInverse.row.position4;
+    uint32_t AA = std::max(aa, 1u);
+    float step = 1.f / (AA + 1);
+
+    Rand rnd(cam.random ^ (tile * 2654435761u));
+    RGBA32f* buf = target.Buffer();
+    for(uint32_t y = y0; y < y1; ++y) {
+        for(uint32_t x = x0; x < x1; ++x) {
+            vec3 color(0,0,0);
+            for(uint32_t sy = 1; sy <= AA; ++sy) {
+                for(uint32_t sx = 1; sx <= AA; ++sx) {
+                    float dx = (x + step * sx) / w * 2.f - 1.f;
+                    float dy = (y + step * sy) / h * 2.f - 1.f;
+                    vec4 t4 = cam.projInverse * vec4(dx, dy, 1, 1);
+                    vec3 dir = rotate(cam.viewInverse, vec3(t4.x, t4.y, t4.z).normalized());
+                    CpuHit hit;
+                    rnd.rays++;
+                    if(Trace(origin, dir, tmin, tmax, hit)) color += ShadePrimary(hit, dir, light, rnd);
+                    else                                    color += Sky(dir, false);
+                }
+            }
+            color /= (float)(AA * AA);
+            buf[x + y * w] = RGBA32f(color.x, color.y, color.z, 1.f);
+        }
+    }
+    return rnd.rays;
+}
+
+void CpuRay::Render(const CamUniform& cam, const LightUniform& light, CImage32f& target) {
+    Timer timer;
+    uint32_t w = target.Width();
+    uint32_t h = target.Height();
+    if(!w || !h) return;
+    tile_size = std::max(tile_size, 1u);  // (0 would divide by zero)
+    uint32_t tiles_x = (w + tile_size - 1) / tile_size;
+    uint32_t tiles_y = (h + tile_size - 1) / tile_size;
+    uint32_t tile_cnt = tiles_x * tiles_y;
+
+    uint32_t thread_cnt = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+    std::atomic<uint32_t> next_tile{0};
+    std::atomic<uint64_t> rays{0};
+    auto worker = [&]() {
+        uint64_t cnt = 0;
+        uint32_t tile;
+        while((tile = next_tile++) < tile_cnt) cnt += RenderTile(tile, cam, light, target);  // grab the next free tile
+        rays += cnt;
+    };
+    std::vector<std::thread> pool;
+    repeat(thread_cnt - 1) pool.emplace_back(worker);
+    worker();  // this thread works too
+    for(auto& t : pool) t.join();
+
+    ray_count   = rays;
+    render_time = timer.Span();
+}
+//------------------------------------------------------------------------
@@ -0,0 +1,94 @@
+// CpuRay
+// Multi-threaded CPU path tracer. Fallback for GPUs without VK_KHR_ray_tracing_pipeline.
+//
+// Consumes the same scene inputs as VKRay: the MeshObject list, the uboData materials (with texid),
+// the TLAS instance list, CamUniform, LightUniform and the skybox cubemap.
+// Geometry and textures are read back from the GPU once, in Init(). Materials come from the scene table's host copy.
+// Each mesh gets its own BVH (like a BLAS), and the image is split into tiles,
+// which worker threads claim from a shared atomic counter, until all tiles are done.
+// Shading mirrors raytrace.rgen / raytrace.rchit / raytrace_2.rchit and the miss shaders.
+//
+// Usage:
+//   CpuRay cpu;
+//   cpu.Init(vkray, cubemap);                      // after AddToBLAS and tlas.AddInstances
+//   cpu.Update(vkray.tlas);                        // per frame: pick up instance transforms
+//   cpu.Render(cam_uniform, light_uniform, image); // render into a CImage32f
+
+#ifndef CPURAY_H
+#define CPURAY_H
+
+#include <vector>
+#include "CImage.h"
+#include "Material.h"
+#include "CObject.h"
+#include "Light.h"
+
+//----------------------------------BVH-----------------------------------
+struct BVHNode {
+    vec3     bmin;
+    uint32_t first;  // inner node: index of left child (right = first+1).  leaf: first triangle
+    vec3     bmax;
+    uint32_t count;  // triangle count (0 = inner node)
+};
+
+struct CpuHit {
+    float    t    = 0;
+    int      mesh = -1;
+    uint32_t prim = 0;
+    vec2     bary = {0, 0};
+};
+
+class CpuMesh {
+    void Split(uint32_t node, std::vector<vec3>& centroids);
+public:
+    std::vector<Vertex>   verts;
+    std::vector<uint32_t> index;     // 3 per triangle
+    std::vector<uint32_t> tris;      // triangle list, sorted by BVH leaf
+    std::vector<BVHNode>  nodes;
+    uboData ubo;                     // material + texid
+    mat4 matrix;                     // world matrix (from TLAS instance)
+    mat4 inverse;
+    bool visible = true;
+
+    void BuildBVH();
+    bool Intersect(vec3 org, vec3 dir, float tmin, CpuHit& hit, bool any_hit) const;  // world-space ray
+};
+//------------------------------------------------------------------------
+
+//---------------------------------CpuRay---------------------------------
+class CpuRay {
+    std::vector<CpuMesh>   meshes;
+    std::vector<CImage32f> textures;  // linear color, indexed by texid
+    CImage32f sky[6];                 // skybox (miss shader 0)
+    CImage32f sky_blur[6];            // low mip of skybox (miss shader 1)
+
+    struct Rand;
+    vec3 Texture(int id, vec2 tc, vec3 fallback = {1,1,1}) const;
+    vec4 Texture4(int id, vec2 tc) const;
+    vec3 Sky(vec3 dir, bool blur) const;
+    bool Trace(vec3 org, vec3 dir, float tmin, float tmax, CpuHit& hit, bool any_hit = false) const;
+    vec3 ShadePrimary  (const CpuHit& hit, vec3 dir, const LightUniform& light, Rand& rnd) const;
+    vec3 ShadeSecondary(const CpuHit& hit) const;
+    vec3 TraceSecondary(vec3 org, vec3 dir, bool blur) const;
+    uint64_t RenderTile(uint32_t tile, const CamUniform& cam, const LightUniform& light, CImage32f& target);
+
+public:
+    uint32_t threads   = 0;   // worker threads (0 = all cores)
+    uint32_t tile_size = 16;  // tile width and height in pixels
+    uint32_t aa        = 2;   // FSAA: aa x aa samples per pixel
+    uint32_t spec_rays = 4;   // specular rays per hit (rough surfaces)
+    uint32_t dif_rays  = 8;   // diffuse rays per hit
+
+    //--- stats (last frame) ---
+    double   render_time = 0;  // seconds
+    uint64_t ray_count   = 0;
+    //--------------------------
+
+    void Init(VKRay& vkray, CCubemap& skybox);  // read back meshes, materials and textures
+    void Update(TLAS& tlas);                    // update instance transforms and visibility
+    void Render(const CamUniform& cam, const LightUniform& light, CImage32f& target);
+    void Clear();
+};
+//------------------------------------------------------------------------
+
+#endif
@@ -65,3 +65,9 @@ void DEM::Build(CImage& img, float zscale) {
     vbo.Data(vertices);  //pack
     ibo.Data(indices);
 }
+
+void DEM::SetHeights(CImage& img, float zscale) {
+    ASSERT(img.Width() == width && img.Height() == height, "DEM: SetHeights needs a %dx%d image.\n", width, height);
+    Build(img, zscale);
+    MarkDirty();
+}
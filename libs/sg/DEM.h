@@ -9,9 +9,10 @@ public:
     uint width  = 0;
     uint height = 0;
 
-    DEM(const char* name="dem") : CMesh(name) {type = "Dem"; }
+    DEM(const char* name="dem") : CMesh(name) {type = "Dem";  deformable = true; }
     void Init(){};
     void Build(CImage& img, float zscale=1);
+    void SetHeights(CImage& img, float zscale=1);  // edit heights (same size): the BLAS is refit, not rebuilt
 };
 //------------------------------------------------------------
 
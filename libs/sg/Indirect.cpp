@@ -0,0 +1,214 @@
+#include "Indirect.h"
+#include <cstring>
+#include <algorithm>
+
+#undef repeat
+#define repeat(COUNT) for(uint32_t i = 0; i < (COUNT); ++i)
+
+struct CullConstants {        // matches "Cull" push constants in cull.comp
+    uint32_t object_count;
+    uint32_t culling;
+    uint32_t compact;
+    uint32_t base;            // first object of this frame's slot
+    uint32_t frame;           // view slot
+};
+
+void IndirectRenderer::Init(CQueue& queue, CRenderpass& renderpass, uint32_t subpass, BindlessTable& table) {
+    device    = queue.device;
+    bindless  = &table;
+    use_count = queue.gpu.features_12.drawIndirectCount;
+    use_multi = queue.gpu.enable_features.multiDrawIndirect;
+    frames    = std::clamp(default_allocator->frames_in_flight, 1u, 3u);
+    if(!use_count) LOGW("IndirectRenderer: drawIndirectCount not supported. Culled objects are still submitted, as empty draws.\n");
+
+    //--- Descriptor set ---
+    VkShaderStageFlags both = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+    std::vector<VkDescriptorSetLayoutBinding> bindings = {
+        {0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, both,                        nullptr},  // objects
+        {1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},  // commands
+        {2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},  // count
+        {3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr}}; // views
+    set_layout = ShaderRegistry::Get().AcquireSetLayout(device, bindings);
+    descriptors.first_pool_sets = 1;
+    descriptors.Init(device, {{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4}});
+    set = descriptors.Allocate(set_layout);
+
+    //--- Cull pipeline ---
+    cull.Init(device);
+    cull.Create("shaders/spirv/cull_comp.spv", {set_layout}, sizeof(CullConstants));
+
+    //--- Draw pipeline ---
+    pipeline.Init(renderpass, subpass);
+    pipeline.shader.LoadVertShader("shaders/spirv/pbr_indirect_vert.spv");
+    pipeline.shader.LoadFragShader("shaders/spirv/pbr_bindless_frag.spv");
+    pipeline.SetBindless(table);          // set 1
+    pipeline.shader.AddSetLayout(set_layout);  // set 2
+    pipeline.CreateGraphicsPipeline();
+}
+
+IndirectRenderer::~IndirectRenderer() {
+    if(set_layout) ShaderRegistry::Get().Release(set_layout);
+}
+
+void IndirectRenderer::Bind(CCamera& camera) {
+    this->camera = &camera;
+    pipeline.shader.Bind("camera", camera.cam_ubo);
+}
+
+void IndirectRenderer::Build(CObject& root) {
+    ASSERT(camera, "IndirectRenderer: Call Bind(camera) before Build.\n");
+    built = true;
+    meshes.clear();
+    objects.clear();
+
+    std::vector<char>     verts;
+    std::vector<uint32_t> index;
+    VkDeviceSize stride = 0;
+    CvkImage* cubemap = 0;
+
+    root.recurse([&](CObject& node) {
+        if(node.hitGroup != 1) return;
+        CMesh& mesh = (CMesh&)node;
+        if(mesh.Vbo().Count()==0 || mesh.Ibo().Count()==0) return;
+        if(!stride) stride = mesh.Vbo().Stride();
+        if(mesh.Vbo().Stride() != stride) { LOGW("IndirectRenderer: Mesh '%s' has a different vertex format. (not pooled)\n", mesh.name.c_str());  return; }
+        if(!cubemap) cubemap = mesh.cubemap;
+
+        //--- vertices ---
+        size_t vtx_start = verts.size();
+        verts.resize(vtx_start + mesh.Vbo().size());
+        default_allocator->ReadBuffer(mesh.Vbo(), mesh.Vbo().size(), &verts[vtx_start]);
+
+        //--- indices ---
+        size_t inx_start = index.size();
+        uint32_t inx_cnt = mesh.Ibo().Count();
+        index.resize(inx_start + inx_cnt);
+        if(mesh.Ibo().Stride() == 4) {
+            default_allocator->ReadBuffer(mesh.Ibo(), mesh.Ibo().size(), &index[inx_start]);
+        } else {  // 16-bit indices
+            std::vector<uint16_t> inx16(inx_cnt);
+            default_allocator->ReadBuffer(mesh.Ibo(), mesh.Ibo().size(), inx16.data());
+            repeat(inx_cnt) index[inx_start + i] = inx16[i];
+        }
+
+        //--- bounding sphere (position is the first vertex attribute) ---
+        uint32_t vtx_cnt = mesh.Vbo().Count();
+        vec3 lo, hi;
+        repeat(vtx_cnt) {
+            vec3 pos;
+            memcpy(&pos, &verts[vtx_start + i * stride], sizeof(vec3));
+            if(i==0) { lo = pos;  hi = pos; }
+            lo = {std::min(lo.x, pos.x), std::min(lo.y, pos.y), std::min(lo.z, pos.z)};
+            hi = {std::max(hi.x, pos.x), std::max(hi.y, pos.y), std::max(hi.z, pos.z)};
+        }
+        vec3 center = (lo + hi) * 0.5f;
+        float radius = 0;
+        repeat(vtx_cnt) {
+            vec3 pos;
+            memcpy(&pos, &verts[vtx_start + i * stride], sizeof(vec3));
+            radius = std::max(radius, (pos - center).length());
+        }
+
+        GpuObject obj;
+        obj.matrix        = mesh.worldMatrix;
+        obj.sphere        = {center.x, center.y, center.z, radius};
+        obj.material      = mesh.material.Register(*bindless, &mesh);
+        obj.index_count   = inx_cnt;
+        obj.first_index   = (uint32_t)inx_start;
+        obj.vertex_offset = (int32_t)(vtx_start / stride);
+        objects.push_back(obj);
+        meshes.push_back(&mesh);
+        mesh.gpu_driven = true;  // Draw_nodes skips it
+    });
+    if(objects.empty()) return;
+
+    //--- Buffers ---
+    uint32_t count = Count();
+    vbo.Data(verts.data(), (uint32_t)(verts.size() / stride), (uint32_t)stride);
+    ibo.Data(index);
+    VkFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+    object_buf .Data(0, count * frames, sizeof(GpuObject), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, &object_buf.mapped);
+    view_buf   .Data(0, frames,         sizeof(GpuView),   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, &view_buf.mapped);
+    command_buf.Data(0, count, sizeof(VkDrawIndexedIndirectCommand), usage);
+    count_buf  .Data(0, 1,     sizeof(uint32_t), usage);
+
+    VkDescriptorBufferInfo infos[4] = {{object_buf, 0, VK_WHOLE_SIZE}, {command_buf, 0, VK_WHOLE_SIZE},
+                                       {count_buf,  0, VK_WHOLE_SIZE}, {view_buf,    0, VK_WHOLE_SIZE}};
+    VkWriteDescriptorSet writes[4];
+    repeat(4) {
+        writes[i] = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+        writes[i].dstSet          = set;
+        writes[i].dstBinding      = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[i].pBufferInfo     = &infos[i];
+    }
+    vkDeviceWaitIdle(device);  // (only if Build is called again: the set may be in use)
+    vkUpdateDescriptorSets(device, 4, writes, 0, nullptr);
+
+    if(cubemap) pipeline.shader.Bind("tex_cubemap", cubemap);
+    printf("IndirectRenderer: %d meshes, %d vertices, %d indices\n", count, vbo.Count(), ibo.Count());
+}
+
+// Record before the renderpass begins.
+void IndirectRenderer::Cull(VkCommandBuffer cmd, bool barriers) {
+    if(objects.empty()) return;
+
+    //--- Update transforms and materials (in this frame's slot) ---
+    uint32_t base = frame * Count();
+    GpuObject* gpu_objects = (GpuObject*)object_buf.mapped + base;
+    repeat(Count()) {
+        CMesh& mesh = *meshes[i];
+        GpuObject& obj = objects[i];
+        obj.matrix   = mesh.worldMatrix;
+        obj.material = mesh.material.id;        // (registered before the table's Update: see CMesh::RegisterMaterials)
+        gpu_objects[i] = obj;
+        if(!mesh.visible) gpu_objects[i].sphere.w = -1;
+    }
+    object_buf.Flush();
+    GpuView* views = (GpuView*)view_buf.mapped;
+    views[frame] = {CObject::cam_uniform.view, CObject::cam_uniform.proj};  // call camera.Apply() first
+    view_buf.Flush();
+
+    //--- Reset draw count ---
+    VkMemoryBarrier barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+    if(barriers)
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0, 0, nullptr, 0, nullptr, 0, nullptr);  // previous frame's draws have read the commands
+    vkCmdFillBuffer(cmd, count_buf, 0, sizeof(uint32_t), 0);
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    //--- Cull ---
+    CullConstants pc = {Count(), culling, use_count, base, frame};
+    cull.Bind(cmd, set);
+    cull.Push(cmd, &pc, sizeof(pc));
+    cull.Dispatch(cmd, (Count() + 63) / 64);
+
+    if(barriers) {
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+    frame = (frame + 1) % frames;
+}
+
+// Record inside the renderpass.
+void IndirectRenderer::Draw(VkCommandBuffer cmd) {
+    if(objects.empty()) return;
+    CShader& shader = pipeline.shader;
+    shader.Bind("camera", camera->cam_ubo);  // current ring slot
+    shader.UpdateDescriptorSets(pipeline.shared_ds);
+    pipeline.Bind(cmd, pipeline.shared_ds);  // sets 0 and 1
+    VkPipelineLayout layout = shader.GetPipelineLayout();
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 2, 1, &set, 0, nullptr);
+    vkCmdBindVertexBuffer(cmd, vbo);
+    vkCmdBindIndexBuffer (cmd, ibo, 0, VK_INDEX_TYPE_UINT32);
+
+    uint32_t count  = Count();
+    uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+    if(use_count)      vkCmdDrawIndexedIndirectCount(cmd, command_buf, 0, count_buf, 0, count, stride);
+    else if(use_multi) vkCmdDrawIndexedIndirect(cmd, command_buf, 0, count, stride);
+    else repeat(count) vkCmdDrawIndexedIndirect(cmd, command_buf, i * stride, 1, stride);
+}
@@ -0,0 +1,85 @@
+// IndirectRenderer
+// GPU-driven drawing: an alternative to Draw_nodes, for scenes with many meshes.
+//
+// Build() copies all mesh geometry into one shared vertex/index pool, and lists one Object
+// (world matrix, bounding sphere, material id, index range) per mesh, in a storage buffer.
+// Each frame, Cull() runs a compute shader that frustum-culls the objects, and writes a
+// VkDrawIndexedIndirectCommand per visible object, plus a draw count.
+// Draw() then renders them all with a single vkCmdDrawIndexedIndirectCount.
+//
+// Materials and textures come from the BindlessTable (set 1). Objects are bound as set 2.
+// The caller registers the mesh materials and updates the table each frame. (see CMesh::RegisterMaterials)
+// With frames in flight, the host-written objects and view matrices get one slot per frame.
+// Meshes in the pool are flagged (CMesh::gpu_driven), so Draw_nodes skips them, but still
+// draws the rest (eg. skybox).
+//
+// Usage:
+//   indirect.Init(queue, renderpass, 0, bindless);
+//   indirect.Bind(camera);
+//   indirect.Build(root);      // after the meshes are loaded
+//   //--- per frame ---
+//   indirect.Cull(cmd);        // outside the renderpass (after camera.Apply)
+//   indirect.Draw(cmd);        // inside the renderpass
+
+#ifndef INDIRECT_H
+#define INDIRECT_H
+
+#include "CPipeline.h"
+#include "ComputePipeline.h"
+#include "CCamera.h"
+#include "Mesh.h"
+
+struct GpuObject {            // matches "Object" in indirect.glsl (std430)
+    mat4     matrix;          // world matrix
+    vec4     sphere;          // local-space bounds (xyz=center, w=radius). radius<0: hidden
+    int      material      = -1;
+    uint32_t index_count   = 0;
+    uint32_t first_index   = 0;
+    int32_t  vertex_offset = 0;
+};
+
+struct GpuView {              // matches "View" in cull.comp (std430)
+    mat4 view;
+    mat4 proj;
+};
+
+class IndirectRenderer {
+    VkDevice       device   = 0;
+    BindlessTable* bindless = 0;
+    CCamera*       camera   = 0;
+    bool use_count = false;   // vkCmdDrawIndexedIndirectCount is supported
+    bool use_multi = false;   // multiDrawIndirect is supported
+    bool built     = false;
+    uint32_t frames = 1;      // per-frame slots in object_buf and view_buf
+    uint32_t frame  = 0;
+
+    std::vector<CMesh*>    meshes;
+    std::vector<GpuObject> objects;
+    VBO       vbo;            // shared geometry pool
+    IBO       ibo;
+    CvkBuffer object_buf;     // GpuObject[frames][count]        (mapped)
+    CvkBuffer view_buf;       // GpuView[frames]                 (mapped)
+    CvkBuffer command_buf;    // VkDrawIndexedIndirectCommand[]  (written by cull shader)
+    CvkBuffer count_buf;      // uint draw count                 (written by cull shader)
+    DescriptorAllocator   descriptors;
+    VkDescriptorSetLayout set_layout = 0;  // binding 0:objects  1:commands  2:count  3:views  (shared, see ShaderRegistry)
+    VkDescriptorSet       set        = 0;  // cull: set 0,  draw: set 2
+    ComputePipeline       cull;
+public:
+    CPipeline pipeline;
+    bool culling = true;      // false: draw all objects (skip frustum test)
+
+    ~IndirectRenderer();
+
+    void Init(CQueue& queue, CRenderpass& renderpass, uint32_t subpass, BindlessTable& table);
+    void Bind(CCamera& camera);
+    void Build(CObject& root);     // pack meshes into the geometry pool
+    void Cull(VkCommandBuffer cmd, bool barriers = true);  // false: the caller syncs the command and count buffers (eg. RenderGraph)
+    void Draw(VkCommandBuffer cmd);
+    bool Built() { return built; }
+    uint32_t Count() { return (uint32_t)objects.size(); }
+    VkBuffer CommandBuffer() { return command_buf; }
+    VkBuffer CountBuffer()   { return count_buf;   }
+};
+
+#endif
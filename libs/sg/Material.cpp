@@ -6,3 +6,19 @@ void Material::Bind(CShader& shader) {  // see CMesh::Bind
     shader.Bind("tex_normal",   texture.normal);
     shader.Bind("tex_orm",      texture.orm);
 }
+
+// Register textures and colors in the bindless table.
+// Shared materials (eg. from glTF) keep their id. If a copy is modified, it gets its own entry.
+int Material::Register(BindlessTable& table, const void* owner) {
+    BindlessMaterial m;
+    m.color[0] = color.albedo;
+    m.color[1] = color.emission;
+    m.color[2] = color.normal;
+    m.color[3] = color.orm;
+    m.texid[0] = table.AddImage(texture.albedo);
+    m.texid[1] = table.AddImage(texture.emission);
+    m.texid[2] = table.AddImage(texture.normal);
+    m.texid[3] = table.AddImage(texture.orm);
+    id = table.Register(id, m, owner);
+    return id;
+}
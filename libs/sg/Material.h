@@ -3,6 +3,7 @@
 
 #include <string>
 #include "CShader.h"
+#include "Bindless.h"
 
 //---- CPU side material ----
 struct Material {
@@ -23,7 +24,10 @@ struct Material {
         //CvkImage*& operator[](int i){return ((CvkImage**)this)[i];};
     } texture;
 
+    int id = -1;                  // bindless material id (see BindlessTable)
+
     void Bind(CShader& shader);   // not used
+    int  Register(BindlessTable& table, const void* owner = 0);  // add/update in bindless table. Returns id.
 };
 //---------------------------
 
@@ -6,43 +6,85 @@
 #define forXY(X, Y) for(uint32_t y = 0; y < Y; ++y) for(uint32_t x = 0; x < X; ++x)
 
 //--------------------------CMesh-----------------------------
+static_assert(sizeof(uboData) == sizeof(ModelData), "uboData must match the scene table's ModelData.");
+
 void CMesh::Init() {}
 
 void CMesh::Bind() {
     assert(pipeline && "Pipeline not set.");
     CShader& shader = pipeline->shader;
-    shader.Bind("model", ubo);
+    if(slots.pipeline != pipeline) {  // resolve binding names to slots (once)
+        if(slots.pipeline) slots.pipeline->shader.FreeDescriptorSets(descriptorSets);  // sets match the old pipeline's layout
+        slots.pipeline = pipeline;
+        slots.model    = shader.Slot("model");
+        slots.albedo   = shader.Slot("tex_albedo");
+        slots.emission = shader.Slot("tex_emission");
+        slots.normal   = shader.Slot("tex_normal");
+        slots.orm      = shader.Slot("tex_orm");
+        slots.cubemap  = shader.Slot("tex_cubemap");
+        if(slots.model<0 || slots.albedo<0 || slots.emission<0 || slots.normal<0 || slots.orm<0)
+            LOGE("CMesh: '%s' pipeline is missing a material binding.\n", name.c_str());
+    }
+    pipeline->BindInputAttachments();  // (subpass pipelines) written with the rest of the set, not while recording
+    shader.Bind(slots.model, ubo);
     //material.Bind(shader);
-    shader.Bind("tex_albedo",   material.texture.albedo);
-    shader.Bind("tex_emission", material.texture.emission);
-    shader.Bind("tex_normal",   material.texture.normal);
-    shader.Bind("tex_orm",      material.texture.orm);
-    if(cubemap) shader.Bind("tex_cubemap", cubemap);
-    shader.UpdateDescriptorSets(descriptorSets);
+    shader.Bind(slots.albedo,   material.texture.albedo);
+    shader.Bind(slots.emission, material.texture.emission);
+    shader.Bind(slots.normal,   material.texture.normal);
+    shader.Bind(slots.orm,      material.texture.orm);
+    if(cubemap && slots.cubemap>=0) shader.Bind(slots.cubemap, cubemap);
+    shader.UpdateDescriptorSets(descriptorSets);  // only writes the descriptor set if a binding changed
 }
 
-void CMesh::UpdateUBO() {  // (does NOT update textures)
+void CMesh::FillUBO() {  // (does NOT update textures)
     ubo_data.matrix   = worldMatrix;
     ubo_data.color[0] = material.color.albedo;
     ubo_data.color[1] = material.color.emission;
     ubo_data.color[2] = material.color.normal;
     ubo_data.color[3] = material.color.orm;
+}
+
+void CMesh::UpdateUBO() {
+    FillUBO();
     ubo.Set(&ubo_data, sizeof(ubo_data));
 }
 
 void CMesh::Draw() {
-    if(!visible)return;
+    if(!visible || gpu_driven)return;
+    if(pipeline->bindless) { DrawBindless(); return; }
     UpdateUBO();
     Bind();
-    pipeline->Bind(commandBuffer, descriptorSets);
+    float depth = -(cam_uniform.view * ubo_data.matrix.position()).z;  // view-space distance
+    render_queue.Add(pipeline, descriptorSets, Vbo(), Ibo(), material.texture.albedo, depth);
+}
 
-    // Geometry
-    vkCmdBindVertexBuffer(commandBuffer, vbo);
-    vkCmdBindIndexBuffer (commandBuffer, ibo, 0, VK_INDEX_TYPE_UINT32);
-    vkCmdDrawIndexed     (commandBuffer, ibo.Count(), 1, 0, 0, 0);
+// Bindless: textures and materials come from the global table. Per-draw state is a push constant.
+// (the material was registered by RegisterMaterials, before the table's Update)
+void CMesh::DrawBindless() {
+    CShader& shader = pipeline->shader;
+    if(slots.pipeline != pipeline) {
+        slots.pipeline = pipeline;
+        slots.cubemap  = shader.Slot("tex_cubemap");
+    }
+    if(cubemap && slots.cubemap>=0) shader.Bind(slots.cubemap, cubemap);
+    shader.UpdateDescriptorSets(pipeline->shared_ds);  // shared set 0 (only written if changed)
+
+    DrawConstants pc;
+    pc.matrix   = worldMatrix;
+    pc.material = material.id;
+    float depth = -(cam_uniform.view * pc.matrix.position()).z;  // view-space distance
+    render_queue.Add(pipeline, pipeline->shared_ds, Vbo(), Ibo(), (void*)(intptr_t)material.id, depth, &pc);
+}
+
+void CMesh::RegisterMaterials(CObject& root, BindlessTable& table) {
+    root.recurse([&](CObject& node) {
+        if(node.hitGroup==1) ((CMesh&)node).material.Register(table, &node);
+    });
 }
 
 void CMesh::AddToBLAS(VKRay& rt) {
+    VBO& vbo = Vbo();
+    IBO& ibo = Ibo();
     if(vbo.Count()==0) { LOGW("AddToBLAS(...) : Mesh: '%s' has no vertex data.\n", name.c_str());  return; }
 
     // Add Material to RT image list
@@ -55,16 +97,22 @@ void CMesh::AddToBLAS(VKRay& rt) {
     if(material.texture.emission) material.color.emission = {1,1,1,1};
     UpdateUBO();
 
-    blasInx = rt.AddMesh(vbo, ibo, ubo);
-    printf("AddMesh: verts:%d\n", vbo.Count());
+    instInx = rt.AddMesh(vbo, ibo, ubo, deformable);  // (same vbo/ibo as an earlier mesh: shares its BLAS)
+    blasInx = rt.blas.BlasIndex(instInx);
+    rt.SetModel(instInx, (const ModelData&)ubo_data);  // the raytracer keeps its own copy (not the UBO ring)
+    printf("AddMesh: verts:%d  blas:%d\n", vbo.Count(), blasInx);
 }
 
 void CMesh::UpdateBLAS(VKRay& rt) {
-    if(vbo.Count()==0) return;
-    ASSERT(blasInx>=0, "BLAS not initialized\n");
+    if(Vbo().Count()==0) return;
+    ASSERT(instInx>=0, "BLAS not initialized\n");
     mat4 world_matrix = worldMatrix;  // double to float
-    rt.tlas.UpdateInst(blasInx, world_matrix, visible);
-    UpdateUBO();
+    rt.tlas.UpdateInst(instInx, world_matrix, visible);
+    FillUBO();
+    rt.SetModel(instInx, (const ModelData&)ubo_data);  // scene table copies (only written if changed)
+    rt.SetMaterial(instInx, material.id);  // scene table entry (only written if changed)
+    if(blas_dirty && deformable) rt.blas.UpdateMesh(instInx, Vbo(), Ibo());  // refit in vkray.UpdateTLAS()
+    blas_dirty = false;
 }
 
 //------------------------------------------------------------
@@ -12,9 +12,17 @@
 class CMesh : public CObject {
     uboData ubo_data;
     VkDescriptorSets  descriptorSets;
+    struct {                                   // shader binding slots, resolved once per pipeline
+        CPipeline* pipeline = 0;
+        int model, albedo, emission, normal, orm, cubemap;
+    } slots;
     void Bind();
-    void UpdateUBO();
-    int blasInx = -1;
+    void FillUBO();                            // ubo_data from the world matrix and material colors
+    void UpdateUBO();                          // FillUBO, and write it to the next slot in the ring
+    void DrawBindless();
+    int blasInx = -1;                          // BLAS (shared by all instances of the same geometry)
+    int instInx = -1;                          // TLAS instance
+    bool blas_dirty = false;
 
 public:
     UBO ubo;
@@ -23,14 +31,22 @@ public:
     CPipeline* pipeline= 0;
     CvkImage*  cubemap = 0;
     Material   material;
+    bool       gpu_driven = false;  // drawn by IndirectRenderer (Draw_nodes skips it)
+    bool       deformable = false;  // BLAS can be refit after the vertices change (set before AddToBLAS)
+    CMesh*     instance_of = 0;     // draw and trace that mesh's vbo/ibo (instancing: they share one BLAS)
+
+    VBO& Vbo() { return instance_of ? instance_of->Vbo() : vbo; }
+    IBO& Ibo() { return instance_of ? instance_of->Ibo() : ibo; }
 
     CMesh(const char* name="mesh") : CObject(name) { type = "Mesh"; hitGroup = 1; }
     void Init();
     void Draw();
+    static void RegisterMaterials(CObject& root, BindlessTable& table);  // add/update all mesh materials (call before table.Update)
 
     //--- RAYTRACE ---
     void AddToBLAS (VKRay& rt);
     void UpdateBLAS(VKRay& rt);
+    void MarkDirty() { blas_dirty = true; }  // vbo/ibo changed: refit the BLAS on the next UpdateBLAS (deformable only)
     //----------------
 };
 //------------------------------------------------------------
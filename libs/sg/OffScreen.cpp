@@ -1,4 +1,5 @@
 #include "OffScreen.h"
+#include "PipelineCache.h"
 #include "CSkybox.h"
 #include "Mesh.h"
 
@@ -22,18 +23,20 @@ void OffScreen::Init(CQueue& queue) {
 
     //--- Pipelines ---
     pbr_pipeline.Init(renderpass, 0);
-    pbr_pipeline.shader.MaxDescriptorSets(32);
     pbr_pipeline.shader.LoadVertShader("shaders/spirv/pbr_vert.spv");
     pbr_pipeline.shader.LoadFragShader("shaders/spirv/pbr_frag.spv");
-    pbr_pipeline.CreateGraphicsPipeline();
 
     sky_pipeline.Init(renderpass, 0);
-    sky_pipeline.shader.MaxDescriptorSets(3);
     sky_pipeline.shader.LoadVertShader("shaders/spirv/sky_vert.spv");
     sky_pipeline.shader.LoadFragShader("shaders/spirv/sky_frag.spv");
     sky_pipeline.depthStencilState.depthWriteEnable = VK_FALSE;          // Skybox does not modify depth
     sky_pipeline.rasterizer.depthClampEnable = VK_TRUE;                  // Dont clip skybox on farplane
-    sky_pipeline.CreateGraphicsPipeline();
+    PipelineCache::Compile({{"pbr", [&]{ pbr_pipeline.CreateGraphicsPipeline(); }},
+                            {"sky", [&]{ sky_pipeline.CreateGraphicsPipeline(); }}});
+
+    if(gpu_driven && !CObject::bindless) { LOGW("OffScreen: gpu_driven needs a BindlessTable.\n");  gpu_driven = false; }
+    if(gpu_driven) indirect.Init(queue, renderpass, 0, *CObject::bindless);
+    graph.Init(queue);
     //-----------------
 }
 
@@ -48,6 +51,7 @@ void OffScreen::Bind(CCamera& camera) {
         if(node.hitGroup==0) ((CBox& )node).pipeline = &sky_pipeline;  // MISS
         if(node.hitGroup==1) ((CMesh&)node).pipeline = &pbr_pipeline;  // HIT
     });
+    if(gpu_driven) indirect.Bind(camera);
 }
 
 void OffScreen::Render() {
@@ -64,13 +68,57 @@ void OffScreen::Render() {
     //camera->flags = window.flags;
 
     root.Transform_nodes();
-    VkCommandBuffer cmd = fbo.BeginFrame();
-        VkFence fence = fbo.CurrBuffer().fence;
-        vkCmdSetViewport(cmd, 0, 1, &viewport);
-        vkCmdSetScissor (cmd, 0, 1, &scissor);
-        camera->Apply(fence);
-        root.Draw_nodes(cmd);
-    fbo.EndFrame();
+    if(gpu_driven && !indirect.Built()) indirect.Build(root);
+
+    fbo.AcquireNext();                      // waits for the frame slot being reused
+    if(gpu_driven) {                        // this frame's material slot
+        CMesh::RegisterMaterials(root, *CObject::bindless);
+        CObject::bindless->Update();
+    }
+    VkFence fence = fbo.CurrBuffer().fence;
+    camera->Apply(fence);                     // writes the camera's next ring slot
+    pbr_pipeline.shader.Bind("camera", camera->cam_ubo);
+    sky_pipeline.shader.Bind("camera", camera->cam_ubo);
+
+    //--- Frame graph: cull (compute) -> scene (renderpass) ---
+    graph.Clear();
+    auto color = graph.ImportImage("color", fbo.CurrBuffer().image, VK_IMAGE_LAYOUT_UNDEFINED);
+    uint32_t commands = 0, count = 0;
+    if(gpu_driven) {                        // cull on the gpu, before the renderpass begins
+        commands = graph.ImportBuffer("commands", indirect.CommandBuffer(), RenderGraph::INDIRECT);  // (last frame's draws)
+        count    = graph.ImportBuffer("count",    indirect.CountBuffer(),   RenderGraph::INDIRECT);
+        graph.AddPass("cull", [&](VkCommandBuffer cmd) { indirect.Cull(cmd, false); })
+             .Write(commands, RenderGraph::STORAGE_WRITE)
+             .Write(count,    RenderGraph::TRANSFER_DST)
+             .Write(count,    RenderGraph::STORAGE_WRITE);
+    }
+    auto& scene = graph.AddPass("scene", [&](VkCommandBuffer cmd) {
+        if(parallel) {
+            auto setup = [&](VkCommandBuffer sec) {  // secondaries don't inherit dynamic state
+                vkCmdSetViewport(sec, 0, 1, &viewport);
+                vkCmdSetScissor (sec, 0, 1, &scissor);
+            };
+            fbo.BeginRenderpass(VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+            root.Draw_nodes(fbo, setup);  // skips gpu_driven meshes
+            if(gpu_driven) fbo.RecordParallel(1, [&](VkCommandBuffer sec, uint32_t, uint32_t, uint32_t) { setup(sec);  indirect.Draw(sec); });
+        } else {
+            fbo.BeginRenderpass();
+            vkCmdSetViewport(cmd, 0, 1, &viewport);
+            vkCmdSetScissor (cmd, 0, 1, &scissor);
+            root.Draw_nodes(cmd);  // skips gpu_driven meshes
+            if(gpu_driven) indirect.Draw(cmd);
+        }
+        fbo.EndRenderpass();
+    });
+    scene.Write(color, RenderGraph::COLOR_ATTACHMENT, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);  // the renderpass transitions it
+    if(gpu_driven) scene.Read(commands, RenderGraph::INDIRECT).Read(count, RenderGraph::INDIRECT);
+    graph.Compile();
+
+    VkCommandBuffer cmd = fbo.BeginCmd();
+    graph.Execute(cmd);
+    fbo.EndCmd();
+    fbo.Submit();
+    if(fbo.FramesInFlight() < 2) fbo.Wait();
 
     //fbo.ReadImage().Save("fbo.png");
 }
@@ -5,6 +5,8 @@
 #include "CRenderpass.h"
 #include "CPipeline.h"
 #include "CCamera.h"
+#include "Indirect.h"
+#include "RenderGraph.h"
 #include "FBO.h"
 
 class OffScreen {
@@ -12,9 +14,13 @@ class OffScreen {
     CPipeline   pbr_pipeline;
     CPipeline   sky_pipeline;
     CCamera*    camera = 0;
+    IndirectRenderer indirect;
 public:
     VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+    bool gpu_driven = false;  // draw meshes with IndirectRenderer (needs CObject::bindless). Set before Init.
+    bool parallel   = false;  // record draws on worker threads, into secondary command buffers (see FBO::RecordParallel)
     FBO  fbo;
+    RenderGraph graph;        // rebuilt each frame. graph.Dump() shows the schedule
     void Init(CQueue& queue);
     void Bind(CCamera& camera);
     void Render();
@@ -1,4 +1,5 @@
 #include "OnScreen.h"
+#include "PipelineCache.h"
 #include "CSkybox.h"
 #include "Mesh.h"
 
@@ -51,35 +52,49 @@ void OnScreen::Init(CQueue& present_queue, CQueue& graphics_queue, VkSurfaceKHR
 
     //--- Pipelines ---
     pbr_pipeline.Init(renderpass, 0);
-    pbr_pipeline.shader.MaxDescriptorSets(32);
-    pbr_pipeline.shader.LoadVertShader("shaders/spirv/pbr_vert.spv");
-    pbr_pipeline.shader.LoadFragShader("shaders/spirv/pbr_frag.spv");
-    pbr_pipeline.CreateGraphicsPipeline();
+    if(CObject::bindless) {                                              // textures and materials from the global table
+        pbr_pipeline.shader.LoadVertShader("shaders/spirv/pbr_bindless_vert.spv");
+        pbr_pipeline.shader.LoadFragShader(hybrid ? "shaders/spirv/pbr_bindless_rq_frag.spv" : "shaders/spirv/pbr_bindless_frag.spv");
+        pbr_pipeline.SetBindless(*CObject::bindless);
+    } else {
+        pbr_pipeline.shader.LoadVertShader("shaders/spirv/pbr_vert.spv");
+        pbr_pipeline.shader.LoadFragShader(hybrid ? "shaders/spirv/pbr_rq_frag.spv" : "shaders/spirv/pbr_frag.spv");
+    }
+    if(hybrid) {                                                         // shadow and AO rays (set after the bindless table)
+        rayquery.Init(device);
+        pbr_pipeline.SetRayQuery(rayquery);
+    }
 
     sky_pipeline.Init(renderpass, 0);
-    sky_pipeline.shader.MaxDescriptorSets(3);
     sky_pipeline.shader.LoadVertShader("shaders/spirv/sky_vert.spv");
     sky_pipeline.shader.LoadFragShader("shaders/spirv/sky_frag.spv");
     sky_pipeline.depthStencilState.depthWriteEnable = VK_FALSE;          // Skybox does not modify depth
     sky_pipeline.rasterizer.depthClampEnable = VK_TRUE;                  // Dont clip skybox on farplane
-    sky_pipeline.CreateGraphicsPipeline();
+    std::vector<PipelineCache::Job> jobs = {{"pbr", [&]{ pbr_pipeline.CreateGraphicsPipeline(); }},
+                                            {"sky", [&]{ sky_pipeline.CreateGraphicsPipeline(); }}};
+
+    if(gpu_driven && !CObject::bindless) { LOGW("OnScreen: gpu_driven needs a BindlessTable.\n");  gpu_driven = false; }
+    if(gpu_driven) indirect.Init(graphics_queue, renderpass, 0, *CObject::bindless);
+    graph.Init(graphics_queue);
     //-----------------
 
 #ifdef TWOPASS
     //---- Subpass 1 ----
     printf("\nSubpass 1:\n");
     pipeline_sub1.Init(renderpass, 1);
-    pipeline_sub1.shader.MaxDescriptorSets(4);
     pipeline_sub1.shader.LoadVertShader("shaders/spirv/sub1_vert.spv");
     pipeline_sub1.shader.LoadFragShader("shaders/spirv/sub1_frag.spv");
-    pipeline_sub1.CreateGraphicsPipeline();
+    jobs.push_back({"sub1", [&]{ pipeline_sub1.CreateGraphicsPipeline(); }});
     //-------------------
 #endif
+    PipelineCache::Compile(jobs);  // all at once, on worker threads
 }
 
 void OnScreen::Bind(CCamera& camera) {
     this->camera = &camera;
     CObject& root = camera.GetRoot();
+    auto lights = root.FindAll("Light");
+    light = lights.empty() ? 0 : (CLight*)lights[0];
 
     pbr_pipeline.shader.Bind("camera", camera.cam_ubo);
     sky_pipeline.shader.Bind("camera", camera.cam_ubo);
@@ -88,6 +103,7 @@ void OnScreen::Bind(CCamera& camera) {
         if(node.hitGroup==0) ((CBox& )node).pipeline = &sky_pipeline;  // MISS
         if(node.hitGroup==1) ((CMesh&)node).pipeline = &pbr_pipeline;  // HIT
     });
+    if(gpu_driven) indirect.Bind(camera);
 }
 
 void OnScreen::Render() {
@@ -104,18 +120,71 @@ void OnScreen::Render() {
     camera->SetPerspective(aspect, 40.f, 0.1f, 1000);
     //camera->flags = window.flags;
 
-    VkCommandBuffer cmd = swapchain.BeginFrame();
-        VkFence fence = swapchain.CurrBuffer().fence;
-        vkCmdSetViewport(cmd, 0, 1, &viewport);
-        vkCmdSetScissor (cmd, 0, 1, &scissor);
-        camera->Apply(fence);
-        root.Draw_nodes(cmd);
+    if(gpu_driven && !indirect.Built()) indirect.Build(root);
+
+    swapchain.AcquireNext();                      // waits for the frame slot being reused
+    if(CObject::bindless) {                       // this frame's material slot (before any draw reads a material id)
+        CMesh::RegisterMaterials(root, *CObject::bindless);
+        CObject::bindless->Update();
+    }
+    VkFence fence = swapchain.CurrBuffer().fence;
+    camera->Apply(fence);                     // writes the camera's next ring slot
+    pbr_pipeline.shader.Bind("camera", camera->cam_ubo);
+    sky_pipeline.shader.Bind("camera", camera->cam_ubo);
+    if(hybrid) {                              // next ray query set: this frame's light and settings
+        if(light) {
+            rayquery.settings.light       = light->position;
+            rayquery.settings.light_color = {light->color.R, light->color.G, light->color.B, 1};
+        }
+        rayquery.Update(hybrid->tlas);
+    }
+
+    //--- Frame graph: cull (compute) -> scene (renderpass) ---
+    graph.Clear();
+    auto color = graph.ImportImage("color", swapchain.CurrBuffer().image, VK_IMAGE_LAYOUT_UNDEFINED);
+    uint32_t commands = 0, count = 0;
+    if(gpu_driven) {                        // cull on the gpu, before the renderpass begins
+        commands = graph.ImportBuffer("commands", indirect.CommandBuffer(), RenderGraph::INDIRECT);  // (last frame's draws)
+        count    = graph.ImportBuffer("count",    indirect.CountBuffer(),   RenderGraph::INDIRECT);
+        graph.AddPass("cull", [&](VkCommandBuffer cmd) { indirect.Cull(cmd, false); })
+             .Write(commands, RenderGraph::STORAGE_WRITE)
+             .Write(count,    RenderGraph::TRANSFER_DST)
+             .Write(count,    RenderGraph::STORAGE_WRITE);
+    }
+    auto& scene = graph.AddPass("scene", [&](VkCommandBuffer cmd) {
+        if(parallel) {
+            auto setup = [&](VkCommandBuffer sec) {  // secondaries don't inherit dynamic state
+                vkCmdSetViewport(sec, 0, 1, &viewport);
+                vkCmdSetScissor (sec, 0, 1, &scissor);
+            };
+            swapchain.BeginRenderpass(VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+            root.Draw_nodes(swapchain, setup);  // skips gpu_driven meshes
+            if(gpu_driven) swapchain.RecordParallel(1, [&](VkCommandBuffer sec, uint32_t, uint32_t, uint32_t) { setup(sec);  indirect.Draw(sec); });
+        } else {
+            swapchain.BeginRenderpass();
+            vkCmdSetViewport(cmd, 0, 1, &viewport);
+            vkCmdSetScissor (cmd, 0, 1, &scissor);
+            root.Draw_nodes(cmd);  // skips gpu_driven meshes
+            if(gpu_driven) indirect.Draw(cmd);
+        }
 #ifdef TWOPASS
-        vkCmdNextSubpass(cmd, VK_SUBPASS_CONTENTS_INLINE);
+        swapchain.NextSubpass(VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdSetViewport(cmd, 0, 1, &viewport);  // (undefined after executing secondaries)
+        vkCmdSetScissor (cmd, 0, 1, &scissor);
         pipeline_sub1.Bind(cmd, sub1_DS);
         vkCmdDraw(cmd, 3, 1, 0, 0);
 #endif
+        swapchain.EndRenderpass();
+    });
+    scene.Write(color, RenderGraph::COLOR_ATTACHMENT, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);  // the renderpass transitions it
+    if(gpu_driven) scene.Read(commands, RenderGraph::INDIRECT).Read(count, RenderGraph::INDIRECT);
+    graph.Compile();
 
-    swapchain.EndFrame();
+    VkCommandBuffer cmd = swapchain.BeginCmd();
+    if(hybrid) hybrid->UpdateTLAS(cmd);       // moved instances (barrier: visible to the fragment shader)
+    graph.Execute(cmd);
+    swapchain.EndCmd();
+    swapchain.Submit();
+    if(swapchain.FramesInFlight() < 2) swapchain.Wait();
     //swapchain.ReadImage().Save("screenshot.png");
 }
@@ -6,6 +6,10 @@
 #include "CPipeline.h"
 #include "Swapchain.h"
 #include "CCamera.h"
+#include "Indirect.h"
+#include "RenderGraph.h"
+#include "RayQuery.h"
+#include "Light.h"
 
 class OnScreen {
     CRenderpass renderpass;
@@ -14,9 +18,16 @@ class OnScreen {
     CPipeline   pipeline_sub1;
     VkDescriptorSets sub1_DS;
     CCamera*  camera = 0;
+    CLight*   light  = 0;
+    IndirectRenderer indirect;
 public:
     VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+    bool gpu_driven = false;  // draw meshes with IndirectRenderer (needs CObject::bindless). Set before Init.
+    bool parallel   = false;  // record draws on worker threads, into secondary command buffers (see FBO::RecordParallel)
+    VKRay*    hybrid = 0;     // trace shadow and AO rays against its TLAS, from the PBR shader (needs VK_KHR_ray_query). Set before Init.
+    RayQuerySet rayquery;     // rayquery.settings: ray counts, AO radius, light size
     Swapchain swapchain;
+    RenderGraph graph;        // rebuilt each frame. graph.Dump() shows the schedule
     void Init(CQueue& present_queue, CQueue& graphics_queue, VkSurfaceKHR surface);
     void Bind(CCamera& camera);
     void Render();
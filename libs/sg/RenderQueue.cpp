@@ -0,0 +1,156 @@
+#include "RenderQueue.h"
+#include <cstring>
+#include <algorithm>
+
+#undef repeat
+#define repeat(COUNT) for(uint32_t i = 0; i < (COUNT); ++i)
+
+//-------------------------------RenderStats-------------------------------
+void RenderStats::Print() {
+    printf("Draws:%4d  Pipelines:%4d  DescriptorSets:%4d  VBOs:%4d  IBOs:%4d  PushConstants:%4d \r",
+           draws, pipeline_binds, set_binds, vertex_binds, index_binds, push_constants);
+}
+
+RenderStats& RenderStats::operator+=(const RenderStats& s) {
+    draws          += s.draws;
+    pipeline_binds += s.pipeline_binds;
+    set_binds      += s.set_binds;
+    vertex_binds   += s.vertex_binds;
+    index_binds    += s.index_binds;
+    push_constants += s.push_constants;
+    return *this;
+}
+//-------------------------------------------------------------------------
+
+//-------------------------------RenderQueue-------------------------------
+uint32_t RenderQueue::GetID(std::unordered_map<const void*, uint32_t>& ids, const void* ptr, uint32_t bits) {
+    auto it = ids.find(ptr);
+    if(it != ids.end()) return it->second;
+    uint32_t max = (1u << bits) - 1;
+    uint32_t id  = std::min((uint32_t)ids.size(), max);  // overflow shares the last id (still correct, just less sorted)
+    if(ids.size() == (size_t)max + 1) LOGW("RenderQueue: more than %d ids. Sorting will be less effective.\n", max + 1);  // (once)
+    ids[ptr] = id;
+    return id;
+}
+
+void RenderQueue::Clear() {
+    packets.clear();
+    stats = {};
+}
+
+void RenderQueue::Reset() {
+    Clear();
+    pipeline_ids.clear();
+    material_ids.clear();
+    buffer_ids.clear();
+}
+
+void RenderQueue::Add(CPipeline* pipeline, VkDescriptorSets& ds, VBO& vbo, IBO& ibo, const void* material, float depth,
+                      const DrawConstants* pc) {
+    ASSERT(pipeline, "RenderQueue: Pipeline not set.\n");
+    DrawPacket packet;
+    packet.pipeline    = pipeline;
+    packet.set         = ds;
+    packet.offset_count = pipeline->shader.DynamicOffsets(packet.offsets);  // (the caller bound this draw's UBOs)
+    packet.vbo         = vbo;
+    packet.ibo         = ibo;
+    packet.index_count = ibo.Count();
+    if(pc) packet.pc   = *pc;
+    if(!enabled) { packets.push_back(packet);  return; }  // unsorted
+
+    // Positive floats sort correctly as integers. Keep the top 24 bits.
+    uint32_t depth_bits;
+    depth = std::max(depth, 0.f);
+    memcpy(&depth_bits, &depth, 4);
+
+    uint64_t pipeline_id = GetID(pipeline_ids, pipeline, 8);
+    uint64_t material_id = GetID(material_ids, material, 16);
+    uint64_t buffer_id   = GetID(buffer_ids,   packet.vbo, 16);
+    packet.key = pipeline_id << 56 | material_id << 40 | buffer_id << 24 | depth_bits >> 8;
+    packets.push_back(packet);
+}
+
+void RenderQueue::PushConstants(VkCommandBuffer cmd, const DrawPacket& p, RenderStats& stats) {
+    VkPipelineLayout layout = p.pipeline->shader.GetPipelineLayout();
+    vkCmdPushConstants(cmd, layout, VK_SHADER_STAGE_ALL_GRAPHICS, 0, sizeof(DrawConstants), &p.pc);
+    stats.push_constants++;
+}
+
+// LSD radix sort, 8 bits per pass. Passes where all keys share the same byte are skipped.
+void RenderQueue::Sort() {
+    uint32_t count = (uint32_t)packets.size();
+    if(count < 2) return;
+    temp.resize(count);
+    repeat(8) {
+        uint32_t shift = i * 8;
+        uint32_t hist[256] = {};
+        for(auto& p : packets) hist[(p.key >> shift) & 0xff]++;
+        if(hist[(packets[0].key >> shift) & 0xff] == count) continue;  // nothing to sort in this byte
+
+        uint32_t sum = 0;
+        for(auto& h : hist) { uint32_t c = h;  h = sum;  sum += c; }
+        for(auto& p : packets) temp[hist[(p.key >> shift) & 0xff]++] = p;
+        packets.swap(temp);
+    }
+}
+
+void RenderQueue::Submit(VkCommandBuffer cmd) {
+    if(enabled) Sort();
+    Record(cmd, 0, Count(), stats);
+    packets.clear();
+}
+
+// Secondary command buffers are recorded in parallel. Descriptor sets were written in Add()'s caller,
+// so recording only binds them.
+void RenderQueue::Submit(FBO& fbo, std::function<void(VkCommandBuffer cmd)> setup) {
+    if(packets.empty()) return;
+    if(enabled) Sort();
+    chunk_stats.assign(fbo.GetRecorder().ThreadCount(), {});
+    fbo.RecordParallel(Count(), [&](VkCommandBuffer cmd, uint32_t chunk, uint32_t first, uint32_t count) {
+        setup(cmd);
+        Record(cmd, first, count, chunk_stats[chunk]);
+    });
+    for(auto& s : chunk_stats) stats += s;
+    packets.clear();
+}
+
+void RenderQueue::Record(VkCommandBuffer cmd, uint32_t first, uint32_t count, RenderStats& stats) {
+    CPipeline*      curr_pipeline = 0;
+    VkDescriptorSet curr_set = 0;
+    const uint32_t* curr_offsets = 0;
+    VkBuffer        curr_vbo = 0;
+    VkBuffer        curr_ibo = 0;
+
+    for(uint32_t i = first; i < first + count; ++i) {
+        DrawPacket& p = packets[i];
+        if(p.pipeline != curr_pipeline) {
+            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, *p.pipeline);
+            curr_pipeline = p.pipeline;
+            curr_set = 0;  // layout may differ
+            stats.pipeline_binds++;
+            if(p.pipeline->BindExtraSets(cmd)) stats.set_binds++;  // sets 1+: bindless table, ray query
+        }
+        bool same_offsets = curr_offsets && !memcmp(curr_offsets, p.offsets, p.offset_count * sizeof(uint32_t));
+        if(p.set != curr_set || !same_offsets) {  // the packet's own set, already written (incl. subpass input attachments)
+            VkPipelineLayout layout = p.pipeline->shader.GetPipelineLayout();
+            vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &p.set, p.offset_count, p.offsets);
+            curr_set     = p.set;
+            curr_offsets = p.offsets;
+            stats.set_binds++;
+        }
+        if(p.pipeline->bindless) PushConstants(cmd, p, stats);
+        if(p.vbo != curr_vbo) {
+            vkCmdBindVertexBuffer(cmd, &p.vbo);
+            curr_vbo = p.vbo;
+            stats.vertex_binds++;
+        }
+        if(p.ibo != curr_ibo) {
+            vkCmdBindIndexBuffer(cmd, p.ibo, 0, VK_INDEX_TYPE_UINT32);
+            curr_ibo = p.ibo;
+            stats.index_binds++;
+        }
+        vkCmdDrawIndexed(cmd, p.index_count, 1, 0, 0, 0);
+        stats.draws++;
+    }
+}
+//-------------------------------------------------------------------------
@@ -0,0 +1,77 @@
+// RenderQueue
+// Collects draw packets during Draw_nodes, instead of recording them in scene-graph order.
+// Packets are sorted by a 64-bit key, then submitted, skipping binds that are already current.
+//
+// Sort key (msb to lsb):
+//   | pipeline : 8 | material : 16 | buffer : 16 | depth : 24 |
+//
+// Pipeline, material and buffer ids are assigned in first-seen order, so pipelines are still
+// drawn in scene-graph order (eg. skybox first), and depth sorts front-to-back within a group.
+//
+// Submit(fbo, setup) splits the sorted list into chunks, and records them on the FBO's worker
+// threads, into secondary command buffers. (see ParallelRecorder) Each chunk starts with no
+// binds, so splitting costs a few redundant binds per chunk.
+//
+// Usage:
+//   queue.Clear();
+//   queue.Add(...);        // per mesh
+//   queue.Submit(cmd);     // sort and record
+//   queue.stats.Print();   // per-frame bind and draw counters
+
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include "CPipeline.h"
+#include "FBO.h"
+
+struct DrawPacket {
+    uint64_t          key = 0;
+    CPipeline*        pipeline = 0;
+    VkDescriptorSet   set = 0;  // current set in the ring buffer (written before Add)
+    uint32_t          offsets[CShader::MAX_DYNAMIC] = {};  // UBO ring slots, at Add time
+    uint32_t          offset_count = 0;
+    VkBuffer          vbo = 0;
+    VkBuffer          ibo = 0;
+    uint32_t          index_count = 0;
+    DrawConstants     pc;           // push constants (bindless pipelines only)
+};
+
+struct RenderStats {
+    uint32_t draws           = 0;
+    uint32_t pipeline_binds  = 0;
+    uint32_t set_binds       = 0;
+    uint32_t vertex_binds    = 0;
+    uint32_t index_binds     = 0;
+    uint32_t push_constants  = 0;
+    void Print();
+    RenderStats& operator+=(const RenderStats& s);
+};
+
+class RenderQueue {
+    std::vector<DrawPacket> packets;
+    std::vector<DrawPacket> temp;  // radix sort scratch
+    std::unordered_map<const void*, uint32_t> pipeline_ids;
+    std::unordered_map<const void*, uint32_t> material_ids;
+    std::unordered_map<const void*, uint32_t> buffer_ids;
+    uint32_t GetID(std::unordered_map<const void*, uint32_t>& ids, const void* ptr, uint32_t bits);
+    std::vector<RenderStats> chunk_stats;  // per chunk, merged after a parallel Submit
+    void Sort();  // LSD radix sort on key
+    void PushConstants(VkCommandBuffer cmd, const DrawPacket& p, RenderStats& stats);
+    void Record(VkCommandBuffer cmd, uint32_t first, uint32_t count, RenderStats& stats);  // binds only (thread-safe)
+public:
+    bool enabled = true;   // false: don't sort. Record in scene-graph order.
+    RenderStats stats;     // counters since Clear()
+
+    void Clear();          // call at start of frame
+    void Reset();          // also forget pipeline/material/buffer ids
+    void Add(CPipeline* pipeline, VkDescriptorSets& ds, VBO& vbo, IBO& ibo, const void* material, float depth,
+             const DrawConstants* pc = 0);  // pc: per-draw push constants, for bindless pipelines
+    void Submit(VkCommandBuffer cmd);
+    void Submit(FBO& fbo, std::function<void(VkCommandBuffer cmd)> setup);  // record on worker threads. setup: per-chunk dynamic state
+    uint32_t Count() { return (uint32_t)packets.size(); }
+};
+
+#endif
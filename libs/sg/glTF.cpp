@@ -14,12 +14,14 @@ void glTF::swap(glTF& other) {
     std::swap(cameras,  other.cameras);
     std::swap(materials,other.materials);
     std::swap(vkImages, other.vkImages);
+    std::swap(loaded_meshes, other.loaded_meshes);
     std::swap(p_model,  other.p_model);
 }
 
 void glTF::Clear() {
     for(auto& node : nodes) { delete node; }
     nodes.clear();
+    loaded_meshes.clear();
     materials.clear();
     matrix.SetIdentity();
 }
@@ -39,6 +41,7 @@ CNode* glTF::Load(const char* filename, CObject* parent) {
     LOG("\n");
     LOGI("Loading glTF Scene : %s\n", filename);
 //    Clear();
+    loaded_meshes.clear();  // (mesh indices are per file)
     tinygltf::TinyGLTF t_loader;
     tinygltf::Model    t_model;
     std::string err;
@@ -171,6 +174,8 @@ void glTF::load_materials(const char* path) {
         if(iOrm>=0) mat.texture.orm      = &(vkImages[iOrm]);
         if(iNrm>=0) mat.texture.normal   = &(vkImages[iNrm]);
         if(iEmi>=0) mat.texture.emission = &(vkImages[iEmi]);
+
+        if(bindless) mat.Register(*bindless, this);  // shared by all meshes using this material
     }
 }
 
@@ -193,7 +198,15 @@ void glTF::load_object(CObject* parent, tinygltf::Node& t_node) {
         uint prim_cnt = (uint)t_mesh.primitives.size();
         repeat(prim_cnt) {  // multiple primitives per model
 
-            CMesh* mesh = get_mesh(t_mesh, i);
+            CMesh*& first = loaded_meshes[{t_node.mesh, i}];
+            CMesh* mesh = nullptr;
+            if(first) {                // mesh is used by more than one node: share its buffers (and BLAS)
+                mesh = new CMesh;
+                mesh->instance_of = first;
+                mesh->material    = first->material;
+            } else {
+                mesh = first = get_mesh(t_mesh, i);
+            }
             mesh->name = t_mesh.name;
             if(mesh->name.size()==0) mesh->name = "mesh";
             if(prim_cnt > 1) mesh->name += "_"+std::to_string(i);
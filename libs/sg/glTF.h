@@ -15,6 +15,7 @@
 #define TINYGLTF_NO_STB_IMAGE_WRITE   // image files are read only
 #define TINYGLTF_NOEXCEPTION          // disable exception handling.
 #include "tiny_gltf.h"
+#include <map>
 
 #undef MOVE_SEMANTICS
 //------------------------------------------------------------
@@ -38,6 +39,7 @@ class glTF : public CObject {
     std::vector<CCamera*> cameras;
     std::vector<Material> materials;
     std::vector<CvkImage> vkImages;
+    std::map<std::pair<int, uint>, CMesh*> loaded_meshes;  // (mesh, primitive) -> first node using it. Other nodes instance it.
 
     void load_materials(const char* path);                        // load all textures
     void load_object(CObject* parent, tinygltf::Node& t_node);    // load nodes recursively
@@ -6,15 +6,50 @@
 #include "CObject.h"
 #include "CCamera.h"
 #include "Light.h"
+#include "CpuRay.h"
 
 class RT {
 
 public:
     VKRay vkray;
     std::vector<CObject*> meshList;
+    std::string as_cache = "blas.cache";  // built BLASes are saved here, and loaded on the next run ("": always build)
+    bool host_build = false;              // build BLASes on the CPU (if supported), to compare with the device build
 
-    void Init(CQueue& queue, CCamera& camera, VkImageView target) {
+    //--- Progressive accumulation ---
+    // While the camera and TLAS instances don't change, each frame's samples are averaged into 'accum'.
+    // Per-pixel luminance variance is tracked too: once a pixel's mean is known to within noise_limit,
+    // (relative standard error) the raygen shader stops tracing it, so the remaining noisy pixels converge faster.
+    bool      accumulate  = true;   // false: every frame starts over
+    float     noise_limit = 0.01f;  // adaptive sampling threshold (0: sample every pixel, every frame)
+    uint32_t  min_samples = 16;     // samples per pixel before the threshold applies
+    CvkImage  accum;                // running mean (rgb) and sample count (a)
+    CvkImage  moments;              // luminance mean and M2
+    CvkBuffer counter;              // pixels sampled per frame (a slot per frame in flight, read back when it's reused)
+    uint32_t  counter_slot = 0;     // this frame's slot
+    uint32_t  stale        = 0;     // slots still holding counts from before the restart
+    mat4      last_view, last_proj; // camera of the last frame, and
+    uint32_t  last_version = 0;     // TLAS version: if either changes, accumulation restarts
+    uint64_t  samples    = 0;       // pixel samples since the restart (each one is 2x2 primary rays)
+    double    accum_time = 0;       // seconds since the restart
+    double    samples_per_sec = 0;  // last frame
+    Timer     frame_timer;
+    //--------------------------------
+
+    //--- CPU fallback ---
+    bool      cpu = false;  // true: use CpuRay instead of the RT pipeline
+    CpuRay    cpuray;
+    CImage32f cpu_image;    // CpuRay output
+    CvkImage  cpu_target;   // cpu_image uploaded to the GPU, for blitting to the swapchain
+    bool      cpu_stats = false;  // print render time and ray rate each frame
+    //--------------------
+
+    // If the ray tracing shaders don't match the descriptor set (stale SPIR-V), falls back to the CPU tracer.
+    void Init(CQueue& queue, CCamera& camera, CCubemap& skybox, VkImageView target) {
         vkray.Init(queue);
+        vkray.blas.cache_file = as_cache;
+        vkray.blas.host_build = host_build;
+        vkray.bindless = CObject::bindless;  // share textures with the rasterizer (if set)
         CObject& root = camera.GetRoot();
         root.FindAll("Skybox")[0]->AddToBLAS(vkray);
         meshList = root.GetRenderList();
@@ -24,13 +59,44 @@ public:
         vkray.m_camera = &camera.cam_ubo;
         CLight* light = (CLight*)root.FindAll("Light")[0];
         vkray.m_light = &light->light_ubo;       
+        SetAccumSize({1, 1});  // (resized on the first frame)
         vkray.CreateDescriptorSet();
-        vkray.CreatePipeline();
+        if(!vkray.CreatePipeline()) {
+            LOGW("RT: Using the CPU raytracer instead.\n");
+            cpu = true;
+            cpuray.Init(vkray, skybox);
+        }
+    }
+
+    // CPU fallback: Collects the same scene inputs, but skips building the AS and pipeline.
+    void InitCPU(CQueue& queue, CCamera& camera, CCubemap& skybox) {
+        cpu = true;
+        vkray.Init(queue);
+        vkray.bindless = CObject::bindless;  // share textures with the rasterizer (if set)
+        CObject& root = camera.GetRoot();
+        root.FindAll("Skybox")[0]->AddToBLAS(vkray);
+        meshList = root.GetRenderList();
+        for(auto item : meshList){ item->AddToBLAS(vkray); }
+        vkray.tlas.AddInstances(vkray.blas);  // instance list only (not built)
+        cpuray.Init(vkray, skybox);
+    }
+
+    void SetAccumSize(VkExtent2D ext) {
+        VkImageUsageFlags usage = VK_IMAGE_USAGE_STORAGE_BIT;
+        accum  .SetSize(ext, VK_FORMAT_R32G32B32A32_SFLOAT, VK_SAMPLE_COUNT_1_BIT, usage);
+        moments.SetSize(ext, VK_FORMAT_R32G32B32A32_SFLOAT, VK_SAMPLE_COUNT_1_BIT, usage);
+        if(!counter.mapped) {  // (256: minStorageBufferOffsetAlignment is at most 256)
+            counter.Data(0, std::max(default_allocator->frames_in_flight, 1u), 256, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU, &counter.mapped);
+            memset(counter.mapped, 0, counter.size());
+            counter.Flush();
+        }
+        vkray.SetAccumulation(accum.view, moments.view, counter);
+        vkray.accum.frame = 0;
     }
 
     void Update() {
         for(auto item : meshList){ item->UpdateBLAS(vkray); }
-        vkray.UpdateTLAS();
+        if(cpu) cpuray.Update(vkray.tlas);  // (the GPU TLAS is updated in Render)
     }
 
     void Render(CCamera& camera, Swapchain& swapchain) {
@@ -38,29 +104,153 @@ public:
         root.Transform_nodes();
         swapchain.AcquireNext();
 
-        CvkImage& attachment = swapchain.att_images[0];
-        attachment.SetLayout(VK_IMAGE_LAYOUT_GENERAL);
-        vkray.SetRenderTarget(attachment.view);
-
         VkExtent2D ext  = swapchain.GetExtent();
         float w = (float)ext.width;
         float h = (float)ext.height;
         float aspect = w / h;
         camera.SetPerspective(aspect, 40.f, 0.1f, 1000);
         //camera->flags = window.flags;
-
-        auto cmd  = swapchain.BeginCmd();
         auto swap = swapchain.CurrBuffer();
         camera.Apply(swap.fence);
 
-        vkray.BindDS(cmd);
+        CvkImage& attachment = swapchain.att_images[0];
+        vkray.SetRenderTarget(attachment.view);  // (only changes after a resize, which waited for the GPU)
+        if(accum.extent2D().width != ext.width || accum.extent2D().height != ext.height) SetAccumSize(ext);
+
+        auto cmd  = swapchain.BeginCmd();
+        vkray.UpdateTLAS(cmd);                   // changed instances only, no wait
+
+        //--- Restart accumulation if anything moved ---
+        CamUniform& cam = CObject::cam_uniform;
+        bool moved = memcmp(&cam.view, &last_view, sizeof(mat4)) || memcmp(&cam.proj, &last_proj, sizeof(mat4));
+        if(!accumulate || moved || vkray.tlas.version != last_version) vkray.accum.frame = 0;
+        if(vkray.accum.frame == 0) { samples = 0;  accum_time = 0;  stale = counter.Count(); }
+        last_view    = cam.view;
+        last_proj    = cam.proj;
+        last_version = vkray.tlas.version;
+        vkray.accum.min_samples = min_samples;
+        vkray.accum.noise_limit = accumulate ? noise_limit : 0;
+
+        //--- Metrics ---
+        // AcquireNext waited for the frame that last used this counter slot, so its count is ready.
+        // (the stats lag by the frames in flight)
+        counter_slot = (counter_slot + 1) % counter.Count();
+        uint32_t* count = (uint32_t*)((char*)counter.mapped + counter_slot * counter.Stride());
+        counter.Invalidate();
+        uint32_t sampled = *count;
+        *count = 0;
+        counter.Flush();
+        double time = frame_timer.Span();
+        if(stale) --stale;
+        else samples += sampled;
+        accum_time     += time;
+        samples_per_sec = sampled / time;
+        if(accumulate) {
+            float active = 100.f * sampled / (ext.width * ext.height);
+            printf("RT: %5d frames  %7.2f Msamples/s  %5.1f%% of pixels sampled  %6.1f avg spp \r",
+                   vkray.accum.frame, samples_per_sec / 1e6, active, (double)samples / (ext.width * ext.height));
+        }
+
+        const VkPipelineStageFlags2 RT_STAGE = VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR;
+        const VkAccessFlags2        RW       = VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT;
+        BarrierBatch batch;
+        attachment.Barrier(batch, VK_IMAGE_LAYOUT_GENERAL, RT_STAGE, VK_ACCESS_2_SHADER_WRITE_BIT);
+        accum     .Barrier(batch, VK_IMAGE_LAYOUT_GENERAL, RT_STAGE, RW);
+        moments   .Barrier(batch, VK_IMAGE_LAYOUT_GENERAL, RT_STAGE, RW);
+        counter   .Barrier(batch, RT_STAGE, RW);
+        batch.Flush(cmd);                        // (waits for last frame's blit and accumulation)
+
+        vkray.BindDS(cmd, counter_slot * (uint32_t)counter.Stride());
         vkray.TraceRays(cmd, ext);
+        counter.Barrier(batch, VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT);
+        batch.Flush(cmd);
         attachment.Blit(cmd, swap.image, ext, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
         swapchain.EndCmd();
         swapchain.Submit();
+        ++vkray.accum.frame;
+    }
+
+    void RenderCPU(CCamera& camera, CLight& light, Swapchain& swapchain) {
+        CObject& root = camera.GetRoot();
+        root.Transform_nodes();
+
+        VkExtent2D ext = swapchain.GetExtent();
+        float aspect = (float)ext.width / (float)ext.height;
+        camera.SetPerspective(aspect, 40.f, 0.1f, 1000);
+        camera.Apply();
+
+        LightUniform light_uniform;
+        light_uniform.enabled  = light.enabled;
+        light_uniform.color    = light.color;
+        light_uniform.position = light.position;
+
+        if(cpu_image.Width() != ext.width || cpu_image.Height() != ext.height) cpu_image.SetSize(ext.width, ext.height);
+        cpuray.Render(CObject::cam_uniform, light_uniform, cpu_image);
+
+        //--- Upload and present ---
+        if(cpu_target.extent2D().width != ext.width || cpu_target.extent2D().height != ext.height) {
+            cpu_target.Data(cpu_image);
+        } else {
+            cpu_target.Write(cpu_image.Buffer());  // from the layout the last Blit left it in
+        }
+
+        swapchain.AcquireNext();
+        auto cmd  = swapchain.BeginCmd();
+        auto swap = swapchain.CurrBuffer();
+        cpu_target.Blit(cmd, swap.image, ext, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+        swapchain.EndCmd();
+        swapchain.Submit();
         swapchain.Wait();
+
+        if(cpu_stats) printf("CpuRay: %5.1f ms  %6.2f Mrays/s \r", cpuray.render_time * 1000, cpuray.ray_count / cpuray.render_time / 1e6);
+    }
+
+    // Regression check for the CPU fallback: renders one frame with a fixed random seed (so the image is deterministic),
+    // and compares it with a reference image. If the reference doesn't exist yet, the frame is saved as the reference.
+    // Returns false if the RMS error (0-255 per channel) is above tolerance.
+    bool CheckCPU(CCamera& camera, CLight& light, const char* reference, float tolerance = 1.0f, VkExtent2D ext = {320, 240}) {
+        CObject& root = camera.GetRoot();
+        root.Transform_nodes();
+        camera.SetPerspective((float)ext.width / (float)ext.height, 40.f, 0.1f, 1000);
+        camera.Apply();
+        Update();                                // instance transforms
+
+        CamUniform cam = CObject::cam_uniform;
+        cam.random = 0;
+        LightUniform light_uniform;
+        light_uniform.enabled  = light.enabled;
+        light_uniform.color    = light.color;
+        light_uniform.position = light.position;
+        cpu_image.SetSize(ext.width, ext.height);
+        cpuray.Render(cam, light_uniform, cpu_image);
+        CImage frame = cpu_image.toLDR();
+
+        FILE* file = fopen(reference, "rb");
+        if(!file) {
+            frame.Save(reference);
+            printf("CpuRay check: reference saved as %s\n", reference);
+            return true;
+        }
+        fclose(file);
+        CImage ref;
+        if(!ref.Load(reference) || ref.Width() != frame.Width() || ref.Height() != frame.Height()) {
+            LOGE("CpuRay check: %s is not a %dx%d image.\n", reference, ext.width, ext.height);
+            return false;
+        }
+        double sum = 0;
+        uint32_t count = ext.width * ext.height;
+        for(uint32_t i = 0; i < count; ++i) {
+            RGBA a = frame[i];
+            RGBA b = ref[i];
+            double dr = a.R - b.R,  dg = a.G - b.G,  db = a.B - b.B;
+            sum += dr * dr + dg * dg + db * db;
+        }
+        float rms = (float)sqrt(sum / (count * 3.0));
+        bool pass = rms <= tolerance;
+        printf("CpuRay check: RMS error %.3f (tolerance %.3f): %s\n", rms, tolerance, pass ? "PASS" : "FAIL");
+        if(!pass) frame.Save("cpuray_check.png");  // for comparison
+        return pass;
     }
-    
 };
     
 #endif
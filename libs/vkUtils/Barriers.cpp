@@ -0,0 +1,124 @@
+#include "Barriers.h"
+
+bool                  BarrierBatch::use_sync2     = false;
+VkPipelineStageFlags2 BarrierBatch::shader_stages = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT |
+                                                    VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT |
+                                                    VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+
+// Stage 0 means "nothing to wait for" (UNDEFINED), or "nothing waits" (PRESENT: the semaphore does).
+SyncState LayoutSync(VkImageLayout layout) {
+    switch(layout) {
+        case VK_IMAGE_LAYOUT_UNDEFINED                        : return {0, 0, layout};
+        case VK_IMAGE_LAYOUT_PREINITIALIZED                   : return {VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_WRITE_BIT, layout};
+        case VK_IMAGE_LAYOUT_GENERAL                          : return {VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT, layout};
+        case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL         : return {VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                                                                        VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, layout};
+        case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : return {VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                                                                        VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, layout};
+        case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL  : return {VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+                                                                        VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_SHADER_READ_BIT, layout};
+        case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL         : return {BarrierBatch::shader_stages, VK_ACCESS_2_SHADER_READ_BIT, layout};
+        case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL             : return {VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT,  layout};
+        case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL             : return {VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, layout};
+        case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR                  : return {0, 0, layout};
+        default : LOGW("LayoutSync: Unsupported image layout (%d)\n", layout);
+                  return {VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT, layout};
+    }
+}
+
+// A write, or a layout change, always needs a barrier. Reads after reads only need one if the stages or
+// accesses are new: the earlier barrier only made the last write visible to the ones it named.
+bool NeedsBarrier(const SyncState& prev, const SyncState& next) {
+    if(prev.layout != next.layout) return true;
+    if((prev.access | next.access) & WRITE_ACCESS) return true;
+    return (next.stage & ~prev.stage) || (next.access & ~prev.access);
+}
+
+void BarrierBatch::Image(VkImage image, const SyncState& src, const SyncState& dst, VkImageSubresourceRange range) {
+    ASSERT(dst.layout != VK_IMAGE_LAYOUT_UNDEFINED, "Can't set layout to VK_IMAGE_LAYOUT_UNDEFINED.");
+    VkImageMemoryBarrier2 barrier = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+    barrier.srcStageMask        = src.stage;
+    barrier.srcAccessMask       = src.access & WRITE_ACCESS;  // only writes need to be made available
+    barrier.dstStageMask        = dst.stage;
+    barrier.dstAccessMask       = dst.access;
+    barrier.oldLayout           = src.layout;
+    barrier.newLayout           = dst.layout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image               = image;
+    barrier.subresourceRange    = range;
+    images.push_back(barrier);
+}
+
+void BarrierBatch::Image(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t baseMipLevel, uint32_t mipLevels, uint32_t layers) {
+    if(oldLayout == newLayout) return;
+    VkImageSubresourceRange range = {VK_IMAGE_ASPECT_COLOR_BIT, baseMipLevel, mipLevels, 0, layers};  // NOTE: must match value in ImageView
+    if(newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
+        range.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+    Image(image, LayoutSync(oldLayout), LayoutSync(newLayout), range);
+}
+
+void BarrierBatch::Buffer(VkBuffer buffer, const SyncState& src, const SyncState& dst, VkDeviceSize offset, VkDeviceSize size) {
+    VkBufferMemoryBarrier2 barrier = {VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2};
+    barrier.srcStageMask        = src.stage;
+    barrier.srcAccessMask       = src.access & WRITE_ACCESS;
+    barrier.dstStageMask        = dst.stage;
+    barrier.dstAccessMask       = dst.access;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer              = buffer;
+    barrier.offset              = offset;
+    barrier.size                = size;
+    buffers.push_back(barrier);
+}
+
+void BarrierBatch::Flush(VkCommandBuffer cmd) {
+    if(!Count()) return;
+    if(use_sync2) {
+        VkDependencyInfo dependency = {VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+        dependency.imageMemoryBarrierCount  = (uint32_t)images.size();
+        dependency.pImageMemoryBarriers     = images.data();
+        dependency.bufferMemoryBarrierCount = (uint32_t)buffers.size();
+        dependency.pBufferMemoryBarriers    = buffers.data();
+        vkCmdPipelineBarrier2KHR(cmd, &dependency);
+    } else {  // synchronization 1: the same bits (all below 32), with the stages merged
+        VkPipelineStageFlags src_stages = 0;
+        VkPipelineStageFlags dst_stages = 0;
+        std::vector<VkImageMemoryBarrier>  image_barriers(images.size(),  {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER});
+        std::vector<VkBufferMemoryBarrier> buffer_barriers(buffers.size(), {VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER});
+        for(size_t i = 0; i < images.size(); ++i) {
+            auto& b = images[i];
+            auto& barrier = image_barriers[i];
+            src_stages |= (VkPipelineStageFlags)b.srcStageMask;
+            dst_stages |= (VkPipelineStageFlags)b.dstStageMask;
+            barrier.srcAccessMask       = (VkAccessFlags)b.srcAccessMask;
+            barrier.dstAccessMask       = (VkAccessFlags)b.dstAccessMask;
+            barrier.oldLayout           = b.oldLayout;
+            barrier.newLayout           = b.newLayout;
+            barrier.srcQueueFamilyIndex = b.srcQueueFamilyIndex;
+            barrier.dstQueueFamilyIndex = b.dstQueueFamilyIndex;
+            barrier.image               = b.image;
+            barrier.subresourceRange    = b.subresourceRange;
+        }
+        for(size_t i = 0; i < buffers.size(); ++i) {
+            auto& b = buffers[i];
+            auto& barrier = buffer_barriers[i];
+            src_stages |= (VkPipelineStageFlags)b.srcStageMask;
+            dst_stages |= (VkPipelineStageFlags)b.dstStageMask;
+            barrier.srcAccessMask       = (VkAccessFlags)b.srcAccessMask;
+            barrier.dstAccessMask       = (VkAccessFlags)b.dstAccessMask;
+            barrier.srcQueueFamilyIndex = b.srcQueueFamilyIndex;
+            barrier.dstQueueFamilyIndex = b.dstQueueFamilyIndex;
+            barrier.buffer              = b.buffer;
+            barrier.offset              = b.offset;
+            barrier.size                = b.size;
+        }
+        if(!src_stages) src_stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;     // sync1 doesn't allow empty stage masks
+        if(!dst_stages) dst_stages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+        vkCmdPipelineBarrier(cmd, src_stages, dst_stages, 0, 0, nullptr,
+                             (uint32_t)buffer_barriers.size(), buffer_barriers.data(),
+                             (uint32_t)image_barriers.size(),  image_barriers.data());
+    }
+    images.clear();
+    buffers.clear();
+}
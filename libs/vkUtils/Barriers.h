@@ -0,0 +1,51 @@
+// BarrierBatch
+// Collects image and buffer barriers, and records them with a single vkCmdPipelineBarrier2.
+// (or one vkCmdPipelineBarrier, with the same bits, when VK_KHR_synchronization2 is not enabled)
+//
+// Each barrier carries its own stage and access masks, so a transition only waits for the stages
+// that actually touched the resource. LayoutSync() gives the usual stages and accesses of a layout,
+// for callers that don't track them. CvkImage and CvkBuffer do track them: see CvkImage::Barrier().
+//
+// Usage:
+//   BarrierBatch batch;
+//   image .Barrier(batch, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT);
+//   buffer.Barrier(batch, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT);
+//   batch.Flush(cmd);   // one call for both
+
+#ifndef BARRIERS_H
+#define BARRIERS_H
+
+#include "CDevices.h"
+#include <vector>
+
+struct SyncState {            // last use of an image or buffer
+    VkPipelineStageFlags2 stage  = 0;
+    VkAccessFlags2        access = 0;
+    VkImageLayout         layout = VK_IMAGE_LAYOUT_UNDEFINED;  // (images)
+};
+
+static const VkAccessFlags2 WRITE_ACCESS = VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT |
+                                           VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT |
+                                           VK_ACCESS_2_HOST_WRITE_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT |
+                                           VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+
+SyncState LayoutSync(VkImageLayout layout);  // typical stages and accesses of an image in this layout
+bool NeedsBarrier(const SyncState& prev, const SyncState& next);  // false: read after read, already visible to 'next'
+
+class BarrierBatch {
+    std::vector<VkImageMemoryBarrier2>  images;
+    std::vector<VkBufferMemoryBarrier2> buffers;
+public:
+    static bool                  use_sync2;      // set by CAllocator::Init
+    static VkPipelineStageFlags2 shader_stages;  // stages that sample textures (+ray tracing, when enabled)
+
+    void Image (VkImage image, const SyncState& src, const SyncState& dst, VkImageSubresourceRange range);
+    void Image (VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t baseMipLevel = 0,
+                uint32_t mipLevels = VK_REMAINING_MIP_LEVELS, uint32_t layers = VK_REMAINING_ARRAY_LAYERS);  // untracked: masks from LayoutSync
+    void Buffer(VkBuffer buffer, const SyncState& src, const SyncState& dst, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+    void Flush (VkCommandBuffer cmd);            // record all pending barriers, in one call
+    uint32_t Count() { return (uint32_t)(images.size() + buffers.size()); }
+    ~BarrierBatch() { if(Count()) LOGW("BarrierBatch: %d barriers were never flushed.\n", Count()); }
+};
+
+#endif
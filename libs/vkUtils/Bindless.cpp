@@ -0,0 +1,155 @@
+#include "Bindless.h"
+#include <algorithm>
+
+BindlessTable::~BindlessTable() {
+    Destroy();
+}
+
+void BindlessTable::Init(VkDevice device, uint32_t max_images) {
+    Destroy();
+    this->device     = device;
+    this->max_images = max_images;
+    uint32_t ring = std::clamp(default_allocator->frames_in_flight, 1u, 3u);
+
+    //--- Layout ---
+    VkDescriptorSetLayoutBinding bindings[2] = {};
+    bindings[0].binding         = 0;
+    bindings[0].descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[0].descriptorCount = max_images;
+    bindings[0].stageFlags      = VK_SHADER_STAGE_ALL_GRAPHICS;
+    bindings[1].binding         = 1;
+    bindings[1].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[1].descriptorCount = 1;
+    bindings[1].stageFlags      = VK_SHADER_STAGE_ALL_GRAPHICS;
+
+    VkDescriptorBindingFlags flags[2] = {VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT, 0};  // unused texture slots may stay empty
+    VkDescriptorSetLayoutBindingFlagsCreateInfo flags_info = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO};
+    flags_info.bindingCount  = 2;
+    flags_info.pBindingFlags = flags;
+
+    VkDescriptorSetLayoutCreateInfo layout_info = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+    layout_info.pNext        = &flags_info;
+    layout_info.bindingCount = 2;
+    layout_info.pBindings    = bindings;
+    VKERRCHECK(vkCreateDescriptorSetLayout(device, &layout_info, nullptr, &layout));
+
+    //--- Pool ---
+    VkDescriptorPoolSize sizes[2] = {{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, max_images * ring},
+                                     {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         ring}};
+    VkDescriptorPoolCreateInfo pool_info = {VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+    pool_info.maxSets       = ring;
+    pool_info.poolSizeCount = 2;
+    pool_info.pPoolSizes    = sizes;
+    VKERRCHECK(vkCreateDescriptorPool(device, &pool_info, nullptr, &pool));
+
+    //--- Sets (one per slot) ---
+    std::vector<VkDescriptorSetLayout> layouts(ring, layout);
+    sets.resize(ring);
+    VkDescriptorSetAllocateInfo alloc_info = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+    alloc_info.descriptorPool     = pool;
+    alloc_info.descriptorSetCount = ring;
+    alloc_info.pSetLayouts        = layouts.data();
+    VKERRCHECK(vkAllocateDescriptorSets(device, &alloc_info, sets.data()));
+    written  = 0;
+    capacity = 0;
+    inx      = 0;
+}
+
+void BindlessTable::Destroy() {
+    if(!device) return;
+    vkDeviceWaitIdle(device);
+    if(pool)   vkDestroyDescriptorPool     (device, pool,   nullptr);  pool   = VK_NULL_HANDLE;
+    if(layout) vkDestroyDescriptorSetLayout(device, layout, nullptr);  layout = VK_NULL_HANDLE;
+    sets.clear();
+    buffer.Clear();
+    device = 0;
+}
+
+int BindlessTable::AddImage(CvkImage* image) {
+    if(!image) return -1;
+    auto it = image_ids.find(image);
+    if(it != image_ids.end()) return it->second;
+    int id = (int)images.size();
+    if(max_images && (uint32_t)id >= max_images) {    // no descriptor for it: draw without the texture
+        LOGE("BindlessTable: More than %d images.\n", max_images);
+        return -1;
+    }
+    images.push_back(image);
+    image_ids[image] = id;
+    return id;
+}
+
+int BindlessTable::Register(int id, const BindlessMaterial& material, const void* owner) {
+    bool valid = (id >= 0 && id < (int)materials.size());
+    if(valid && materials[id] == material) return id;  // unchanged
+    if(valid && owner && owners[id] == owner) {         // modify in place
+        materials[id] = material;
+        ++version;
+        return id;
+    }
+    materials.push_back(material);                     // new (or diverged from a shared material)
+    owners.push_back(owner);
+    ++version;
+    return (int)materials.size() - 1;
+}
+
+// The next slot was last current at least frames_in_flight frames ago, so if Update is called once
+// per frame, after AcquireNext, no frame still in flight reads it.
+void BindlessTable::Update() {
+    ASSERT(!sets.empty(), "BindlessTable: Call Init() first.\n");
+    uint32_t ring    = (uint32_t)sets.size();
+    uint32_t img_cnt = (uint32_t)images.size();
+    uint32_t mat_cnt = std::max((uint32_t)materials.size(), 1u);
+    bool grow = mat_cnt > capacity;
+    if(img_cnt == written && !grow && uploaded == version) return;
+
+    // Writing descriptors is rare (new textures or more materials), so just wait for the gpu.
+    if(img_cnt > written || grow) vkDeviceWaitIdle(device);
+
+    std::vector<VkWriteDescriptorSet> writes;
+    std::vector<VkDescriptorImageInfo> img_info;
+    img_info.reserve(img_cnt - written);
+    for(uint32_t i = written; i < img_cnt; ++i) {
+        CvkImage& img = *images[i];
+        img_info.push_back({img.sampler, img.view, img.GetLayout()});
+    }
+    if(!img_info.empty()) {
+        for(auto set : sets) {
+            VkWriteDescriptorSet write = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+            write.dstSet          = set;
+            write.dstBinding      = 0;
+            write.dstArrayElement = written;
+            write.descriptorCount = (uint32_t)img_info.size();
+            write.descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            write.pImageInfo      = img_info.data();
+            writes.push_back(write);
+        }
+        written = img_cnt;
+    }
+
+    std::vector<VkDescriptorBufferInfo> buf_info(ring);
+    if(grow) {
+        capacity = std::max(mat_cnt, capacity * 2);
+        uint32_t slot_size = (capacity * sizeof(BindlessMaterial) + 0xFF) & ~0xFF;  // 256: >= minStorageBufferOffsetAlignment
+        buffer.Data(0, ring, slot_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, &buffer.mapped);
+        for(uint32_t i = 0; i < ring; ++i) {
+            buf_info[i] = {buffer, i * buffer.Stride(), buffer.Stride()};
+            VkWriteDescriptorSet write = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+            write.dstSet          = sets[i];
+            write.dstBinding      = 1;
+            write.descriptorCount = 1;
+            write.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            write.pBufferInfo     = &buf_info[i];
+            writes.push_back(write);
+        }
+        uploaded = version - 1;  // every slot is stale
+    }
+    if(!writes.empty()) vkUpdateDescriptorSets(device, (uint32_t)writes.size(), writes.data(), 0, nullptr);
+
+    if(uploaded != version) {
+        inx = (inx + 1) % ring;
+        if(!materials.empty()) memcpy((char*)buffer.mapped + inx * buffer.Stride(), materials.data(), materials.size() * sizeof(BindlessMaterial));
+        buffer.Flush();
+        uploaded = version;
+    }
+}
@@ -0,0 +1,73 @@
+// BindlessTable
+// A global texture array, and a material SSBO, shared by all draws (and the raytracer).
+//
+// Textures are registered once, and addressed by index (texid).
+// Materials are registered once, and addressed by index (material id).
+// Per-draw state is then just a push constant (model matrix + material id),
+// so draws don't need their own descriptor sets.
+//
+// Descriptor set layout (bind as set 1):
+//   binding 0 : sampler2D textures[max_images]   (partially bound)
+//   binding 1 : Material  materials[]            (storage buffer)
+//
+// With frames in flight, the materials get one buffer slot, and one descriptor set, per frame.
+// When a material changes, Update() moves on to the next slot, and uploads all materials into it,
+// while earlier frames still read their own. (AcquireNext has waited for the frame that last used it)
+//
+// Usage:
+//   BindlessTable table;
+//   table.Init(device);            // after CAllocator::frames_in_flight is set
+//   int tex = table.AddImage(&image);
+//   int mat = table.Register(-1, material, this);
+//   pipeline.SetBindless(table);
+//   table.Update();  // once per frame, after AcquireNext, and after registering this frame's materials
+
+#ifndef BINDLESS_H
+#define BINDLESS_H
+
+#include <cstring>
+#include <unordered_map>
+#include "vkImages.h"
+
+struct BindlessMaterial {         // matches "Material" in bindless.glsl (std430)
+    vec4 color[4] {};             // albedo, emission, normal, orm
+    int  texid[4] {-1,-1,-1,-1};  // index into textures[] (-1 = none)
+    bool operator==(const BindlessMaterial& m) const { return !memcmp(this, &m, sizeof(m)); }
+    bool operator!=(const BindlessMaterial& m) const { return !(*this == m); }
+};
+
+struct DrawConstants {            // push constants, per draw
+    mat4     matrix;              // world matrix
+    int      material = -1;       // material id
+};
+
+class BindlessTable {
+    VkDevice         device = 0;
+    VkDescriptorPool pool   = 0;
+    uint32_t         max_images = 0;
+    uint32_t         written    = 0;  // images already written to the descriptor sets
+    uint32_t         capacity   = 0;  // materials per slot
+    uint32_t         version    = 0;  // incremented when a material changes
+    uint32_t         uploaded   = 0;  // version in the current slot
+    uint32_t         inx        = 0;  // current slot (and set)
+    CvkBuffer        buffer;          // material SSBO: one slot per frame in flight
+    std::vector<VkDescriptorSet> sets;  // one per slot
+    std::unordered_map<const CvkImage*, int> image_ids;
+    std::vector<const void*> owners;  // who may modify each material in place
+
+public:
+    VkDescriptorSetLayout layout = 0;
+    std::vector<CvkImage*>        images;
+    std::vector<BindlessMaterial> materials;
+
+    ~BindlessTable();
+    void Init(VkDevice device, uint32_t max_images = 1024);
+    void Destroy();
+
+    int  AddImage(CvkImage* image);  // returns texid (-1 if null, or if the table is full). Same image returns same id.
+    int  Register(int id, const BindlessMaterial& material, const void* owner = 0);  // returns material id
+    void Update();                   // write new descriptors, and upload changed materials into the next slot
+    VkDescriptorSet Set() { return sets[inx]; }  // current set (bind after Update)
+};
+
+#endif
@@ -24,54 +24,9 @@ static VkExtent2D Extent2D(const CImageBase& img) { return {img.Width(), img.Hei
 static VkExtent3D Extent3D(const VkExtent2D ext2D){ return {ext2D.width, ext2D.height, 1}; }
 
 void setLayout(VkCommandBuffer cmd, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t baseMipLevel, uint32_t mipLevels, uint32_t layers) {
-    ASSERT(newLayout != VK_IMAGE_LAYOUT_UNDEFINED, "Can't set layout to VK_IMAGE_LAYOUT_UNDEFINED.");
-    if(oldLayout == newLayout) return;
-    VkImageMemoryBarrier barrier = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
-    barrier.oldLayout = oldLayout;
-    barrier.newLayout = newLayout;
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.image = image;
-    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;  // NOTE: must match value in ImageView
-    barrier.subresourceRange.baseMipLevel   = baseMipLevel; //0;
-    barrier.subresourceRange.levelCount     = mipLevels;    //1;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount     = layers;       //1;
-
-    if(newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
-        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
-
-    struct LayoutSet { uint32_t AccessMask; uint32_t Stage; };  //what,where
-    static const std::map<VkImageLayout, LayoutSet> layouts = {
-        {VK_IMAGE_LAYOUT_UNDEFINED,                        {0,                                            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT            }},  //0
-        {VK_IMAGE_LAYOUT_GENERAL,                          {0,                                            VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT         }},  //1
-        {VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,         {VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,         VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT}},  //2
-        {VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, {VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
-                                                            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT   }},  //3
-        {VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,  {VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,  VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT        }},  //4
-        {VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,         {VK_ACCESS_SHADER_READ_BIT,                    VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT        }},  //5
-        {VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,             {VK_ACCESS_TRANSFER_READ_BIT,                  VK_PIPELINE_STAGE_TRANSFER_BIT               }},  //6
-        {VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,             {VK_ACCESS_TRANSFER_WRITE_BIT,                 VK_PIPELINE_STAGE_TRANSFER_BIT               }},  //7
-        {VK_IMAGE_LAYOUT_PREINITIALIZED,                   {0,                                            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT            }},  //8  (Linear images only)
-        {VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,                  {0,                                            VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT         }},
-
-    };
-    auto prev_it = layouts.find(oldLayout);  if(prev_it == layouts.end()) { LOGE("Unsupported image layout (oldLayout)\n"); return;}
-    auto next_it = layouts.find(newLayout);  if(next_it == layouts.end()) { LOGE("Unsupported image layout (newLayout)\n"); return;}
-    LayoutSet prev = prev_it->second;
-    LayoutSet next = next_it->second;
-    barrier.srcAccessMask = prev.AccessMask;
-    barrier.dstAccessMask = next.AccessMask;
-
-    VkDependencyFlags depFlags = VK_DEPENDENCY_BY_REGION_BIT;
-    vkCmdPipelineBarrier(cmd,
-        prev.Stage,  // We wait for prev-stage to finish
-        next.Stage,  // Next-stage waits for us to finish
-        depFlags,
-        0, nullptr,  // MemoryBarriers
-        0, nullptr,  // BufferMemoryBarriers
-        1, &barrier  // ImageMemoryBarriers
-    );
+    BarrierBatch batch;
+    batch.Image(image, oldLayout, newLayout, baseMipLevel, mipLevels, layers);
+    batch.Flush(cmd);
 }
 //------------------------------------------------------------------------------------------------
 
@@ -152,6 +107,11 @@ void CAllocator::Init(VkInstance instance, const CQueue& queue, VkDeviceSize blo
     if(!default_allocator) default_allocator = this;
     LOGI("VMA Allocator created\n");
 
+    BarrierBatch::use_sync2 = queue.gpu.extensions.IsPicked("VK_KHR_synchronization2") &&
+                              queue.gpu.features_Synchronization2.synchronization2 && vkCmdPipelineBarrier2KHR;
+    if(queue.gpu.extensions.IsPicked("VK_KHR_ray_tracing_pipeline"))
+        BarrierBatch::shader_stages |= VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR;
+
     yuv_sampler.Create(device);
 }
 
@@ -159,6 +119,7 @@ CAllocator::~CAllocator() {
     if(default_allocator == this) {
         default_allocator = 0;
     }
+    Sync();
     vmaDestroyAllocator(allocator);
 
     //if(command_buffer)  vkFreeCommandBuffers(device, command_pool, 1, &command_buffer);
@@ -189,6 +150,33 @@ vmaBuffer CAllocator::vkmalloc(uint64_t size, VkBufferUsageFlags usage, bool map
 void CAllocator::vkfree(vmaBuffer vbuf) {
     vmaDestroyBuffer(allocator, vbuf.buffer, vbuf.bufferAlloc);
 }
+
+void CAllocator::Release(vmaBuffer vbuf) {
+    if(IsDone(last_ticket)) vkfree(vbuf);
+    else garbage.push_back({last_ticket, vbuf});
+}
+
+void CAllocator::Collect() {
+    size_t kept = 0;
+    for(auto& item : garbage) {
+        if(IsDone(item.first)) vkfree(item.second);
+        else garbage[kept++] = item;
+    }
+    garbage.resize(kept);
+}
+//------------------------------------------------------------------------
+
+//---------------------------------EndCmd---------------------------------
+// Submits without waiting, unless the host needs the result. (eg. ReadImage)
+// The final barrier makes the transfer writes visible to any later submit on this queue.
+CmdTicket CAllocator::EndCmd(bool wait) {
+    VkMemoryBarrier barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT | VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+                         0, 1, &barrier, 0, nullptr, 0, nullptr);
+    return CCmd::End(true, wait);
+}
 //------------------------------------------------------------------------
 
 void CAllocator::CreateBuffer(const void* data, uint64_t size, VkFlags usage, VmaMemoryUsage memtype, VkBuffer& buffer, VmaAllocation& alloc, void** mapped) {
@@ -211,7 +199,7 @@ void CAllocator::CreateBuffer(const void* data, uint64_t size, VkFlags usage, Vm
             bufCopyRegion.size = size;
             vkCmdCopyBuffer(command_buffer, stage_buf, buf, 1, &bufCopyRegion);
         EndCmd();
-        vkfree(stage_buf);
+        Release(stage_buf);
     }
     buffer = buf.buffer;
     alloc  = buf.bufferAlloc;
@@ -219,6 +207,7 @@ void CAllocator::CreateBuffer(const void* data, uint64_t size, VkFlags usage, Vm
 }
 
 void CAllocator::DestroyBuffer(VkBuffer buffer, VmaAllocation alloc) {
+    if(!IsDone(last_ticket)) Wait();  // buffer may still be used by a pending upload
     buf_stats -= alloc->GetSize();
     vmaDestroyBuffer(allocator, buffer, alloc);
 }
@@ -323,6 +312,7 @@ void CAllocator::CreateImage(VkExtent2D extent, VkFormat format, VkSampleCountFl
 
     VkImageAspectFlags aspectFlags=0;
     if(usage & VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT)         aspectFlags = VK_IMAGE_ASPECT_COLOR_BIT;
+    if(usage & VK_IMAGE_USAGE_STORAGE_BIT)                  aspectFlags = VK_IMAGE_ASPECT_COLOR_BIT;
     if(usage & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) aspectFlags = VK_IMAGE_ASPECT_DEPTH_BIT;// | VK_IMAGE_ASPECT_STENCIL_BIT;
 
     // Create ImageView
@@ -361,8 +351,11 @@ void CAllocator::WriteImage(VkImage& image, VkImageLayout layout, VkExtent3D ext
     else     memset(stagebuf,    0, size);  // if not data, clear to black
 
     //  Copy image from staging buffer to texture
+    bool mipmap = (mipLevels > 1) && CanBlit(format);
+    BarrierBatch batch;
     BeginCmd();
-        SetImageLayout(image, layout, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevel, mipLevels, arrayLayers);
+        batch.Image(image, layout, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevel, mipLevels, arrayLayers);
+        batch.Flush(command_buffer);
         VkBufferImageCopy region = {};
         region.bufferOffset     =0;
         region.bufferRowLength  =0;
@@ -374,11 +367,11 @@ void CAllocator::WriteImage(VkImage& image, VkImageLayout layout, VkExtent3D ext
         region.imageOffset = {0, 0, 0};
         region.imageExtent = extent;
         vkCmdCopyBufferToImage(command_buffer, stagebuf, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-        SetImageLayout(image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipLevel, mipLevels, arrayLayers);
+        if(mipmap) RecordMipmaps(batch, image, extent.width, extent.height, mipLevels, arrayLayers);  // same submit
+        else batch.Image(image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipLevel, mipLevels, arrayLayers);
+        batch.Flush(command_buffer);
     EndCmd();
-    vkfree(stagebuf);
-
-    if(mipLevels > 1) GenerateMipmaps(image, format, extent.width, extent.height, mipLevels, arrayLayers);
+    Release(stagebuf);
 }
 //------------------------------------------------------------------------
 //--------------------------------ReadImage-------------------------------
@@ -409,12 +402,26 @@ void CAllocator::ReadImage(VkImage& image, VkImageLayout layout, VkExtent3D exte
         region.imageExtent = extent;
         vkCmdCopyImageToBuffer(command_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, stagebuf, 1, &region);
         SetImageLayout(image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, layout, 0, mipLevels, arrayLayers);
-    EndCmd();
+    EndCmd(true);
 
     memcpy(data, stagebuf, size);
     vkfree(stagebuf);
 }
 //------------------------------------------------------------------------
+//--------------------------------ReadBuffer------------------------------
+void CAllocator::ReadBuffer(VkBuffer buffer, uint64_t size, void* data, uint64_t offset) {
+    auto stagebuf = vkmalloc(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+    BeginCmd();
+        VkBufferCopy region = {};
+        region.srcOffset = offset;
+        region.dstOffset = 0;
+        region.size      = size;
+        vkCmdCopyBuffer(command_buffer, buffer, stagebuf, 1, &region);
+    EndCmd(true);
+    memcpy(data, stagebuf, size);
+    vkfree(stagebuf);
+}
+//------------------------------------------------------------------------
 
 void CAllocator::SetImageLayout(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t baseMipLevel, uint32_t mipLevels, uint32_t layers) {
     if(oldLayout == newLayout) return;
@@ -425,10 +432,9 @@ void CAllocator::SetImageLayout(VkImage image, VkImageLayout oldLayout, VkImageL
 }
 
 //---------------------------------Mipmaps--------------------------------
-bool CAllocator::GenerateMipmaps(VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels, uint32_t arrayLayers) {
-    // Check if image format supports linear blitting
+bool CAllocator::CanBlit(VkFormat format) {
     VkFormatProperties formatProperties;
-    vkGetPhysicalDeviceFormatProperties(gpu, imageFormat, &formatProperties);
+    vkGetPhysicalDeviceFormatProperties(gpu, format, &formatProperties);
 
     if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)) {
         LOGW("GenerateMipmaps: Texture image format does not support linear blitting.\n");
@@ -439,16 +445,25 @@ bool CAllocator::GenerateMipmaps(VkImage image, VkFormat imageFormat, int32_t te
         LOGW("GenerateMipmaps: Texture image format does not support blitting.\n");
         return false;
     }
+    return true;
+}
 
+// Each level is blitted from the one above it. The barrier before each blit also carries the
+// previous level's transition to SHADER_READ, so there is one barrier call per level.
+// Leaves the barrier for the last two levels in 'batch'.
+void CAllocator::RecordMipmaps(BarrierBatch& batch, VkImage image, int32_t texWidth, int32_t texHeight, uint32_t mipLevels, uint32_t arrayLayers) {
     LOGI("Generate mipmaps on GPU(%d)\n", mipLevels);
-    BeginCmd();
     int32_t mipW = texWidth;
     int32_t mipH = texHeight;
+    VkImageSubresourceRange range = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, arrayLayers};
+    SyncState written   = {VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL};
+    SyncState blit_src  = {VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT,  VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL};
+    SyncState sampled   = LayoutSync(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
-    SetImageLayout(image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, mipLevels, arrayLayers);
     for (uint32_t i = 1; i < mipLevels; i++) {  // largest image : i=0
-        uint32_t baseMip = i-1;
-        SetImageLayout(image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, baseMip, 1, arrayLayers);
+        range.baseMipLevel = i-1;
+        batch.Image(image, written, blit_src, range);
+        batch.Flush(command_buffer);
 
         VkImageBlit blit = {};
         blit.srcOffsets[0] = {0, 0, 0};
@@ -472,15 +487,27 @@ bool CAllocator::GenerateMipmaps(VkImage image, VkFormat imageFormat, int32_t te
             1, &blit,
             VK_FILTER_LINEAR);
 
-        SetImageLayout(image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, baseMip, 1, arrayLayers);
+        batch.Image(image, blit_src, sampled, range);  // flushed with the next level's barrier
     }
-    SetImageLayout(image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipLevels-1, 1, arrayLayers);
+    range.baseMipLevel = mipLevels-1;
+    batch.Image(image, written, sampled, range);
+}
+
+bool CAllocator::GenerateMipmaps(VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels, uint32_t arrayLayers) {
+    if(!CanBlit(imageFormat)) return false;
+    BarrierBatch batch;
+    BeginCmd();
+    batch.Image(image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, mipLevels, arrayLayers);
+    batch.Flush(command_buffer);
+    RecordMipmaps(batch, image, texWidth, texHeight, mipLevels, arrayLayers);
+    batch.Flush(command_buffer);
     EndCmd();
     return true;
 }
 //------------------------------------------------------------------------
 //---------------------------------------------------
 void CAllocator::DestroyImage(VkImage image, VkImageView view, VmaAllocation alloc) {
+    if(!IsDone(last_ticket)) Wait();  // image may still be used by a pending upload
     if(view) vkDestroyImageView(device, view, nullptr);
     if(image) vmaDestroyImage(allocator, image, alloc);
     img_stats -= alloc->GetSize();
@@ -501,14 +528,18 @@ CvkBuffer::~CvkBuffer() { Clear(); }
 
 void CvkBuffer::Clear() {
     if(!allocator) { allocator = default_allocator; }
-    if(buffer) {
-        VKERRCHECK(vkQueueWaitIdle(allocator->queue));
-        allocator->DestroyBuffer(buffer, allocation);
-    }
+    if(buffer) VKERRCHECK(vkQueueWaitIdle(allocator->queue));
+    Release();
+}
+
+void CvkBuffer::Release() {
+    if(!allocator) { allocator = default_allocator; }
+    if(buffer) allocator->DestroyBuffer(buffer, allocation);
     buffer = 0;
     count  = 0;
     stride = 0;
     mapped = 0;
+    sync   = {};
 }
 
 // move construction
@@ -519,6 +550,7 @@ void CvkBuffer::swap(CvkBuffer& other) {
     std::swap(count,     other.count);
     std::swap(stride,    other.stride);
     std::swap(mapped,    other.mapped);
+    std::swap(sync,      other.sync);
 }
 
 void CvkBuffer::Data(const void* data, uint32_t count, uint32_t stride, VkFlags usage, VmaMemoryUsage memtype, void** mapped ) {
@@ -531,6 +563,13 @@ void CvkBuffer::Data(const void* data, uint32_t count, uint32_t stride, VkFlags
     this->stride = stride;
 }
 
+void CvkBuffer::Barrier(BarrierBatch& batch, VkPipelineStageFlags2 stage, VkAccessFlags2 access) {
+    SyncState next = {stage, access};
+    if(!NeedsBarrier(sync, next)) return;
+    batch.Buffer(buffer, sync, next);
+    sync = next;
+}
+
 void CvkBuffer::Invalidate() {  //
     vmaInvalidateAllocation(*allocator, allocation, 0, VK_WHOLE_SIZE);
 }
@@ -549,7 +588,7 @@ VkDeviceAddress CvkBuffer::DeviceAddress() {
 VBO::VBO(const void* data, uint32_t count, uint32_t stride) {Data(data, count, stride);}
 
 void VBO::Data(const void* data, uint32_t count, uint32_t stride) {  // does NOT pack normals
-    CvkBuffer::Data(data, count, stride, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+    CvkBuffer::Data(data, count, stride, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_GPU_ONLY);  // (ReadBuffer)
 }
 
 // Convert vec3 to VK_FORMAT_A2B10G10R10_SNORM_PACK32
@@ -586,11 +625,11 @@ IBO::IBO(const uint16_t* data, uint32_t count) {Data(data, count);}
 IBO::IBO(const uint32_t* data, uint32_t count) {Data(data, count);}
 
 void IBO::Data(const uint16_t* data, uint32_t count) {
-    CvkBuffer::Data(data, count, 2, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+    CvkBuffer::Data(data, count, 2, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_GPU_ONLY);  // (ReadBuffer)
 }
 
 void IBO::Data(const uint32_t* data, uint32_t count) {
-    CvkBuffer::Data(data, count, 4, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+    CvkBuffer::Data(data, count, 4, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_GPU_ONLY);  // (ReadBuffer)
 }
 
 void IBO::Data(const IndexArray& index) {
@@ -600,13 +639,15 @@ void IBO::Data(const IndexArray& index) {
 //--------------------------UBO-----------------------
 UBO::UBO(VkDeviceSize size, uint32_t count) {Allocate(size, count);}
 void UBO::Allocate(VkDeviceSize size, uint32_t count) {
+    if(!allocator) allocator = default_allocator;
+    if(!count) count = allocator->frames_in_flight;  // ring: frames in flight each read their own slot
     VkDeviceSize blocksize = RoundUp(size, 0x100);  // memory alignment: 256 bytes
-    Data(0, count, blocksize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, &mapped);
+    Data(0, count, blocksize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, &mapped);  // (ReadBuffer)
 }
 
 void UBO::Set(const void* data, size_t size) {
     if(!count) Allocate(size);
-    assert((stride == RoundUp(size, 0x100)) && (count==1));
+    assert(stride == RoundUp(size, 0x100));
     Update(data);
 }
 
@@ -635,10 +676,10 @@ void SBO::Allocate(VkDeviceSize size) {
 //--------------------------ABO-----------------------
 ABO::ABO(VkDeviceSize size, ABOType type) {ABO::Allocate(size, type);}
 
-void ABO::Allocate(VkDeviceSize size, ABOType type) {
+void ABO::Allocate(VkDeviceSize size, ABOType type, bool host) {
     if(structure) Clear();
     VkFlags usage = VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
-    Data(0, 1, size, usage, VMA_MEMORY_USAGE_GPU_ONLY);
+    Data(0, 1, size, usage, host ? VMA_MEMORY_USAGE_CPU_ONLY : VMA_MEMORY_USAGE_GPU_ONLY);
     CreateAS(VkAccelerationStructureTypeKHR(type));
 }
 
@@ -651,6 +692,14 @@ void ABO::Clear() {
     CvkBuffer::Clear();
 }
 
+void ABO::Release() {
+    if(structure) {
+        vkDestroyAccelerationStructureKHR(allocator->device, structure, nullptr);
+        structure = nullptr;
+    }
+    CvkBuffer::Release();
+}
+
 void ABO::CreateAS(VkAccelerationStructureTypeKHR type) { // Create BLAS/TLAS structure
     VkAccelerationStructureCreateInfoKHR createInfo{VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR};
     createInfo.type   = type; //VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
@@ -31,25 +31,27 @@
 
 
 #include "CDevices.h"
+#include "Barriers.h"
 #include "vk_mem_alloc.h"
 //#include "CImage.h"
 #include "matrix.h"
 
 #undef MOVE_SEMANTICS
 //------------------------------------------------------------
-#define MOVE_SEMANTICS(CLASS)                                \
-    public:                                                  \
-        CLASS(const CLASS&) = delete;                        \
-        CLASS& operator=(const CLASS&) = delete;             \
-        CLASS(CLASS&& other) noexcept { swap(other); }       \
-        CLASS& operator=(CLASS&& other) noexcept {           \
-            if(this != &other) swap(other);                  \
-            return *this;                                    \
-        }                                                    \
-    protected:                                               \
+#define MOVE_SEMANTICS(CLASS)                                     \
+    public:                                                       \
+        CLASS(const CLASS&) = delete;                             \
+        CLASS& operator=(const CLASS&) = delete;                  \
+        CLASS(CLASS&& other) noexcept : CLASS() { swap(other); }  \
+        CLASS& operator=(CLASS&& other) noexcept {                \
+            if(this != &other) swap(other);                       \
+            return *this;                                         \
+        }                                                         \
+    protected:                                                    \
         void swap(CLASS& other);
 //------------------------------------------------------------
 
+// Single transition, with the stages and accesses of LayoutSync(). To transition several images at once, use a BarrierBatch.
 void setLayout(VkCommandBuffer cmd, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t baseMipLevel = 0, uint32_t mipLevels = VK_REMAINING_MIP_LEVELS, uint32_t layers = VK_REMAINING_ARRAY_LAYERS);
 
 //------------------------------------vmaBuffer-----------------------------------
@@ -83,8 +85,12 @@ class CAllocator : public CCmd {
     //VkQueue          queue;
     //VkCommandPool    command_pool;
     //VkCommandBuffer  command_buffer;
-    void BeginCmd(){CCmd::Begin();}
-    void EndCmd(){CCmd::End(true);}
+    // Uploads are submitted without waiting. Staging buffers are freed once their ticket is done.
+    std::vector<std::pair<CmdTicket, vmaBuffer>> garbage;
+    void BeginCmd(){Collect();  CCmd::Begin();}
+    CmdTicket EndCmd(bool wait = false);
+    void Release(vmaBuffer sb);            // free, once the last submit is done
+    void Collect();                        // free staging buffers of finished submits
 
     void SetImageLayout(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t baseMipLevel = 0, uint32_t mipLevels = VK_REMAINING_MIP_LEVELS, uint32_t layers = VK_REMAINING_ARRAY_LAYERS);
 
@@ -105,6 +111,8 @@ class CAllocator : public CCmd {
     void CreateImage(const void* data, VkExtent3D extent, VkFormat format, uint32_t mipLevels, uint32_t arrayLayers, VkImageViewType viewType, VkImageUsageFlags usage, VkImage& image, VmaAllocation& alloc, VkImageView& view, void** mapped = 0);
     void CreateImage(VkExtent2D extent, VkFormat format, VkSampleCountFlagBits samples, VkImageUsageFlags usage, VkImage& image, VmaAllocation& alloc, VkImageView& view);  // For Swapchain Attachments
     void DestroyImage(VkImage image, VkImageView view, VmaAllocation alloc);
+    bool CanBlit(VkFormat format);
+    void RecordMipmaps(BarrierBatch& batch, VkImage image, int32_t texWidth, int32_t texHeight, uint32_t mipLevels, uint32_t arrayLayers);  // all mips in TRANSFER_DST
     bool GenerateMipmaps(VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels, uint32_t arrayLayers);
     void WriteImage(VkImage& image, VkImageLayout layout, VkExtent3D extent, VkFormat format, const void* data, uint32_t mipLevel=0, uint32_t mipLevels=1, uint32_t arrayLayers=1);
     void ReadImage (VkImage& image, VkImageLayout layout, VkExtent3D extent, VkFormat format, void* data);
@@ -118,11 +126,14 @@ public:
     CAllocator(VkInstance instance, const CQueue& queue, VkDeviceSize blockSize=256);
     virtual ~CAllocator();
     void Init(VkInstance instance, const CQueue& queue, VkDeviceSize blockSize=256); // Select a transfer queue for staging operations.
+    void Sync() {Wait();  Collect();}      // wait for all pending uploads
 
     float maxAnisotropy = 1.0f;
     bool  useRTX        = false;
     bool  pack_normals  = false;
+    uint32_t frames_in_flight = 1;  // UBO ring size, and FBO frames the CPU may run ahead. (Set before creating UBOs and FBOs. Max 3)
     std::vector<VmaBudget> GetBudget();
+    void ReadBuffer(VkBuffer buffer, uint64_t size, void* data, uint64_t offset = 0);  // Copy buffer contents to host memory (needs TRANSFER_SRC usage: VBO, IBO and UBO have it)
     operator VmaAllocator () {return allocator;}
 };
 
@@ -140,6 +151,7 @@ protected:
     uint32_t      count;
 protected:
     VkDeviceSize  stride;
+    SyncState     sync;       // last use, for Barrier()
 public:
     void* mapped = nullptr;
 
@@ -147,6 +159,7 @@ public:
     CvkBuffer();
     ~CvkBuffer();
     virtual void Clear();
+    virtual void Release();  // Clear, without waiting for the queue (the caller knows the GPU is done with it)
     void Invalidate();  // Invalidate cache before reading (only needed if not HOST_COHERENT)
     void Flush();       // Flush the buffer after writing  (only needed if not HOST_COHERENT)
     void Data(const void* data, uint32_t count, uint32_t stride, VkFlags usage, VmaMemoryUsage memtype=VMA_MEMORY_USAGE_GPU_ONLY, void** mapped = nullptr);
@@ -154,6 +167,7 @@ public:
     VkDeviceSize Stride(){ return stride; }
     VkDeviceSize size(){ return stride * count; }
     VkDeviceAddress DeviceAddress();  // Requires Vulkan 1.2
+    void Barrier(BarrierBatch& batch, VkPipelineStageFlags2 stage, VkAccessFlags2 access);  // queue a dependency on the last use (flush before this use)
     operator VkBuffer () {return buffer;}
     operator VkBuffer* () {return &buffer;}
 };
@@ -188,10 +202,10 @@ class UBO : public CvkBuffer {  // Uniform buffer
 public:
     using CvkBuffer::CvkBuffer;
     UBO() : CvkBuffer() {}
-    UBO(VkDeviceSize size, uint32_t count=1);
+    UBO(VkDeviceSize size, uint32_t count=0);            // count=0: one slot per frame in flight
     void Set(const void* data, size_t size);
-    void Allocate(VkDeviceSize size, uint32_t count=1);
-    void Update(const void* data);                  // update entire buffer
+    void Allocate(VkDeviceSize size, uint32_t count=0);  // count=0: one slot per frame in flight
+    void Update(const void* data);                  // write the next slot in the ring, and make it current
     void Update(const void* data, uint32_t index);  // update a single item only
     uint32_t index=0;
     VkFence fence=0;  // optional, but may improve performance
@@ -214,8 +228,9 @@ public:
     VkAccelerationStructureKHR structure = VK_NULL_HANDLE;
     using CvkBuffer::CvkBuffer;
     ABO(VkDeviceSize size, ABOType type);
-    void Allocate(VkDeviceSize size, ABOType type);
+    void Allocate(VkDeviceSize size, ABOType type, bool host=false);  // host: in host-visible memory, for host builds
     void Clear()  override;
+    void Release() override;
     ~ABO(){Clear();}
 };
 
@@ -105,6 +105,7 @@ void CPhysicalDevices::Init(const VkInstance instance) {
         gpu.extensions.Add("VK_KHR_swapchain");
         gpu.extensions.Add("VK_KHR_buffer_device_address");
         //gpu.extensions.Add("VK_KHR_sampler_ycbcr_conversion");
+        if(gpu.extensions.Has("VK_KHR_synchronization2")) gpu.extensions.Add("VK_KHR_synchronization2");  // for RenderGraph
 
         //--Device Features 2-- (Vulkan 1.1+)
         gpu.features2                      = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
@@ -115,6 +116,7 @@ void CPhysicalDevices::Init(const VkInstance instance) {
         gpu.features_AccelerationStructure = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_FEATURES_KHR};
         gpu.features_RayTracingPipeline    = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_FEATURES_KHR};
         gpu.features_RayQuery              = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_QUERY_FEATURES_KHR};
+        gpu.features_Synchronization2      = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR};
         if(VK_API_VERSION == VK_API_VERSION_1_2) {
             getNext(&gpu.features2) = &gpu.features_11;
             getNext(&gpu.features2) = &gpu.features_12;
@@ -130,6 +132,7 @@ void CPhysicalDevices::Init(const VkInstance instance) {
             getNext(&gpu.features2) = &gpu.features_RayTracingPipeline;
             getNext(&gpu.features2) = &gpu.features_RayQuery;
         }
+        if(gpu.extensions.Has("VK_KHR_synchronization2")) getNext(&gpu.features2) = &gpu.features_Synchronization2;
 
         vkGetPhysicalDeviceFeatures2 (gpu, &gpu.features2);   // Vulkan 1.1+
         //---------------------
@@ -235,6 +238,9 @@ void CDevice::Create() {
     gpu.enable_features_12 = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
     gpu.enable_features_12.runtimeDescriptorArray = true;
     gpu.enable_features_12.shaderSampledImageArrayNonUniformIndexing=true;
+    gpu.enable_features_12.descriptorBindingPartiallyBound = gpu.features_12.descriptorBindingPartiallyBound;  // for BindlessTable
+    gpu.enable_features_12.drawIndirectCount               = gpu.features_12.drawIndirectCount;                // for IndirectRenderer
+    gpu.enable_features_12.timelineSemaphore               = gpu.features_12.timelineSemaphore;                // for CCmd tickets
     if(extensions.IsPicked("VK_EXT_descriptor_indexing"))    gpu.enable_features_12.descriptorIndexing = true;
     if(extensions.IsPicked("VK_KHR_buffer_device_address"))  gpu.enable_features_12.bufferDeviceAddress= true;
     if(extensions.IsPicked("VK_KHR_vulkan_memory_model"))    gpu.enable_features_12.vulkanMemoryModel  = true;
@@ -251,6 +257,10 @@ void CDevice::Create() {
     gpu.enable_features_AccelerationStructure.pNext = 0;
     gpu.enable_features_RayQuery.pNext              = 0;
     gpu.enable_features_RayTracingPipeline.pNext    = 0;
+    if(extensions.IsPicked("VK_KHR_synchronization2")) {
+        gpu.enable_features_Synchronization2 = gpu.features_Synchronization2;
+        gpu.enable_features_Synchronization2.pNext = 0;
+    }
     gpu.enable_features.depthClamp = true;                // clamp skybox to farplane
 
     if(VK_API_VERSION == VK_API_VERSION_1_2) {
@@ -261,6 +271,7 @@ void CDevice::Create() {
     if(extensions.IsPicked("VK_KHR_acceleration_structure")) getNext(&device_create_info) = &gpu.enable_features_AccelerationStructure;
     if(extensions.IsPicked("VK_KHR_ray_tracing_pipeline"))   getNext(&device_create_info) = &gpu.enable_features_RayTracingPipeline;
     if(extensions.IsPicked("VK_KHR_ray_query"))              getNext(&device_create_info) = &gpu.enable_features_RayQuery;
+    if(extensions.IsPicked("VK_KHR_synchronization2"))       getNext(&device_create_info) = &gpu.enable_features_Synchronization2;
 
 
 /*  // PRE-VULKAN 1.2 METHOD: (deprecated.  Use: "enable_features_12" instead.)
@@ -374,7 +385,7 @@ void CDevice::Print() {  // List created queues
 */
 
 //------------------------------CCmd------------------------------
-CCmd::CCmd() : device(), queue(), command_pool(), command_buffer(), fence() {}
+CCmd::CCmd() : device(), queue(), command_pool(), command_buffer() {}
 
 CCmd::CCmd(const CQueue& cqueue) {
     SelectQueue(cqueue);
@@ -385,49 +396,131 @@ void CCmd::SelectQueue(const CQueue& cqueue) {
     queue          = cqueue.queue;
     ASSERT(!!queue, "queue not yet initialized\n");
     command_pool   = cqueue.CreateCommandPool();
-    command_buffer = cqueue.CreateCommandBuffer(command_pool);
-    //---Fence---
-    VkFenceCreateInfo createInfo = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
-    createInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-    vkCreateFence(device, &createInfo, nullptr, &fence);
-    //-----------
+    //---Timeline semaphore---
+    use_timeline = (VK_API_VERSION == VK_API_VERSION_1_2) && cqueue.gpu.features_12.timelineSemaphore;
+    if(use_timeline) {
+        VkSemaphoreTypeCreateInfo typeInfo = {VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO};
+        typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        typeInfo.initialValue  = 0;
+        VkSemaphoreCreateInfo createInfo = {VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+        createInfo.pNext = &typeInfo;
+        VKERRCHECK(vkCreateSemaphore(device, &createInfo, nullptr, &timeline));
+    }
+    //------------------------
 }
 
 CCmd::~CCmd() {
-    if(fence)          vkDestroyFence(device, fence, nullptr);
-    if(command_buffer) vkFreeCommandBuffers(device, command_pool, 1, &command_buffer);
+    if(last_ticket) Wait();
+    for(auto& buf : pool) {
+        if(buf.fence) vkDestroyFence(device, buf.fence, nullptr);
+        vkFreeCommandBuffers(device, command_pool, 1, &buf.buffer);
+    }
+    if(timeline)       vkDestroySemaphore(device, timeline, nullptr);
     if(command_pool)   vkDestroyCommandPool(device, command_pool, nullptr);
 }
 
+CCmd::CmdBuffer* CCmd::Find(CmdTicket ticket) {
+    for(auto& buf : pool) if(buf.ticket == ticket) return &buf;
+    return nullptr;  // buffer was reused, so its work is done
+}
+
 void CCmd::Begin(VkCommandBufferUsageFlags flags) {
     ASSERT(queue, "CCmd: No Queue selected.\n");
     ASSERT(recording==false, "Command buffer is already recording.\n");
-    vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
+
+    //---Pick a buffer whose work is done---
+    uint32_t count  = (uint32_t)pool.size();
+    uint32_t oldest = 0;
+    current = count;
+    for(uint32_t i = 0; i < count; ++i) {
+        if(IsDone(pool[i].ticket)) { current = i;  break; }
+        if(pool[i].ticket < pool[oldest].ticket) oldest = i;
+    }
+    if(current == count && count >= max_buffers) {  // pool is full: wait for the oldest
+        Wait(pool[oldest].ticket);
+        current = oldest;
+    }
+    if(current == count) {                            // grow the pool
+        CmdBuffer buf;
+        VkCommandBufferAllocateInfo allocInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        allocInfo.commandPool        = command_pool;
+        allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+        VKERRCHECK(vkAllocateCommandBuffers(device, &allocInfo, &buf.buffer));
+        if(!use_timeline) {
+            VkFenceCreateInfo createInfo = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+            VKERRCHECK(vkCreateFence(device, &createInfo, nullptr, &buf.fence));
+        }
+        pool.push_back(buf);
+    }
+    //--------------------------------------
+
+    command_buffer = pool[current].buffer;
     VkCommandBufferBeginInfo cmdBufBeginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
     cmdBufBeginInfo.flags = flags;  // = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
     VKERRCHECK( vkBeginCommandBuffer(command_buffer, &cmdBufBeginInfo) );
     recording = true;
 }
 
-void CCmd::End(bool submit) {
+CmdTicket CCmd::End(bool submit, bool wait) {
     ASSERT(recording==true, "Command buffer is not recording.\n");
     VKERRCHECK(vkEndCommandBuffer(command_buffer));
-    if(submit) Submit();
     recording = false;
+    return submit ? Submit(wait) : 0;
 }
 
-void CCmd::Submit(bool wait) {
+CmdTicket CCmd::Submit(bool wait) {
+    ASSERT(current < pool.size(), "CCmd: Nothing recorded.\n");
+    CmdBuffer& buf = pool[current];
+    CmdTicket ticket = next_ticket++;
+
     VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
     submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &command_buffer;
-    //VKERRCHECK(vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE))
-    vkResetFences(device, 1, &fence);
-    VKERRCHECK(vkQueueSubmit(queue, 1, &submitInfo, fence))
-    if(wait) Wait();
+    submitInfo.pCommandBuffers = &buf.buffer;
+    if(use_timeline) {
+        VkTimelineSemaphoreSubmitInfo timelineInfo = {VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO};
+        timelineInfo.signalSemaphoreValueCount = 1;
+        timelineInfo.pSignalSemaphoreValues    = &ticket;
+        submitInfo.pNext                = &timelineInfo;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores    = &timeline;
+        VKERRCHECK(vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE))
+    } else {
+        vkResetFences(device, 1, &buf.fence);
+        VKERRCHECK(vkQueueSubmit(queue, 1, &submitInfo, buf.fence))
+    }
+    buf.ticket  = ticket;
+    last_ticket = ticket;
+    if(wait) Wait(ticket);
+    return ticket;
 }
 
 void CCmd::Wait() {
-    //VKERRCHECK(vkQueueWaitIdle(queue));
-    VKERRCHECK(vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX));
+    Wait(last_ticket);
+}
+
+void CCmd::Wait(CmdTicket ticket) {
+    if(!ticket) return;
+    if(use_timeline) {
+        VkSemaphoreWaitInfo waitInfo = {VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO};
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores    = &timeline;
+        waitInfo.pValues        = &ticket;
+        VKERRCHECK(vkWaitSemaphores(device, &waitInfo, UINT64_MAX));
+    } else {
+        CmdBuffer* buf = Find(ticket);
+        if(buf) VKERRCHECK(vkWaitForFences(device, 1, &buf->fence, VK_TRUE, UINT64_MAX));
+    }
+}
+
+bool CCmd::IsDone(CmdTicket ticket) {
+    if(!ticket) return true;
+    if(use_timeline) {
+        uint64_t value = 0;
+        VKERRCHECK(vkGetSemaphoreCounterValue(device, timeline, &value));
+        return value >= ticket;
+    }
+    CmdBuffer* buf = Find(ticket);
+    return !buf || vkGetFenceStatus(device, buf->fence) == VK_SUCCESS;
 }
 //----------------------------------------------------------------
@@ -56,6 +56,7 @@ class CPhysicalDevice {
     VkPhysicalDeviceAccelerationStructureFeaturesKHR features_AccelerationStructure;
     VkPhysicalDeviceRayTracingPipelineFeaturesKHR    features_RayTracingPipeline;
     VkPhysicalDeviceRayQueryFeaturesKHR              features_RayQuery;
+    VkPhysicalDeviceSynchronization2FeaturesKHR      features_Synchronization2;
 
     std::vector<VkQueueFamilyProperties> queue_families;  // array of queue families
     // VkSurfaceCapabilitiesKHR   surface_caps;
@@ -67,6 +68,7 @@ class CPhysicalDevice {
     VkPhysicalDeviceAccelerationStructureFeaturesKHR enable_features_AccelerationStructure={};
     VkPhysicalDeviceRayQueryFeaturesKHR              enable_features_RayQuery={};
     VkPhysicalDeviceRayTracingPipelineFeaturesKHR    enable_features_RayTracingPipeline={};
+    VkPhysicalDeviceSynchronization2FeaturesKHR      enable_features_Synchronization2={};
 
     operator VkPhysicalDevice() const { return handle; }
     int FindQueueFamily(VkQueueFlags flags, VkSurfaceKHR surface = 0);  // Returns a QueueFamlyIndex, or -1 if none found.
@@ -144,14 +146,39 @@ class CDevice {
 };
 //----------------------------------------------------------------
 //------------------------------CCmd------------------------------ // Command Buffer
+// Records one-off command buffers, from a pool of reusable buffers.
+// Submit() returns a ticket: the value of the timeline semaphore, once that submit has completed.
+// Tickets can be waited on later, so several recordings may be in flight at once.
+// Begin() reuses a buffer whose work is done, or allocates a new one.
+// (Without timelineSemaphore support, each buffer falls back to its own fence.)
+//
+//   cmd.Begin();
+//   vkCmd...(cmd);
+//   CmdTicket ticket = cmd.End(true, false);  // submit, but don't wait
+//   ...
+//   cmd.Wait(ticket);                         // or poll: cmd.IsDone(ticket)
+typedef uint64_t CmdTicket;                                        // 0: nothing submitted
+
 class CCmd {                                                       // TODO: merge with CQueue?
+    struct CmdBuffer {
+        VkCommandBuffer buffer = nullptr;
+        VkFence         fence  = nullptr;  // fallback, without timeline semaphores
+        CmdTicket       ticket = 0;        // last submit of this buffer
+    };
+    std::vector<CmdBuffer> pool;
+    uint32_t  current      = 0;            // pool index of the buffer being recorded
+    CmdTicket next_ticket  = 1;
+    bool      use_timeline = false;
+    CmdBuffer* Find(CmdTicket ticket);
   public:
   //friend class CBuffers;
     VkDevice        device;
     VkQueue         queue;
     VkCommandPool   command_pool;
-    VkCommandBuffer command_buffer;
-    VkFence         fence;
+    VkCommandBuffer command_buffer;        // buffer being recorded
+    VkSemaphore     timeline = nullptr;    // signaled with each submit's ticket
+    CmdTicket       last_ticket = 0;       // ticket of the last submit
+    uint32_t        max_buffers = 16;      // Begin waits for the oldest buffer, once the pool is this big
     bool            recording=false;
   public:
     CCmd(const CQueue& queue);
@@ -159,9 +186,11 @@ class CCmd {                                                       // TODO: merg
     ~CCmd();
     void SelectQueue(const CQueue& queue);
     void Begin(VkCommandBufferUsageFlags flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-    void End(bool submit = false);
-    void Submit(bool wait = true);  // (TODO: Default to false?)
-    void Wait();  //wait for submit to complete
+    CmdTicket End(bool submit = false, bool wait = true);
+    CmdTicket Submit(bool wait = true);    // returns the ticket of this submit
+    void Wait();                           // wait for the last submit to complete
+    void Wait(CmdTicket ticket);           // wait for the given submit to complete
+    bool IsDone(CmdTicket ticket);         // non-blocking
     operator VkCommandBuffer() {return command_buffer;}
 };
 //----------------------------------------------------------------
@@ -3,6 +3,7 @@
 
 #include "CPipeline.h"
 #include "vkWindow.h"
+#include "PipelineCache.h"
 
 CPipeline::CPipeline() :device(), renderpass(), graphicsPipeline() {}
 
@@ -31,8 +32,10 @@ CPipeline::~CPipeline() {
 }
 
 void CPipeline::Destroy() {
-    if (device) vkDeviceWaitIdle(device);
-    if (graphicsPipeline) vkDestroyPipeline(device, graphicsPipeline, nullptr);
+    if (!graphicsPipeline) return;  // (no vkDeviceWaitIdle: pipelines may be created on several threads)
+    vkDeviceWaitIdle(device);
+    vkDestroyPipeline(device, graphicsPipeline, nullptr);
+    graphicsPipeline = 0;
 }
 
 void CPipeline::SetDefaults() {
@@ -145,18 +148,48 @@ VkPipeline CPipeline::CreateGraphicsPipeline() {
     pipelineInfo.basePipelineHandle  = VK_NULL_HANDLE;
     //pipelineInfo.basePipelineIndex = 0;
 
-    VKERRCHECK(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline));
+    VKERRCHECK(vkCreateGraphicsPipelines(device, DefaultPipelineCache(), 1, &pipelineInfo, nullptr, &graphicsPipeline));
     return graphicsPipeline;
 }
 
 void CPipeline::Bind(VkCommandBuffer cmd, VkDescriptorSets& ds) {
     if(subpass>0) {
-        shader.BindInputAttachments(input_attachments);
+        BindInputAttachments();
         shader.UpdateDescriptorSets(ds);
     }
     VkPipelineLayout pipelineLayout = shader.GetPipelineLayout();
     vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, *this);
-    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, ds, 0, nullptr);
+    uint32_t offsets[CShader::MAX_DYNAMIC];
+    uint32_t offset_count = shader.DynamicOffsets(offsets);  // UBO ring slots
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, ds, offset_count, offsets);
+    BindExtraSets(cmd);
+}
+
+void CPipeline::BindInputAttachments() {
+    if(subpass>0) shader.BindInputAttachments(input_attachments);
+}
+
+uint32_t CPipeline::BindExtraSets(VkCommandBuffer cmd) {
+    VkDescriptorSet sets[2];
+    uint32_t count = 0;
+    if(bindless) sets[count++] = bindless->Set();
+    if(rayquery) sets[count++] = rayquery->Set();
+    if(count) vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, shader.GetPipelineLayout(), 1, count, sets, 0, nullptr);
+    return count;
+}
+
+void CPipeline::SetBindless(BindlessTable& table) {
+    ASSERT(!graphicsPipeline, "SetBindless must be called before CreateGraphicsPipeline.\n");
+    ASSERT(table.layout, "BindlessTable not initialized.\n");
+    bindless = &table;
+    shader.AddSetLayout(table.layout);
+}
+
+void CPipeline::SetRayQuery(RayQuerySet& set) {
+    ASSERT(!graphicsPipeline, "SetRayQuery must be called before CreateGraphicsPipeline.\n");
+    ASSERT(set.layout, "RayQuerySet not initialized.\n");
+    rayquery = &set;
+    shader.AddSetLayout(set.layout);
 }
 
 
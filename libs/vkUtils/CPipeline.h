@@ -3,6 +3,8 @@
 
 #include "CRenderpass.h"
 #include "CShader.h"
+#include "Bindless.h"
+#include "RayQuery.h"
 
 class CPipeline {
     VkDevice     device          =0;
@@ -14,6 +16,9 @@ class CPipeline {
     std::vector<CvkImage*> input_attachments;
   public:
     CShader shader;
+    BindlessTable*   bindless = 0;  // set 1: bindless textures and materials (see SetBindless)
+    RayQuerySet*     rayquery = 0;  // next set: TLAS for inline ray queries (see SetRayQuery)
+    VkDescriptorSets shared_ds;     // set 0: shared by all bindless draws (eg. camera)
 
     CPipeline();
     CPipeline(CRenderpass& renderpass, uint32_t subpass = 0);
@@ -35,7 +40,12 @@ class CPipeline {
     VkPipeline CreateGraphicsPipeline();
     void Destroy();
     operator VkPipeline() const { return graphicsPipeline; }
+    uint32_t Subpass() const { return subpass; }
     void Bind(VkCommandBuffer cmd, VkDescriptorSets& ds);
+    void BindInputAttachments();                  // subpass>0: bind the input attachments to the shader (before UpdateDescriptorSets)
+    uint32_t BindExtraSets(VkCommandBuffer cmd);  // sets 1+ (bindless table, ray query). Returns the number bound.
+    void SetBindless(BindlessTable& table);  // Call before CreateGraphicsPipeline. Per-draw state is then passed as DrawConstants.
+    void SetRayQuery(RayQuerySet& set);      // Call after SetBindless, and before CreateGraphicsPipeline.
 };
 
 
@@ -149,6 +149,20 @@ void CRenderpass::Create() {
     std::vector<VkSubpassDescription> subs(subpasses.size());
     repeat(subpasses.size()) subs[i] = subpasses[i];
 
+    // Frames in flight share the depth and intermediate attachments:
+    // Order this frame's attachment writes after the previous frame's reads and writes.
+    VkPipelineStageFlags stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    VkSubpassDependency external = {};
+    external.srcSubpass    = VK_SUBPASS_EXTERNAL;
+    external.dstSubpass    = 0;
+    external.srcStageMask  = stages | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;  // input attachment reads
+    external.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    external.dstStageMask  = stages;
+    external.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT  | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                             VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    std::vector<VkSubpassDependency> deps = dependencies;
+    deps.push_back(external);
+
     VkRenderPassCreateInfo rp_info = {VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO};
     rp_info.pNext = NULL;
     rp_info.flags = 0;
@@ -156,8 +170,8 @@ void CRenderpass::Create() {
     rp_info.pAttachments    =           attachments.data();
     rp_info.subpassCount    = (uint32_t)subs.size();
     rp_info.pSubpasses      =           subs.data();
-    rp_info.dependencyCount = (uint32_t)dependencies.size();
-    rp_info.pDependencies   =           dependencies.data();
+    rp_info.dependencyCount = (uint32_t)deps.size();
+    rp_info.pDependencies   =           deps.data();
     VKERRCHECK(vkCreateRenderPass(device, &rp_info, nullptr, &renderpass));
     LOGI("Renderpass created\n");
 }
@@ -5,14 +5,15 @@
 #include "VkFormats.h"
 #include "Buffers.h"
 #include <algorithm>
+#include <cstring>
 
 CvkImage* CShader::imgWhite = 0;
 
 CShader::CShader() : device(), vertShaderModule(), fragShaderModule(),
-                     descriptorPool(), descriptorSetLayout(), pipelineLayout() {}
+                     descriptorSetLayout(), pipelineLayout() {}
 
 CShader::CShader(VkDevice device) : device(device), vertShaderModule(), fragShaderModule(),
-                                    descriptorPool(), descriptorSetLayout(), pipelineLayout() { Init(device); }
+                                    descriptorSetLayout(), pipelineLayout() { Init(device); }
 
 void CShader::Init(VkDevice device) {
     this->device = device;
@@ -23,18 +24,19 @@ void CShader::Init(VkDevice device) {
 CShader::~CShader() {
     if (device) vkDeviceWaitIdle(device);
     if (imgWhite) delete imgWhite; imgWhite = 0;
-    if (vertShaderModule)    vkDestroyShaderModule       (device, vertShaderModule,    nullptr);
-    if (fragShaderModule)    vkDestroyShaderModule       (device, fragShaderModule,    nullptr);
-    if (pipelineLayout)      vkDestroyPipelineLayout     (device, pipelineLayout,      nullptr);
-    if (descriptorSetLayout) vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
-    if (descriptorPool)      vkDestroyDescriptorPool     (device, descriptorPool,      nullptr);
+    auto& registry = ShaderRegistry::Get();  // shared objects: destroyed by their last user
+    registry.Release(vertModule);
+    registry.Release(fragModule);
+    registry.Release(pipelineLayout);
+    registry.Release(descriptorSetLayout);
+    descriptors.Clear();
 }
 
 bool CShader::LoadVertShader(const char* filename) {
     assert(!vertShaderModule && "Vertex shader already loaded.");
-    auto spirv = LoadShader(filename);
-    vertShaderModule = CreateShaderModule(spirv);
-    Parse(spirv);
+    vertModule = ShaderRegistry::Get().AcquireModule(device, filename);
+    vertShaderModule = vertModule->module;
+    Apply(*vertModule);
 
     // ---pack normals to 32bits---
     if((attribute_descriptions.size()==3)   // Check vertex contains 3 attributes (vnt?)
@@ -49,181 +51,88 @@ bool CShader::LoadVertShader(const char* filename) {
 
 bool CShader::LoadFragShader(const char* filename) {
     assert(!fragShaderModule && "Fragment shader already loaded.");
-    auto spirv = LoadShader(filename);
-    fragShaderModule = CreateShaderModule(spirv);
-    Parse(spirv);
+    fragModule = ShaderRegistry::Get().AcquireModule(device, filename);
+    fragShaderModule = fragModule->module;
+    Apply(*fragModule);
     return !!fragShaderModule;
 }
 
-std::vector<char> CShader::LoadShader(const char* filename) {
-    // Read File
-    printf("Load Shader: %s...", filename);
-    FILE* file = fopen(filename, "rb");
-    printf(" %s\n" RESET, (file?GREEN"Found" : RED"Not found"));
-    assert(!!file && "File not found");
-
-    fseek(file, 0L, SEEK_END);
-    size_t file_size = (size_t) ftell(file);
-    std::vector<char> buffer(file_size);
-    rewind(file);
-    size_t s = fread(buffer.data(), 1, file_size, file);  s=s;
-    fclose(file);
-
-    return buffer;
-}
-
-VkShaderModule CShader::CreateShaderModule(const std::vector<char>& spirv) {
-    VkShaderModuleCreateInfo createInfo = {};
-    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = spirv.size();
+// Builds the set 0 bindings, shader stage and vertex inputs from the (cached) reflection.
+void CShader::Apply(const ShaderRegistry::Module& mod) {
+    const ShaderReflection& refl = mod.reflection;
+    VkShaderStageFlagBits stage = refl.stage;
 
-    std::vector<uint32_t> codeAligned(spirv.size() / 4 + 1);
-    memcpy(codeAligned.data(), spirv.data(), spirv.size());
-    createInfo.pCode = codeAligned.data();
+    for(auto& ds_binding : refl.bindings) {
+        if(ds_binding.set != 0) continue;  // only set 0 is managed by CShader. (see AddSetLayout)
 
-    VkShaderModule shaderModule = nullptr;
-    VKERRCHECK(vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule))
-    return shaderModule;
-}
+        VkDescriptorType type = ds_binding.type;
+        if(type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;  // ring slot is a bind-time offset
 
-void CShader::Parse(const std::vector<char>& spirv) {
-    SpvReflectShaderModule module = {};
-    SpvReflectResult result = spvReflectCreateShaderModule(spirv.size(), spirv.data(), &module);
-    assert(result == SPV_REFLECT_RESULT_SUCCESS);
-
-    //-- Enumerate DescriptorSets --
-    uint32_t count = 0;
-    result = spvReflectEnumerateDescriptorSets(&module, &count, nullptr);
-    assert(result == SPV_REFLECT_RESULT_SUCCESS);
-
-    std::vector<SpvReflectDescriptorSet*> sets(count);
-    result = spvReflectEnumerateDescriptorSets(&module, &count, sets.data());
-    assert(result == SPV_REFLECT_RESULT_SUCCESS);
-    //------------------------------
-
-    VkShaderStageFlagBits stage = (VkShaderStageFlagBits)module.shader_stage;
-
-    VkDescriptorSet descriptorSet = nullptr;  //temp ??????
-
-    for(auto set : sets) {
-        for (uint32_t i = 0; i < set->binding_count; ++i) {
-            const SpvReflectDescriptorBinding& ds_binding = *set->bindings[i];
-            VkDescriptorType type = (VkDescriptorType)ds_binding.descriptor_type;
-
-            //  Detect and merge with duplicate bindings from previous shader stages 
-            for (auto& item : bindings) if (item.binding == ds_binding.binding) {
-                if(item.descriptorType != (VkDescriptorType)ds_binding.descriptor_type)
-                    { LOGE("Shader binding %d:\"%s\" conflicts with a previous binding.\n"     , item.binding, ds_binding.name); abort(); }  // error
-                //else{ LOGV("Shader binding %d:\"%s\" referenced from multiple shader stages.\n", item.binding, ds_binding.name); }           // performance warning
-                item.stageFlags |= stage;  // Mark binding as used by additional shader stage
-                goto SKIP;                 // Don't add this duplicate
-            }
-
-            {   //-- VkDescriptorSetLayoutBinding array --
-                VkDescriptorSetLayoutBinding layoutBinding = {};
-                layoutBinding.binding         = ds_binding.binding;
-                layoutBinding.descriptorType  = (VkDescriptorType)ds_binding.descriptor_type; 
-                layoutBinding.descriptorCount = 1;
-                for (uint32_t i_dim = 0; i_dim < ds_binding.array.dims_count; ++i_dim) {
-                    layoutBinding.descriptorCount *= ds_binding.array.dims[i_dim];
-                }
-                layoutBinding.stageFlags         = stage;
-                layoutBinding.pImmutableSamplers = nullptr; // Optional
-                bindings.push_back(layoutBinding);
-            }
-            //  -- Descriptor Set Info --
-            dsInfo.push_back({ds_binding.name, ds_binding.input_attachment_index});
-
-            {   // -- VkWriteDescriptorSet array --
-                VkWriteDescriptorSet writeDS = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
-                writeDS.dstSet = descriptorSet;
-                writeDS.dstBinding = ds_binding.binding; //0;
-                writeDS.dstArrayElement = 0;
-                writeDS.descriptorType  = type;  //VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-                writeDS.descriptorCount = 1;
-                //writeDS.pBufferInfo = &bufferInfo;
-                //if(type==VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)         writeDS.pBufferInfo = &dsInfo.back().bufferInfo;
-                //if(type==VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER) writeDS.pImageInfo  = &dsInfo.back().imageInfo;
-                descriptorWrites.push_back(writeDS);
-            }
-            SKIP:;
+        //  Detect and merge with duplicate bindings from previous shader stages
+        auto dup = std::find_if(bindings.begin(), bindings.end(), [&](auto& item) { return item.binding == ds_binding.binding; });
+        if(dup != bindings.end()) {
+            if(dup->descriptorType != type)
+                { LOGE("Shader binding %d:\"%s\" conflicts with a previous binding.\n", dup->binding, ds_binding.name.c_str()); abort(); }
+            dup->stageFlags |= stage;  // Mark binding as used by additional shader stage
+            continue;                  // Don't add this duplicate
         }
+
+        //-- VkDescriptorSetLayoutBinding array --
+        VkDescriptorSetLayoutBinding layoutBinding = {};
+        layoutBinding.binding            = ds_binding.binding;
+        layoutBinding.descriptorType     = type;
+        layoutBinding.descriptorCount    = ds_binding.count;
+        layoutBinding.stageFlags         = stage;
+        layoutBinding.pImmutableSamplers = nullptr; // Optional
+        bindings.push_back(layoutBinding);
+
+        //  -- Descriptor Set Info --
+        dsInfo.push_back({ds_binding.name, ds_binding.input_attachment_index});
+
+        // -- VkWriteDescriptorSet array --
+        VkWriteDescriptorSet writeDS = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+        writeDS.dstBinding      = ds_binding.binding;
+        writeDS.dstArrayElement = 0;
+        writeDS.descriptorType  = type;
+        writeDS.descriptorCount = 1;
+        descriptorWrites.push_back(writeDS);
     }
 
+    // Dynamic offsets are passed in binding order
+    dynamic.clear();
+    repeat(bindings.size()) if(bindings[i].descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC) dynamic.push_back(i);
+    std::sort(dynamic.begin(), dynamic.end(), [&](uint32_t a, uint32_t b) { return bindings[a].binding < bindings[b].binding; });
+    if(dynamic.size() > MAX_DYNAMIC) { LOGE("Shader has %d UBOs in set 0. (max %d)\n", (int)dynamic.size(), MAX_DYNAMIC); abort(); }
 
     // ShaderStages
     VkPipelineShaderStageCreateInfo stageInfo = {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO};
-    stageInfo.stage = stage;  //VK_SHADER_STAGE_VERTEX_BIT;
-    if(stage == VK_SHADER_STAGE_VERTEX_BIT) {
-        stageInfo.module = vertShaderModule;
-        vert_entry_point_name = module.entry_point_name;
-        stageInfo.pName = vert_entry_point_name.c_str(); //"main";
-    }
-    if(stage == VK_SHADER_STAGE_FRAGMENT_BIT) {
-        stageInfo.module = fragShaderModule;
-        frag_entry_point_name = module.entry_point_name;
-        stageInfo.pName = frag_entry_point_name.c_str(); //"main";
-    }
+    stageInfo.stage  = stage;
+    stageInfo.module = mod.module;
+    stageInfo.pName  = refl.entry_point.c_str();  // (the module outlives this shader's pipeline)
     shaderStages.push_back(stageInfo);
 
-#ifdef ENABLE_LOGGING
-    PrintModuleInfo(module);
-    for(auto& set : sets) PrintDescriptorSet(*set);
-#endif
+    for(auto& block : refl.push_blocks)
+        if(block.offset + block.size > PUSH_CONSTANT_SIZE)
+            LOGW("Push constant block \"%s\" (%d bytes) exceeds the pipeline layout's %d bytes.\n", block.name.c_str(), block.offset + block.size, PUSH_CONSTANT_SIZE);
 
-    if(stage == VK_SHADER_STAGE_VERTEX_BIT) ParseInputs(module);
-    ParsePushConstants(module);
-
-    spvReflectDestroyShaderModule(&module);
-}
-
-void CShader::ParseInputs(SpvReflectShaderModule& module) {
-    uint32_t count = 0;
-    SpvReflectResult result;
-    result = spvReflectEnumerateInputVariables(&module, &count, nullptr);
-    assert(result == SPV_REFLECT_RESULT_SUCCESS);
-
-    std::vector<SpvReflectInterfaceVariable*> input_vars(count);
-    result = spvReflectEnumerateInputVariables(&module, &count, input_vars.data());
-    assert(result == SPV_REFLECT_RESULT_SUCCESS);
-
-    // remove "gl_VertexIndex" from input_vars list
-    for(uint32_t i=0; i<input_vars.size(); ++i)
-        if(!strcmp(input_vars[i]->name, "gl_VertexIndex")) input_vars.erase(input_vars.begin() + i);
-
-    // Sort attributes by location
-    std::sort(std::begin(input_vars), std::end(input_vars),
-      [](const SpvReflectInterfaceVariable* a, const SpvReflectInterfaceVariable* b) {
-      return a->location < b->location; });
+    if(stage != VK_SHADER_STAGE_VERTEX_BIT) return;
 
     //Populate VkPipelineVertexInputStateCreateInfo structure
-    //VkVertexInputBindingDescription binding_description = {};
     binding_description = {};
     binding_description.binding = 0;
     binding_description.stride = 0;  // computed below
     binding_description.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
     vertexInputs = { VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO };
-    attribute_descriptions.resize(input_vars.size());
-
-    // Populate attribute_descriptions
-    for (size_t i_var = 0; i_var < input_vars.size(); ++i_var) {
-      const SpvReflectInterfaceVariable& refl_var = *(input_vars[i_var]);
-      VkVertexInputAttributeDescription& attr_desc = attribute_descriptions[i_var];
-      attr_desc.location = refl_var.location;
-      attr_desc.binding = binding_description.binding;
-      attr_desc.format = static_cast<VkFormat>(refl_var.format);
-      attr_desc.offset = 0;      // final offset computed below.
+    attribute_descriptions.resize(refl.inputs.size());
+    repeat(refl.inputs.size()) {
+        VkVertexInputAttributeDescription& attr_desc = attribute_descriptions[i];
+        attr_desc.location = refl.inputs[i].location;
+        attr_desc.binding  = binding_description.binding;
+        attr_desc.format   = refl.inputs[i].format;
+        attr_desc.offset   = 0;      // final offset computed below.
     }
     ComputeVertexInputOffsets();
-
-#ifdef ENABLE_LOGGING
-    // Print input attributes
-    printf("  Vertex Input attributes:\n");
-    for(auto& var : input_vars) 
-        printf("    %d : %s %s\n", var->location, ToStringGLSLType(*var->type_description).c_str(), var->name);
-    printf("\n");
-#endif
 }
 
 void CShader::ComputeVertexInputOffsets() {
@@ -250,53 +159,14 @@ void CShader::SetVertexAttributeFormat(uint32_t location, VkFormat newFormat) {
     ComputeVertexInputOffsets();
 }
 
-void CShader::ParsePushConstants(SpvReflectShaderModule& module) {
-    uint32_t count = 0;
-    SpvReflectResult result;
-    result = spvReflectEnumeratePushConstantBlocks(&module, &count, nullptr);
-    assert(result == SPV_REFLECT_RESULT_SUCCESS);
-    if(!count) return;
-
-    std::vector<SpvReflectBlockVariable*> push_blocks(count);
-    result = spvReflectEnumeratePushConstantBlocks(&module, &count, push_blocks.data());
-    assert(result == SPV_REFLECT_RESULT_SUCCESS);
-
-#ifdef ENABLE_LOGGING
-    for(auto& block : push_blocks){
-        printf("  Push Constants:  Block(%s)\n", block->name);
-        for(uint32_t i=0; i<block->member_count; ++i) {
-            auto& member = block->members[i];
-            printf("    %d : %-12s offset=%d size=%d\n", i, member.name, member.offset, member.size);
-        }
-        printf("\n");
-    }
-#endif
-}
-
 //----DescriptorSetLayout----
 VkDescriptorSetLayout& CShader::CreateDescriptorSetLayout() {
-    VkDescriptorSetLayoutCreateInfo create_info = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
-    create_info.bindingCount = (uint32_t)bindings.size();
-    create_info.pBindings    =           bindings.data();
-    VKERRCHECK( vkCreateDescriptorSetLayout(device, &create_info, nullptr, &descriptorSetLayout) )
-    return descriptorSetLayout;
-}
+    descriptorSetLayout = ShaderRegistry::Get().AcquireSetLayout(device, bindings);  // shared with identical shaders
 
-//----DescriptorPool----
-VkDescriptorPool& CShader::CreateDescriptorPool(uint32_t maxSets) {
-    uint32_t cnt = (uint32_t)bindings.size();
-    std::vector<VkDescriptorPoolSize> poolSizes(cnt);
-    for(uint32_t i = 0; i<cnt; ++i) { 
-        poolSizes[i].type            = bindings[i].descriptorType;
-        poolSizes[i].descriptorCount = bindings[i].descriptorCount * maxSets;
-    }
-
-    VkDescriptorPoolCreateInfo poolInfo = {VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
-    poolInfo.maxSets       = maxSets;
-    poolInfo.poolSizeCount = cnt;
-    poolInfo.pPoolSizes    = poolSizes.data();
-    VKERRCHECK( vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) )
-    return descriptorPool;
+    std::vector<VkDescriptorPoolSize> per_set;  // descriptors in one set
+    for(auto& binding : bindings) per_set.push_back({binding.descriptorType, binding.descriptorCount});
+    descriptors.Init(device, per_set);
+    return descriptorSetLayout;
 }
 
 //----DescriptorSet----
@@ -305,19 +175,8 @@ VkDescriptorSet CShader::CreateDescriptorSet() {  //creates a new descriptor set
     VkDescriptorSet descriptorSet = nullptr;
 
     CheckBindings();
-    if(!descriptorPool) CreateDescriptorPool(maxSets);
     if(!pipelineLayout) GetPipelineLayout();
-
-    VkDescriptorSetAllocateInfo allocInfo = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
-    allocInfo.descriptorPool = descriptorPool;
-    allocInfo.descriptorSetCount = 1;
-    allocInfo.pSetLayouts = &descriptorSetLayout;
-    //VKERRCHECK( vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet); )  // if out VK_ERROR_OUT_OF_POOL_MEMORY error, try increasing slots with: shader.MaxDescriptorSets()
-
-    VkResult result = vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet);
-    if(result==VK_ERROR_OUT_OF_POOL_MEMORY) {LOGE("VK_ERROR_OUT_OF_POOL_MEMORY:  Try increasing shader.MaxDescriptorSets()\n");}
-    VKERRCHECK(result);
-
+    descriptorSet = descriptors.Allocate(descriptorSetLayout);  // new pool if the current one is full
     UpdateDescriptorSet(descriptorSet);
     return descriptorSet;
 }
@@ -342,25 +201,42 @@ VkDescriptorSets CShader::CreateDescriptorSets() {  //creates a new descriptor s
 }
 
 void CShader::UpdateDescriptorSets(VkDescriptorSets& ds) {  // update descriptorset in ringbuffer
+    static_assert(sizeof(VkDescriptorBufferInfo) == sizeof(VkDescriptorImageInfo), "DsInfo union size mismatch");
+    uint32_t cnt = (uint32_t)dsInfo.size();
+    bool changed = (ds.set[ds.inx] == 0) || (ds.written.size() != cnt);
+    for(uint32_t i=0; i<cnt && !changed; ++i)
+        changed = !!memcmp(&ds.written[i], &dsInfo[i].bufferInfo, sizeof(VkDescriptorBufferInfo));
+    if(!changed) return;  // set is already up to date
+
+    // Write to the next set in the ring, so sets still in use by previous frames are not modified.
     ds.inx = (ds.inx + 1) % ds.count;
     UpdateDescriptorSet(ds.set[ds.inx]);
+    ds.written.resize(cnt);
+    repeat(cnt) memcpy(&ds.written[i], &dsInfo[i].bufferInfo, sizeof(VkDescriptorBufferInfo));
 };
+
+uint32_t CShader::DynamicOffsets(uint32_t* offsets) {
+    uint32_t cnt = (uint32_t)dynamic.size();
+    repeat(cnt) offsets[i] = dsInfo[dynamic[i]].dynamic_offset;
+    return cnt;
+}
+
+void CShader::FreeDescriptorSets(VkDescriptorSets& ds) {
+    if(!ds.set[0]) return;
+    vkDeviceWaitIdle(device);  // the sets may still be in use by frames in flight (rare: eg. a mesh changing pipeline)
+    for(auto& set : ds.set) descriptors.Free(set, descriptorSetLayout);
+    ds = {};
+}
 //---------------------
 //---------------------
 VkPipelineLayout& CShader::GetPipelineLayout() {
     if(pipelineLayout) return pipelineLayout;
     if(!descriptorSetLayout) CreateDescriptorSetLayout();
 
-    VkPushConstantRange pcr[] {VK_SHADER_STAGE_ALL_GRAPHICS, 0, 128};
-
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 1;
-    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
-    pipelineLayoutInfo.pushConstantRangeCount = 1;
-    pipelineLayoutInfo.pPushConstantRanges = pcr;
-
-    VKERRCHECK(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout))
+    VkPushConstantRange pcr {VK_SHADER_STAGE_ALL_GRAPHICS, 0, PUSH_CONSTANT_SIZE};
+    std::vector<VkDescriptorSetLayout> setLayouts {descriptorSetLayout};  // set 0
+    setLayouts.insert(setLayouts.end(), extraSetLayouts.begin(), extraSetLayouts.end());  // set 1+
+    pipelineLayout = ShaderRegistry::Get().AcquirePipelineLayout(device, setLayouts, pcr);
     return pipelineLayout;
 }
 
@@ -375,8 +251,9 @@ void CShader::Bind(std::string name, UBO& ubo, uint32_t index) {
         if(item.name == name) {
             //LOGI("Bind UBO   to shader var: \"%s\"\n", name.c_str())
             item.bufferInfo.buffer = ubo;
-            item.bufferInfo.offset = ubo.size() * index;
-            item.bufferInfo.range  = ubo.size();  //VK_WHOLE_SIZE;
+            item.bufferInfo.offset = 0;
+            item.bufferInfo.range  = ubo.Stride();  //VK_WHOLE_SIZE;
+            item.dynamic_offset    = ubo.Stride() * index;  // ring slot
             return;
         }
     } 
@@ -418,7 +295,23 @@ void CShader::Bind(std::string name, const CvkImage& image) {
     Bind(name, image.view, image.sampler);
 }
 
-void CShader::Bind(uint index, const CvkImage* image) {  // Not used?
+int CShader::Slot(std::string_view name) {
+    repeat(dsInfo.size()) if(dsInfo[i].name == name) return (int)i;
+    return -1;
+}
+
+void CShader::Bind(uint index, UBO& ubo) {
+    ASSERT(index<dsInfo.size(), "Shader slot out of bounds.\n");
+    ASSERT(ubo.size()>0       , "UBO has not been initialized.\n");
+    auto& item = dsInfo[index];
+    item.bufferInfo.buffer = ubo;
+    item.bufferInfo.offset = 0;
+    item.bufferInfo.range  = ubo.Stride();
+    item.dynamic_offset    = ubo.Stride() * ubo.index;  // ring slot
+}
+
+void CShader::Bind(uint index, const CvkImage* image) {
+    ASSERT(index<dsInfo.size(), "Shader slot out of bounds.\n");
     auto& item = dsInfo[index];
     if(!image) { image = imgWhite; }  // Defaults to white.
     item.imageInfo.imageView   = image->view;
@@ -441,110 +334,3 @@ void CShader::CheckBindings() {
         }
     }
 }
-
-
-//---------------------------------------------PRINT---------------------------------------------
-void CShader::PrintModuleInfo(const SpvReflectShaderModule& module) {
-    //printf("  Source language : %s\n", spvReflectSourceLanguage(module.source_language));
-    printf("  Entry Point     : %s\n", module.entry_point_name);
-
-    const char* stage ="UNKNOWN";
-    switch(module.shader_stage) {
-        case SPV_REFLECT_SHADER_STAGE_VERTEX_BIT                   : stage = "VERTEX";                  break;
-        case SPV_REFLECT_SHADER_STAGE_TESSELLATION_CONTROL_BIT     : stage = "TESSELLATION_CONTROL";    break;
-        case SPV_REFLECT_SHADER_STAGE_TESSELLATION_EVALUATION_BIT  : stage = "TESSELLATION_EVALUATION"; break;
-        case SPV_REFLECT_SHADER_STAGE_GEOMETRY_BIT                 : stage = "GEOMETRY";                break;
-        case SPV_REFLECT_SHADER_STAGE_FRAGMENT_BIT                 : stage = "FRAGMENT";                break;
-        case SPV_REFLECT_SHADER_STAGE_COMPUTE_BIT                  : stage = "COMPUTE";                 break;
-
-        case SPV_REFLECT_SHADER_STAGE_TASK_BIT_NV                  : stage = "TASK";                    break;
-        case SPV_REFLECT_SHADER_STAGE_MESH_BIT_NV                  : stage = "MESH";                    break;
-        case SPV_REFLECT_SHADER_STAGE_RAYGEN_BIT_KHR               : stage = "RAYGEN";                  break;
-        case SPV_REFLECT_SHADER_STAGE_ANY_HIT_BIT_KHR              : stage = "ANY_HIT";                 break;
-        case SPV_REFLECT_SHADER_STAGE_CLOSEST_HIT_BIT_KHR          : stage = "CLOSEST_HIT";             break;
-        case SPV_REFLECT_SHADER_STAGE_MISS_BIT_KHR                 : stage = "MISS";                    break;
-        case SPV_REFLECT_SHADER_STAGE_INTERSECTION_BIT_KHR         : stage = "INTERSECTION";            break;
-        case SPV_REFLECT_SHADER_STAGE_CALLABLE_BIT_KHR             : stage = "CALLABLE";                break;
-        default : LOGE("Unknown shader stage.\n");
-    }
-    printf("  Shader stage    : %s\n", stage);
-}
-
-//----DescriptorSet----
-void CShader::PrintDescriptorSet(const SpvReflectDescriptorSet& set) {
-    printf("  Descriptor set  : %d\n", set.set);
-    for (uint32_t i = 0; i < set.binding_count; ++i) {
-        const SpvReflectDescriptorBinding& binding = *set.bindings[i];
-        printf("       binding %2d : %-12s (%s)\n", binding.binding, binding.name, ToStringDescriptorType(binding.descriptor_type).c_str());
-    }
-    printf("\n");
-}
-
-std::string CShader::ToStringDescriptorType(SpvReflectDescriptorType value) {
-    switch (value) {
-        case SPV_REFLECT_DESCRIPTOR_TYPE_SAMPLER                    : return "VK_DESCRIPTOR_TYPE_SAMPLER";
-        case SPV_REFLECT_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER     : return "VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER";
-        case SPV_REFLECT_DESCRIPTOR_TYPE_SAMPLED_IMAGE              : return "VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE";
-        case SPV_REFLECT_DESCRIPTOR_TYPE_STORAGE_IMAGE              : return "VK_DESCRIPTOR_TYPE_STORAGE_IMAGE";
-        case SPV_REFLECT_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER       : return "VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER";
-        case SPV_REFLECT_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER       : return "VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER";
-        case SPV_REFLECT_DESCRIPTOR_TYPE_UNIFORM_BUFFER             : return "VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER";
-        case SPV_REFLECT_DESCRIPTOR_TYPE_STORAGE_BUFFER             : return "VK_DESCRIPTOR_TYPE_STORAGE_BUFFER";
-        case SPV_REFLECT_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC     : return "VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC";
-        case SPV_REFLECT_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC     : return "VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC";
-        case SPV_REFLECT_DESCRIPTOR_TYPE_INPUT_ATTACHMENT           : return "VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT";
-        case SPV_REFLECT_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR : return "VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR";
-    }
-    // unhandled SpvReflectDescriptorType enum value
-    return "VK_DESCRIPTOR_TYPE_???";
-}
-
-std::string CShader::ToStringGLSLType(const SpvReflectTypeDescription& type) {
-  switch (type.op) {
-    case SpvOpTypeVector: {
-      switch (type.traits.numeric.scalar.width) {
-        case 32: {
-          switch (type.traits.numeric.vector.component_count) {
-          case 2: return "vec2";
-          case 3: return "vec3";
-          case 4: return "vec4";
-          }
-        }
-        break;
-
-        case 64: {
-          switch (type.traits.numeric.vector.component_count) {
-          case 2: return "dvec2";
-          case 3: return "dvec3";
-          case 4: return "dvec4";
-          }
-        }
-        break;
-      }
-    }
-    break;
-
-    case SpvOpTypeBool: {
-        return "bool";
-    }
-
-    case SpvOpTypeInt: {
-        uint32_t width = type.traits.numeric.scalar.width;
-        uint32_t  sign = type.traits.numeric.scalar.signedness;
-        if(width == 32) return sign ? "int" : "uint";
-    }
-    break;
-
-    case SpvOpTypeFloat: {
-        uint32_t width = type.traits.numeric.scalar.width;
-        if(width == 32) return "float";
-        if(width == 64) return "double";
-    }
-
-    default:
-      break;
-  }
-  return "";
-}
-
-//-----------------------------------------------------------------------------------------------
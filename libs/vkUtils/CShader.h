@@ -9,10 +9,16 @@
 *  CShader uses SPIR-V reflection to examine the loaded shaders, extract the binding point names,
 *  and auto-generate appropriate descriptor sets, pipeline layouts and vertex-input-attribute structs.
 *  You can then use the Bind functions to bind UBO and Image resources by name.
+*  For per-frame binding, resolve names to slots once with Slot(), and bind by slot instead.
+*  UBOs are bound as dynamic uniform buffers: the ring slot is an offset passed when the set is bound
+*  (see DynamicOffsets), so moving to the next slot does not rewrite the descriptor set.
+*  UpdateDescriptorSets() only rewrites the descriptor set when the bound resources have changed.
+*  Shader modules, reflection results and layouts come from the ShaderRegistry, so shaders loaded
+*  by several pipelines are only loaded once, and reflection is only parsed on the first run.
 
 *  Finally, call CreateDescriptorSet() to generate the following descriptor structs.
 *      VkDescriptorSetLayout                   // Used by CPipeline
-*      VkDescriptorPool                        // Used internally only
+*      DescriptorAllocator                     // Used internally only (grows as sets are created)
 *      VkDescriptorSet                         // Used when you call vkCmdBindDescriptorSets
 *      VkPipelineShaderStageCreateInfo         // Used by CPipeline
 *      VkPipelineVertexInputStateCreateInfo    // Used by CPipeline
@@ -25,7 +31,6 @@
 *    CShader shaders(device);
 *    shaders.LoadVertShader("shaders/vert.spv");                        // Load Vertex shader
 *    shaders.LoadFragShader("shaders/frag.spv");                        // Load Fragment shader
-*    shaders.MaxDescriptorSets(7);                                      // Set how many models are using this shader
 *    shaders.Bind("ubo", ubo);                                          // Bind Uniform buffer to shader binding point, named "ubo"
 *    shaders.Bind("texSampler", image);                                 // Bind an Image to the shader binding point named "texSampler"
 *    VkPipelineLayout pipelineLayout = shader.GetPipelineLayout();      // Generate the pipeline layout (used by vkCmdBindDescriptorSets)
@@ -48,26 +53,29 @@
 
 //#include "vkWindow.h"
 #include "vkImages.h"
-#include "spirv_reflect.h"
+#include "ShaderRegistry.h"
+#include "DescriptorAllocator.h"
 
 struct VkDescriptorSets { // ring-buffer the VkDescriptorSet
     static const uint32_t count = 3;
     uint32_t inx = 0;
     VkDescriptorSet set[count]{};
+    std::vector<VkDescriptorBufferInfo> written;  // bindings last written to set[inx] (buffer or image info)
     operator VkDescriptorSet* () {return &set[inx];}
     operator VkDescriptorSet () {return set[inx];}
 };
 
 
 class CShader {
+    static const uint32_t PUSH_CONSTANT_SIZE = 128;  // one range for all graphics stages (eg. DrawConstants)
     static CvkImage* imgWhite;
 //public:
     VkDevice device;
     VkShaderModule         vertShaderModule;
     VkShaderModule         fragShaderModule;
-    VkDescriptorPool       descriptorPool;
+    DescriptorAllocator    descriptors;        // grows as needed
     VkDescriptorSetLayout  descriptorSetLayout;
-    uint32_t maxSets = 1;
+    std::vector<VkDescriptorSetLayout> extraSetLayouts;  // sets 1+ (not owned)
 
     std::vector<VkDescriptorSetLayoutBinding> bindings;
     std::vector<VkWriteDescriptorSet> descriptorWrites;
@@ -86,35 +94,27 @@ class CShader {
             VkDescriptorBufferInfo bufferInfo;
             VkDescriptorImageInfo  imageInfo;
         };
+        uint32_t dynamic_offset = 0;  // UBO ring slot (bind-time offset)
         bool operator ==(const std::string& str){return str == name;}  // for find
     };
     std::vector<DsInfo> dsInfo;
+    std::vector<uint32_t> dynamic;  // dsInfo index of each dynamic UBO, in binding order
 
-    std::vector<char> LoadShader(const char* filename);
-    VkShaderModule CreateShaderModule(const std::vector<char>& spirv);
-    void Parse(const std::vector<char>& spirv);
-    void ParseInputs(SpvReflectShaderModule& module);
-    void ParsePushConstants(SpvReflectShaderModule& module);
+    const ShaderRegistry::Module* vertModule = 0;  // shared (see ShaderRegistry)
+    const ShaderRegistry::Module* fragModule = 0;
+    void Apply(const ShaderRegistry::Module& module);
     void ComputeVertexInputOffsets();
 
-    // --Print--
-    void PrintModuleInfo        (const SpvReflectShaderModule& module);
-    void PrintDescriptorSet     (const SpvReflectDescriptorSet& set);
-    std::string ToStringDescriptorType(SpvReflectDescriptorType value);
-    std::string ToStringGLSLType(const SpvReflectTypeDescription& type);
-    //----------
-
     void CheckBindings();
     VkDescriptorSetLayout& CreateDescriptorSetLayout();
-    VkDescriptorPool&  CreateDescriptorPool(uint32_t maxSets=3);
 public:
+    static const uint32_t MAX_DYNAMIC = 4;           // dynamic UBOs per set (see DynamicOffsets)
     CShader();
     CShader(VkDevice device);
     ~CShader();
     void Init(VkDevice device);
     bool LoadVertShader(const char* filename);
     bool LoadFragShader(const char* filename);
-    void MaxDescriptorSets(uint32_t count) {maxSets = count;}  // 3 for each mesh that uses this shader.  TODO: eliminate this?
     void SetVertexAttributeFormat(uint32_t location, VkFormat newFormat); // change a vertex input attribute's format (used to set normals to pack32)
 
     void Bind(std::string name, UBO& ubo);
@@ -122,15 +122,20 @@ public:
     void Bind(std::string name, VkImageView imageView, VkSampler sampler);
     void Bind(std::string name, const CvkImage* image=0);  // defaults to white
     void Bind(std::string name, const CvkImage& image);
-    void Bind(uint index, const CvkImage* image);  //not used
+    void Bind(uint index, const CvkImage* image);  // bind by slot (see Slot)
+    void Bind(uint index, UBO& ubo);               // bind by slot (see Slot)
+    int  Slot(std::string_view name);              // binding slot for name, or -1 if not found. Resolve once, then bind by slot.
     void BindInputAttachments(std::vector<CvkImage*> attachments);  // subpass input-attachments
+    void AddSetLayout(VkDescriptorSetLayout layout) { extraSetLayouts.push_back(layout); }  // add set 1+ (eg. BindlessTable). Call before GetPipelineLayout.
 
     // ---used by vkCmdBindDescriptorSets --
     VkPipelineLayout& GetPipelineLayout();  
     VkDescriptorSet   CreateDescriptorSet();                  // single
     VkDescriptorSets  CreateDescriptorSets();                 // ringbuffer
     void UpdateDescriptorSet(VkDescriptorSet& descriptorSet); // update existing descriptorset (used with multi-subpass)
-    void UpdateDescriptorSets(VkDescriptorSets& ds);          // update descriptorset in ringbuffer
+    void UpdateDescriptorSets(VkDescriptorSets& ds);          // update descriptorset in ringbuffer (skipped if bindings are unchanged)
+    uint32_t DynamicOffsets(uint32_t* offsets);               // current UBO ring offsets, for vkCmdBindDescriptorSets. Returns the count (max MAX_DYNAMIC)
+    void FreeDescriptorSets(VkDescriptorSets& ds);            // return the ring's sets for reuse (waits for the device)
 
     // ---used by CPipeline---
     VkPipelineLayout pipelineLayout;
@@ -0,0 +1,88 @@
+#include "ComputePipeline.h"
+#include "PipelineCache.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+void ComputePipeline::Init(VkDevice device) {
+    this->device = device;
+}
+
+ComputePipeline::~ComputePipeline() {
+    Clear();
+}
+
+void ComputePipeline::Clear() {
+    if (pipeline) vkDestroyPipeline      (device, pipeline, nullptr);  pipeline = 0;
+    if (layout)   vkDestroyPipelineLayout(device, layout,   nullptr);  layout = 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+std::vector<char> ComputePipeline::LoadFile(const char* filename) {
+    printf("Load Shader: %s... ", filename);
+    FILE* file = fopen(filename, "rb");
+    printf("%s\n", (file?"Found":"Not found"));
+    assert(!!file && "File not found");
+
+    fseek(file, 0, SEEK_END);
+    size_t file_size = (size_t) ftell(file);
+    std::vector<char> buffer(file_size);
+    rewind(file);
+    size_t s = fread(buffer.data(), 1, file_size, file); s=s;
+    fclose(file);
+
+    return buffer;
+}
+
+VkShaderModule ComputePipeline::CreateShaderModule(const std::vector<char>& spirv) {
+    std::vector<uint32_t> codeAligned(spirv.size() / 4 + 1);
+    memcpy(codeAligned.data(), spirv.data(), spirv.size());
+
+    VkShaderModuleCreateInfo createInfo = {VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
+    createInfo.codeSize = spirv.size();
+    createInfo.pCode = codeAligned.data();
+
+    VkShaderModule shaderModule = nullptr;
+    VKERRCHECK(vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule))
+    return shaderModule;
+}
+//--------------------------------------------------------------------------------------------------
+
+void ComputePipeline::Create(const char* filename, const std::vector<VkDescriptorSetLayout>& set_layouts, uint32_t push_size) {
+    ASSERT(device, "ComputePipeline: Call Init() first.\n");
+    Clear();
+
+    //--- Layout ---
+    VkPushConstantRange pcr = {VK_SHADER_STAGE_COMPUTE_BIT, 0, push_size};
+    VkPipelineLayoutCreateInfo layoutInfo = {VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+    layoutInfo.setLayoutCount         = (uint32_t)set_layouts.size();
+    layoutInfo.pSetLayouts            = set_layouts.data();
+    layoutInfo.pushConstantRangeCount = push_size ? 1 : 0;
+    layoutInfo.pPushConstantRanges    = &pcr;
+    VKERRCHECK(vkCreatePipelineLayout(device, &layoutInfo, nullptr, &layout));
+
+    //--- Pipeline ---
+    VkShaderModule module = CreateShaderModule(LoadFile(filename));
+    VkComputePipelineCreateInfo pipelineInfo = {VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO};
+    pipelineInfo.stage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = module;
+    pipelineInfo.stage.pName  = "main";
+    pipelineInfo.layout       = layout;
+    VKERRCHECK(vkCreateComputePipelines(device, DefaultPipelineCache(), 1, &pipelineInfo, nullptr, &pipeline));
+    vkDestroyShaderModule(device, module, nullptr);
+}
+
+void ComputePipeline::Bind(VkCommandBuffer cmd, VkDescriptorSet set, uint32_t first_set) {
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, layout, first_set, 1, &set, 0, nullptr);
+}
+
+void ComputePipeline::Push(VkCommandBuffer cmd, const void* data, uint32_t size) {
+    vkCmdPushConstants(cmd, layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, size, data);
+}
+
+void ComputePipeline::Dispatch(VkCommandBuffer cmd, uint32_t x, uint32_t y, uint32_t z) {
+    vkCmdDispatch(cmd, x, y, z);
+}
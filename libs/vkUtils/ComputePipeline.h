@@ -0,0 +1,41 @@
+// ComputePipeline
+// Loads a single compute shader, and creates its pipeline layout and pipeline.
+// Descriptor sets are created by the caller, and passed in as layouts.
+//
+// Usage:
+//   ComputePipeline cull;
+//   cull.Init(device);
+//   cull.Create("shaders/spirv/cull_comp.spv", {ds.layout}, sizeof(PushConstants));
+//   cull.Bind(cmd, ds.set);
+//   cull.Push(cmd, &pc, sizeof(pc));
+//   cull.Dispatch(cmd, (count + 63) / 64);
+
+#ifndef COMPUTEPIPELINE_H
+#define COMPUTEPIPELINE_H
+
+#include "Validation.h"
+#include <vector>
+
+class ComputePipeline {
+    VkDevice   device   = 0;
+    VkPipeline pipeline = 0;
+
+    std::vector<char> LoadFile(const char* filename);
+    VkShaderModule    CreateShaderModule(const std::vector<char>& spirv);
+public:
+    VkPipelineLayout layout = 0;
+
+    ComputePipeline(){};
+    ~ComputePipeline();
+
+    void Init(VkDevice device);
+    void Clear();
+    void Create(const char* filename, const std::vector<VkDescriptorSetLayout>& set_layouts, uint32_t push_size = 0);
+
+    void Bind    (VkCommandBuffer cmd, VkDescriptorSet set, uint32_t first_set = 0);
+    void Push    (VkCommandBuffer cmd, const void* data, uint32_t size);
+    void Dispatch(VkCommandBuffer cmd, uint32_t x, uint32_t y = 1, uint32_t z = 1);
+    operator VkPipeline() const { return pipeline; }
+};
+
+#endif
@@ -0,0 +1,99 @@
+#include "DescriptorAllocator.h"
+#include <algorithm>
+
+#undef repeat
+#define repeat(COUNT) for(uint32_t i = 0; i < (COUNT); ++i)
+
+DescriptorAllocator::~DescriptorAllocator() {
+    Clear();
+}
+
+void DescriptorAllocator::Init(VkDevice device, const std::vector<VkDescriptorPoolSize>& per_set, uint32_t frame_slots) {
+    Clear();
+    this->device  = device;
+    this->per_set = per_set;
+    frames.resize(frame_slots);
+}
+
+void DescriptorAllocator::Clear() {
+    auto destroy = [&](PoolList& list) {
+        for(auto pool : list.pools) vkDestroyDescriptorPool(device, pool, nullptr);
+        list = {};
+    };
+    destroy(persistent);
+    for(auto& list : frames) destroy(list);
+    free_sets.clear();
+    allocated = 0;
+}
+
+VkDescriptorPool DescriptorAllocator::NewPool(PoolList& list) {
+    ASSERT(device, "DescriptorAllocator: Call Init() first.\n");
+    uint32_t sets = list.next_size ? list.next_size : std::max(first_pool_sets, 1u);
+    list.next_size = std::min(sets * 2, std::max(max_sets_per_pool, sets));
+
+    std::vector<VkDescriptorPoolSize> sizes = per_set;
+    for(auto& size : sizes) size.descriptorCount *= sets;
+    if(sizes.empty()) sizes.push_back({VK_DESCRIPTOR_TYPE_SAMPLER, 1});  // (sets without bindings still need a valid pool)
+    VkDescriptorPoolCreateInfo poolInfo = {VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+    poolInfo.maxSets       = sets;
+    poolInfo.poolSizeCount = (uint32_t)sizes.size();
+    poolInfo.pPoolSizes    = sizes.data();
+    VkDescriptorPool pool = nullptr;
+    VKERRCHECK(vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool));
+    list.pools.push_back(pool);
+    return pool;
+}
+
+// Try the current pool. If it is full, (or fragmented) move on to the next one, or create a new, bigger one.
+VkDescriptorSet DescriptorAllocator::Allocate(PoolList& list, VkDescriptorSetLayout layout) {
+    VkDescriptorSetAllocateInfo allocInfo = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts        = &layout;
+    VkDescriptorSet set = nullptr;
+    for(; list.current < list.pools.size(); ++list.current) {
+        allocInfo.descriptorPool = list.pools[list.current];
+        VkResult result = vkAllocateDescriptorSets(device, &allocInfo, &set);
+        if(result == VK_SUCCESS) return set;
+        if(result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL) VKERRCHECK(result);
+    }
+    allocInfo.descriptorPool = NewPool(list);
+    VKERRCHECK(vkAllocateDescriptorSets(device, &allocInfo, &set));  // a new pool has room for at least one set
+    return set;
+}
+
+VkDescriptorSet DescriptorAllocator::Allocate(VkDescriptorSetLayout layout) {
+    ++allocated;
+    auto it = free_sets.find(layout);
+    if(it != free_sets.end() && !it->second.empty()) {
+        VkDescriptorSet set = it->second.back();
+        it->second.pop_back();
+        return set;
+    }
+    return Allocate(persistent, layout);
+}
+
+void DescriptorAllocator::Free(VkDescriptorSet set, VkDescriptorSetLayout layout) {
+    if(!set) return;
+    --allocated;
+    free_sets[layout].push_back(set);
+}
+
+// Resets the slot's pools, but keeps them: after the first few frames, no new pools are created.
+void DescriptorAllocator::BeginFrame(uint32_t slot) {
+    if(frames.empty()) return;
+    frame = slot % (uint32_t)frames.size();
+    PoolList& list = frames[frame];
+    for(auto pool : list.pools) VKERRCHECK(vkResetDescriptorPool(device, pool, 0));
+    list.current = 0;
+}
+
+VkDescriptorSet DescriptorAllocator::AllocateTransient(VkDescriptorSetLayout layout) {
+    ASSERT(!frames.empty(), "DescriptorAllocator: Init() with frame_slots > 0 to use transient sets.\n");
+    return Allocate(frames[frame], layout);
+}
+
+uint32_t DescriptorAllocator::PoolCount() {
+    uint32_t count = (uint32_t)persistent.pools.size();
+    for(auto& list : frames) count += (uint32_t)list.pools.size();
+    return count;
+}
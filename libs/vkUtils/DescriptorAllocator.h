@@ -0,0 +1,62 @@
+// DescriptorAllocator
+// Allocates descriptor sets from a growing list of pools, so callers don't need to know in advance
+// how many sets they will need. When a pool runs out, a new one is created, twice the size of the
+// last one. (up to max_sets_per_pool) The first pool is small, so nothing is over-reserved.
+//
+// Pool sizes are given per set: eg. {{UNIFORM_BUFFER, 1}, {COMBINED_IMAGE_SAMPLER, 5}} for one set
+// with one UBO and 5 textures. A pool of N sets then holds N times these descriptors.
+//
+// Sets are allocated in one of two ways:
+//  - Allocate():          Long-lived. Free() puts the set on a free-list, and the next Allocate()
+//                         of the same layout reuses it. (pools are never fragmented)
+//  - AllocateTransient(): Valid for one frame only. BeginFrame(slot) resets all of that frame slot's
+//                         pools at once. (call it only after the slot's previous frame has completed)
+//
+// Usage:
+//   DescriptorAllocator allocator;
+//   allocator.Init(device, {{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1}}, frames_in_flight);
+//   VkDescriptorSet set = allocator.Allocate(layout);
+//   allocator.BeginFrame(frame);
+//   VkDescriptorSet temp = allocator.AllocateTransient(layout);
+
+#ifndef DESCRIPTORALLOCATOR_H
+#define DESCRIPTORALLOCATOR_H
+
+#include "Validation.h"
+#include <vector>
+#include <unordered_map>
+
+class DescriptorAllocator {
+    struct PoolList {
+        std::vector<VkDescriptorPool> pools;
+        uint32_t current   = 0;               // pool to allocate from (earlier ones are full)
+        uint32_t next_size = 0;               // sets in the next new pool
+    };
+    VkDevice device = nullptr;
+    std::vector<VkDescriptorPoolSize> per_set;
+    PoolList              persistent;
+    std::vector<PoolList> frames;             // transient pools, one list per frame slot
+    uint32_t              frame = 0;
+    std::unordered_map<VkDescriptorSetLayout, std::vector<VkDescriptorSet>> free_sets;
+    uint32_t allocated = 0;                   // live long-lived sets (for stats)
+
+    VkDescriptorPool NewPool(PoolList& list);
+    VkDescriptorSet  Allocate(PoolList& list, VkDescriptorSetLayout layout);
+public:
+    uint32_t first_pool_sets   = 4;           // sets in the first pool of each list
+    uint32_t max_sets_per_pool = 256;
+
+    ~DescriptorAllocator();
+    void Init(VkDevice device, const std::vector<VkDescriptorPoolSize>& per_set, uint32_t frame_slots = 0);
+    void Clear();                             // destroy all pools (and every set allocated from them)
+
+    VkDescriptorSet Allocate(VkDescriptorSetLayout layout);
+    void            Free(VkDescriptorSet set, VkDescriptorSetLayout layout);  // keep for reuse
+    void            BeginFrame(uint32_t slot);                                 // reset the slot's transient pools
+    VkDescriptorSet AllocateTransient(VkDescriptorSetLayout layout);          // valid until the slot's next BeginFrame
+
+    uint32_t PoolCount();
+    uint32_t LiveSets() { return allocated; }
+};
+
+#endif
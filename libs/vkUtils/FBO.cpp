@@ -1,5 +1,6 @@
 #include "FBO.h"
 #include "VkFormats.h"
+#include <algorithm>
 
 FBO::FBO(CRenderpass& renderpass, const CQueue* graphics_queue) {
     Init(renderpass, graphics_queue);
@@ -13,12 +14,15 @@ void FBO::Init(CRenderpass& renderpass, const CQueue* graphics_queue) {
 
 FBO::~FBO() {
     if(device) Clear();
+    recorder.Clear();
     if(command_pool) vkDestroyCommandPool(device, command_pool, nullptr);  command_pool=0;
     LOGI("FBO destroyed\n");
 }
 
 void FBO::Clear() {
     vkDeviceWaitIdle(device);
+    readback.Flush();  // before the fences are destroyed
+    for(auto& fence : in_flight) fence = nullptr;
     for(auto& buf : buffers) {
         if(buf.fence) {
             vkWaitForFences(device, 1, &buf.fence, VK_TRUE, UINT64_MAX);
@@ -34,6 +38,7 @@ void FBO::Init(const CQueue* graphics_queue) {
     this->gpu     = graphics_queue->gpu;
     this->device  = graphics_queue->device;
     this->graphics_queue = *graphics_queue;
+    this->queue_family   = graphics_queue->family;
     is_acquired   = false;
 
     //VkInstance instance = default_allocator->instance;
@@ -43,9 +48,29 @@ void FBO::Init(const CQueue* graphics_queue) {
     command_pool = graphics_queue->CreateCommandPool();
     auto* att = renderpass->GetDepthAttachment();
     if(att) depth_buffer.SetSize(extent, att->format, att->samples);
-    SetFramebufferCount(2);
+    InitFrames();
+    SetFramebufferCount(std::max(2u, frames_in_flight));
 }
 
+//---------------------------------Frames in flight--------------------------------
+void FBO::InitFrames() {
+    frames_in_flight = default_allocator ? default_allocator->frames_in_flight : 1;
+    frames_in_flight = std::clamp(frames_in_flight, 1u, 3u);  // CShader's descriptor set ring has 3 sets
+    in_flight.assign(frames_in_flight, nullptr);
+    frame = 0;
+}
+
+void FBO::WaitFrame() {
+    VkFence fence = in_flight[frame];  // may already be resubmitted for a later frame. (then just waits longer)
+    if(fence) VKERRCHECK(vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX));
+}
+
+void FBO::SubmitFrame(VkFence fence) {
+    in_flight[frame] = fence;
+    frame = (frame + 1) % frames_in_flight;
+}
+//---------------------------------------------------------------------------------
+
 void FBO::SetExtent(uint32_t width, uint32_t height) {
     if((extent.width == width)&&(extent.height == height)) return;
     extent = {width, height};
@@ -184,6 +209,7 @@ FrameBuffer& FBO::AcquireNext() {
     FrameBuffer& buf = buffers[acquired_index];
     buf.extent = extent;
     vkWaitForFences(device, 1, &buf.fence, VK_TRUE, UINT64_MAX);
+    WaitFrame();
     rendered_index = prev;
     is_acquired = true;
     return buf;
@@ -201,6 +227,9 @@ void FBO::Submit() {
 
     vkResetFences(device, 1, &buffer.fence);
     VKERRCHECK(vkQueueSubmit(graphics_queue, 1, &submitInfo, buffer.fence));
+    SubmitFrame(buffer.fence);
+    readback.Submitted(buffer.fence);
+    readback.Poll();
     //if(wait) { VKERRCHECK(vkWaitForFences(device, 1, &buffer.fence, VK_TRUE, UINT64_MAX)) }
     // --- Present ---
     //...
@@ -229,7 +258,7 @@ void FBO::EndFrame() {
     EndRenderpass();
     EndCmd();
     Submit();
-    Wait();
+    if(frames_in_flight < 2) Wait();  // else: AcquireNext waits, when the frame slot is reused
 }
 
 //---------------------------------------------------------------------------------
@@ -240,15 +269,18 @@ VkCommandBuffer FBO::BeginCmd() {
     VkCommandBufferBeginInfo beginInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
     beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
     VKERRCHECK(vkBeginCommandBuffer(cmd_buf, &beginInfo));
+    if(recorder.Enabled()) recorder.BeginFrame(frame);  // AcquireNext has waited for this frame slot
     return cmd_buf;
 }
 
 void FBO::EndCmd() {
-    auto& cmd_buf = buffers[acquired_index].command_buffer;
+    auto& buf = buffers[acquired_index];
+    auto& cmd_buf = buf.command_buffer;
+    if(readback.Enabled()) readback.Record(cmd_buf, buf.image, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, buf.extent, format);
     VKERRCHECK(vkEndCommandBuffer(cmd_buf));
 }
 
-void FBO::BeginRenderpass() {
+void FBO::BeginRenderpass(VkSubpassContents contents) {
     auto& swap_buf = buffers[acquired_index];
     auto& cmd_buf = swap_buf.command_buffer;
 
@@ -259,7 +291,27 @@ void FBO::BeginRenderpass() {
     renderPassInfo.renderArea.extent = swap_buf.extent;
     renderPassInfo.clearValueCount = (uint32_t)renderpass->clearValues.size();
     renderPassInfo.pClearValues    =           renderpass->clearValues.data();
-    vkCmdBeginRenderPass(cmd_buf, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBeginRenderPass(cmd_buf, &renderPassInfo, contents);
+    subpass = 0;
+}
+
+void FBO::NextSubpass(VkSubpassContents contents) {
+    vkCmdNextSubpass(buffers[acquired_index].command_buffer, contents);
+    ++subpass;
+}
+
+ParallelRecorder& FBO::GetRecorder() {
+    if(!recorder.Enabled()) {
+        recorder.Init(device, queue_family, frames_in_flight, record_threads);
+        recorder.BeginFrame(frame);
+    }
+    return recorder;
+}
+
+void FBO::RecordParallel(uint32_t count, const ParallelRecorder::Job& job) {
+    auto& swap_buf = buffers[acquired_index];
+    ParallelRecorder::Target target = {*renderpass, subpass, swap_buf.framebuffer};
+    GetRecorder().Execute(swap_buf.command_buffer, target, count, job);
 }
 
 void FBO::EndRenderpass() {
@@ -271,7 +323,7 @@ void FBO::EndRenderpass() {
 //---------------------------------------------------------------------------------
 
 CImage& FBO::ReadImage() {
-    //Wait();
+    Wait();  // frame may still be in flight
     FrameBuffer fb = CurrBuffer();
     uint32_t w = fb.extent.width;
     uint32_t h = fb.extent.height;
@@ -289,3 +341,8 @@ CImage& FBO::ReadImage() {
     //if(fmt.isSwizzled()) img.BGRAtoRGBA();
     return img;
 }
+
+void FBO::ReadImageAsync(Readback::Callback callback, uint32_t slots) {
+    if(callback) readback.Init(device, slots, callback);
+    else         readback.Clear();
+}
@@ -10,6 +10,11 @@
  *  Use SetFramebufferCount() to set the number of frame buffers. (default=2)
  *  Use SetExtent to set the width & height of the render target.
  *
+ *  Frames in flight:
+ *    Set CAllocator::frames_in_flight (2 or 3) before creating the FBO, to let the CPU record the next
+ *    frame while the GPU is still rendering. EndFrame then no longer waits. Instead, AcquireNext waits
+ *    for the frame that last used the frame slot being reused. UBOs become rings with one slot per frame.
+ *
  *  Simple interface:
  *    Call BeginFrame() to acquire the next frame and its command buffer.
  *    Record vkCmd* commands, using the returned command buffer.
@@ -18,6 +23,16 @@
  * Flexible interface:
  *    The alternative flexible interface is more verbose, for fine-grained control.
  *
+ * Parallel recording:
+ *    Begin the renderpass with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS, and call RecordParallel()
+ *    to record a list of draws on worker threads, into secondary command buffers. (see ParallelRecorder)
+ *    Each worker has its own command pool per frame slot, which BeginCmd() resets.
+ *
+ * Readback:
+ *    ReadImage() copies the last frame to host memory, and blocks until it is done.
+ *    For capturing every frame, use ReadImageAsync(callback) instead. EndCmd() then also records a copy
+ *    of the frame into a readback slot, and Submit() delivers frames to the callback, as they finish.
+ *
 */
 
 #ifndef FBO_H
@@ -26,6 +41,8 @@
 #include "CDevices.h"
 #include "CRenderpass.h"
 #include "Buffers.h"
+#include "Readback.h"
+#include "ParallelRecorder.h"
 
 struct FrameBuffer {
     VkImage         image         = nullptr;
@@ -33,8 +50,6 @@ struct FrameBuffer {
     VkExtent2D      extent        {};
     VkFramebuffer   framebuffer   = nullptr;
     VkCommandBuffer command_buffer= nullptr;
-    VkSemaphore acquire_semaphore = nullptr;  // signaled when a new fb is acquired, and cmd-submit may begin (Swapchain only)
-    VkSemaphore submit_semaphore  = nullptr;  // signaled that submit is complete and present may begin (Swapchain only)
     VkFence         fence         = nullptr;  // signaled when rendering to this FB is complete
 };
 
@@ -44,6 +59,7 @@ class FBO {
     VkDevice          device        = nullptr;
     VkQueue           graphics_queue= nullptr;
     VkCommandPool     command_pool  = nullptr;
+    uint32_t          queue_family  = 0;
     CRenderpass*      renderpass    = nullptr;
     CDepthBuffer      depth_buffer;
     //CAllocator        export_allocator;
@@ -53,17 +69,28 @@ class FBO {
 
     std::vector<FrameBuffer> buffers;
     std::vector<CvkImage>    images;  // Render target (offscreen)
+    Readback                 readback;
+    ParallelRecorder         recorder;
+    uint32_t                 subpass = 0;  // current subpass of the renderpass
 
     uint32_t rendered_index = 0;      // index of last rendered image
     uint32_t acquired_index = 0;      // index of last acquired image
     bool is_acquired = false;
 
+    uint32_t frames_in_flight = 1;    // 1: EndFrame waits for the GPU
+    uint32_t frame = 0;               // current frame slot
+    std::vector<VkFence> in_flight;   // fence of the last submit in each frame slot
+    void InitFrames();                // read frames_in_flight from the default allocator
+    void WaitFrame();                 // wait for the frame slot about to be reused
+    void SubmitFrame(VkFence fence);  // record the fence, and advance the frame slot
+
     void Clear();
     void Init(const CQueue* graphics_queue);
     void ResizeAttachments();
     void Apply();
 public:
     std::vector<CvkImage> att_images;  // additional attachments, besides the depth and present buffers
+    uint32_t record_threads = 0;       // RecordParallel worker count (0: one per hardware thread). Set before the first call.
 
     FBO(CRenderpass& renderpass, const CQueue* graphics_queue);
     FBO(){};
@@ -75,6 +102,7 @@ public:
 
     FrameBuffer& CurrBuffer() {return buffers[acquired_index];}  // buffer being rendered
     FrameBuffer& PrevBuffer() {return buffers[rendered_index];}  // last rendered buffer
+    uint32_t FramesInFlight() {return frames_in_flight;}
 
     //-----Simple interface-----
     VkCommandBuffer BeginFrame();        // Get next cmd buffer and start recording commands
@@ -83,14 +111,19 @@ public:
     //----Flexible interface----
     virtual FrameBuffer& AcquireNext();  // Acquires next frame buffer
     VkCommandBuffer BeginCmd();          // Begin recording command buffer
-    void BeginRenderpass();              // Begin the renderpass
+    void BeginRenderpass(VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);  // Begin the renderpass
     //...                                // vkCmd... commands go here
+    void NextSubpass(VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
+    void RecordParallel(uint32_t count, const ParallelRecorder::Job& job);  // record 'count' draws on worker threads (SECONDARY contents)
+    ParallelRecorder& GetRecorder();     // started on first use
     void EndRenderpass();                // End the renderpass
     void EndCmd();                       // End recording the command buffer
     virtual void Submit();               // Swap frame buffers (no wait)
-    void Wait();                         // Wait until submit is done
+    void Wait();                         // Wait until the last submit is done
     //--------------------------
     CImage& ReadImage();                  // Copy last rendered frame to host memory
+    void ReadImageAsync(Readback::Callback callback, uint32_t slots = 3);  // Copy each frame, and deliver it a few frames later (callback=0: stop)
+    Readback& GetReadback() {return readback;}
 };
 
 #endif
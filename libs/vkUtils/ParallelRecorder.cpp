@@ -0,0 +1,136 @@
+#include "ParallelRecorder.h"
+#include <algorithm>
+
+#undef repeat
+#define repeat(COUNT) for(uint32_t i = 0; i < (COUNT); ++i)
+
+ParallelRecorder::~ParallelRecorder() {
+    Clear();
+}
+
+void ParallelRecorder::Init(VkDevice device, uint32_t queue_family, uint32_t frames, uint32_t thread_count) {
+    Clear();
+    this->device = device;
+    if(!thread_count) thread_count = std::thread::hardware_concurrency();
+    thread_count = std::max(thread_count, 1u);
+    frames       = std::max(frames, 1u);
+
+    VkCommandPoolCreateInfo poolInfo = {VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+    poolInfo.queueFamilyIndex = queue_family;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;  // reset as a whole, once per frame
+    workers.resize(thread_count);
+    for(auto& worker : workers) {
+        worker.frames.resize(frames);
+        for(auto& fp : worker.frames) VKERRCHECK(vkCreateCommandPool(device, &poolInfo, nullptr, &fp.pool));
+    }
+
+    quit = false;
+    generation = 0;
+    for(uint32_t w = 1; w < thread_count; ++w) threads.emplace_back(&ParallelRecorder::Work, this, w);
+    LOGI("ParallelRecorder: %d threads, %d frame slots\n", thread_count, frames);
+}
+
+void ParallelRecorder::Clear() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    work_ready.notify_all();
+    for(auto& thread : threads) thread.join();
+    threads.clear();
+    for(auto& worker : workers)
+        for(auto& fp : worker.frames)
+            vkDestroyCommandPool(device, fp.pool, nullptr);  // also frees its buffers
+    workers.clear();
+}
+
+void ParallelRecorder::BeginFrame(uint32_t frame) {
+    if(workers.empty()) return;
+    this->frame = frame % (uint32_t)workers[0].frames.size();
+    for(auto& worker : workers) {
+        FramePool& fp = worker.frames[this->frame];
+        VKERRCHECK(vkResetCommandPool(device, fp.pool, 0));
+        fp.used = 0;
+    }
+}
+
+VkCommandBuffer ParallelRecorder::NextBuffer(uint32_t worker) {
+    FramePool& fp = workers[worker].frames[frame];
+    if(fp.used == fp.buffers.size()) {
+        VkCommandBufferAllocateInfo allocInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        allocInfo.commandPool        = fp.pool;
+        allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandBufferCount = 1;
+        VkCommandBuffer cmd;
+        VKERRCHECK(vkAllocateCommandBuffers(device, &allocInfo, &cmd));
+        fp.buffers.push_back(cmd);
+    }
+    return fp.buffers[fp.used++];
+}
+
+// Chunk n is always recorded by worker n, into worker n's pool.
+void ParallelRecorder::RecordChunk(uint32_t chunk) {
+    VkCommandBuffer cmd = NextBuffer(chunk);
+    VkCommandBufferInheritanceInfo inheritInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO};
+    inheritInfo.renderPass  = target.renderpass;
+    inheritInfo.subpass     = target.subpass;
+    inheritInfo.framebuffer = target.framebuffer;
+    VkCommandBufferBeginInfo beginInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.pInheritanceInfo = &inheritInfo;
+    VKERRCHECK(vkBeginCommandBuffer(cmd, &beginInfo));
+    (*job)(cmd, chunk, chunk_first[chunk], chunk_count[chunk]);
+    VKERRCHECK(vkEndCommandBuffer(cmd));
+    chunk_buffers[chunk] = cmd;
+}
+
+void ParallelRecorder::Work(uint32_t worker) {
+    uint64_t seen = 0;
+    while(true) {
+        std::unique_lock<std::mutex> lock(mutex);
+        work_ready.wait(lock, [&]{ return quit || generation != seen; });
+        if(quit) return;
+        seen = generation;
+        if(worker >= chunk_buffers.size()) continue;  // not needed for this list
+        lock.unlock();
+
+        RecordChunk(worker);
+
+        lock.lock();
+        if(--pending == 0) work_done.notify_all();
+    }
+}
+
+void ParallelRecorder::Execute(VkCommandBuffer primary, const Target& target, uint32_t count, const Job& job) {
+    ASSERT(!workers.empty(), "ParallelRecorder: Not initialized.\n");
+    if(!count) return;
+
+    //--- Split the list into contiguous chunks ---
+    uint32_t chunks = std::clamp(count / std::max(min_batch, 1u), 1u, (uint32_t)workers.size());
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->job    = &job;
+        this->target = target;
+        chunk_buffers.assign(chunks, nullptr);
+        chunk_first.resize(chunks);
+        chunk_count.resize(chunks);
+        uint32_t first = 0;
+        repeat(chunks) {
+            chunk_first[i] = first;
+            chunk_count[i] = count / chunks + (i < count % chunks ? 1 : 0);
+            first += chunk_count[i];
+        }
+        pending = chunks - 1;
+        ++generation;
+    }
+    if(chunks > 1) work_ready.notify_all();
+
+    //--- Record chunk 0 here, and wait for the rest ---
+    RecordChunk(0);
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        work_done.wait(lock, [&]{ return pending == 0; });
+        this->job = nullptr;
+    }
+    vkCmdExecuteCommands(primary, chunks, chunk_buffers.data());
+}
@@ -0,0 +1,85 @@
+// ParallelRecorder
+// Records the draws of one subpass on a pool of worker threads, into secondary command buffers.
+//
+// Each worker owns one VkCommandPool per frame slot, so no pool is ever shared between threads,
+// or reset while the GPU may still be reading from it. BeginFrame(slot) resets that slot's pools.
+// (call it only after the slot's fence has signaled: FBO::BeginCmd does this)
+//
+// Execute() splits a list of 'count' draws into contiguous chunks, one per worker. Each worker begins
+// a secondary command buffer that continues the renderpass, calls the job for its chunk, and ends it.
+// The primary buffer then executes the secondaries in chunk order, so the draw order is preserved.
+// The renderpass (or subpass) must be begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.
+// Secondaries don't inherit dynamic state: jobs must set their own viewport and scissor.
+//
+// Small lists (less than min_batch draws per chunk) use fewer chunks. Chunk 0 runs on the calling thread.
+//
+// Usage:
+//   recorder.Init(device, queue_family, frames_in_flight);
+//   recorder.BeginFrame(frame);
+//   vkCmdBeginRenderPass(primary, &info, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+//   recorder.Execute(primary, {renderpass, 0, framebuffer}, draw_count,
+//                    [&](VkCommandBuffer cmd, uint32_t chunk, uint32_t first, uint32_t count) { ... });
+
+#ifndef PARALLELRECORDER_H
+#define PARALLELRECORDER_H
+
+#include "CDevices.h"
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+class ParallelRecorder {
+public:
+    typedef std::function<void(VkCommandBuffer cmd, uint32_t chunk, uint32_t first, uint32_t count)> Job;
+    struct Target {
+        VkRenderPass  renderpass  = nullptr;
+        uint32_t      subpass     = 0;
+        VkFramebuffer framebuffer = nullptr;  // optional
+    };
+private:
+    struct FramePool {
+        VkCommandPool                pool = nullptr;
+        std::vector<VkCommandBuffer> buffers;      // secondaries, reused each time this frame slot comes around
+        uint32_t                     used = 0;
+    };
+    struct Worker {
+        std::vector<FramePool> frames;              // one pool per frame slot
+    };
+
+    VkDevice            device = nullptr;
+    uint32_t            frame  = 0;
+    std::vector<Worker> workers;                    // worker 0 is the calling thread
+    std::vector<std::thread> threads;
+
+    //--- current Execute() ---
+    std::mutex              mutex;
+    std::condition_variable work_ready;
+    std::condition_variable work_done;
+    uint64_t                generation = 0;         // bumped for each Execute()
+    uint32_t                pending    = 0;         // chunks not yet recorded
+    bool                    quit       = false;
+    const Job*              job        = nullptr;
+    Target                  target;
+    std::vector<VkCommandBuffer> chunk_buffers;
+    std::vector<uint32_t>   chunk_first;
+    std::vector<uint32_t>   chunk_count;
+
+    void Work(uint32_t worker);
+    void RecordChunk(uint32_t chunk);
+    VkCommandBuffer NextBuffer(uint32_t worker);
+public:
+    uint32_t min_batch = 256;                       // fewest draws worth a thread of their own
+
+    ~ParallelRecorder();
+    void Init(VkDevice device, uint32_t queue_family, uint32_t frames, uint32_t thread_count = 0);  // 0: one per hardware thread
+    void Clear();
+    bool Enabled() { return !workers.empty(); }
+    uint32_t ThreadCount() { return (uint32_t)workers.size(); }  // most chunks an Execute() will use
+
+    void BeginFrame(uint32_t frame);                // reset this frame slot's pools
+    void Execute(VkCommandBuffer primary, const Target& target, uint32_t count, const Job& job);
+};
+
+#endif
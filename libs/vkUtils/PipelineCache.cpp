@@ -0,0 +1,159 @@
+#include "PipelineCache.h"
+#include <cstring>
+#include <cstdio>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+#undef repeat
+#define repeat(COUNT) for(uint32_t i = 0; i < (COUNT); ++i)
+
+PipelineCache* default_pipeline_cache = nullptr;
+
+VkPipelineCache DefaultPipelineCache() {
+    return default_pipeline_cache ? (VkPipelineCache)*default_pipeline_cache : VK_NULL_HANDLE;
+}
+
+struct CacheFileHeader {                  // written before the VkPipelineCache data
+    uint32_t magic;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint32_t driverVersion;
+    uint8_t  uuid[VK_UUID_SIZE];
+    uint64_t data_size;
+};
+static const uint32_t CACHE_MAGIC = 0x48435056;  // "VPCH"
+
+PipelineCache::~PipelineCache() {
+    Destroy();
+}
+
+void PipelineCache::Init(const CQueue& queue, const char* filename) {
+    Destroy();
+    this->device   = queue.device;
+    this->filename = filename;
+    props          = queue.gpu.properties;
+
+    std::vector<char> data = Load();
+    VkPipelineCacheCreateInfo info = {VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+    info.initialDataSize = data.size();
+    info.pInitialData    = data.data();
+    VkResult result = vkCreatePipelineCache(device, &info, nullptr, &cache);
+    if(result != VK_SUCCESS && !data.empty()) {   // driver rejected the data: start empty
+        LOGW("PipelineCache: Driver rejected %s. Starting with an empty cache.\n", filename);
+        info.initialDataSize = 0;
+        info.pInitialData    = nullptr;
+        result = vkCreatePipelineCache(device, &info, nullptr, &cache);
+    }
+    VKERRCHECK(result);
+    loaded_size = data.size();
+    LOGI("PipelineCache: %s (%zu bytes)\n", loaded_size ? "Loaded" : "Cold start", loaded_size);
+    if(!default_pipeline_cache) default_pipeline_cache = this;
+}
+
+std::vector<char> PipelineCache::Load() {
+    std::vector<char> data;
+    FILE* file = fopen(filename.c_str(), "rb");
+    if(!file) return data;
+
+    CacheFileHeader header = {};
+    bool valid = (fread(&header, sizeof(header), 1, file) == 1) && header.magic == CACHE_MAGIC && header.data_size < (1u << 30);
+    if(!valid) {
+        LOGW("PipelineCache: %s is not a pipeline cache file.\n", filename.c_str());
+    } else if(header.vendorID      != props.vendorID ||
+            header.deviceID      != props.deviceID ||
+            header.driverVersion != props.driverVersion ||
+            memcmp(header.uuid, props.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        LOGI("PipelineCache: %s is from another device or driver version. Rebuilding.\n", filename.c_str());
+        valid = false;
+    }
+    if(valid) {
+        data.resize((size_t)header.data_size);
+        if(fread(data.data(), 1, data.size(), file) != data.size()) {
+            LOGW("PipelineCache: %s is truncated.\n", filename.c_str());
+            data.clear();
+        }
+    }
+    fclose(file);
+
+    //--- The driver's own header must agree too ---
+    if(data.size() >= sizeof(VkPipelineCacheHeaderVersionOne)) {
+        VkPipelineCacheHeaderVersionOne vk_header;
+        memcpy(&vk_header, data.data(), sizeof(vk_header));
+        if(vk_header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+           vk_header.vendorID != props.vendorID || vk_header.deviceID != props.deviceID ||
+           memcmp(vk_header.pipelineCacheUUID, props.pipelineCacheUUID, VK_UUID_SIZE) != 0) data.clear();
+    } else data.clear();
+    return data;
+}
+
+size_t PipelineCache::Size() {
+    size_t size = 0;
+    if(cache) VKERRCHECK(vkGetPipelineCacheData(device, cache, &size, nullptr));
+    return size;
+}
+
+void PipelineCache::Save() {
+    if(!cache) return;
+    size_t size = Size();
+    if(size == loaded_size) return;      // nothing new was compiled
+    std::vector<char> data(size);
+    VKERRCHECK(vkGetPipelineCacheData(device, cache, &size, data.data()));
+
+    CacheFileHeader header = {};
+    header.magic         = CACHE_MAGIC;
+    header.vendorID      = props.vendorID;
+    header.deviceID      = props.deviceID;
+    header.driverVersion = props.driverVersion;
+    header.data_size     = size;
+    memcpy(header.uuid, props.pipelineCacheUUID, VK_UUID_SIZE);
+
+    std::string temp = filename + ".tmp";  // write, then rename: a crash can't leave a half-written cache
+    FILE* file = fopen(temp.c_str(), "wb");
+    if(!file) { LOGW("PipelineCache: Can't write %s\n", temp.c_str());  return; }
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(data.data(), 1, size, file) == size;
+    ok = (fclose(file) == 0) && ok;
+    remove(filename.c_str());
+    if(!ok || rename(temp.c_str(), filename.c_str()) != 0) { LOGW("PipelineCache: Failed to save %s\n", filename.c_str());  return; }
+    loaded_size = size;
+    LOGI("PipelineCache: Saved %s (%zu bytes)\n", filename.c_str(), size);
+}
+
+void PipelineCache::Destroy() {
+    if(!cache) return;
+    Save();
+    vkDestroyPipelineCache(device, cache, nullptr);
+    cache = nullptr;
+    if(default_pipeline_cache == this) default_pipeline_cache = nullptr;
+}
+
+// Workers take the next job from a shared counter, so a slow pipeline doesn't hold up the others.
+// Times are printed after all jobs are done, in job order.
+void PipelineCache::Compile(const std::vector<Job>& jobs, uint32_t thread_count) {
+    if(jobs.empty()) return;
+    if(!thread_count) thread_count = std::thread::hardware_concurrency();
+    thread_count = std::clamp(thread_count, 1u, (uint32_t)jobs.size());
+
+    typedef std::chrono::steady_clock Clock;
+    std::vector<double> ms(jobs.size());
+    std::atomic<uint32_t> next(0);
+    auto work = [&]() {
+        for(uint32_t j = next++; j < jobs.size(); j = next++) {
+            auto start = Clock::now();
+            jobs[j].create();
+            ms[j] = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        }
+    };
+
+    auto start = Clock::now();
+    std::vector<std::thread> threads;
+    repeat(thread_count - 1) threads.emplace_back(work);
+    work();
+    for(auto& thread : threads) thread.join();
+    double total = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    LOGI("Compiled %zu pipelines on %d threads:\n", jobs.size(), thread_count);
+    repeat((uint32_t)jobs.size()) LOGI("  %-16s %8.2f ms\n", jobs[i].name.c_str(), ms[i]);
+    LOGI("  %-16s %8.2f ms\n", "(wall time)", total);
+}
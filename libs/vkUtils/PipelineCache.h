@@ -0,0 +1,56 @@
+// PipelineCache
+// A VkPipelineCache that is loaded from, and saved to, a file. So pipelines compiled on one run
+// are not compiled again on the next one. CPipeline, ComputePipeline, RayPipeline and DearImGui
+// all use the default cache: the first one initialized. (same pattern as default_allocator)
+//
+// The file starts with our own header: the device's vendorID, deviceID, driverVersion and
+// pipelineCacheUUID. If any of these don't match the current device, (eg. after a driver update)
+// the file is ignored, and rebuilt on the next Save(). The destructor saves, if the cache grew.
+//
+// Compile() creates several pipelines at once, on worker threads, and prints how long each one took.
+// (VkPipelineCache is internally synchronized, so the workers can share it)
+// Each job must only touch its own pipeline: eg. one job per CPipeline, after its shaders are loaded.
+//
+// Usage:
+//   PipelineCache pipeline_cache;
+//   pipeline_cache.Init(queue, "pipeline.cache");
+//   PipelineCache::Compile({{"pbr", [&]{ pbr_pipeline.CreateGraphicsPipeline(); }},
+//                           {"sky", [&]{ sky_pipeline.CreateGraphicsPipeline(); }}});
+
+#ifndef PIPELINECACHE_H
+#define PIPELINECACHE_H
+
+#include "CDevices.h"
+#include <string>
+#include <vector>
+#include <functional>
+
+class PipelineCache {
+    VkDevice        device = nullptr;
+    VkPipelineCache cache  = nullptr;
+    std::string     filename;
+    VkPhysicalDeviceProperties props = {};
+    size_t          loaded_size = 0;      // bytes loaded from the file (0: cold start)
+
+    std::vector<char> Load();             // cache data, or empty if missing, corrupt or from another device/driver
+public:
+    struct Job {
+        std::string           name;
+        std::function<void()> create;
+    };
+
+    PipelineCache(){}
+    ~PipelineCache();
+    void Init(const CQueue& queue, const char* filename = "pipeline.cache");
+    void Save();                          // write the cache to the file (only if it changed since Load)
+    void Destroy();                       // save, and destroy the cache
+    size_t Size();                        // current size of the cache data, in bytes
+    operator VkPipelineCache() const { return cache; }
+
+    static void Compile(const std::vector<Job>& jobs, uint32_t thread_count = 0);  // 0: one thread per core
+};
+
+extern PipelineCache* default_pipeline_cache;
+VkPipelineCache DefaultPipelineCache();   // VK_NULL_HANDLE if none
+
+#endif
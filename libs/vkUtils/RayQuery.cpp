@@ -0,0 +1,94 @@
+#include "RayQuery.h"
+
+#undef repeat
+#define repeat(COUNT) for(uint32_t i = 0; i < (COUNT); ++i)
+
+RayQuerySet::~RayQuerySet() {
+    Destroy();
+}
+
+void RayQuerySet::Init(VkDevice device) {
+    Destroy();
+    this->device = device;
+
+    //--- Layout ---
+    VkDescriptorSetLayoutBinding bindings[2] = {};
+    bindings[0].binding         = 0;
+    bindings[0].descriptorType  = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags      = VK_SHADER_STAGE_FRAGMENT_BIT;
+    bindings[1].binding         = 1;
+    bindings[1].descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    bindings[1].descriptorCount = 1;
+    bindings[1].stageFlags      = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layout_info = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+    layout_info.bindingCount = 2;
+    layout_info.pBindings    = bindings;
+    VKERRCHECK(vkCreateDescriptorSetLayout(device, &layout_info, nullptr, &layout));
+
+    //--- Pool ---
+    VkDescriptorPoolSize sizes[2] = {{VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, ring},
+                                     {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,             ring}};
+    VkDescriptorPoolCreateInfo pool_info = {VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+    pool_info.maxSets       = ring;
+    pool_info.poolSizeCount = 2;
+    pool_info.pPoolSizes    = sizes;
+    VKERRCHECK(vkCreateDescriptorPool(device, &pool_info, nullptr, &pool));
+
+    //--- Sets ---
+    VkDescriptorSetLayout layouts[ring];
+    repeat(ring) layouts[i] = layout;
+    VkDescriptorSetAllocateInfo alloc_info = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+    alloc_info.descriptorPool     = pool;
+    alloc_info.descriptorSetCount = ring;
+    alloc_info.pSetLayouts        = layouts;
+    VKERRCHECK(vkAllocateDescriptorSets(device, &alloc_info, sets));
+
+    //--- Settings buffer (each set points at its own slot) ---
+    buffer.Data(0, ring, (uint32_t)stride, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, &buffer.mapped);
+    repeat(ring) {
+        VkDescriptorBufferInfo buffer_info = {buffer, i * stride, sizeof(RayQuerySettings)};
+        VkWriteDescriptorSet write = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+        write.dstSet          = sets[i];
+        write.dstBinding      = 1;
+        write.descriptorCount = 1;
+        write.descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        write.pBufferInfo     = &buffer_info;
+        vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+        bound[i] = VK_NULL_HANDLE;
+    }
+    inx = 0;
+}
+
+void RayQuerySet::Destroy() {
+    if(!device) return;
+    vkDeviceWaitIdle(device);
+    if(pool)   vkDestroyDescriptorPool     (device, pool,   nullptr);  pool   = VK_NULL_HANDLE;
+    if(layout) vkDestroyDescriptorSetLayout(device, layout, nullptr);  layout = VK_NULL_HANDLE;
+    repeat(ring) { sets[i] = VK_NULL_HANDLE;  bound[i] = VK_NULL_HANDLE; }
+    buffer.Clear();
+    device = 0;
+}
+
+// The frame that last used the next set has completed (AcquireNext waited for it), so it can be rewritten.
+void RayQuerySet::Update(VkAccelerationStructureKHR tlas) {
+    ASSERT(device, "RayQuerySet not initialized.\n");
+    ASSERT(tlas, "RayQuerySet: The TLAS has not been built.\n");
+    inx = (inx + 1) % ring;
+    memcpy((char*)buffer.mapped + inx * stride, &settings, sizeof(settings));
+    buffer.Flush();
+    if(bound[inx] == tlas) return;
+
+    VkWriteDescriptorSetAccelerationStructureKHR as_info = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR};
+    as_info.accelerationStructureCount = 1;
+    as_info.pAccelerationStructures    = &tlas;
+    VkWriteDescriptorSet write = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+    write.pNext           = &as_info;
+    write.dstSet          = sets[inx];
+    write.dstBinding      = 0;
+    write.descriptorCount = 1;
+    write.descriptorType  = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+    vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+    bound[inx] = tlas;
+}
@@ -0,0 +1,56 @@
+// RayQuerySet
+// Lets raster shaders trace rays inline (GL_EXT_ray_query), against the ray tracer's TLAS:
+// eg. shadow and ambient-occlusion rays from the PBR fragment shader, without an RT pipeline or SBT.
+//
+// Descriptor set layout (bind as the set after BindlessTable: set 2, or set 1 without it):
+//   binding 0 : accelerationStructureEXT tlas
+//   binding 1 : RayQuery settings          (uniform buffer, see rayquery.glsl)
+//
+// There is one set per frame in flight, each with its own copy of the settings. Update() moves on to
+// the next set, and writes the current settings and TLAS into it. (the TLAS is re-written only if it
+// was re-created) So settings can change every frame, without waiting for the GPU.
+//
+// Usage:
+//   RayQuerySet rq;
+//   rq.Init(device);
+//   pipeline.SetRayQuery(rq);   // after SetBindless
+//   rq.settings.ao_rays = 8;
+//   rq.Update(tlas);            // each frame, after AcquireNext (and before recording draws)
+
+#ifndef RAYQUERY_H
+#define RAYQUERY_H
+
+#include "Buffers.h"
+#include "matrix.h"
+
+struct RayQuerySettings {             // matches "RayQuery" in rayquery.glsl (std140)
+    vec4     light       {0,1,0,0};   // xyz: direction towards the light (w=0)
+    vec4     light_color {1,1,1,1};   // direct light, added to the diffuse light where the shadow rays reach it
+    uint32_t shadow_rays = 1;         // per pixel (0: no shadows)
+    uint32_t ao_rays     = 4;         // per pixel (0: no ray traced AO)
+    float    ao_radius   = 0.5f;      // occluders further away than this don't darken
+    float    light_size  = 0.01f;     // angular radius of the light, in radians (soft shadows, with shadow_rays > 1)
+};
+
+class RayQuerySet {
+    static const uint32_t     ring   = 3;    // >= frames in flight
+    static const VkDeviceSize stride = 256;  // max minUniformBufferOffsetAlignment
+    VkDevice         device = 0;
+    VkDescriptorPool pool   = 0;
+    CvkBuffer        buffer;                 // settings: one slot per set
+    VkAccelerationStructureKHR bound[ring]{};  // TLAS written to each set
+    uint32_t         inx = 0;
+
+public:
+    VkDescriptorSetLayout layout = 0;
+    VkDescriptorSet       sets[ring]{};
+    RayQuerySettings      settings;
+
+    ~RayQuerySet();
+    void Init(VkDevice device);
+    void Destroy();
+    void Update(VkAccelerationStructureKHR tlas);  // next set: write settings and TLAS
+    VkDescriptorSet Set() { return sets[inx]; }    // current set
+};
+
+#endif
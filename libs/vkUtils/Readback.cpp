@@ -0,0 +1,134 @@
+#include "Readback.h"
+#include "VkFormats.h"
+#include <string.h>
+
+Readback::~Readback() {
+    Clear();
+}
+
+void Readback::Init(VkDevice device, uint32_t slot_count, Callback callback) {
+    Clear();
+    ASSERT(slot_count > 0, "Readback: At least one slot is required.\n");
+    this->device   = device;
+    this->callback = callback;
+    slots.resize(slot_count);
+    head = tail = 0;
+    frame_count = 0;
+}
+
+void Readback::Clear() {
+    if(slots.empty()) return;
+    Flush();
+    slots.clear();
+}
+
+//---------------------------------------Record--------------------------------------
+// Copy the image into the next slot. Call after the last write to the image (eg. after the renderpass).
+void Readback::Record(VkCommandBuffer cmd, VkImage image, VkImageLayout layout, VkExtent2D extent, VkFormat format) {
+    if(slots.empty()) return;
+    format_info fmt = FormatInfo(format);
+    if(fmt.size != 4) { LOGW("Readback: Format %d not supported by CImage. (4 bytes per pixel)\n", format);  return; }
+
+    Slot& slot = slots[head];
+    ASSERT(slot.state != RECORDED, "Readback: Call Submitted() after each Record().\n");
+    if(slot.state == PENDING) {  // all slots in flight: wait for the oldest (this one)
+        VKERRCHECK(vkWaitForFences(device, 1, &slot.fence, VK_TRUE, UINT64_MAX));
+        Deliver(slot);
+    }
+
+    VkDeviceSize size = (VkDeviceSize)extent.width * extent.height * fmt.size;
+    if(slot.buffer.size() < size)
+        slot.buffer.Data(0, 1, (uint32_t)size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU, &slot.buffer.mapped);
+
+    VkImageMemoryBarrier barrier = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image               = image;
+    barrier.subresourceRange    = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+    //--- layout -> TRANSFER_SRC ---
+    barrier.oldLayout     = layout;
+    barrier.newLayout     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;  // renderpass or blit
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    //--- copy ---
+    VkBufferImageCopy region = {};
+    region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.imageExtent      = {extent.width, extent.height, 1};
+    vkCmdCopyImageToBuffer(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.buffer, 1, &region);
+
+    //--- TRANSFER_SRC -> layout ---
+    barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.newLayout     = layout;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.dstAccessMask = 0;
+    VkBufferMemoryBarrier host = {VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER};  // make the copy visible to the host
+    host.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+    host.dstAccessMask       = VK_ACCESS_HOST_READ_BIT;
+    host.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    host.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    host.buffer              = slot.buffer;
+    host.size                = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT | VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                         0, 0, nullptr, 1, &host, 1, &barrier);
+
+    slot.extent = extent;
+    slot.format = format;
+    slot.frame  = frame_count++;
+    slot.state  = RECORDED;
+    head = (head + 1) % (uint32_t)slots.size();
+}
+
+void Readback::Submitted(VkFence fence) {
+    for(auto& slot : slots) {
+        if(slot.state != RECORDED) continue;
+        slot.fence = fence;
+        slot.state = PENDING;
+    }
+}
+//-----------------------------------------------------------------------------------
+
+//---------------------------------------Deliver-------------------------------------
+void Readback::Deliver(Slot& slot) {
+    uint32_t w = slot.extent.width;
+    uint32_t h = slot.extent.height;
+    format_info fmt = FormatInfo(slot.format);
+    slot.buffer.Invalidate();
+    image.SetSize(w, h);
+    memcpy(image.Buffer(), slot.buffer.mapped, (size_t)w * h * 4);
+
+    //--- format conversion ---
+    image.colorspace = (fmt.type == SRGB) ? csSRGB : csUNORM;
+    if(swizzle && fmt.isSwizzled()) image.BGRAtoRGBA();
+    if(to_srgb && image.colorspace == csUNORM) { image.UNORMtoSRGB();  image.colorspace = csSRGB; }
+
+    slot.state = IDLE;
+    slot.fence = 0;
+    tail = (tail + 1) % (uint32_t)slots.size();
+    if(callback) callback(image, slot.frame);
+}
+
+uint32_t Readback::Poll() {
+    uint32_t delivered = 0;
+    while(!slots.empty()) {
+        Slot& slot = slots[tail];
+        if(slot.state != PENDING) break;
+        if(vkGetFenceStatus(device, slot.fence) != VK_SUCCESS) break;  // not done yet (or fence reused by a later frame)
+        Deliver(slot);
+        ++delivered;
+    }
+    return delivered;
+}
+
+void Readback::Flush() {
+    while(!slots.empty()) {
+        Slot& slot = slots[tail];
+        if(slot.state != PENDING) break;
+        VKERRCHECK(vkWaitForFences(device, 1, &slot.fence, VK_TRUE, UINT64_MAX));
+        Deliver(slot);
+    }
+}
+//-----------------------------------------------------------------------------------
@@ -0,0 +1,66 @@
+// Readback
+// Asynchronous frame readback, for video capture and headless frame export.
+//
+// Record() adds an image-to-buffer copy to the end of the frame's own command buffer,
+// into one of N persistently mapped readback slots. Submitted() tags the recorded slots
+// with the frame's fence, and Poll() hands finished frames to the callback, a few frames
+// later, without stalling the render loop. Only when all slots are still in flight,
+// does Record() wait for the oldest one.
+//
+// Frames are delivered as RGBA8 CImages: BGRA formats are swizzled, and the colorspace is
+// set from the format. (optionally, UNORM frames are gamma-encoded to sRGB)
+// The callback runs on the render thread. Copy the image, if it is needed after returning.
+//
+// Usage:
+//   fbo.ReadImageAsync([](CImage& img, uint64_t frame) { ... }, 3);  // FBO records, and polls
+// or directly:
+//   readback.Init(device, 3, callback);
+//   readback.Record(cmd, image, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, extent, format);  // before vkEndCommandBuffer
+//   readback.Submitted(fence);  // after vkQueueSubmit
+//   readback.Poll();            // deliver finished frames
+//   readback.Flush();           // wait for, and deliver all pending frames
+
+#ifndef READBACK_H
+#define READBACK_H
+
+#include "Buffers.h"
+#include "CImage.h"
+#include <functional>
+
+class Readback {
+public:
+    typedef std::function<void(CImage& image, uint64_t frame)> Callback;
+private:
+    enum State {IDLE, RECORDED, PENDING};
+    struct Slot {
+        CvkBuffer  buffer;          // GPU_TO_CPU (mapped)
+        VkFence    fence  = 0;      // signaled when the copy is done
+        VkExtent2D extent = {};
+        VkFormat   format = VK_FORMAT_UNDEFINED;
+        uint64_t   frame  = 0;
+        State      state  = IDLE;
+    };
+    VkDevice          device = 0;
+    std::vector<Slot> slots;
+    uint32_t          head   = 0;   // next slot to record
+    uint32_t          tail   = 0;   // oldest slot not yet delivered
+    uint64_t          frame_count = 0;
+    CImage            image;        // conversion target (reused)
+    Callback          callback;
+    void Deliver(Slot& slot);
+public:
+    bool swizzle = true;    // convert BGRA formats to RGBA
+    bool to_srgb = false;   // gamma-encode UNORM frames
+
+    ~Readback();
+    void Init(VkDevice device, uint32_t slot_count, Callback callback);
+    void Clear();           // flush, and free the slots
+    bool Enabled() { return !slots.empty(); }
+
+    void Record(VkCommandBuffer cmd, VkImage image, VkImageLayout layout, VkExtent2D extent, VkFormat format);
+    void Submitted(VkFence fence);  // fence of the command buffer passed to Record
+    uint32_t Poll();                // deliver finished frames (non-blocking). Returns the number delivered.
+    void Flush();                   // wait for, and deliver all submitted frames
+};
+
+#endif
@@ -0,0 +1,623 @@
+#include "RenderGraph.h"
+#include "VkFormats.h"
+#include <algorithm>
+
+#undef repeat
+#define repeat(COUNT) for(uint32_t i = 0; i < (COUNT); ++i)
+
+//---------------------------------------Usages--------------------------------------
+// All stage and access bits used here also exist in synchronization 1, with the same values.
+struct UsageInfo {
+    VkPipelineStageFlags2 stage;
+    VkAccessFlags2        access;
+    VkImageLayout         layout;  // (images)
+    const char*           name;
+};
+
+static const UsageInfo usage_info[RenderGraph::USAGE_COUNT] = {
+    {0,                                                  0,                                           VK_IMAGE_LAYOUT_UNDEFINED,                        "NONE"},
+    {VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,    VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT |
+                                                         VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,      VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,         "COLOR_ATTACHMENT"},
+    {VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT |
+     VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,        VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                                                         VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, "DEPTH_ATTACHMENT"},
+    {VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,            VK_ACCESS_2_INPUT_ATTACHMENT_READ_BIT,       VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,         "INPUT_ATTACHMENT"},
+    {VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,            VK_ACCESS_2_SHADER_READ_BIT,                 VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,         "SAMPLED"},
+    {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,             VK_ACCESS_2_SHADER_READ_BIT,                 VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,         "SAMPLED_COMPUTE"},
+    {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,             VK_ACCESS_2_SHADER_READ_BIT,                 VK_IMAGE_LAYOUT_GENERAL,                          "STORAGE_READ"},
+    {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,             VK_ACCESS_2_SHADER_READ_BIT |
+                                                         VK_ACCESS_2_SHADER_WRITE_BIT,                VK_IMAGE_LAYOUT_GENERAL,                          "STORAGE_WRITE"},
+    {VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR,     VK_ACCESS_2_SHADER_READ_BIT,                 VK_IMAGE_LAYOUT_GENERAL,                          "RAYTRACE_READ"},
+    {VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR,     VK_ACCESS_2_SHADER_READ_BIT |
+                                                         VK_ACCESS_2_SHADER_WRITE_BIT,                VK_IMAGE_LAYOUT_GENERAL,                          "RAYTRACE_WRITE"},
+    {VK_PIPELINE_STAGE_2_TRANSFER_BIT,                   VK_ACCESS_2_TRANSFER_READ_BIT,               VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,             "TRANSFER_SRC"},
+    {VK_PIPELINE_STAGE_2_TRANSFER_BIT,                   VK_ACCESS_2_TRANSFER_WRITE_BIT,              VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,             "TRANSFER_DST"},
+    {VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,              VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT,       VK_IMAGE_LAYOUT_UNDEFINED,                        "INDIRECT"},
+    {VK_PIPELINE_STAGE_2_VERTEX_INPUT_BIT,               VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT,       VK_IMAGE_LAYOUT_UNDEFINED,                        "VERTEX"},
+    {VK_PIPELINE_STAGE_2_VERTEX_INPUT_BIT,               VK_ACCESS_2_INDEX_READ_BIT,                  VK_IMAGE_LAYOUT_UNDEFINED,                        "INDEX"},
+    {VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT |
+     VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,            VK_ACCESS_2_UNIFORM_READ_BIT,                VK_IMAGE_LAYOUT_UNDEFINED,                        "UNIFORM"},
+    {0,                                                  0,                                           VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,                  "PRESENT"},
+    {VK_PIPELINE_STAGE_2_HOST_BIT,                       VK_ACCESS_2_HOST_READ_BIT,                   VK_IMAGE_LAYOUT_UNDEFINED,                        "HOST_READ"},
+};
+
+static const VkAccessFlags2 write_access = VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT |
+                                           VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT |
+                                           VK_ACCESS_2_HOST_WRITE_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+static std::string StageNames(VkPipelineStageFlags2 stages) {
+    static const std::pair<VkPipelineStageFlags2, const char*> names[] = {
+        {VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,           "INDIRECT"},
+        {VK_PIPELINE_STAGE_2_VERTEX_INPUT_BIT,            "VERTEX_INPUT"},
+        {VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT,           "VERTEX"},
+        {VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT,    "EARLY_Z"},
+        {VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,         "FRAGMENT"},
+        {VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,     "LATE_Z"},
+        {VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, "COLOR_OUTPUT"},
+        {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,          "COMPUTE"},
+        {VK_PIPELINE_STAGE_2_TRANSFER_BIT,                "TRANSFER"},
+        {VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR,  "RAYTRACE"},
+        {VK_PIPELINE_STAGE_2_HOST_BIT,                    "HOST"},
+    };
+    std::string str;
+    for(auto& name : names) if(stages & name.first) str += (str.empty() ? "" : "|") + std::string(name.second);
+    return str.empty() ? "NONE" : str;
+}
+
+static const char* LayoutName(VkImageLayout layout) {
+    switch(layout) {
+        case VK_IMAGE_LAYOUT_UNDEFINED                        : return "UNDEFINED";
+        case VK_IMAGE_LAYOUT_GENERAL                          : return "GENERAL";
+        case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL         : return "COLOR_ATTACHMENT";
+        case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : return "DEPTH_ATTACHMENT";
+        case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL         : return "SHADER_READ";
+        case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL             : return "TRANSFER_SRC";
+        case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL             : return "TRANSFER_DST";
+        case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR                  : return "PRESENT_SRC";
+        default                                               : return "OTHER";
+    }
+}
+//-----------------------------------------------------------------------------------
+
+//----------------------------------------Pass---------------------------------------
+RenderGraph::Pass& RenderGraph::Pass::Read(uint32_t resource, Usage usage) {
+    uses.push_back({resource, usage, false, VK_IMAGE_LAYOUT_UNDEFINED});
+    return *this;
+}
+
+RenderGraph::Pass& RenderGraph::Pass::Write(uint32_t resource, Usage usage, VkImageLayout end_layout) {
+    uses.push_back({resource, usage, true, end_layout});
+    return *this;
+}
+
+RenderGraph::Pass& RenderGraph::Pass::SideEffect() {
+    side_effect = true;
+    return *this;
+}
+//-----------------------------------------------------------------------------------
+
+//--------------------------------------Resources------------------------------------
+RenderGraph::~RenderGraph() {
+    FreeTransients();
+}
+
+void RenderGraph::Init(const CQueue& queue) {
+    device    = queue.device;
+    use_sync2 = queue.gpu.extensions.IsPicked("VK_KHR_synchronization2") &&
+                queue.gpu.features_Synchronization2.synchronization2 && vkCmdPipelineBarrier2KHR;
+    if(!use_sync2) LOGI("RenderGraph: synchronization2 not available. Using vkCmdPipelineBarrier.\n");
+}
+
+void RenderGraph::Clear() {
+    resources.clear();
+    passes.clear();
+    epilogue.clear();
+    slots.clear();
+    compiled = false;
+}
+
+uint32_t RenderGraph::AddResource(const Resource& res) {
+    compiled = false;
+    resources.push_back(res);
+    return (uint32_t)resources.size() - 1;
+}
+
+uint32_t RenderGraph::ImportImage(const char* name, VkImage image, VkImageLayout initial_layout, VkImageLayout final_layout,
+                                  Usage initial_usage, VkImageAspectFlags aspect) {
+    Resource res;
+    res.name           = name;
+    res.is_image       = true;
+    res.image          = image;
+    res.aspect         = aspect;
+    res.initial_layout = initial_layout;
+    res.final_layout   = final_layout;
+    res.initial_usage  = initial_usage;
+    return AddResource(res);
+}
+
+uint32_t RenderGraph::ImportBuffer(const char* name, VkBuffer buffer, Usage initial_usage) {
+    Resource res;
+    res.name          = name;
+    res.buffer        = buffer;
+    res.initial_usage = initial_usage;
+    return AddResource(res);
+}
+
+uint32_t RenderGraph::CreateImage(const char* name, VkExtent2D extent, VkFormat format, VkImageUsageFlags usage, VkSampleCountFlagBits samples) {
+    format_info fmt = FormatInfo(format);
+    Resource res;
+    res.name        = name;
+    res.is_image    = true;
+    res.transient   = true;
+    res.extent      = extent;
+    res.format      = format;
+    res.usage_flags = usage;
+    res.samples     = samples;
+    res.aspect      = fmt.hasDepth() ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+    if(fmt.hasStencil()) res.aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+    return AddResource(res);
+}
+
+void RenderGraph::SetImage(uint32_t resource, VkImage image, VkImageView view) {
+    ASSERT(!resources[resource].transient, "RenderGraph: Transient images are created by Realize().\n");
+    resources[resource].image = image;
+    resources[resource].view  = view;
+}
+
+void RenderGraph::SetBuffer(uint32_t resource, VkBuffer buffer) {
+    resources[resource].buffer = buffer;
+}
+
+RenderGraph::Pass& RenderGraph::AddPass(const char* name, Exec exec) {
+    compiled = false;
+    passes.emplace_back();
+    Pass& pass = passes.back();
+    pass.name = name;
+    pass.exec = exec;
+    return pass;
+}
+//-----------------------------------------------------------------------------------
+
+//---------------------------------------Compile-------------------------------------
+void RenderGraph::Compile() {
+    for(auto& res : resources) { res.first = UINT32_MAX;  res.last = 0;  res.slot = -1; }
+    Cull();
+    Alias();
+    Schedule();
+    compiled = true;
+}
+
+// Walk back from the passes with visible results: writes to imported resources, or side effects.
+// A pass is live if it writes something a live pass reads.
+void RenderGraph::Cull() {
+    std::vector<bool> needed(resources.size(), false);
+    for(uint32_t i = (uint32_t)passes.size(); i-- > 0;) {
+        Pass& pass = passes[i];
+        bool live = pass.side_effect;
+        for(auto& use : pass.uses)
+            if(use.write && (!resources[use.resource].transient || needed[use.resource])) live = true;
+        pass.culled = !live;
+        if(live) for(auto& use : pass.uses) if(!use.write || use.usage == DEPTH_ATTACHMENT) needed[use.resource] = true;
+    }
+}
+
+// Greedy interval packing: each transient image takes the best fitting slot that is free by its first pass.
+void RenderGraph::Alias() {
+    slots.clear();
+    uint32_t count = (uint32_t)passes.size();
+    repeat(count) {
+        if(passes[i].culled) continue;
+        for(auto& use : passes[i].uses) {
+            Resource& res = resources[use.resource];
+            res.first = std::min(res.first, i);
+            res.last  = std::max(res.last,  i);
+        }
+    }
+
+    std::vector<uint32_t> order;
+    repeat((uint32_t)resources.size()) if(resources[i].transient && resources[i].first != UINT32_MAX) order.push_back(i);
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return resources[a].first < resources[b].first; });
+
+    for(uint32_t r : order) {
+        Resource& res = resources[r];
+        VkDeviceSize size = (VkDeviceSize)res.extent.width * res.extent.height * res.samples * std::max((int)FormatInfo(res.format).size, 1);
+        int best = -1;
+        repeat((uint32_t)slots.size()) {
+            Slot& slot = slots[i];
+            if(slot.last >= res.first) continue;                      // still occupied
+            if(best < 0) { best = i;  continue; }
+            VkDeviceSize best_size = slots[best].size;
+            bool fits = slot.size >= size, best_fits = best_size >= size;
+            if(fits && (!best_fits || slot.size < best_size)) best = i;  // smallest that fits
+            if(!fits && !best_fits && slot.size > best_size)  best = i;  // else: the largest (least growth)
+        }
+        if(best < 0) { best = (int)slots.size();  slots.emplace_back(); }
+        Slot& slot = slots[best];
+        slot.size = std::max(slot.size, size);
+        slot.last = res.last;
+        slot.images.push_back(r);
+        res.slot = best;
+    }
+}
+
+struct RenderGraph::State {
+    VkImageLayout         layout        = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkPipelineStageFlags2 write_stage   = 0;  // last write (or layout transition)
+    VkAccessFlags2        write_access  = 0;
+    VkPipelineStageFlags2 read_stages   = 0;  // reads since the last write
+    VkPipelineStageFlags2 visible_stage = 0;  // stages/accesses the last write was made visible to
+    VkAccessFlags2        visible_access= 0;
+};
+
+void RenderGraph::Schedule() {
+    std::vector<State> state(resources.size());
+    repeat((uint32_t)resources.size()) {
+        Resource& res = resources[i];
+        State& st = state[i];
+        st.layout = res.transient ? VK_IMAGE_LAYOUT_UNDEFINED : res.initial_layout;
+        const UsageInfo& info = usage_info[res.initial_usage];
+        if(info.access & write_access) { st.write_stage = info.stage;  st.write_access = info.access & write_access; }
+        else st.read_stages = info.stage;
+    }
+    struct Patch { uint32_t pass;  size_t barrier;  int slot; };
+    std::vector<Patch> patches;                                         // first occupant of each slot
+
+    uint32_t count = (uint32_t)passes.size();
+    repeat(count) {
+        Pass& pass = passes[i];
+        pass.barriers.clear();
+        if(pass.culled) continue;
+
+        //--- Merge all uses of each resource in this pass ---
+        struct Merged { uint32_t resource; VkPipelineStageFlags2 stage; VkAccessFlags2 access; VkImageLayout layout, end_layout; bool write, renderpass; };
+        std::vector<Merged> merged;
+        for(auto& use : pass.uses) {
+            const UsageInfo& info = usage_info[use.usage];
+            auto it = std::find_if(merged.begin(), merged.end(), [&](Merged& m) { return m.resource == use.resource; });
+            if(it == merged.end()) { merged.push_back({use.resource, 0, 0, info.layout, VK_IMAGE_LAYOUT_UNDEFINED, false, false});  it = merged.end() - 1; }
+            if(resources[use.resource].is_image && it->layout != info.layout)
+                LOGE("RenderGraph: Pass '%s' uses '%s' in two layouts.\n", pass.name.c_str(), resources[use.resource].name.c_str());
+            it->stage  |= info.stage;
+            it->access |= info.access;
+            it->write  |= use.write;
+            if(use.end_layout) it->end_layout = use.end_layout;
+            if(use.end_layout && (use.usage == COLOR_ATTACHMENT || use.usage == DEPTH_ATTACHMENT)) it->renderpass = true;
+        }
+
+        //--- Barriers ---
+        for(auto& m : merged) {
+            Resource& res = resources[m.resource];
+            State& st = state[m.resource];
+            bool first_use = res.transient && i == res.first;
+            if(first_use) {                                             // new occupant of an aliased slot
+                st = {};
+                Slot& slot = slots[res.slot];
+                auto pos = std::find(slot.images.begin(), slot.images.end(), m.resource);
+                if(pos != slot.images.begin()) {                        // wait for the previous occupant
+                    State& prev = state[*(pos - 1)];
+                    st.write_stage  = prev.write_stage | prev.read_stages;
+                    st.write_access = prev.write_access;
+                }
+                if(!m.write) LOGW("RenderGraph: Pass '%s' reads '%s' before it is written.\n", pass.name.c_str(), res.name.c_str());
+            }
+
+            VkImageLayout layout = res.is_image ? m.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+            if(m.renderpass) layout = st.layout;                        // the renderpass does its own transitions
+            bool transition = res.is_image && st.layout != layout;
+            Barrier b;
+            b.resource   = m.resource;
+            b.dst_stage  = m.stage;
+            b.dst_access = m.access;
+            b.old_layout = res.is_image ? st.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+            b.new_layout = layout;
+            bool needed  = false;
+            if(transition || m.write) {                                 // WAR, WAW, or layout change
+                b.src_stage  = st.write_stage | st.read_stages;
+                b.src_access = st.write_access;
+                needed = transition || b.src_stage;
+            } else if(st.write_stage) {                                 // RAW, unless already visible to this use
+                bool visible = (st.visible_stage & m.stage) == m.stage && (st.visible_access & m.access) == m.access;
+                b.src_stage  = st.write_stage;
+                b.src_access = st.write_access;
+                needed = !visible;
+            }
+            if(needed) {
+                if(first_use && slots[res.slot].images.front() == m.resource) patches.push_back({i, pass.barriers.size(), res.slot});
+                pass.barriers.push_back(b);
+            }
+
+            if(m.write || transition) {                                 // a layout transition counts as a write
+                st.write_stage    = m.stage;
+                st.write_access   = m.write ? (m.access & write_access) : 0;
+                st.read_stages    = m.write ? 0 : m.stage;
+                st.visible_stage  = m.stage;
+                st.visible_access = m.access;
+            } else {
+                st.read_stages |= m.stage;
+                if(needed) { st.visible_stage |= m.stage;  st.visible_access |= m.access; }
+            }
+            if(res.is_image) st.layout = m.end_layout ? m.end_layout : layout;
+        }
+    }
+
+    //--- The first occupant of a slot overwrites the last occupant of the previous frame ---
+    for(auto& p : patches) {
+        State& end = state[slots[p.slot].images.back()];
+        Barrier& b = passes[p.pass].barriers[p.barrier];
+        b.src_stage  |= end.write_stage | end.read_stages;
+        b.src_access |= end.write_access;
+    }
+
+    //--- Final layouts ---
+    epilogue.clear();
+    repeat((uint32_t)resources.size()) {
+        Resource& res = resources[i];
+        State& st = state[i];
+        if(!res.is_image || res.transient || !res.final_layout || st.layout == res.final_layout) continue;
+        Barrier b;
+        b.resource   = i;
+        b.src_stage  = st.write_stage | st.read_stages;
+        b.src_access = st.write_access;
+        b.old_layout = st.layout;
+        b.new_layout = res.final_layout;
+        epilogue.push_back(b);
+    }
+}
+//-----------------------------------------------------------------------------------
+
+//---------------------------------------Execute-------------------------------------
+void RenderGraph::Emit(VkCommandBuffer cmd, const std::vector<Barrier>& barriers) {
+    if(barriers.empty()) return;
+    if(use_sync2) {
+        std::vector<VkMemoryBarrier2>       memory_barriers;
+        std::vector<VkImageMemoryBarrier2>  image_barriers;
+        std::vector<VkBufferMemoryBarrier2> buffer_barriers;
+        for(auto& b : barriers) {
+            Resource& res = resources[b.resource];
+            if(res.is_image && !b.new_layout) {                        // no layout yet (renderpass attachment): execution + memory only
+                VkMemoryBarrier2 barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+                barrier.srcStageMask  = b.src_stage;
+                barrier.srcAccessMask = b.src_access;
+                barrier.dstStageMask  = b.dst_stage;
+                barrier.dstAccessMask = b.dst_access;
+                memory_barriers.push_back(barrier);
+            } else if(res.is_image) {
+                VkImageMemoryBarrier2 barrier = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+                barrier.srcStageMask        = b.src_stage;
+                barrier.srcAccessMask       = b.src_access;
+                barrier.dstStageMask        = b.dst_stage;
+                barrier.dstAccessMask       = b.dst_access;
+                barrier.oldLayout           = b.old_layout;
+                barrier.newLayout           = b.new_layout;
+                barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.image               = res.image;
+                barrier.subresourceRange    = {res.aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS};
+                image_barriers.push_back(barrier);
+            } else {
+                VkBufferMemoryBarrier2 barrier = {VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2};
+                barrier.srcStageMask        = b.src_stage;
+                barrier.srcAccessMask       = b.src_access;
+                barrier.dstStageMask        = b.dst_stage;
+                barrier.dstAccessMask       = b.dst_access;
+                barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.buffer              = res.buffer;
+                barrier.size                = VK_WHOLE_SIZE;
+                buffer_barriers.push_back(barrier);
+            }
+        }
+        VkDependencyInfo dependency = {VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+        dependency.memoryBarrierCount       = (uint32_t)memory_barriers.size();
+        dependency.pMemoryBarriers          = memory_barriers.data();
+        dependency.imageMemoryBarrierCount  = (uint32_t)image_barriers.size();
+        dependency.pImageMemoryBarriers     = image_barriers.data();
+        dependency.bufferMemoryBarrierCount = (uint32_t)buffer_barriers.size();
+        dependency.pBufferMemoryBarriers    = buffer_barriers.data();
+        vkCmdPipelineBarrier2KHR(cmd, &dependency);
+        return;
+    }
+
+    //--- synchronization 1: same bits, merged into one call ---
+    VkPipelineStageFlags src_stages = 0, dst_stages = 0;
+    VkMemoryBarrier memory_barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+    std::vector<VkImageMemoryBarrier>  image_barriers;
+    std::vector<VkBufferMemoryBarrier> buffer_barriers;
+    for(auto& b : barriers) {
+        Resource& res = resources[b.resource];
+        src_stages |= (VkPipelineStageFlags)b.src_stage;
+        dst_stages |= (VkPipelineStageFlags)b.dst_stage;
+        if(res.is_image && !b.new_layout) {
+            memory_barrier.srcAccessMask |= (VkAccessFlags)b.src_access;
+            memory_barrier.dstAccessMask |= (VkAccessFlags)b.dst_access;
+        } else if(res.is_image) {
+            VkImageMemoryBarrier barrier = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+            barrier.srcAccessMask       = (VkAccessFlags)b.src_access;
+            barrier.dstAccessMask       = (VkAccessFlags)b.dst_access;
+            barrier.oldLayout           = b.old_layout;
+            barrier.newLayout           = b.new_layout;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image               = res.image;
+            barrier.subresourceRange    = {res.aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS};
+            image_barriers.push_back(barrier);
+        } else {
+            VkBufferMemoryBarrier barrier = {VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER};
+            barrier.srcAccessMask       = (VkAccessFlags)b.src_access;
+            barrier.dstAccessMask       = (VkAccessFlags)b.dst_access;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.buffer              = res.buffer;
+            barrier.size                = VK_WHOLE_SIZE;
+            buffer_barriers.push_back(barrier);
+        }
+    }
+    if(!src_stages) src_stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;     // sync1 doesn't allow empty stage masks
+    if(!dst_stages) dst_stages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+    bool has_memory = memory_barrier.srcAccessMask || memory_barrier.dstAccessMask;
+    vkCmdPipelineBarrier(cmd, src_stages, dst_stages, 0, has_memory ? 1 : 0, &memory_barrier,
+                         (uint32_t)buffer_barriers.size(), buffer_barriers.data(),
+                         (uint32_t)image_barriers.size(),  image_barriers.data());
+}
+
+void RenderGraph::Execute(VkCommandBuffer cmd) {
+    if(!compiled) Compile();
+    for(auto& res : resources)
+        if(!res.transient && !(res.is_image ? (void*)res.image : (void*)res.buffer))
+            LOGW("RenderGraph: Resource '%s' is not set.\n", res.name.c_str());
+    for(auto& pass : passes) {
+        if(pass.culled) continue;
+        Emit(cmd, pass.barriers);
+        if(pass.exec) pass.exec(cmd);
+    }
+    Emit(cmd, epilogue);
+}
+//-----------------------------------------------------------------------------------
+
+//---------------------------------------Realize-------------------------------------
+std::string RenderGraph::Signature() {
+    std::string sig;
+    char buf[128];
+    for(auto& res : resources) {
+        if(!res.transient || res.slot < 0) continue;
+        snprintf(buf, sizeof(buf), "%dx%d:%d:%x:%d@%d;", res.extent.width, res.extent.height, res.format, res.usage_flags, res.samples, res.slot);
+        sig += buf;
+    }
+    return sig;
+}
+
+void RenderGraph::FreeTransients() {
+    if(!device) return;
+    for(auto view  : t_views)  if(view)  vkDestroyImageView(device, view, nullptr);
+    for(auto image : t_images) if(image) vkDestroyImage(device, image, nullptr);
+    for(auto alloc : memory)   if(alloc) vmaFreeMemory(*default_allocator, alloc);
+    t_views.clear();
+    t_images.clear();
+    memory.clear();
+    realized.clear();
+}
+
+// Images of one slot share a single allocation. The caller must make sure the GPU is done
+// with the previous transients, when their signature changes. (eg. on resize)
+void RenderGraph::Realize() {
+    if(!compiled) Compile();
+    std::string sig = Signature();
+    if(sig != realized) {
+        ASSERT(device, "RenderGraph: Not initialized.\n");
+        FreeTransients();
+        t_images.assign(resources.size(), nullptr);
+        t_views .assign(resources.size(), nullptr);
+
+        std::vector<VkMemoryRequirements> reqs(resources.size());
+        repeat((uint32_t)resources.size()) {
+            Resource& res = resources[i];
+            if(!res.transient || res.slot < 0) continue;
+            VkImageCreateInfo info = {VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+            info.imageType     = VK_IMAGE_TYPE_2D;
+            info.format        = res.format;
+            info.extent        = {res.extent.width, res.extent.height, 1};
+            info.mipLevels     = 1;
+            info.arrayLayers   = 1;
+            info.samples       = res.samples;
+            info.tiling        = VK_IMAGE_TILING_OPTIMAL;
+            info.usage         = res.usage_flags;
+            info.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+            info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            VKERRCHECK(vkCreateImage(device, &info, nullptr, &t_images[i]));
+            vkGetImageMemoryRequirements(device, t_images[i], &reqs[i]);
+        }
+
+        VmaAllocationCreateInfo alloc_info = {};
+        alloc_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+        auto allocate = [&](VkMemoryRequirements& req) {
+            VmaAllocation alloc = nullptr;
+            VKERRCHECK(vmaAllocateMemory(*default_allocator, &req, &alloc_info, &alloc, nullptr));
+            memory.push_back(alloc);
+            return alloc;
+        };
+        for(auto& slot : slots) {
+            VkMemoryRequirements req = {0, 1, ~0u};
+            for(uint32_t r : slot.images) {
+                req.size            = std::max(req.size, reqs[r].size);
+                req.alignment       = std::max(req.alignment, reqs[r].alignment);
+                req.memoryTypeBits &= reqs[r].memoryTypeBits;
+            }
+            if(req.memoryTypeBits) {                                    // shared
+                VmaAllocation alloc = allocate(req);
+                for(uint32_t r : slot.images) VKERRCHECK(vmaBindImageMemory(*default_allocator, alloc, t_images[r]));
+            } else {                                                    // no common memory type: don't alias
+                LOGW("RenderGraph: Slot images have no common memory type. Not aliased.\n");
+                for(uint32_t r : slot.images) VKERRCHECK(vmaBindImageMemory(*default_allocator, allocate(reqs[r]), t_images[r]));
+            }
+        }
+
+        repeat((uint32_t)resources.size()) {
+            Resource& res = resources[i];
+            if(!t_images[i]) continue;
+            VkImageViewCreateInfo info = {VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+            info.image            = t_images[i];
+            info.viewType         = VK_IMAGE_VIEW_TYPE_2D;
+            info.format           = res.format;
+            info.subresourceRange = {res.aspect & ~VK_IMAGE_ASPECT_STENCIL_BIT, 0, 1, 0, 1};
+            if(!(res.aspect & VK_IMAGE_ASPECT_DEPTH_BIT)) info.subresourceRange.aspectMask = res.aspect;
+            VKERRCHECK(vkCreateImageView(device, &info, nullptr, &t_views[i]));
+        }
+        realized = sig;
+        LOGI("RenderGraph: %d transient images in %d memory slots\n", (int)std::count_if(t_images.begin(), t_images.end(), [](VkImage img) { return img; }), (int)slots.size());
+    }
+    repeat((uint32_t)resources.size()) {
+        if(!resources[i].transient || i >= t_images.size()) continue;
+        resources[i].image = t_images[i];
+        resources[i].view  = t_views[i];
+    }
+}
+//-----------------------------------------------------------------------------------
+
+//---------------------------------------Schedule------------------------------------
+uint32_t RenderGraph::PassCount() {
+    return (uint32_t)std::count_if(passes.begin(), passes.end(), [](Pass& pass) { return !pass.culled; });
+}
+
+uint32_t RenderGraph::CulledCount() {
+    return (uint32_t)passes.size() - PassCount();
+}
+
+uint32_t RenderGraph::BarrierCount() {
+    size_t count = epilogue.size();
+    for(auto& pass : passes) count += pass.barriers.size();
+    return (uint32_t)count;
+}
+
+std::string RenderGraph::Dump() {
+    if(!compiled) Compile();
+    std::string str;
+    char buf[512];
+    auto dump_barriers = [&](const std::vector<Barrier>& barriers) {
+        for(auto& b : barriers) {
+            Resource& res = resources[b.resource];
+            int len = snprintf(buf, sizeof(buf), "      %-12s %s -> %s", res.name.c_str(),
+                               StageNames(b.src_stage).c_str(), StageNames(b.dst_stage).c_str());
+            if(res.is_image && b.old_layout != b.new_layout)
+                snprintf(buf + len, sizeof(buf) - len, "  (%s -> %s)", LayoutName(b.old_layout), LayoutName(b.new_layout));
+            str += buf;
+            str += "\n";
+        }
+    };
+    snprintf(buf, sizeof(buf), "RenderGraph: %d passes (%d culled), %d barriers, %d aliasing slots, %s\n",
+             PassCount(), CulledCount(), BarrierCount(), SlotCount(), use_sync2 ? "sync2" : "sync1");
+    str += buf;
+    for(auto& pass : passes) {
+        snprintf(buf, sizeof(buf), "  %s %s\n", pass.culled ? "[-]" : "[+]", pass.name.c_str());
+        str += buf;
+        dump_barriers(pass.barriers);
+    }
+    if(!epilogue.empty()) { str += "  [end]\n";  dump_barriers(epilogue); }
+    repeat((uint32_t)slots.size()) {
+        snprintf(buf, sizeof(buf), "  slot %d (~%d KB):", i, (int)(slots[i].size / 1024));
+        str += buf;
+        for(uint32_t r : slots[i].images) str += " " + resources[r].name;
+        str += "\n";
+    }
+    return str;
+}
+//-----------------------------------------------------------------------------------
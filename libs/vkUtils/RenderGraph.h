@@ -0,0 +1,168 @@
+// RenderGraph
+// A small frame graph: passes declare which images and buffers they read and write,
+// and Compile() derives the schedule from those declarations:
+//   - Culling:  passes whose writes are never read (and that write no imported resource) are dropped.
+//   - Barriers: one batch per pass, with the exact stages and access masks of both uses.
+//               Read-after-read needs none, and reads already made visible are not repeated.
+//   - Aliasing: transient images (CreateImage) whose lifetimes don't overlap share one memory slot.
+//
+// Compile() does not touch the device, so a schedule can be built, and checked (Dump(), BarrierCount())
+// without a GPU. Realize() then creates the transient images, and Execute() records the passes,
+// with synchronization2 barriers when VK_KHR_synchronization2 is enabled. (else vkCmdPipelineBarrier)
+//
+// Imported resources start in the given layout, after the given usage. (eg. the previous frame's)
+// Images can be left in a final layout (eg. PRESENT_SRC), and re-pointed each frame with SetImage().
+// A renderpass transitions its own attachments: pass the attachment's finalLayout as Write's end_layout.
+// Attachment writes with an end_layout then only get an execution/memory dependency, without a layout change.
+//
+// Usage:
+//   RenderGraph graph;
+//   graph.Init(queue);
+//   auto color = graph.ImportImage("color", image, VK_IMAGE_LAYOUT_UNDEFINED);
+//   auto cmds  = graph.ImportBuffer("commands", buffer, RenderGraph::INDIRECT);
+//   graph.AddPass("cull",  [&](VkCommandBuffer cmd) {...}).Write(cmds, RenderGraph::STORAGE_WRITE);
+//   graph.AddPass("scene", [&](VkCommandBuffer cmd) {...}).Read(cmds, RenderGraph::INDIRECT)
+//                                                          .Write(color, RenderGraph::COLOR_ATTACHMENT, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+//   graph.Compile();
+//   graph.Dump();
+//   graph.Realize();        // create transient images (only when they changed)
+//   graph.Execute(cmd);
+
+#ifndef RENDERGRAPH_H
+#define RENDERGRAPH_H
+
+#include "Buffers.h"
+#include <string>
+#include <deque>
+#include <functional>
+
+class RenderGraph {
+public:
+    enum Usage {
+        NONE,
+        COLOR_ATTACHMENT,     // write
+        DEPTH_ATTACHMENT,     // read + write
+        INPUT_ATTACHMENT,
+        SAMPLED,              // fragment shader
+        SAMPLED_COMPUTE,
+        STORAGE_READ,         // compute shader
+        STORAGE_WRITE,        // compute shader (read + write)
+        RAYTRACE_READ,        // ray tracing shaders
+        RAYTRACE_WRITE,
+        TRANSFER_SRC,
+        TRANSFER_DST,
+        INDIRECT,
+        VERTEX,
+        INDEX,
+        UNIFORM,              // vertex + fragment shader
+        PRESENT,
+        HOST_READ,
+        USAGE_COUNT
+    };
+    struct Barrier {          // device-independent, so a schedule can be checked without a GPU
+        uint32_t              resource   = 0;
+        VkPipelineStageFlags2 src_stage  = 0;
+        VkPipelineStageFlags2 dst_stage  = 0;
+        VkAccessFlags2        src_access = 0;
+        VkAccessFlags2        dst_access = 0;
+        VkImageLayout         old_layout = VK_IMAGE_LAYOUT_UNDEFINED;  // (images only)
+        VkImageLayout         new_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    };
+    typedef std::function<void(VkCommandBuffer cmd)> Exec;
+
+    class Pass {
+        friend class RenderGraph;
+        struct Use {
+            uint32_t      resource;
+            Usage         usage;
+            bool          write;
+            VkImageLayout end_layout;
+        };
+        std::string          name;
+        Exec                 exec;
+        std::vector<Use>     uses;
+        std::vector<Barrier> barriers;  // recorded before exec
+        bool side_effect = false;
+        bool culled      = false;
+    public:
+        Pass& Read (uint32_t resource, Usage usage);
+        Pass& Write(uint32_t resource, Usage usage, VkImageLayout end_layout = VK_IMAGE_LAYOUT_UNDEFINED);  // end_layout: layout the pass leaves the image in
+        Pass& SideEffect();   // never cull (eg. host readback)
+    };
+
+private:
+    struct Resource {
+        std::string        name;
+        bool               is_image  = false;
+        bool               transient = false;
+        VkImage            image     = nullptr;
+        VkImageView        view      = nullptr;
+        VkBuffer           buffer    = nullptr;
+        VkImageAspectFlags aspect    = VK_IMAGE_ASPECT_COLOR_BIT;
+        VkImageLayout      initial_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkImageLayout      final_layout   = VK_IMAGE_LAYOUT_UNDEFINED;  // UNDEFINED: leave as is
+        Usage              initial_usage  = NONE;
+        //--- transient ---
+        VkExtent2D            extent  = {};
+        VkFormat              format  = VK_FORMAT_UNDEFINED;
+        VkImageUsageFlags     usage_flags = 0;
+        VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+        uint32_t first = UINT32_MAX;    // lifetime: first and last live pass
+        uint32_t last  = 0;
+        int      slot  = -1;            // aliasing slot
+    };
+    struct Slot {
+        VkDeviceSize size = 0;          // estimate, from the formats (Realize uses the real requirements)
+        uint32_t     last = 0;          // last pass of the current occupant
+        std::vector<uint32_t> images;   // occupants, in lifetime order
+    };
+    struct State;
+
+    VkDevice             device    = nullptr;
+    bool                 use_sync2 = false;
+    bool                 compiled  = false;
+    std::vector<Resource> resources;
+    std::deque<Pass>     passes;        // (stable references)
+    std::vector<Barrier> epilogue;      // final layouts, after the last pass
+    std::vector<Slot>    slots;
+    std::string          realized;      // transient signature of the realized images
+    std::vector<VmaAllocation> memory;  // one per slot (realized)
+    std::vector<VkImage>       t_images;// realized transients, in resource order
+    std::vector<VkImageView>   t_views;
+
+    uint32_t AddResource(const Resource& res);
+    void Cull();
+    void Alias();
+    void Schedule();
+    void Emit(VkCommandBuffer cmd, const std::vector<Barrier>& barriers);
+    void FreeTransients();
+    std::string Signature();
+public:
+    ~RenderGraph();
+    void Init(const CQueue& queue);     // (not needed to Compile or Dump)
+    void Clear();                       // remove all passes and resources (keeps realized memory, if unchanged)
+
+    uint32_t ImportImage (const char* name, VkImage image, VkImageLayout initial_layout, VkImageLayout final_layout = VK_IMAGE_LAYOUT_UNDEFINED,
+                          Usage initial_usage = NONE, VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT);
+    uint32_t ImportBuffer(const char* name, VkBuffer buffer, Usage initial_usage = NONE);
+    uint32_t CreateImage (const char* name, VkExtent2D extent, VkFormat format, VkImageUsageFlags usage,
+                          VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT);  // transient (aliased)
+    void SetImage (uint32_t resource, VkImage image, VkImageView view = nullptr);  // re-point an imported image (eg. next swapchain image)
+    void SetBuffer(uint32_t resource, VkBuffer buffer);
+    VkImage     GetImage(uint32_t resource) { return resources[resource].image; }
+    VkImageView GetView (uint32_t resource) { return resources[resource].view;  }
+
+    Pass& AddPass(const char* name, Exec exec);
+    void Compile();                     // cull, alias and derive barriers
+    void Realize();                     // create transient images and their shared memory
+    void Execute(VkCommandBuffer cmd);  // record barriers and live passes
+
+    //--- Schedule ---
+    uint32_t PassCount();               // live passes
+    uint32_t CulledCount();
+    uint32_t BarrierCount();
+    uint32_t SlotCount() { return (uint32_t)slots.size(); }
+    std::string Dump();                 // compiled schedule, as text
+};
+
+#endif
@@ -0,0 +1,345 @@
+#undef  _CRT_SECURE_NO_WARNINGS
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "ShaderRegistry.h"
+#include "spirv_reflect.h"
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+
+#undef repeat
+#define repeat(COUNT) for(uint32_t i = 0; i < (COUNT); ++i)
+
+static const uint32_t REFL_MAGIC   = 0x4C464552;  // "REFL"
+static const uint32_t REFL_VERSION = 1;
+
+//---------------------------------------------Sidecar---------------------------------------------
+// Little binary writer/reader: uint32s, and strings as length + chars.
+struct Writer {
+    std::vector<char> data;
+    void u32(uint32_t v)           { data.insert(data.end(), (char*)&v, (char*)&v + 4); }
+    void u64(uint64_t v)           { data.insert(data.end(), (char*)&v, (char*)&v + 8); }
+    void str(const std::string& s) { u32((uint32_t)s.size());  data.insert(data.end(), s.begin(), s.end()); }
+};
+
+struct Reader {
+    const std::vector<char>& data;
+    size_t pos = 0;
+    bool   ok  = true;
+    Reader(const std::vector<char>& data) : data(data) {}
+    bool get(void* dst, size_t size) {
+        ok = ok && (pos + size <= data.size());
+        if(ok) memcpy(dst, &data[pos], size);
+        pos += size;
+        return ok;
+    }
+    uint32_t u32() { uint32_t v = 0;  get(&v, 4);  return v; }
+    uint64_t u64() { uint64_t v = 0;  get(&v, 8);  return v; }
+    std::string str() {
+        uint32_t len = u32();
+        ok = ok && (pos + len <= data.size());
+        if(!ok) return "";
+        std::string s(&data[pos], len);
+        pos += len;
+        return s;
+    }
+};
+
+static std::vector<char> ReadFile(const char* filename) {
+    std::vector<char> buffer;
+    FILE* file = fopen(filename, "rb");
+    if(!file) return buffer;
+    fseek(file, 0L, SEEK_END);
+    buffer.resize((size_t)ftell(file));
+    rewind(file);
+    if(fread(buffer.data(), 1, buffer.size(), file) != buffer.size()) buffer.clear();
+    fclose(file);
+    return buffer;
+}
+
+void ShaderReflection::Write(const char* filename, uint64_t hash) const {
+    Writer w;
+    w.u32(REFL_MAGIC);
+    w.u32(REFL_VERSION);
+    w.u64(hash);
+    w.u32(stage);
+    w.str(entry_point);
+    w.u32((uint32_t)bindings.size());
+    for(auto& b : bindings) { w.u32(b.set);  w.u32(b.binding);  w.u32(b.type);  w.u32(b.count);  w.u32(b.input_attachment_index);  w.str(b.name); }
+    w.u32((uint32_t)inputs.size());
+    for(auto& in : inputs)  { w.u32(in.location);  w.u32(in.format);  w.str(in.name);  w.str(in.type); }
+    w.u32((uint32_t)push_blocks.size());
+    for(auto& p : push_blocks) { w.str(p.name);  w.u32(p.offset);  w.u32(p.size); }
+
+    FILE* file = fopen(filename, "wb");
+    if(!file) { LOGW("ShaderRegistry: Can't write %s (reflection will be parsed again next time)\n", filename);  return; }
+    fwrite(w.data.data(), 1, w.data.size(), file);
+    fclose(file);
+}
+
+bool ShaderReflection::Read(const char* filename, uint64_t hash) {
+    std::vector<char> data = ReadFile(filename);
+    if(data.empty()) return false;
+    Reader r(data);
+    if(r.u32() != REFL_MAGIC || r.u32() != REFL_VERSION || r.u64() != hash) return false;  // stale: shader was recompiled
+    stage       = (VkShaderStageFlagBits)r.u32();
+    entry_point = r.str();
+    bindings.resize(std::min(r.u32(), 1024u));
+    for(auto& b : bindings) { b.set = r.u32();  b.binding = r.u32();  b.type = (VkDescriptorType)r.u32();  b.count = r.u32();
+                              b.input_attachment_index = r.u32();  b.name = r.str(); }
+    inputs.resize(std::min(r.u32(), 64u));
+    for(auto& in : inputs)  { in.location = r.u32();  in.format = (VkFormat)r.u32();  in.name = r.str();  in.type = r.str(); }
+    push_blocks.resize(std::min(r.u32(), 64u));
+    for(auto& p : push_blocks) { p.name = r.str();  p.offset = r.u32();  p.size = r.u32(); }
+    return r.ok;
+}
+//-------------------------------------------------------------------------------------------------
+
+//---------------------------------------------Parse-----------------------------------------------
+static std::string ToStringGLSLType(const SpvReflectTypeDescription& type) {
+    uint32_t width = type.traits.numeric.scalar.width;
+    switch (type.op) {
+        case SpvOpTypeVector: {
+            uint32_t n = type.traits.numeric.vector.component_count;
+            if(n < 2 || n > 4) break;
+            if(width == 32) return std::string("vec")  + char('0' + n);
+            if(width == 64) return std::string("dvec") + char('0' + n);
+            break;
+        }
+        case SpvOpTypeBool  : return "bool";
+        case SpvOpTypeInt   : if(width == 32) return type.traits.numeric.scalar.signedness ? "int" : "uint";  break;
+        case SpvOpTypeFloat : if(width == 32) return "float";  if(width == 64) return "double";  break;
+        default: break;
+    }
+    return "";
+}
+
+bool ShaderReflection::Parse(const std::vector<char>& spirv) {
+    SpvReflectShaderModule module = {};
+    SpvReflectResult result = spvReflectCreateShaderModule(spirv.size(), spirv.data(), &module);
+    if(result != SPV_REFLECT_RESULT_SUCCESS) return false;
+
+    stage       = (VkShaderStageFlagBits)module.shader_stage;
+    entry_point = module.entry_point_name;
+
+    //-- Descriptor bindings --
+    uint32_t count = 0;
+    spvReflectEnumerateDescriptorSets(&module, &count, nullptr);
+    std::vector<SpvReflectDescriptorSet*> sets(count);
+    spvReflectEnumerateDescriptorSets(&module, &count, sets.data());
+    bindings.clear();
+    for(auto set : sets) {
+        repeat(set->binding_count) {
+            const SpvReflectDescriptorBinding& ds_binding = *set->bindings[i];
+            Binding b = {set->set, ds_binding.binding, (VkDescriptorType)ds_binding.descriptor_type, 1,
+                         ds_binding.input_attachment_index, ds_binding.name ? ds_binding.name : ""};
+            for (uint32_t i_dim = 0; i_dim < ds_binding.array.dims_count; ++i_dim) b.count *= ds_binding.array.dims[i_dim];
+            bindings.push_back(b);
+        }
+    }
+
+    //-- Vertex inputs --
+    inputs.clear();
+    if(stage == VK_SHADER_STAGE_VERTEX_BIT) {
+        count = 0;
+        spvReflectEnumerateInputVariables(&module, &count, nullptr);
+        std::vector<SpvReflectInterfaceVariable*> input_vars(count);
+        spvReflectEnumerateInputVariables(&module, &count, input_vars.data());
+        for(auto var : input_vars) {
+            if(var->decoration_flags & SPV_REFLECT_DECORATION_BUILT_IN) continue;  // skip gl_VertexIndex, gl_InstanceIndex, ...
+            inputs.push_back({var->location, (VkFormat)var->format, var->name, ToStringGLSLType(*var->type_description)});
+        }
+        std::sort(inputs.begin(), inputs.end(), [](const Input& a, const Input& b) { return a.location < b.location; });
+    }
+
+    //-- Push constants --
+    count = 0;
+    spvReflectEnumeratePushConstantBlocks(&module, &count, nullptr);
+    std::vector<SpvReflectBlockVariable*> blocks(count);
+    spvReflectEnumeratePushConstantBlocks(&module, &count, blocks.data());
+    push_blocks.clear();
+    for(auto block : blocks) push_blocks.push_back({block->name ? block->name : "", block->offset, block->size});
+
+    spvReflectDestroyShaderModule(&module);
+    return true;
+}
+
+static const char* ToStringDescriptorType(VkDescriptorType value) {
+    switch (value) {
+        case VK_DESCRIPTOR_TYPE_SAMPLER                    : return "VK_DESCRIPTOR_TYPE_SAMPLER";
+        case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER     : return "VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER";
+        case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE              : return "VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE";
+        case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE              : return "VK_DESCRIPTOR_TYPE_STORAGE_IMAGE";
+        case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER       : return "VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER";
+        case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER       : return "VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER";
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER             : return "VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER";
+        case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER             : return "VK_DESCRIPTOR_TYPE_STORAGE_BUFFER";
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC     : return "VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC";
+        case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC     : return "VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC";
+        case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT           : return "VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT";
+        case VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR : return "VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR";
+        default: return "VK_DESCRIPTOR_TYPE_???";
+    }
+}
+
+void ShaderReflection::Print() const {
+    const char* stage_name = "UNKNOWN";
+    switch(stage) {
+        case VK_SHADER_STAGE_VERTEX_BIT          : stage_name = "VERTEX";       break;
+        case VK_SHADER_STAGE_FRAGMENT_BIT        : stage_name = "FRAGMENT";     break;
+        case VK_SHADER_STAGE_GEOMETRY_BIT        : stage_name = "GEOMETRY";     break;
+        case VK_SHADER_STAGE_COMPUTE_BIT         : stage_name = "COMPUTE";      break;
+        case VK_SHADER_STAGE_RAYGEN_BIT_KHR      : stage_name = "RAYGEN";       break;
+        case VK_SHADER_STAGE_ANY_HIT_BIT_KHR     : stage_name = "ANY_HIT";      break;
+        case VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR : stage_name = "CLOSEST_HIT";  break;
+        case VK_SHADER_STAGE_MISS_BIT_KHR        : stage_name = "MISS";         break;
+        case VK_SHADER_STAGE_INTERSECTION_BIT_KHR: stage_name = "INTERSECTION"; break;
+        case VK_SHADER_STAGE_CALLABLE_BIT_KHR    : stage_name = "CALLABLE";     break;
+        default: break;
+    }
+    printf("  Entry Point     : %s\n", entry_point.c_str());
+    printf("  Shader stage    : %s\n", stage_name);
+    uint32_t set = UINT32_MAX;
+    for(auto& b : bindings) {
+        if(b.set != set) printf("  Descriptor set  : %d\n", set = b.set);
+        printf("       binding %2d : %-12s (%s)\n", b.binding, b.name.c_str(), ToStringDescriptorType(b.type));
+    }
+    if(!inputs.empty()) {
+        printf("  Vertex Input attributes:\n");
+        for(auto& in : inputs) printf("    %d : %s %s\n", in.location, in.type.c_str(), in.name.c_str());
+    }
+    for(auto& p : push_blocks) printf("  Push Constants:  Block(%s) offset=%d size=%d\n", p.name.c_str(), p.offset, p.size);
+    printf("\n");
+}
+//-------------------------------------------------------------------------------------------------
+
+//--------------------------------------------Registry---------------------------------------------
+ShaderRegistry& ShaderRegistry::Get() {
+    static ShaderRegistry registry;  // (objects are destroyed by their last Release, not here: the device is gone by then)
+    return registry;
+}
+
+uint64_t ShaderRegistry::Hash(const void* data, size_t size) {  // FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    const uint8_t* bytes = (const uint8_t*)data;
+    for(size_t i = 0; i < size; ++i) { hash ^= bytes[i];  hash *= 1099511628211ull; }
+    return hash;
+}
+
+const ShaderRegistry::Module* ShaderRegistry::AcquireModule(VkDevice device, const char* filename) {
+    std::vector<char> spirv = ReadFile(filename);
+    printf("Load Shader: %s... %s\n" RESET, filename, (spirv.empty() ? RED"Not found" : GREEN"Found"));
+    ASSERT(!spirv.empty(), "File not found: %s\n", filename);
+    uint64_t hash = Hash(spirv.data(), spirv.size());
+
+    std::lock_guard<std::mutex> lock(mutex);
+    ASSERT(!this->device || this->device == device, "ShaderRegistry: Only one VkDevice is supported.\n");
+    this->device = device;
+    ++stats.loads;
+    auto& shared = modules[hash];
+    if(shared.refs++) { ++stats.shared;  return shared.handle; }  // same SPIR-V already loaded
+
+    Module* mod = new Module();
+    mod->hash = hash;
+    std::string sidecar = std::string(filename) + ".refl";
+    if(mod->reflection.Read(sidecar.c_str(), hash)) {
+        ++stats.sidecar;
+    } else {
+        bool ok = mod->reflection.Parse(spirv);
+        ASSERT(ok, "ShaderRegistry: Failed to parse %s\n", filename);
+        mod->reflection.Write(sidecar.c_str(), hash);
+        ++stats.parsed;
+    }
+#ifdef ENABLE_LOGGING
+    mod->reflection.Print();
+#endif
+
+    VkShaderModuleCreateInfo createInfo = {VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
+    std::vector<uint32_t> codeAligned(spirv.size() / 4 + 1);
+    memcpy(codeAligned.data(), spirv.data(), spirv.size());
+    createInfo.codeSize = spirv.size();
+    createInfo.pCode    = codeAligned.data();
+    VKERRCHECK(vkCreateShaderModule(device, &createInfo, nullptr, &mod->module));
+    shared.handle = mod;
+    return mod;
+}
+
+VkDescriptorSetLayout ShaderRegistry::AcquireSetLayout(VkDevice device, const std::vector<VkDescriptorSetLayoutBinding>& bindings) {
+    Writer key;
+    for(auto& b : bindings) {
+        key.u32(b.binding);  key.u32(b.descriptorType);  key.u32(b.descriptorCount);  key.u32(b.stageFlags);
+        key.u64(b.pImmutableSamplers ? (uint64_t)*b.pImmutableSamplers : 0);
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& shared = set_layouts[std::string(key.data.begin(), key.data.end())];
+    if(shared.refs++) { ++stats.layouts;  return shared.handle; }
+
+    VkDescriptorSetLayoutCreateInfo create_info = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+    create_info.bindingCount = (uint32_t)bindings.size();
+    create_info.pBindings    =           bindings.data();
+    VKERRCHECK(vkCreateDescriptorSetLayout(device, &create_info, nullptr, &shared.handle));
+    return shared.handle;
+}
+
+VkPipelineLayout ShaderRegistry::AcquirePipelineLayout(VkDevice device, const std::vector<VkDescriptorSetLayout>& set_layouts,
+                                                       const VkPushConstantRange& push_range) {
+    Writer key;
+    for(auto layout : set_layouts) key.u64((uint64_t)layout);
+    key.u32(push_range.stageFlags);  key.u32(push_range.offset);  key.u32(push_range.size);
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& shared = pipeline_layouts[std::string(key.data.begin(), key.data.end())];
+    if(shared.refs++) { ++stats.layouts;  return shared.handle; }
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+    pipelineLayoutInfo.setLayoutCount         = (uint32_t)set_layouts.size();
+    pipelineLayoutInfo.pSetLayouts            = set_layouts.data();
+    pipelineLayoutInfo.pushConstantRangeCount = push_range.size ? 1 : 0;
+    pipelineLayoutInfo.pPushConstantRanges    = &push_range;
+    VKERRCHECK(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &shared.handle));
+    return shared.handle;
+}
+
+void ShaderRegistry::Release(const Module* module) {
+    if(!module) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = modules.find(module->hash);
+    ASSERT(it != modules.end(), "ShaderRegistry: Unknown shader module.\n");
+    if(--it->second.refs) return;
+    vkDestroyShaderModule(device, module->module, nullptr);
+    delete module;
+    modules.erase(it);
+}
+
+// Layouts are few, so a linear search by handle is fine.
+void ShaderRegistry::Release(VkDescriptorSetLayout layout) {
+    if(!layout) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    for(auto it = set_layouts.begin(); it != set_layouts.end(); ++it) {
+        if(it->second.handle != layout) continue;
+        if(--it->second.refs) return;
+        vkDestroyDescriptorSetLayout(device, layout, nullptr);
+        set_layouts.erase(it);
+        return;
+    }
+    LOGW("ShaderRegistry: Unknown descriptor set layout.\n");
+}
+
+void ShaderRegistry::Release(VkPipelineLayout layout) {
+    if(!layout) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    for(auto it = pipeline_layouts.begin(); it != pipeline_layouts.end(); ++it) {
+        if(it->second.handle != layout) continue;
+        if(--it->second.refs) return;
+        vkDestroyPipelineLayout(device, layout, nullptr);
+        pipeline_layouts.erase(it);
+        return;
+    }
+    LOGW("ShaderRegistry: Unknown pipeline layout.\n");
+}
+
+void ShaderRegistry::PrintStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    printf("ShaderRegistry: %d loads, %d shared modules, %d reflections from sidecar, %d parsed, %d shared layouts\n",
+           stats.loads, stats.shared, stats.sidecar, stats.parsed, stats.layouts);
+}
+//-------------------------------------------------------------------------------------------------
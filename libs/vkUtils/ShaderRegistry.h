@@ -0,0 +1,89 @@
+// ShaderRegistry
+// Shares shader modules, and the layouts built from them, between all CShaders.
+//
+//  - Modules are deduplicated by a hash of their SPIR-V. Loading the same shader twice
+//    (eg. by the OnScreen and OffScreen pipelines) returns the same VkShaderModule.
+//  - Reflection results (bindings, vertex inputs, push constants) are cached in a small binary
+//    sidecar file, next to the .spv: "pbr_vert.spv" -> "pbr_vert.spv.refl". On the next run,
+//    the sidecar is used instead of parsing the SPIR-V again, as long as the hash still matches.
+//  - Identical VkDescriptorSetLayouts and VkPipelineLayouts are created once, and shared.
+//
+// Everything is reference counted: each Acquire must be matched by a Release, and the
+// Vulkan object is destroyed when the last user releases it. (CShader does this)
+// The registry is thread-safe, so pipelines may be created on worker threads. (see PipelineCache::Compile)
+
+#ifndef SHADERREGISTRY_H
+#define SHADERREGISTRY_H
+
+#include "Validation.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+
+struct ShaderReflection {                 // what CShader needs to know about a SPIR-V module
+    struct Binding {
+        uint32_t         set;
+        uint32_t         binding;
+        VkDescriptorType type;
+        uint32_t         count;           // array size (1 if not an array)
+        uint32_t         input_attachment_index;
+        std::string      name;
+    };
+    struct Input {                        // vertex input attribute
+        uint32_t    location;
+        VkFormat    format;
+        std::string name;
+        std::string type;                 // GLSL type name (for printing)
+    };
+    struct PushBlock {
+        std::string name;
+        uint32_t    offset;
+        uint32_t    size;
+    };
+    VkShaderStageFlagBits  stage = (VkShaderStageFlagBits)0;
+    std::string            entry_point;
+    std::vector<Binding>   bindings;      // all sets, in set/binding order
+    std::vector<Input>     inputs;        // sorted by location, without built-ins (vertex shaders only)
+    std::vector<PushBlock> push_blocks;
+
+    bool Parse(const std::vector<char>& spirv);
+    bool Read (const char* filename, uint64_t hash);   // false if missing, or made from other SPIR-V
+    void Write(const char* filename, uint64_t hash) const;
+    void Print() const;
+};
+
+class ShaderRegistry {
+public:
+    struct Module {
+        uint64_t         hash   = 0;
+        VkShaderModule   module = nullptr;
+        ShaderReflection reflection;
+    };
+private:
+    template<typename T> struct Shared {
+        T        handle = nullptr;
+        uint32_t refs   = 0;
+    };
+    std::mutex mutex;
+    VkDevice   device = nullptr;
+    std::unordered_map<uint64_t, Shared<Module*>>                    modules;          // by SPIR-V hash
+    std::unordered_map<std::string, Shared<VkDescriptorSetLayout>>   set_layouts;      // by binding list
+    std::unordered_map<std::string, Shared<VkPipelineLayout>>        pipeline_layouts; // by set layouts + push range
+    struct { uint32_t loads, shared, sidecar, parsed, layouts; } stats = {};
+    ShaderRegistry(){}
+public:
+    static ShaderRegistry& Get();         // process-wide
+    static uint64_t Hash(const void* data, size_t size);
+
+    const Module*         AcquireModule(VkDevice device, const char* filename);
+    VkDescriptorSetLayout AcquireSetLayout(VkDevice device, const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+    VkPipelineLayout      AcquirePipelineLayout(VkDevice device, const std::vector<VkDescriptorSetLayout>& set_layouts,
+                                                const VkPushConstantRange& push_range);
+    void Release(const Module* module);
+    void Release(VkDescriptorSetLayout layout);
+    void Release(VkPipelineLayout layout);
+    void PrintStats();
+};
+
+#endif
@@ -16,12 +16,18 @@ void Swapchain::Init(CRenderpass& renderpass, const CQueue* present_queue, const
 
 Swapchain::~Swapchain() {
     Clear();
+    for(auto& s : sync) {
+        vkDestroySemaphore(device, s.acquire, nullptr);  s.acquire = nullptr;
+        vkDestroySemaphore(device, s.submit,  nullptr);  s.submit  = nullptr;
+    }
     if (swapchain) vkDestroySwapchainKHR(device, swapchain, nullptr);  swapchain=nullptr;
     LOGI("Swapchain destroyed\n");
 }
 
 void Swapchain::Clear() {
     vkDeviceWaitIdle(device);
+    readback.Flush();  // before the fences are destroyed
+    for(auto& fence : in_flight) fence = nullptr;
     for(auto& buf : buffers) {
         // ---Wait for fence, before destroying ---
         vkWaitForFences(device, 1, &buf.fence, VK_TRUE, UINT64_MAX);
@@ -31,8 +37,6 @@ void Swapchain::Clear() {
         vkDestroyFence      (device, buf.fence,             nullptr);  buf.fence      =nullptr;
         vkDestroyFramebuffer(device, buf.framebuffer,       nullptr);  buf.framebuffer=nullptr;
         vkDestroyImageView  (device, buf.view,              nullptr);  buf.view       =nullptr;
-        vkDestroySemaphore  (device, buf.acquire_semaphore, nullptr);  buf.acquire_semaphore=nullptr;
-        vkDestroySemaphore  (device, buf.submit_semaphore,  nullptr);  buf.submit_semaphore =nullptr;
     }
 }
 
@@ -45,6 +49,16 @@ void Swapchain::Init(const CQueue* present_queue, const CQueue* graphics_queue)
     this->present_queue  = *present_queue;
     this->graphics_queue = *graphics_queue;
     this->command_pool = graphics_queue->CreateCommandPool();
+    InitFrames();
+
+    // ---Create Semaphores (per frame slot)---
+    VkSemaphoreCreateInfo semaphoreInfo = {VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+    sync.resize(frames_in_flight);
+    for(auto& s : sync) {
+        VKERRCHECK(vkCreateSemaphore(device, &semaphoreInfo, nullptr, &s.acquire));
+        VKERRCHECK(vkCreateSemaphore(device, &semaphoreInfo, nullptr, &s.submit));
+    }
+    // ----------------------------------------
 
     //--- surface caps ---
     VKERRCHECK(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(gpu, surface, &surface_caps));
@@ -58,6 +72,7 @@ void Swapchain::Init(const CQueue* present_queue, const CQueue* graphics_queue)
     info.surface               = surface;
     //info.minImageCount         = 2; // double-buffer
     info.imageFormat           = renderpass->GetPresentFormat(); // renderpass->present_format;
+    format                     = info.imageFormat;                // for ReadImage / Readback
     info.imageColorSpace       = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
 
     //info.imageExtent           = {64, 64}; //extent;
@@ -280,11 +295,6 @@ void Swapchain::Apply() {
         createInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
         vkCreateFence(device, &createInfo, nullptr, &buf.fence);
         //------------------
-        // ---Create Semaphores---
-        VkSemaphoreCreateInfo semaphoreInfo = {VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
-        VKERRCHECK(vkCreateSemaphore(device, &semaphoreInfo, nullptr, &buf.acquire_semaphore));
-        VKERRCHECK(vkCreateSemaphore(device, &semaphoreInfo, nullptr, &buf.submit_semaphore));
-        // -----------------------
 
         //printf("---Extent = %d x %d\n", info.imageExtent.width, info.imageExtent.height);
     }
@@ -296,23 +306,26 @@ FrameBuffer& Swapchain::AcquireNext() {
     ASSERT(!is_acquired, "CSwapchain: Previous swapchain buffer has not yet been presented.\n");
     while(SetExtent()){}
 
+    // Wait for the frame slot's last submit, so its semaphores are no longer in use
+    WaitFrame();
+
     // Acquire next image
     uint32_t prev = acquired_index;
-    VkSemaphore acquire_semaphore = CurrBuffer().acquire_semaphore;
+    VkSemaphore acquire_semaphore = sync[frame].acquire;
     VkResult result = vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, acquire_semaphore, VK_NULL_HANDLE, &acquired_index);
     //ShowVkResult(result);
 /*
     // window resized (for Nvidia GPU)
     while(result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
         SetExtent();
-        acquire_semaphore = CurrBuffer().acquire_semaphore;
+        acquire_semaphore = sync[frame].acquire;
         result = vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, acquire_semaphore, VK_NULL_HANDLE, &acquired_index);
         ShowVkResult(result);
     }
 */
     FrameBuffer& buf = buffers[acquired_index];
     buf.extent = info.imageExtent;
-    vkWaitForFences(device, 1, &buf.fence, VK_TRUE, UINT64_MAX);
+    vkWaitForFences(device, 1, &buf.fence, VK_TRUE, UINT64_MAX);  // the image's command buffer is free
     rendered_index = prev;
     is_acquired = true;
     return buf;
@@ -320,8 +333,8 @@ FrameBuffer& Swapchain::AcquireNext() {
 
 void Swapchain::Submit() {  // and present
     ASSERT(!!is_acquired, "CSwapchain: A buffer must be acquired before presenting.\n");
-    VkSemaphore acquire_semaphore = PrevBuffer().acquire_semaphore;
-    VkSemaphore submit_semaphore  = CurrBuffer().submit_semaphore;
+    VkSemaphore acquire_semaphore = sync[frame].acquire;  // (frame advances in SubmitFrame)
+    VkSemaphore submit_semaphore  = sync[frame].submit;
 
     // --- Submit ---
     FrameBuffer& buf = CurrBuffer();
@@ -336,6 +349,9 @@ void Swapchain::Submit() {  // and present
     submitInfo.pSignalSemaphores    = &submit_semaphore;   // signal when submit has completed
     vkResetFences(device, 1, &buf.fence);
     VKERRCHECK(vkQueueSubmit(graphics_queue, 1, &submitInfo, buf.fence));  // Submit new render commands
+    SubmitFrame(buf.fence);
+    readback.Submitted(buf.fence);
+    readback.Poll();
 
     // --- Present ---
     VkPresentInfoKHR presentInfo = {};
@@ -46,6 +46,12 @@ class Swapchain : public FBO {
     VkSwapchainKHR swapchain;
     bool resized = false;  // TODO: Remove?
 
+    struct FrameSync {
+        VkSemaphore acquire = nullptr;  // signaled when the image is acquired, and cmd-submit may begin
+        VkSemaphore submit  = nullptr;  // signaled when submit is complete, and present may begin
+    };
+    std::vector<FrameSync> sync;        // one per frame slot (not per image): reused only after WaitFrame
+
     void Clear();
     void Init(const CQueue* present_queue, const CQueue* graphics_queue=0);
     bool SetExtent();
@@ -76,6 +82,8 @@ public:
     using FBO::BeginCmd;         // Begin recording command buffer
     using FBO::BeginRenderpass;  // Begin the renderpass
     //...                        // vkCmd... commands go here
+    using FBO::NextSubpass;      // Begin the next subpass
+    using FBO::RecordParallel;   // Record draws on worker threads
     using FBO::EndRenderpass;    // End the renderpass
     using FBO::EndCmd;           // End recording the command buffer
     void Submit();               // Swaps frame buffers, to show the rendered image
@@ -34,6 +34,8 @@ void CvkImage::Clear() {
     extent  = {};
     format  = VK_FORMAT_UNDEFINED;
     layout  = VK_IMAGE_LAYOUT_UNDEFINED;
+    stage   = 0;
+    access  = 0;
     samples = VK_SAMPLE_COUNT_1_BIT;
 }
 
@@ -47,6 +49,10 @@ void CvkImage::swap(CvkImage& other) {
 
     std::swap(extent,      other.extent);
     std::swap(format,      other.format);
+    std::swap(layout,      other.layout);
+    std::swap(stage,       other.stage);
+    std::swap(access,      other.access);
+    std::swap(samples,     other.samples);
     std::swap(samplerInfo, other.samplerInfo);
     std::swap(mapped,      other.mapped);
 }
@@ -54,6 +60,9 @@ void CvkImage::swap(CvkImage& other) {
 void CvkImage::Write(const void* data) {
     //VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
     allocator->WriteImage(image, layout, extent, format, data, 0, mipLevels, 1);  // updates mips too
+    layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    stage  = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;  // (separate submit)
+    access = 0;
 }
 
 void CvkImage::Write(CImage& image) {
@@ -368,9 +377,14 @@ void CvkImage::Blit(VkCommandBuffer cmd, VkImage dst, VkExtent2D ext, VkImageLay
 
     VkImageLayout blit_layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
     //VkImageLayout blit_layout = VK_IMAGE_LAYOUT_GENERAL;
-    setLayout(cmd, dst, VK_IMAGE_LAYOUT_UNDEFINED, blit_layout);
+    VkImageLayout src_layout  = (layout == VK_IMAGE_LAYOUT_GENERAL) ? layout : VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    BarrierBatch batch;
+    Barrier(batch, src_layout, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT);  // eg. after the ray tracing shader's writes
+    batch.Image(dst, VK_IMAGE_LAYOUT_UNDEFINED, blit_layout);
+    batch.Flush(cmd);
     vkCmdBlitImage(cmd, image, layout, dst, blit_layout, 1, &region, filter);
-    setLayout(cmd, dst, blit_layout, dst_layout);
+    batch.Image(dst, blit_layout, dst_layout);
+    batch.Flush(cmd);
 }
 
 //----------------------------------------------------
@@ -385,6 +399,26 @@ void CvkImage::AddressModeV(VkSamplerAddressMode V) { samplerInfo.addressModeV =
 void CvkImage::SetLayout(VkImageLayout newLayout) {
     allocator->SetImageLayout(image, layout, newLayout, 0);  // uses Cmd
     layout = newLayout;
+    stage  = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;           // an earlier submit: later barriers wait for all of it
+    access = 0;
+}
+
+// Tracks the whole image. For per-mip transitions, use a BarrierBatch directly.
+void CvkImage::Barrier(BarrierBatch& batch, VkImageLayout newLayout, VkPipelineStageFlags2 stage, VkAccessFlags2 access) {
+    SyncState prev = {this->stage, this->access, layout};
+    SyncState next = {stage, access, newLayout};
+    if(!NeedsBarrier(prev, next)) return;
+    batch.Image(image, prev, next, Range());
+    layout       = newLayout;
+    this->stage  = stage;
+    this->access = access;
+}
+
+VkImageSubresourceRange CvkImage::Range() const {
+    format_info fmt = FormatInfo(format);
+    VkImageAspectFlags aspect = fmt.hasDepth() ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+    if(fmt.hasStencil()) aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+    return {aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS};
 }
 
 void CvkImage::PrintLayout() {
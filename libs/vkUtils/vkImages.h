@@ -36,6 +36,8 @@ protected:
     VkExtent3D            extent {};
     VkFormat              format = VK_FORMAT_UNDEFINED;
     VkImageLayout         layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkPipelineStageFlags2 stage  = 0;  // last use in 'layout' (for Barrier). 0: no pending GPU work
+    VkAccessFlags2        access = 0;
     VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
     void CreateSampler(float maxLod = 0);
     VkFormatProperties FormatProperties(VkFormat fmt);
@@ -94,7 +96,7 @@ public:
     operator CImage    () { return this->Read(); }
     operator CImage32f () { return this->Read32f(); }
 
-    void Blit(VkCommandBuffer cmd, VkImage dst, VkExtent2D ext, VkImageLayout dst_layout = VK_IMAGE_LAYOUT_GENERAL, VkFilter filter = VK_FILTER_LINEAR);
+    void Blit(VkCommandBuffer cmd, VkImage dst, VkExtent2D ext, VkImageLayout dst_layout = VK_IMAGE_LAYOUT_GENERAL, VkFilter filter = VK_FILTER_LINEAR);  // waits for this image's last use
 
     void MinFilter(VkFilter minFilter = VK_FILTER_LINEAR);  // Call mesh.UpdateDescriptorSet(); to apply.
     void MagFilter(VkFilter magFilter = VK_FILTER_LINEAR);  // Call mesh.UpdateDescriptorSet(); to apply.
@@ -104,7 +106,9 @@ public:
     //void AddressModeW(VkSamplerAddressMode W  = VK_SAMPLER_ADDRESS_MODE_REPEAT);
 
     VkImageLayout GetLayout() const {return layout;}
-    void SetLayout(VkImageLayout newLayout);
+    void SetLayout(VkImageLayout newLayout);  // separate submit. In a command buffer, use Barrier instead.
+    void Barrier(BarrierBatch& batch, VkImageLayout newLayout, VkPipelineStageFlags2 stage, VkAccessFlags2 access);  // queue a transition from the last use (flush before this use)
+    VkImageSubresourceRange Range() const;    // whole image
     void PrintLayout();
 
     void* Pixel(int x, int y, uint8_t bytes_per_pixel=4);
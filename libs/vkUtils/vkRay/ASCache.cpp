@@ -0,0 +1,168 @@
+#include "ASCache.h"
+#include "ShaderRegistry.h"
+#include <cstring>
+#include <cstdio>
+
+#undef repeat
+#define repeat(COUNT) for(uint32_t i = 0; i < (COUNT); ++i)
+
+struct CacheFileHeader {                  // followed by 'count' entries of: {hash, size, data}
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t reserved;
+};
+static const uint32_t CACHE_MAGIC   = 0x48435341;  // "ASCH"
+static const uint32_t CACHE_VERSION = 1;
+static const VkDeviceSize ALIGNMENT = 256;         // serialized data must be 256-byte aligned
+
+// Serialized AS header: driverUUID, compatibilityUUID, serialized size, deserialized size, handle count
+static const size_t SERIAL_HEADER_SIZE = 2 * VK_UUID_SIZE + 3 * sizeof(uint64_t);
+
+static VkDeviceSize Align(VkDeviceSize size) { return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1); }
+
+uint32_t ASCache::Load(VkDevice device, const char* filename) {
+    this->filename = filename;
+    entries.clear();
+    FILE* file = fopen(filename, "rb");
+    if(!file) return 0;
+
+    CacheFileHeader header = {};
+    bool valid = (fread(&header, sizeof(header), 1, file) == 1) && header.magic == CACHE_MAGIC && header.version == CACHE_VERSION;
+    if(!valid) LOGW("ASCache: %s is not an acceleration structure cache file.\n", filename);
+    uint32_t dropped = 0;
+    repeat(valid ? header.count : 0) {
+        uint64_t hash = 0, size = 0;
+        if(fread(&hash, sizeof(hash), 1, file) != 1 || fread(&size, sizeof(size), 1, file) != 1 || size >= (1ull << 32)) break;
+        Blob data((size_t)size);
+        if(fread(data.data(), 1, data.size(), file) != data.size()) { LOGW("ASCache: %s is truncated.\n", filename);  break; }
+        if(data.size() < SERIAL_HEADER_SIZE) continue;
+        if(!Compatible(device, data)) { ++dropped;  continue; }
+        entries[hash] = std::move(data);
+    }
+    fclose(file);
+    if(dropped) LOGI("ASCache: %d entries in %s are from another device or driver version. Rebuilding.\n", dropped, filename);
+    return Count();
+}
+
+bool ASCache::Save() {
+    if(filename.empty()) return false;
+    std::string temp = filename + ".tmp";  // write, then rename: a crash can't leave a half-written cache
+    FILE* file = fopen(temp.c_str(), "wb");
+    if(!file) { LOGW("ASCache: Can't write %s\n", temp.c_str());  return false; }
+
+    CacheFileHeader header = {CACHE_MAGIC, CACHE_VERSION, Count(), 0};
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    size_t total = 0;
+    for(auto& entry : entries) {
+        uint64_t size = entry.second.size();
+        ok = ok && fwrite(&entry.first, sizeof(entry.first), 1, file) == 1
+                && fwrite(&size, sizeof(size), 1, file) == 1
+                && fwrite(entry.second.data(), 1, entry.second.size(), file) == entry.second.size();
+        total += entry.second.size();
+    }
+    ok = (fclose(file) == 0) && ok;
+    remove(filename.c_str());
+    if(!ok || rename(temp.c_str(), filename.c_str()) != 0) { LOGW("ASCache: Failed to save %s\n", filename.c_str());  return false; }
+    LOGI("ASCache: Saved %s (%d entries, %zu KB)\n", filename.c_str(), Count(), total >> 10);
+    return true;
+}
+
+const ASCache::Blob* ASCache::Find(uint64_t hash) {
+    auto it = entries.find(hash);
+    return (it == entries.end()) ? nullptr : &it->second;
+}
+
+uint64_t ASCache::Hash(const MeshObject& obj, VkBuildAccelerationStructureFlagsKHR flags) {
+    VkDeviceSize vrt_size = (VkDeviceSize)obj.vertexCount * obj.vertexStride;
+    VkDeviceSize inx_size = (VkDeviceSize)obj.indexCount * sizeof(uint32_t);
+    struct { uint32_t vertexCount, vertexStride, indexCount, flags, opaque; } key =
+           {obj.vertexCount, obj.vertexStride, obj.indexCount, (uint32_t)flags, (uint32_t)obj.isOpaque};
+
+    std::vector<char> data(vrt_size + inx_size + sizeof(key));
+    default_allocator->ReadBuffer(obj.vertexBuffer, vrt_size, data.data(),            obj.vertexOffset);
+    default_allocator->ReadBuffer(obj.indexBuffer,  inx_size, data.data() + vrt_size, obj.indexOffset);
+    memcpy(data.data() + vrt_size + inx_size, &key, sizeof(key));
+    return ShaderRegistry::Hash(data.data(), data.size());
+}
+
+VkDeviceSize ASCache::DeserializedSize(const Blob& data) {
+    uint64_t size = 0;
+    if(data.size() >= SERIAL_HEADER_SIZE) memcpy(&size, data.data() + 2 * VK_UUID_SIZE + sizeof(uint64_t), sizeof(size));
+    return size;
+}
+
+bool ASCache::Compatible(VkDevice device, const Blob& data) {
+    if(data.size() < SERIAL_HEADER_SIZE) return false;
+    VkAccelerationStructureVersionInfoKHR version = {VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_VERSION_INFO_KHR};
+    version.pVersionData = (const uint8_t*)data.data();
+    VkAccelerationStructureCompatibilityKHR compatibility = VK_ACCELERATION_STRUCTURE_COMPATIBILITY_INCOMPATIBLE_KHR;
+    vkGetDeviceAccelerationStructureCompatibilityKHR(device, &version, &compatibility);
+    return compatibility == VK_ACCELERATION_STRUCTURE_COMPATIBILITY_COMPATIBLE_KHR;
+}
+
+std::vector<ASCache::Blob> ASCache::Serialize(CCmd& cmd, const std::vector<VkAccelerationStructureKHR>& src) {
+    uint32_t count = (uint32_t)src.size();
+    if(!count) return {};
+
+    //--- Serialized sizes ---
+    std::vector<VkDeviceSize> sizes;
+    {
+        cmd.Begin();
+        Query query(cmd, src.data(), count, VK_QUERY_TYPE_ACCELERATION_STRUCTURE_SERIALIZATION_SIZE_KHR);
+        cmd.End(true);
+        sizes = query.GetResults();
+    }
+    std::vector<VkDeviceSize> offsets(count);
+    VkDeviceSize total = 0;
+    repeat(count) { offsets[i] = total;  total += Align(sizes[i]); }
+
+    //--- Copy all to one host-visible buffer ---
+    CvkBuffer buffer;
+    VkFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+    buffer.Data(0, 1, (uint32_t)total, usage, VMA_MEMORY_USAGE_GPU_TO_CPU, &buffer.mapped);
+    VkDeviceAddress base = buffer.DeviceAddress();
+    cmd.Begin();
+    repeat(count) {
+        VkCopyAccelerationStructureToMemoryInfoKHR info = {VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_TO_MEMORY_INFO_KHR};
+        info.src               = src[i];
+        info.dst.deviceAddress = base + offsets[i];
+        info.mode              = VK_COPY_ACCELERATION_STRUCTURE_MODE_SERIALIZE_KHR;
+        vkCmdCopyAccelerationStructureToMemoryKHR(cmd, &info);
+    }
+    cmd.End(true);
+
+    buffer.Invalidate();
+    std::vector<Blob> result(count);
+    repeat(count) {
+        const char* data = (const char*)buffer.mapped + offsets[i];
+        result[i].assign(data, data + sizes[i]);
+    }
+    return result;
+}
+
+void ASCache::Deserialize(CCmd& cmd, const std::vector<const Blob*>& src, const std::vector<VkAccelerationStructureKHR>& dst) {
+    uint32_t count = (uint32_t)src.size();
+    if(!count) return;
+    std::vector<VkDeviceSize> offsets(count);
+    VkDeviceSize total = 0;
+    repeat(count) { offsets[i] = total;  total += Align(src[i]->size()); }
+
+    //--- Upload all, in one host-visible buffer ---
+    CvkBuffer buffer;
+    VkFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+    buffer.Data(0, 1, (uint32_t)total, usage, VMA_MEMORY_USAGE_CPU_TO_GPU, &buffer.mapped);
+    repeat(count) memcpy((char*)buffer.mapped + offsets[i], src[i]->data(), src[i]->size());
+    buffer.Flush();
+
+    VkDeviceAddress base = buffer.DeviceAddress();
+    cmd.Begin();
+    repeat(count) {
+        VkCopyMemoryToAccelerationStructureInfoKHR info = {VK_STRUCTURE_TYPE_COPY_MEMORY_TO_ACCELERATION_STRUCTURE_INFO_KHR};
+        info.src.deviceAddress = base + offsets[i];
+        info.dst               = dst[i];
+        info.mode              = VK_COPY_ACCELERATION_STRUCTURE_MODE_DESERIALIZE_KHR;
+        vkCmdCopyMemoryToAccelerationStructureKHR(cmd, &info);
+    }
+    cmd.End(true);
+}
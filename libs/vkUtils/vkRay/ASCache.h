@@ -0,0 +1,42 @@
+// ASCache
+// Saves built BLASes to a file, and loads them on the next run, instead of building them again.
+//
+// Entries are keyed by a hash of the geometry: vertex and index data, counts, and build flags.
+// Serialized acceleration structures start with the driver's version header. On Load, entries this
+// device can't use (other GPU, or driver update) are dropped, and those BLASes are built as usual.
+//
+// Usage: (BLAS::Build does this, when BLAS::cache_file is set)
+//   ASCache cache;
+//   cache.Load(device, "blas.cache");
+//   auto* data = cache.Find(ASCache::Hash(obj, flags));             // null: not cached, build it
+//   ...
+//   cache.Set(hash, ASCache::Serialize(cmd, {structure})[0]);
+//   cache.Save();
+
+#ifndef ASCACHE_H
+#define ASCACHE_H
+
+#include "BLAS.h"
+#include <string>
+#include <unordered_map>
+
+class ASCache {
+    std::string filename;
+    std::unordered_map<uint64_t, std::vector<char>> entries;  // geometry hash -> serialized AS
+public:
+    typedef std::vector<char> Blob;
+
+    uint32_t    Load(VkDevice device, const char* filename);  // returns the number of usable entries
+    bool        Save();
+    const Blob* Find(uint64_t hash);                          // null if not cached
+    void        Set(uint64_t hash, Blob&& data) { entries[hash] = std::move(data); }
+    uint32_t    Count() { return (uint32_t)entries.size(); }
+
+    static uint64_t     Hash(const MeshObject& obj, VkBuildAccelerationStructureFlagsKHR flags);  // reads back the vertex and index buffers
+    static VkDeviceSize DeserializedSize(const Blob& data);   // size of the ABO to deserialize into
+    static bool         Compatible(VkDevice device, const Blob& data);  // can this device deserialize it?
+    static std::vector<Blob> Serialize(CCmd& cmd, const std::vector<VkAccelerationStructureKHR>& src);  // waits
+    static void Deserialize(CCmd& cmd, const std::vector<const Blob*>& src, const std::vector<VkAccelerationStructureKHR>& dst);  // waits
+};
+
+#endif
@@ -1,22 +1,34 @@
 #include "BLAS.h"
 #include "vkray_helpers.h"
+#include "ASCache.h"
+#include "DeferredOps.h"
+#include <algorithm>
+
+#undef repeat
+#define repeat(COUNT) for(uint32_t i = 0; i < (COUNT); ++i)
 
 //#define SIZE(VECTOR) (uint32_t)VECTOR.size()
 
 //---------------------------------------------QUERY------------------------------------------------
-Query::Query(CCmd& cmd, VkAccelerationStructureKHR* as, VkQueryType query_type) {
+Query::Query(CCmd& cmd, const VkAccelerationStructureKHR* as, uint32_t count, VkQueryType query_type) {
     device = cmd.device;
+    this->count = count;
     VkQueryPoolCreateInfo query_pool_info = {VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
     query_pool_info.queryType  = query_type; // VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR;
-    query_pool_info.queryCount = 1;
-    vkCreateQueryPool(device, &query_pool_info, nullptr, &query_pool);
-    vkResetQueryPool(device, query_pool, 0, 1);
-    vkCmdWriteAccelerationStructuresPropertiesKHR(cmd, 1, as, query_type, query_pool, 0);
+    query_pool_info.queryCount = count;
+    VKERRCHECK(vkCreateQueryPool(device, &query_pool_info, nullptr, &query_pool));
+    vkCmdResetQueryPool(cmd, query_pool, 0, count);
+    vkCmdWriteAccelerationStructuresPropertiesKHR(cmd, count, as, query_type, query_pool, 0);
 }
 
 VkDeviceSize Query::GetResult() {
-    uint32_t data = 0;
-    vkGetQueryPoolResults(device, query_pool, 0, 1, 4, &data, 4, VK_QUERY_RESULT_WAIT_BIT);
+    return GetResults()[0];
+}
+
+std::vector<VkDeviceSize> Query::GetResults() {
+    std::vector<VkDeviceSize> data(count);
+    VkQueryResultFlags flags = VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT;
+    VKERRCHECK(vkGetQueryPoolResults(device, query_pool, 0, count, count * sizeof(VkDeviceSize), data.data(), sizeof(VkDeviceSize), flags));
     return data;
 }
 
@@ -49,7 +61,8 @@ BlasInfo::BlasInfo(VkDevice device, MeshObject obj) {
     rangeInfo= {primCount, 0,0,0};
 
     VkFlags flags = 0;
-  //flags |= VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
+    if(obj.allowUpdate)
+    flags |= VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
     flags |= VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR;
     flags |= VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
   //flags |= VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_BUILD_BIT_KHR;
@@ -69,9 +82,18 @@ BlasInfo::BlasInfo(VkDevice device, MeshObject obj) {
                                             &geomInfo, &primCount, &sizeInfo);
 }
 
-auto BlasInfo::getGeomInfo(VkAccelerationStructureKHR structure, VkBuffer scratch) {
+void BlasInfo::UseHostData(const void* vertices, const void* indices) {
+    asGeometry.geometry.triangles.vertexData.hostAddress = vertices;
+    asGeometry.geometry.triangles.indexData.hostAddress  = indices;
+    geomInfo.pGeometries = &asGeometry;
+    vkGetAccelerationStructureBuildSizesKHR(device, VK_ACCELERATION_STRUCTURE_BUILD_TYPE_HOST_KHR,
+                                            &geomInfo, &rangeInfo.primitiveCount, &sizeInfo);
+}
+
+auto BlasInfo::getGeomInfo(VkAccelerationStructureKHR structure, VkDeviceAddress scratch) {
+    geomInfo.pGeometries = &asGeometry;   // (BlasInfo may have been copied)
     geomInfo.dstAccelerationStructure = structure;
-    geomInfo.scratchData = deviceAddress(device, scratch);
+    geomInfo.scratchData.deviceAddress = scratch;
     return geomInfo;
 }
 //--------------------------------------------------------------------------------------------------
@@ -86,9 +108,21 @@ void BLAS::Init(VkPhysicalDevice gpu, VkDevice device) {
     vkCreateAccelerationStructureKHR         = (PFN_vkCreateAccelerationStructureKHR)       vkGetDeviceProcAddr(device, "vkCreateAccelerationStructureKHR");
     vkGetBufferDeviceAddressKHR              = (PFN_vkGetBufferDeviceAddressKHR)            vkGetDeviceProcAddr(device, "vkGetBufferDeviceAddressKHR");
     vkCmdBuildAccelerationStructuresKHR      = (PFN_vkCmdBuildAccelerationStructuresKHR)    vkGetDeviceProcAddr(device, "vkCmdBuildAccelerationStructuresKHR");
+
+    VkPhysicalDeviceAccelerationStructurePropertiesKHR asProperties = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_PROPERTIES_KHR};
+    VkPhysicalDeviceProperties2 props{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2};
+    props.pNext = &asProperties;
+    vkGetPhysicalDeviceProperties2(gpu, &props);
+    scratch_alignment = std::max<VkDeviceSize>(asProperties.minAccelerationStructureScratchOffsetAlignment, 1);
+
+    VkPhysicalDeviceAccelerationStructureFeaturesKHR asFeatures = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_FEATURES_KHR};
+    VkPhysicalDeviceFeatures2 features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
+    features.pNext = &asFeatures;
+    vkGetPhysicalDeviceFeatures2(gpu, &features);
+    host_commands = asFeatures.accelerationStructureHostCommands;  // (CDevices enables it when supported)
 }
 
-uint32_t BLAS::AddMesh(VBO& vbo, IBO& ibo, UBO& ubo, bool is_opaque) {
+uint32_t BLAS::AddMesh(VBO& vbo, IBO& ibo, UBO& ubo, bool is_opaque, bool allow_update) {
     ASSERT(vbo.count > 0,   "VKRay: VBO has not been initialized.\n");
     ASSERT(ibo.count > 0,   "VKRay: IBO has not been initialized.\n");
     ASSERT(ubo.count > 0,   "VKRay: UBO has not been initialized.\n");
@@ -101,62 +135,375 @@ uint32_t BLAS::AddMesh(VBO& vbo, IBO& ibo, UBO& ubo, bool is_opaque) {
     obj.indexCount    = ibo.count;
     obj.uniformBuffer = ubo.buffer;
     obj.isOpaque = is_opaque;
+    obj.allowUpdate = allow_update;
     return AddMesh(obj);
 }
 
 uint32_t BLAS::AddMesh(MeshObject obj) {
+    auto same_geometry = [&](const MeshObject& a) {
+        return a.vertexBuffer == obj.vertexBuffer && a.vertexOffset == obj.vertexOffset && a.vertexCount == obj.vertexCount &&
+               a.indexBuffer  == obj.indexBuffer  && a.indexOffset  == obj.indexOffset  && a.indexCount  == obj.indexCount  &&
+               a.isOpaque == obj.isOpaque && a.allowUpdate == obj.allowUpdate;
+    };
+    uint32_t blas = (uint32_t)geometries.size();
+    repeat((uint32_t)geometries.size()) if(same_geometry(mesh_list[geometries[i]])) { blas = i;  break; }
+    if(blas == geometries.size()) geometries.push_back((uint32_t)mesh_list.size());  // new geometry
+
     mesh_list.push_back(obj);
+    blas_index.push_back(blas);
     return mesh_list.size()-1;  //return index
 }
 
+// Records the builds into cmd, each with a slice of the shared scratch pool. (if grow: grown if needed, up to scratch_budget)
+// Builds that don't fit in the pool go into the next batch, after a barrier.
+uint32_t BLAS::RecordBuilds(VkCommandBuffer cmd, const std::vector<BuildJob>& jobs, bool grow) {
+    auto align = [&](VkDeviceSize size) { return (size + scratch_alignment - 1) & ~(scratch_alignment - 1); };
+    auto scratch_size = [&](const BuildJob& job) {
+        return align(job.update ? job.info->sizeInfo.updateScratchSize : job.info->sizeInfo.buildScratchSize);
+    };
+
+    //--- One scratch pool, shared by all builds ---
+    VkDeviceSize total_scratch = 0, largest_scratch = 0;
+    for(auto& job : jobs) {
+        total_scratch  += scratch_size(job);
+        largest_scratch = std::max(largest_scratch, scratch_size(job));
+    }
+    VkDeviceSize pool_size = std::max(std::min(total_scratch, scratch_budget), largest_scratch);
+    if(grow && scratch.size() < pool_size + scratch_alignment) scratch.Allocate(pool_size + scratch_alignment);  // (room to align the base address)
+    ASSERT(scratch.size() >= largest_scratch + scratch_alignment, "BLAS: The scratch pool is too small for this build.\n");
+    pool_size = scratch.size() - scratch_alignment;
+    VkDeviceAddress scratch_base = align(scratch.DeviceAddress());
+
+    //--- A batch takes as many builds as fit in the pool ---
+    std::vector<VkAccelerationStructureBuildGeometryInfoKHR> geomInfos;
+    std::vector<VkAccelerationStructureBuildRangeInfoKHR*>   rangeInfos;
+    geomInfos.reserve(jobs.size());
+    rangeInfos.reserve(jobs.size());
+    uint32_t batches = 0;
+    auto flush = [&]() {
+        if(geomInfos.empty()) return;
+        if(batches++) mem_barrier(cmd, VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,  // previous batch is done with the scratch pool
+                                       VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR);
+        vkCmdBuildAccelerationStructuresKHR(cmd, (uint32_t)geomInfos.size(), geomInfos.data(), rangeInfos.data());
+        geomInfos.clear();
+        rangeInfos.clear();
+    };
+
+    VkDeviceSize offset = 0;
+    for(auto& job : jobs) {
+        VkDeviceSize size = scratch_size(job);
+        if(offset + size > pool_size) { flush();  offset = 0; }
+        auto gi = job.info->getGeomInfo(job.structure, scratch_base + offset);
+        if(job.update) {
+            gi.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR;
+            gi.srcAccelerationStructure = job.structure;  // refit in place
+        }
+        geomInfos.push_back(gi);
+        rangeInfos.push_back(&job.info->rangeInfo);
+        offset += size;
+    }
+    flush();
+    return batches;
+}
+
 void BLAS::Build(CCmd& cmd, bool compact) {
-    blas_list.reserve(mesh_list.size());
-    for(const auto& obj : mesh_list) {
-        BuildObj(cmd, obj, compact);
+    uint32_t first = (uint32_t)blas_list.size();
+    uint32_t count = (uint32_t)geometries.size() - first;
+    if(count == 0) return;
+
+    //--- Find all sizes. With a cache file, look up each geometry ---
+    std::vector<BlasInfo> infos;
+    infos.reserve(count);
+    repeat(count) infos.emplace_back(device, mesh_list[geometries[first + i]]);
+
+    ASCache cache;
+    std::vector<uint64_t> hashes(count);
+    std::vector<const ASCache::Blob*> cached(count, nullptr);
+    if(!cache_file.empty()) {
+        bool loaded = cache.Load(device, cache_file.c_str()) > 0;
+        repeat(count) {
+            hashes[i] = ASCache::Hash(mesh_list[geometries[first + i]], infos[i].geomInfo.flags);
+            if(loaded) cached[i] = cache.Find(hashes[i]);
+        }
+    }
+
+    //--- Host build: the results are loaded like cached BLASes, but still compacted and saved ---
+    bool host = host_build && host_commands;
+    if(host_build && !host_commands) LOGW("BLAS: Host builds are not supported by this device. Building on the device.\n");
+    double build_time = 0;                                            // until the BLASes are in device memory (not compacted)
+    Timer timer;
+    std::vector<bool> host_built(count, false);
+    std::vector<ASCache::Blob> host_blobs;
+    uint32_t host_count = 0;                                          // host-built BLASes the device can load
+    if(host) {
+        std::vector<uint32_t> todo;
+        repeat(count) if(!cached[i]) todo.push_back(i);
+        host_blobs = HostBuild(first, infos, todo);
+        repeat((uint32_t)todo.size()) {
+            if(!ASCache::Compatible(device, host_blobs[i])) continue;  // built on the device instead
+            cached[todo[i]] = &host_blobs[i];
+            host_built[todo[i]] = true;
+            ++host_count;
+        }
+        if(host_count < todo.size())
+            LOGW("BLAS: This device can't load %u of %u host-built BLAS. Building them on the device.\n", (uint32_t)todo.size() - host_count, (uint32_t)todo.size());
+        build_time += timer.Span();
+    }
+
+    //--- Create the BLASes: cached ones at their final size, the others uncompacted ---
+    std::vector<BuildJob> jobs;
+    std::vector<VkAccelerationStructureKHR> structures;                // to build
+    std::vector<uint32_t>                   built;                     // (their index, from 'first')
+    std::vector<const ASCache::Blob*>       load_src;
+    std::vector<VkAccelerationStructureKHR> load_dst;
+    blas_list.reserve(geometries.size());
+    repeat(count) {
+        BlasInfo& bi = infos[i];
+        VkDeviceSize size = cached[i] ? ASCache::DeserializedSize(*cached[i]) : bi.sizeInfo.accelerationStructureSize;
+        ABO& blas = blas_list.emplace_back(size, ABO::BLAS);
+        if(cached[i]) {
+            load_src.push_back(cached[i]);
+            load_dst.push_back(blas.structure);
+        } else {
+            jobs.push_back({&bi, blas.structure, false});
+        }
+        if(!cached[i] || host_built[i]) {
+            structures.push_back(blas.structure);
+            built.push_back(i);
+        }
+    }
+    refit_state.resize(blas_list.size());
+
+    //--- Size the pool for the largest refit or rebuild now: Refit() can't reallocate it, while earlier frames' refits use it ---
+    VkDeviceSize refit_scratch = 0;
+    repeat(count) {
+        if(!mesh_list[geometries[first + i]].allowUpdate) continue;
+        auto& sizes = infos[i].sizeInfo;
+        refit_scratch = std::max({refit_scratch, sizes.buildScratchSize, sizes.updateScratchSize});
+    }
+    refit_scratch = (refit_scratch + scratch_alignment - 1) & ~(scratch_alignment - 1);
+    if(refit_scratch && scratch.size() < refit_scratch + scratch_alignment) scratch.Allocate(refit_scratch + scratch_alignment);
+
+    if(!load_dst.empty()) {
+        timer.Start();
+        ASCache::Deserialize(cmd, load_src, load_dst);
+        if(host) build_time += timer.Span();      // (includes any cached BLASes)
+        uint32_t loaded = (uint32_t)load_dst.size() - host_count;
+        if(loaded) printf("Blas cache: loaded %u of %u BLAS from %s\n", loaded, count, cache_file.c_str());
+    }
+    if(built.empty()) return;
+
+    timer.Start();
+    cmd.Begin();
+    uint32_t batches = jobs.empty() ? 0 : RecordBuilds(cmd, jobs, true);
+    mem_barrier(cmd, VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+                     VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR);
+    Query query(cmd, structures.data(), (uint32_t)structures.size());  // query all compacted sizes at once
+    cmd.End(true);
+    build_time += timer.Span();
+
+    VkDeviceSize built_size = 0;
+    for(uint32_t i : built) built_size += blas_list[first + i].size();
+    printf("Blas build (%s): %u meshes (%u BLAS) in %u batch(es), scratch pool: %lu KB, size: %lu KB, time: %.2f ms\n",
+           host_count ? "host" : "device", (uint32_t)mesh_list.size(), (uint32_t)built.size(), batches,
+           (long)(scratch.size() >> 10), (long)(built_size >> 10), build_time * 1000);
+
+    bool refittable = false;
+    for(auto& obj : mesh_list) refittable |= obj.allowUpdate;
+    if(!refittable) scratch.Clear();            // only refits reuse the pool
+
+    if(compact) {
+        std::vector<VkDeviceSize> results = query.GetResults();
+        std::vector<VkDeviceSize> sizes(count, 0);   // 0: not compacted (cached, or refit)
+        repeat((uint32_t)built.size()) if(!mesh_list[geometries[first + built[i]]].allowUpdate) sizes[built[i]] = results[i];
+        Compact(cmd, first, sizes);
+    }
+
+    //--- Save the new BLASes (after compaction: smaller files) ---
+    if(!cache_file.empty()) {
+        std::vector<VkAccelerationStructureKHR> src;
+        for(uint32_t i : built) src.push_back(blas_list[first + i].structure);
+        std::vector<ASCache::Blob> blobs = ASCache::Serialize(cmd, src);
+        repeat((uint32_t)built.size()) cache.Set(hashes[built[i]], std::move(blobs[i]));
+        cache.Save();
     }
-    //mesh_list.clear();
 }
 
-void BLAS::BuildObj(CCmd& cmd, MeshObject obj, bool compact) {
-    BlasInfo bi(device, obj);
-    VkDeviceSize scratchSize = bi.sizeInfo.buildScratchSize;
-    VkDeviceSize blasSize    = bi.sizeInfo.accelerationStructureSize;
+void BLAS::MarkDirty(uint32_t mesh) {
+    ASSERT(mesh < blas_index.size() && blas_index[mesh] < refit_state.size(), "BLAS: Build() before MarkDirty().\n");
+    ASSERT(mesh_list[mesh].allowUpdate, "BLAS: Mesh %d was not added with allowUpdate.\n", mesh);
+    refit_state[blas_index[mesh]].dirty = true;
+}
 
-    SBO scratch(scratchSize);
-    ABO& blas = blas_list.emplace_back(blasSize, ABO::BLAS);
-    auto gi = bi.getGeomInfo(blas.structure, scratch);
-    auto* pRangeInfo = &bi.rangeInfo;
+void BLAS::UpdateMesh(uint32_t mesh, VBO& vbo, IBO& ibo) {
+    ASSERT(vbo.Count() == mesh_list[mesh].vertexCount && ibo.Count() == mesh_list[mesh].indexCount, "BLAS: Refit needs the same vertex and index count.\n");
+    uint32_t blas = blas_index[mesh];
+    repeat((uint32_t)mesh_list.size()) {           // all instances of this geometry
+        if(blas_index[i] != blas) continue;
+        mesh_list[i].vertexBuffer = vbo;
+        mesh_list[i].indexBuffer  = ibo;
+    }
+    MarkDirty(mesh);
+}
 
+bool BLAS::Refit(CCmd& cmd) {
+    bool dirty = false;
+    for(auto& state : refit_state) dirty |= state.dirty;
+    if(!dirty) return false;
     cmd.Begin();
-      vkCmdBuildAccelerationStructuresKHR(cmd, 1, &gi, &pRangeInfo);
-      //Barrier(cmd);
-      mem_barrier(cmd, VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
-                       VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR);
-      Query query(cmd, &blas.structure, VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR);  // query compacted size
+    Refit((VkCommandBuffer)cmd);
     cmd.End(true);
+    return true;
+}
+
+// Global memory barrier with explicit stages. (synchronization2, or the same bits with vkCmdPipelineBarrier)
+static void mem_barrier2(VkCommandBuffer cmd, VkPipelineStageFlags2 src_stage, VkAccessFlags2 src_access,
+                                              VkPipelineStageFlags2 dst_stage, VkAccessFlags2 dst_access) {
+    if(BarrierBatch::use_sync2) {
+        VkMemoryBarrier2 barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+        barrier.srcStageMask  = src_stage;
+        barrier.srcAccessMask = src_access;
+        barrier.dstStageMask  = dst_stage;
+        barrier.dstAccessMask = dst_access;
+        VkDependencyInfo dependency = {VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+        dependency.memoryBarrierCount = 1;
+        dependency.pMemoryBarriers    = &barrier;
+        vkCmdPipelineBarrier2KHR(cmd, &dependency);
+        return;
+    }
+    VkMemoryBarrier barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+    barrier.srcAccessMask = (VkAccessFlags)src_access;
+    barrier.dstAccessMask = (VkAccessFlags)dst_access;
+    vkCmdPipelineBarrier(cmd, (VkPipelineStageFlags)src_stage, (VkPipelineStageFlags)dst_stage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
 
-    VkDeviceSize cmpSize = query.GetResult();
-    if(compact) Compact(cmd, blas, cmpSize);
+bool BLAS::Refit(VkCommandBuffer cmd) {
+    std::vector<uint32_t> dirty;
+    repeat((uint32_t)refit_state.size()) if(refit_state[i].dirty) dirty.push_back(i);
+    if(dirty.empty()) return false;
+
+    std::vector<BlasInfo> infos;
+    std::vector<BuildJob> jobs;
+    infos.reserve(dirty.size());
+    for(uint32_t inx : dirty) {
+        RefitState& state = refit_state[inx];
+        bool rebuild = (++state.refits > max_refits);
+        if(rebuild) state.refits = 0;
+        state.dirty = false;
+        BlasInfo& bi = infos.emplace_back(device, mesh_list[geometries[inx]]);
+        jobs.push_back({&bi, blas_list[inx].structure, !rebuild});  // (rebuilds into the same structure: same size)
+    }
+
+    // The BLASes are updated in place, while the previous frame may still be tracing them (ray tracing
+    // pipeline, or ray queries in the fragment shader). Wait for those reads, and for earlier builds.
+    const VkPipelineStageFlags2 BUILD   = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR;
+    const VkPipelineStageFlags2 TRACE   = BarrierBatch::shader_stages;  // (incl. RAY_TRACING_SHADER, when enabled)
+    const VkAccessFlags2        READ    = VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR;
+    const VkAccessFlags2        WRITE   = VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+    mem_barrier2(cmd, BUILD | TRACE, WRITE, BUILD, READ | WRITE);  // WAR on last frame's traces, WAW on the scratch pool
+    RecordBuilds(cmd, jobs, false);  // (the pool was sized by Build)
+    mem_barrier2(cmd, BUILD, WRITE, BUILD | TRACE, READ);          // visible to the TLAS build, and to this frame's traces
+    return true;
 }
 
-void BLAS::Compact(CCmd& cmd, ABO& blas, VkDeviceSize cmpSize) {
-    printf("Blas compact: %lu/%lu (%lu%%)\n", (long)cmpSize, (long)blas.size(), (long)(cmpSize*100/blas.size()));
+// Builds infos[todo[i]] on the CPU, and returns them serialized. (for ASCache::Deserialize)
+// Each build and each serialization is a deferred operation, with its own scratch buffer, so the
+// worker pool can run them side by side. The host structures are only kept until they are serialized.
+std::vector<ASCache::Blob> BLAS::HostBuild(uint32_t first, std::vector<BlasInfo>& infos, const std::vector<uint32_t>& todo) {
+    uint32_t count = (uint32_t)todo.size();
+    if(!count) return {};
+    Timer timer;
 
-    ABO old = std::move(blas);          // save old blas data
-    blas.Allocate(cmpSize, ABO::BLAS);  // reallocate blas to compact size
+    //--- Host copies of the vertices and indices ---
+    std::vector<std::vector<char>> vertices(count), indices(count);
+    repeat(count) {
+        const MeshObject& obj = mesh_list[geometries[first + todo[i]]];
+        vertices[i].resize((size_t)obj.vertexCount * obj.vertexStride);
+        indices [i].resize((size_t)obj.indexCount  * sizeof(uint32_t));
+        default_allocator->ReadBuffer(obj.vertexBuffer, vertices[i].size(), vertices[i].data(), obj.vertexOffset);
+        default_allocator->ReadBuffer(obj.indexBuffer,  indices [i].size(), indices [i].data(), obj.indexOffset);
+        infos[todo[i]].UseHostData(vertices[i].data(), indices[i].data());
+    }
+    double read_time = timer.Span();
 
-    VkCopyAccelerationStructureInfoKHR cpyInfo{VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_INFO_KHR};
-    cpyInfo.src = old.structure;
-    cpyInfo.dst = blas.structure;
-    cpyInfo.mode= VK_COPY_ACCELERATION_STRUCTURE_MODE_COMPACT_KHR;
+    //--- Build, in host memory (the parameters must stay valid until the operations complete) ---
+    std::vector<ABO> host_blas(count);
+    std::vector<std::vector<uint8_t>> scratch_mem(count);
+    std::vector<VkAccelerationStructureBuildGeometryInfoKHR> geomInfos(count);
+    std::vector<VkAccelerationStructureBuildRangeInfoKHR*>   rangeInfos(count);
+    std::vector<VkAccelerationStructureKHR>                  structures(count);
+    DeferredOps ops(device);
+    ops.max_threads = host_threads;
+    repeat(count) {
+        BlasInfo& bi = infos[todo[i]];
+        host_blas[i].Allocate(bi.sizeInfo.accelerationStructureSize, ABO::BLAS, true);
+        scratch_mem[i].resize(bi.sizeInfo.buildScratchSize);
+        structures[i] = host_blas[i].structure;
+        geomInfos [i] = bi.getGeomInfo(structures[i], 0);
+        geomInfos [i].scratchData.hostAddress = scratch_mem[i].data();
+        rangeInfos[i] = &bi.rangeInfo;
+        ops.Run([&, i](VkDeferredOperationKHR op) {
+            return vkBuildAccelerationStructuresKHR(device, op, 1, &geomInfos[i], &rangeInfos[i]);
+        });
+    }
+    uint32_t threads = ops.Threads();
+    VKERRCHECK(ops.Join());
+    double build_time = timer.Span();
+    scratch_mem.clear();
+
+    //--- Serialize ---
+    std::vector<VkDeviceSize> sizes(count);
+    VKERRCHECK(vkWriteAccelerationStructuresPropertiesKHR(device, count, structures.data(), VK_QUERY_TYPE_ACCELERATION_STRUCTURE_SERIALIZATION_SIZE_KHR,
+                                                          count * sizeof(VkDeviceSize), sizes.data(), sizeof(VkDeviceSize)));
+    std::vector<ASCache::Blob> result(count);
+    std::vector<VkCopyAccelerationStructureToMemoryInfoKHR> copies(count);
+    repeat(count) {
+        result[i].resize((size_t)sizes[i]);
+        copies[i] = {VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_TO_MEMORY_INFO_KHR};
+        copies[i].src             = structures[i];
+        copies[i].dst.hostAddress = result[i].data();
+        copies[i].mode            = VK_COPY_ACCELERATION_STRUCTURE_MODE_SERIALIZE_KHR;
+        ops.Run([&, i](VkDeferredOperationKHR op) { return vkCopyAccelerationStructureToMemoryKHR(device, op, &copies[i]); });
+    }
+    VKERRCHECK(ops.Join());
+    printf("Blas host build: %u BLAS on %u thread(s): read %.2f ms, build %.2f ms, serialize %.2f ms\n",
+           count, threads, read_time * 1000, build_time * 1000, timer.Span() * 1000);
+    return result;
+}
+
+// Copy all new BLASes to compacted ones, in one command buffer.
+// The old (uncompacted) structures are kept until the copies have completed.
+void BLAS::Compact(CCmd& cmd, uint32_t first, const std::vector<VkDeviceSize>& sizes) {
+    uint32_t count = (uint32_t)sizes.size();
+    std::vector<ABO> old(count);
+    VkDeviceSize old_size = 0, new_size = 0;
 
     cmd.Begin();
+    repeat(count) {
+        if(!sizes[i]) continue;                 // not compacted
+        ABO& blas = blas_list[first + i];
+        old_size += blas.size();
+        new_size += sizes[i];
+        old[i] = std::move(blas);               // save old blas data
+        blas.Allocate(sizes[i], ABO::BLAS);     // reallocate blas to compact size
+
+        VkCopyAccelerationStructureInfoKHR cpyInfo{VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_INFO_KHR};
+        cpyInfo.src = old[i].structure;
+        cpyInfo.dst = blas.structure;
+        cpyInfo.mode= VK_COPY_ACCELERATION_STRUCTURE_MODE_COMPACT_KHR;
         vkCmdCopyAccelerationStructureKHR(cmd, &cpyInfo);
+    }
     cmd.End(true);
+    if(old_size == 0) return;
+    printf("Blas compact: %lu/%lu KB (%lu%%)\n", (long)(new_size >> 10), (long)(old_size >> 10), (long)(new_size*100/std::max<VkDeviceSize>(old_size, 1)));
 }
 
 void BLAS::Destroy() {
     blas_list.clear();
     mesh_list.clear();
+    refit_state.clear();
+    geometries.clear();
+    blas_index.clear();
+    scratch.Clear();
 }
 //--------------------------------------------------------------------------------------------------
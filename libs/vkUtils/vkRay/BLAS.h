@@ -2,6 +2,7 @@
 #define BLAS_H
 
 #include "Buffers.h"
+#include <string>
 
 //GeometryInstance
 struct MeshObject {
@@ -15,6 +16,7 @@ struct MeshObject {
     VkBuffer     uniformBuffer;
     VkDeviceSize uniformOffset;
     bool isOpaque = true;
+    bool allowUpdate = false;  // deformable: may be refit after its vertices change (not compacted)
 };
 
 
@@ -24,12 +26,15 @@ typedef std::vector<ABO>        BLASList;
 //--------------------------------------------------------------------------------------------------
 
 //---------------------------------------------QUERY------------------------------------------------
-struct Query {  // query AS compacted size
+struct Query {  // query AS compacted size (of one, or many structures at once)
     VkDevice    device     = VK_NULL_HANDLE;
     VkQueryPool query_pool = VK_NULL_HANDLE;
-    Query(CCmd& cmd, VkAccelerationStructureKHR* as, VkQueryType queryType=VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR);
+    uint32_t    count      = 0;
+    Query(CCmd& cmd, const VkAccelerationStructureKHR* as, uint32_t count=1,
+          VkQueryType queryType=VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR);
     ~Query();
-    VkDeviceSize GetResult();
+    VkDeviceSize GetResult();                 // first result
+    std::vector<VkDeviceSize> GetResults();   // all results (waits for the command buffer)
 };
 //--------------------------------------------------------------------------------------------------
 
@@ -46,34 +51,83 @@ public:
     //VkAccelerationStructureBuildRangeInfoKHR* pRangeInfo=&rangeInfo;
     BlasInfo(VkDevice device, MeshObject obj);
     ~BlasInfo(){}
-    auto getGeomInfo(VkAccelerationStructureKHR structure, VkBuffer scratch);
+    void UseHostData(const void* vertices, const void* indices);  // for host builds: read host copies, and find host build sizes
+    auto getGeomInfo(VkAccelerationStructureKHR structure, VkDeviceAddress scratch);
 };
 //--------------------------------------------------------------------------------------------------
 
 //---------------------------------------------BLAS-------------------------------------------------
+// Build() builds all new meshes in one command buffer:
+//  - All build sizes are found up front, and each build gets a slice of one shared scratch pool.
+//  - If the scratch for all builds doesn't fit in scratch_budget, the pool is reused: the builds are
+//    split into batches, with a barrier between them.
+//  - Compacted sizes are queried for all BLASes together, and all copies are done in a second pass.
+// So there are two submits in total, instead of two or three per mesh.
+// With a cache_file, BLASes saved by an earlier run are loaded instead of built.
+//
+// Meshes that share their VBO and IBO (instances of the same geometry) share one BLAS:
+// mesh_list has one entry per instance (indexed by gl_InstanceID in the shaders), but blas_list
+// only has one entry per unique geometry. BlasIndex(mesh) maps one to the other.
+//
+// Deformable meshes (allowUpdate) can be refit instead: MarkDirty() them after changing their vertices,
+// and the next Refit() runs update-mode builds for only those BLASes. Refitting keeps the tree topology,
+// so trace quality degrades as vertices move. After max_refits, the BLAS is rebuilt instead.
+//
+// With host_build, new BLASes are built by the CPU instead (needs accelerationStructureHostCommands):
+// each build is a deferred operation, and a pool of worker threads joins them all. The results are
+// serialized, and loaded into device memory the same way as cached BLASes. (then compacted as usual)
+// Build() still waits, so the worker pool only helps with the build itself, not with overlapping frames.
+// Both paths log their time ("Blas build (host/device)"), so they can be compared on the same scene.
 class BLAS {
     VkPhysicalDevice gpu    = VK_NULL_HANDLE;
     VkDevice         device = VK_NULL_HANDLE;
-
-    void BuildObj(CCmd& cmd, MeshObject obj, bool compact=true);
-    void Compact(CCmd& cmd, ABO& blas, VkDeviceSize cmpSize);
+    VkDeviceSize     scratch_alignment = 256;  // minAccelerationStructureScratchOffsetAlignment
+    bool             host_commands = false;    // accelerationStructureHostCommands
+    SBO              scratch;                  // shared scratch pool (kept for refits)
+
+    struct BuildJob {
+        BlasInfo*                  info;
+        VkAccelerationStructureKHR structure;
+        bool                       update;     // refit structure in place
+    };
+    struct RefitState {
+        bool     dirty  = false;
+        uint32_t refits = 0;                   // since the last full build
+    };
+    std::vector<RefitState> refit_state;       // one per BLAS
+    std::vector<uint32_t>   geometries;        // one per BLAS: the first mesh that uses it (what is built)
+    std::vector<uint32_t>   blas_index;        // one per mesh: its BLAS
+
+    uint32_t RecordBuilds(VkCommandBuffer cmd, const std::vector<BuildJob>& jobs, bool grow);  // returns the number of batches
+    void Compact(CCmd& cmd, uint32_t first, const std::vector<VkDeviceSize>& sizes);
+    std::vector<std::vector<char>> HostBuild(uint32_t first, std::vector<BlasInfo>& infos, const std::vector<uint32_t>& todo);  // serialized (ASCache::Blob)
 
 public:
-    MeshList mesh_list;
-    BLASList blas_list;
+    MeshList mesh_list;                        // one per instance
+    BLASList blas_list;                        // one per unique geometry
+    VkDeviceSize scratch_budget = 64 << 20;    // max size of the shared scratch pool (the largest build may exceed it)
+    uint32_t     max_refits     = 32;          // refits before a full rebuild
+    std::string  cache_file;                   // if set: load BLASes from this file when possible, save new ones (see ASCache)
+    bool         host_build     = false;       // build on the CPU, if the device supports it
+    uint32_t     host_threads   = 0;           // worker pool size for host builds (0: one per CPU core)
 
     BLAS(){}
     ~BLAS(){Destroy();}
 
     void Init(VkPhysicalDevice gpu, VkDevice device);
-    uint32_t AddMesh(VBO& vbo, IBO& ibo, UBO& ubo, bool isOpaque=true);  //return index
-    uint32_t AddMesh(MeshObject obj);
-
-    void Build(CCmd& cmd, bool compact=true);  // build blas_list from mesh_list
+    uint32_t AddMesh(VBO& vbo, IBO& ibo, UBO& ubo, bool isOpaque=true, bool allowUpdate=false);  //return mesh index
+    uint32_t AddMesh(MeshObject obj);          // reuses the BLAS of an earlier mesh with the same geometry
+    uint32_t BlasIndex(uint32_t mesh) { return blas_index[mesh]; }
+
+    void Build(CCmd& cmd, bool compact=true);  // build blas_list from mesh_list (only meshes added since the last Build)
+    void MarkDirty(uint32_t mesh);             // vertices changed: refit on the next Refit()
+    void UpdateMesh(uint32_t mesh, VBO& vbo, IBO& ibo);  // buffers were re-created (same counts), and MarkDirty
+    bool Refit(CCmd& cmd);                     // refit (or rebuild) all dirty BLASes, and wait. Returns false if none were dirty
+    bool Refit(VkCommandBuffer cmd);           // same, but record into the frame's command buffer
     void Destroy();
 
     ABO& operator[](uint32_t i) {return blas_list[i];}
-    uint32_t count(){return blas_list.size();}
+    uint32_t count(){return blas_list.size();}  // unique BLASes (mesh_list.size() instances)
     operator MeshList& () { return mesh_list; }
 };
 
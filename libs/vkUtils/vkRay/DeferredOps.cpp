@@ -0,0 +1,61 @@
+#include "DeferredOps.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#undef repeat
+#define repeat(COUNT) for(uint32_t i = 0; i < (COUNT); ++i)
+
+DeferredOps::~DeferredOps() {
+    if(!ops.empty()) Join();
+}
+
+void DeferredOps::Run(std::function<VkResult(VkDeferredOperationKHR)> command) {
+    VkDeferredOperationKHR op = VK_NULL_HANDLE;
+    VkResult res = vkCreateDeferredOperationKHR(device, nullptr, &op);
+    if(res == VK_SUCCESS) res = command(op);
+    if(res == VK_OPERATION_DEFERRED_KHR) { ops.push_back(op);  return; }  // completed in Join()
+    if(op) vkDestroyDeferredOperationKHR(device, op, nullptr);
+    if(res != VK_OPERATION_NOT_DEFERRED_KHR && res != VK_SUCCESS && result == VK_SUCCESS) result = res;  // (not deferred: already complete)
+}
+
+uint32_t DeferredOps::Threads() {
+    uint32_t threads = max_threads ? max_threads : std::max(std::thread::hardware_concurrency(), 1u);
+    uint64_t concurrency = 0;  // how many threads the driver can use, in total (each op may report UINT32_MAX: no limit)
+    for(auto op : ops) concurrency += std::max(vkGetDeferredOperationMaxConcurrencyKHR(device, op), 1u);
+    return std::max((uint32_t)std::min<uint64_t>(threads, concurrency), 1u);
+}
+
+// Join returns: VK_SUCCESS: the operation is complete.  VK_THREAD_DONE_KHR: not complete, but it has
+// no more work for this thread.  VK_THREAD_IDLE_KHR: no work right now, but there may be more later.
+VkResult DeferredOps::Join() {
+    uint32_t count = (uint32_t)ops.size();
+    if(count) {
+        std::vector<std::atomic<bool>> done(count);
+        auto worker = [&](uint32_t first) {
+            repeat(count) {
+                uint32_t inx = (first + i) % count;
+                if(done[inx]) continue;
+                VkResult res;
+                while((res = vkDeferredOperationJoinKHR(device, ops[inx])) == VK_THREAD_IDLE_KHR) std::this_thread::yield();
+                if(res == VK_SUCCESS) done[inx] = true;
+            }
+        };
+        uint32_t threads = Threads();
+        std::vector<std::thread> pool;
+        for(uint32_t t = 1; t < threads; ++t) pool.emplace_back(worker, t * count / threads);
+        worker(0);                              // this thread joins too
+        for(auto& thread : pool) thread.join();
+
+        for(auto op : ops) {
+            VkResult res;                       // (DONE: any remaining work is the driver's own)
+            while((res = vkGetDeferredOperationResultKHR(device, op)) == VK_NOT_READY) std::this_thread::yield();
+            if(res != VK_SUCCESS && result == VK_SUCCESS) result = res;
+            vkDestroyDeferredOperationKHR(device, op, nullptr);
+        }
+        ops.clear();
+    }
+    VkResult res = result;
+    result = VK_SUCCESS;
+    return res;
+}
@@ -0,0 +1,34 @@
+// DeferredOps
+// Runs host commands (vkBuildAccelerationStructuresKHR, vkCopyAccelerationStructureToMemoryKHR...)
+// as deferred operations (VK_KHR_deferred_host_operations), and joins them from a pool of worker threads.
+//
+// Run() gives each command its own deferred operation, so the driver can split the work of all of them
+// across the pool. Join() then runs the pool until every operation is complete: each worker joins the
+// operations in turn, starting at a different one, so independent builds run side by side.
+//
+// Usage:
+//   DeferredOps ops(device);
+//   repeat(count) ops.Run([&](VkDeferredOperationKHR op) { return vkBuildAccelerationStructuresKHR(device, op, 1, &info[i], &range[i]); });
+//   VKERRCHECK(ops.Join());   // waits
+
+#ifndef DEFERREDOPS_H
+#define DEFERREDOPS_H
+
+#include "Buffers.h"
+#include <functional>
+
+class DeferredOps {
+    VkDevice device = VK_NULL_HANDLE;
+    std::vector<VkDeferredOperationKHR> ops;  // deferred, not joined yet
+    VkResult result = VK_SUCCESS;             // first error
+public:
+    uint32_t max_threads = 0;                 // worker pool size (0: one per CPU core)
+
+    DeferredOps(VkDevice device) : device(device) {}
+    ~DeferredOps();
+    void     Run(std::function<VkResult(VkDeferredOperationKHR)> command);  // start a host command
+    VkResult Join();                          // complete all, on the worker pool. Returns the first error
+    uint32_t Threads();                       // pool size the next Join() will use
+};
+
+#endif
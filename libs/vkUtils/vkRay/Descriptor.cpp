@@ -105,6 +105,11 @@ void RayDescriptorSet::Bind(uint32_t binding, VkBuffer buffer) { // Bind a buffe
     Bind(binding, {{buffer, 0, VK_WHOLE_SIZE}});
 }
 
+void RayDescriptorSet::Bind(uint32_t binding, UBO& ubo) {  // Bind the current slot of a UBO ring (dynamic: the slot is a bind-time offset)
+    bool dynamic = bindings[binding].descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    Bind(binding, {{ubo, dynamic ? 0 : ubo.Stride() * ubo.index, ubo.Stride()}});
+}
+
 void RayDescriptorSet::BindMesh(uint32_t ubo_bind, uint32_t vbo_bind, uint32_t ibo_bind, MeshList& mesh_list) {  // Bind Mesh list
     uint cnt = mesh_list.size();
     std::vector<VkDescriptorBufferInfo> uboInfo(cnt);
@@ -86,10 +86,12 @@ public:
     void Bind(uint32_t binding, VkAccelerationStructureKHR& as);                                  // Bind TLAS
     void Bind(uint32_t binding, VkImageView view);                                                // Bind RenderTarget
     void Bind(uint32_t binding, VkBuffer buffer);                                                 // Bind UBO
+    void Bind(uint32_t binding, UBO& ubo);                                                        // Bind UBO (current ring slot, or slot 0 if dynamic)
     void BindMesh(uint32_t ubo_bind, uint32_t vbo_bind, uint32_t ibo_bind, MeshList& mesh_list);  // Bind Geometries
     void BindImages(uint32_t binding, std::vector<CvkImage*>& img);                               // Bind Textures
 
     void UpdateSetContents();
+    const BindingMap& Bindings() const { return bindings; }
 };
 //--------------------------------------------------------------------------------------------------
 #endif
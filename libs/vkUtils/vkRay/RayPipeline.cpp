@@ -1,4 +1,7 @@
 #include "RayPipeline.h"
+#include "PipelineCache.h"
+#include <chrono>
+#include <algorithm>
 
 #include <assert.h>
 #include <stdio.h>
@@ -12,10 +15,28 @@ void RayPipeline::Init(VkPhysicalDevice gpu, VkDevice device) {
 //--------------------------------------------------------------------------------------------------
 VkShaderModule RayPipeline::LoadShader(const char* filename) {
     auto spirv = LoadFile(filename);
-    //Parse(spirv);
+    Loaded& loaded = m_Loaded.emplace_back();
+    loaded.filename = filename;
+    if(!loaded.reflection.Parse(spirv)) LOGW("RayPipeline: Can't reflect %s\n", filename);
     return CreateShaderModule(spirv);
 }
 
+bool RayPipeline::Requires(const char* filename, const std::vector<uint32_t>& bindings, uint32_t push_size) {
+    auto it = std::find_if(m_Loaded.begin(), m_Loaded.end(), [&](Loaded& l) { return l.filename == filename; });
+    ASSERT(it != m_Loaded.end(), "RayPipeline: %s was not loaded.\n", filename);
+    const ShaderReflection& refl = it->reflection;
+    bool ok = true;
+    for(uint32_t binding : bindings) {
+        bool used = std::any_of(refl.bindings.begin(), refl.bindings.end(), [&](auto& b) { return b.set == 0 && b.binding == binding; });
+        if(!used) { LOGE("RayPipeline: %s doesn't use binding %d.\n", filename, binding);  ok = false; }
+    }
+    uint32_t push = 0;
+    for(auto& block : refl.push_blocks) push = std::max(push, block.offset + block.size);
+    if(push < push_size) { LOGE("RayPipeline: %s has %d bytes of push constants. (expected %d)\n", filename, push, push_size);  ok = false; }
+    if(!ok) LOGE("RayPipeline: %s is stale SPIR-V. Rebuild the shaders. (compile.sh, or the CMake build)\n", filename);
+    return ok;
+}
+
 std::vector<char> RayPipeline::LoadFile(const char* filename) {
     printf("Load Shader: %s... ", filename);
     FILE* file = fopen(filename, "rb");
@@ -44,11 +65,32 @@ VkShaderModule RayPipeline::CreateShaderModule(const std::vector<char>& spirv) {
     VKERRCHECK(vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule))
     return shaderModule;
 }
+bool RayPipeline::CheckLayout(const BindingMap& layout) {
+    auto shader_type = [](VkDescriptorType type) {  // dynamic buffers are plain buffers in the shader
+        if(type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC) return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        if(type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC) return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        return type;
+    };
+    bool ok = true;
+    for(auto& loaded : m_Loaded) {
+        for(auto& b : loaded.reflection.bindings) {
+            if(b.set != 0) continue;
+            auto it = layout.find(b.binding);
+            if(it == layout.end())
+                { LOGE("RayPipeline: %s uses binding %d (%s), which is not in the layout.\n", loaded.filename.c_str(), b.binding, b.name.c_str());  ok = false; }
+            else if(shader_type(it->second.descriptorType) != b.type)
+                { LOGE("RayPipeline: %s uses binding %d (%s) with another descriptor type.\n", loaded.filename.c_str(), b.binding, b.name.c_str());  ok = false; }
+        }
+    }
+    if(!ok) LOGE("RayPipeline: Stale SPIR-V. Rebuild the shaders. (compile.sh, or the CMake build)\n");
+    return ok;
+}
 //--------------------------------------------------------------------------------------------------
 
 void RayPipeline::Clear() {
     for(auto& stage : m_Stages) vkDestroyShaderModule(device, stage.module, 0);
     m_Stages.clear();
+    m_Loaded.clear();
     m_Groups.clear();
 }
 
@@ -143,8 +185,11 @@ void RayPipeline::Create(VkPipelineLayout layout, uint32_t maxRecursionDepth) {
     rayPipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
     rayPipelineCreateInfo.basePipelineIndex = -1;
 
-    VKERRCHECK(vkCreateRayTracingPipelinesKHR(device, VK_NULL_HANDLE, VK_NULL_HANDLE, 1,
+    auto start = std::chrono::steady_clock::now();
+    VKERRCHECK(vkCreateRayTracingPipelinesKHR(device, VK_NULL_HANDLE, DefaultPipelineCache(), 1,
                                               &rayPipelineCreateInfo, NULL, &pipeline));
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    LOGI("RayPipeline: Compiled %d stages in %.2f ms%s\n", (int)m_Stages.size(), ms, DefaultPipelineCache() ? "" : " (no pipeline cache)");
     sbt.Create(gpu, device, pipeline);
     Clear();
 }
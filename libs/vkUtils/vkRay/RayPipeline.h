@@ -3,7 +3,10 @@
 
 #include "Validation.h"
 #include <vector>
+#include <string>
 #include "SBT.h"
+#include "ShaderRegistry.h"
+#include "Descriptor.h"
 
 class RayPipeline {
     VkPhysicalDevice gpu = 0;
@@ -13,6 +16,12 @@ class RayPipeline {
     std::vector<char> LoadFile(const char* filename);
     VkShaderModule    CreateShaderModule(const std::vector<char>& spirv);
 
+    struct Loaded {
+        std::string      filename;
+        ShaderReflection reflection;
+    };
+    std::vector<Loaded> m_Loaded;  // reflection of each loaded shader (to detect stale SPIR-V)
+
     std::vector<VkPipelineShaderStageCreateInfo>      m_Stages;
     std::vector<VkRayTracingShaderGroupCreateInfoKHR> m_Groups;
     uint32_t AddStage(VkShaderModule module, VkShaderStageFlagBits shader_stage);
@@ -38,6 +47,13 @@ public:
     uint32_t AddCallShader  (const char* filename);    // Callable shader is optional.
 
     void Create(VkPipelineLayout layout, uint32_t maxRecursionDepth = 3);
+
+    // Stale SPIR-V (compiled from older GLSL) still loads, but ignores newer bindings.
+    // Returns false, and says so, if the loaded shader doesn't use these bindings (set 0) or push constants.
+    bool Requires(const char* filename, const std::vector<uint32_t>& bindings, uint32_t push_size = 0);
+    // Returns false, and says which, if a loaded shader uses a binding (set 0) that the layout lacks, or has with another type.
+    // (eg. SPIR-V built before the layout changed) Creating the pipeline with it would be invalid.
+    bool CheckLayout(const BindingMap& layout);
     //operator VkPipeline() const { return m_Pipeline; }
 };
 
@@ -2,6 +2,13 @@
 #define SBT_H
 #include "Buffers.h"
 
+//----------------------------- SBT -------------------------------
+// Shader binding table: one region each for raygen, miss, hit and callable shader records.
+// Each region holds one record per shader group: its handle, with no data. Per-instance data
+// (buffer addresses and material) is in the scene table instead, so ray queries can read it too.
+//
+// Regions are aligned to shaderGroupBaseAlignment, and records to shaderGroupHandleAlignment.
+// The table is built once, in Create(), in device memory.
 class SBT {
     VkPipeline rtPipeline = 0;
     VkStridedDeviceAddressRegionKHR m_rgenRegion{};
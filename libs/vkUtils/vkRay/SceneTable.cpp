@@ -0,0 +1,60 @@
+#include "SceneTable.h"
+#include <algorithm>
+#include <cstring>
+
+bool SceneTable::Resize(uint32_t count) {
+    entries.resize(count);
+    models.resize(count);
+    if(buffer.Count() >= std::max(count, 1u)) return false;
+    uint32_t capacity = std::max({count, buffer.Count() * 2, 1u});  // leave room to add more
+    VkFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    buffer      .Data(0, capacity, sizeof(InstanceData), usage, VMA_MEMORY_USAGE_GPU_ONLY);
+    model_buffer.Data(0, capacity, sizeof(ModelData), usage | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+    model_address = model_buffer.DeviceAddress();
+    dirty_begin = 0;                 // new buffers: upload everything
+    dirty_end   = count;
+    return true;
+}
+
+void SceneTable::Mark(uint32_t inx) {
+    if(dirty_end == dirty_begin) { dirty_begin = inx;  dirty_end = inx + 1; }
+    dirty_begin = std::min(dirty_begin, inx);
+    dirty_end   = std::max(dirty_end,   inx + 1);
+}
+
+void SceneTable::Set(uint32_t inx, const InstanceData& data) {
+    ASSERT(inx < entries.size(), "SceneTable: Index %d out of range.\n", inx);
+    if(!memcmp(&entries[inx], &data, sizeof(data))) return;  // unchanged
+    entries[inx] = data;
+    Mark(inx);
+}
+
+void SceneTable::SetModel(uint32_t inx, const ModelData& model) {
+    if(inx >= models.size()) models.resize(inx + 1);  // (Resize() sets the final count)
+    if(!memcmp(&models[inx], &model, sizeof(model))) return;  // unchanged
+    models[inx] = model;
+    Mark(inx);
+}
+
+// vkCmdUpdateBuffer: up to 64KB per call.
+void SceneTable::Update(VkCommandBuffer cmd) {
+    dirty_end = std::min(dirty_end, Count());
+    if(dirty_end <= dirty_begin) return;
+    BarrierBatch batch;
+    buffer      .Barrier(batch, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT);  // after the last TraceRays
+    model_buffer.Barrier(batch, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT);
+    batch.Flush(cmd);
+    auto upload = [&](VkBuffer dst, const void* src, uint32_t stride) {
+        const uint32_t per_copy = 65536 / stride;
+        for(uint32_t first = dirty_begin; first < dirty_end; first += per_copy) {
+            uint32_t count = std::min(per_copy, dirty_end - first);
+            vkCmdUpdateBuffer(cmd, dst, first * stride, count * stride, (const char*)src + first * stride);
+        }
+    };
+    upload(buffer,       entries.data(), sizeof(InstanceData));
+    upload(model_buffer, models.data(),  sizeof(ModelData));
+    buffer      .Barrier(batch, VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_READ_BIT);
+    model_buffer.Barrier(batch, VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_READ_BIT);
+    batch.Flush(cmd);
+    dirty_begin = dirty_end = 0;
+}
@@ -0,0 +1,60 @@
+// SceneTable
+// One SSBO with the per-instance data the ray tracing shaders need: the buffer addresses of each
+// instance's vertices, indices and model data (world matrix and material), indexed by gl_InstanceCustomIndexEXT.
+// The descriptor set then holds this one buffer, instead of UBO/VBO/IBO arrays that grow with the scene.
+//
+// The model data is the table's own copy, in a second buffer, not the mesh's UBO: the rasterizer writes
+// that UBO's ring slots while earlier frames may still read them, and the tracer may run in a different frame.
+//
+// Set() and SetModel() only change the host copies. Update() copies the changed entries into the buffers,
+// in the frame's command buffer. Resize() keeps the buffers while the count fits, so adding or removing meshes
+// only rewrites entries. (When it grows, the buffers are re-created, and the table must be bound again.)
+//
+// Usage:
+//   SceneTable scene;
+//   if(scene.Resize(count)) ds.Bind(3, scene);
+//   scene.Set(i, {vbo_address, ibo_address, scene.ModelAddress(i), material});
+//   scene.SetModel(i, model);
+//   scene.Update(cmd);  // before TraceRays
+
+#ifndef SCENETABLE_H
+#define SCENETABLE_H
+
+#include "Buffers.h"
+
+struct InstanceData {                // matches "InstanceData" in unpack.glsl (std430)
+    VkDeviceAddress vertices = 0;    // vertex buffer (+ offset)
+    VkDeviceAddress indices  = 0;    // index buffer  (+ offset)
+    VkDeviceAddress model    = 0;    // ModelData (see ModelAddress)
+    int32_t         material = -1;   // bindless material id (-1: none)
+    uint32_t        pad      = 0;
+};
+
+struct ModelData {                   // matches "Model" in the hit shaders (std430), and uboData
+    float   matrix[16];              // world matrix
+    float   color[4][4];             // material colors
+    int32_t texid[4];                // texture ids
+};
+
+class SceneTable {
+    CvkBuffer buffer;                // device-local
+    CvkBuffer model_buffer;          // device-local: one ModelData per entry
+    VkDeviceAddress model_address = 0;
+    std::vector<InstanceData> entries;
+    std::vector<ModelData>    models;
+    uint32_t dirty_begin = 0;        // entries (and models) not yet copied to the buffers
+    uint32_t dirty_end   = 0;
+    void Mark(uint32_t inx);
+public:
+    bool     Resize(uint32_t count); // true: the buffers were re-created (bind it again)
+    void     Set(uint32_t inx, const InstanceData& data);  // (only marked if changed)
+    void     SetModel(uint32_t inx, const ModelData& model);  // (same. Also before Resize: the CPU tracer reads the host copy)
+    void     Update(VkCommandBuffer cmd);
+    uint32_t Count() { return (uint32_t)entries.size(); }
+    VkDeviceAddress  ModelAddress(uint32_t inx) const { return model_address + inx * sizeof(ModelData); }
+    const ModelData& Model(uint32_t inx) const { return models[inx]; }
+    const InstanceData& operator[](uint32_t inx) const { return entries[inx]; }
+    operator VkBuffer () { return buffer; }
+};
+
+#endif
@@ -1,5 +1,7 @@
 ﻿#include "TLAS.h"
-#include "vkray_helpers.h"
+#include "DeferredOps.h"
+#include <cstring>
+#include <algorithm>
 
 VkTransformMatrixKHR vkMatrix(mat4 m) {
     return  {m.m00, m.m01, m.m02, m.m03,
@@ -18,50 +20,78 @@ void TLAS::Init(VkPhysicalDevice gpu, VkDevice device) {
     inst_list.clear();
 }
 
-void TLAS::AddInstances(BLAS& blas) {
-    uint cnt = blas.count();
+void TLAS::AddInstances(BLAS& blas) {  // one instance per mesh (BLAS may be unbuilt, for CPU raytracing)
+    uint cnt = (uint)blas.mesh_list.size();
     inst_list.clear();
     inst_list.reserve(cnt);
-    repeat(cnt) AddInst(blas[i].structure, 0);
+    pending.clear();
+    blas_handles.clear();
+    repeat(cnt) {
+        uint32_t inx = blas.BlasIndex(i);
+        AddInstance(inx < blas.count() ? blas[inx].structure : VK_NULL_HANDLE, i);  // custom index = mesh index
+    }
 }
 
-uint32_t TLAS::AddInst(VkAccelerationStructureKHR blas, uint32_t hitGroupIndex, VkGeometryInstanceFlagsKHR flags) {
+uint32_t TLAS::AddInstance(VkAccelerationStructureKHR blas, uint32_t customIndex, uint32_t hitGroupIndex, VkGeometryInstanceFlagsKHR flags) {
     uint id = inst_list.size();
     VkAccelerationStructureInstanceKHR& inst = inst_list.emplace_back();
     inst.transform                              = vkMatrix(Identity4x4);
-    inst.instanceCustomIndex                    = id;                            // gl_InstanceCustomIndexEXT
+    inst.instanceCustomIndex                    = customIndex;                   // gl_InstanceCustomIndexEXT
     inst.mask                                   = 0xFF;
     inst.instanceShaderBindingTableRecordOffset = hitGroupIndex;                 // hit group index
     inst.flags                                  = flags;
-    inst.accelerationStructureReference         = ASdeviceAddress(device, blas);
+    inst.accelerationStructureReference         = blas ? ASdeviceAddress(device, blas) : 0;
+    pending.push_back(0xFF);                                                     // (clamped to the ring size)
+    blas_handles.push_back(blas);
+    ++version;
     return id;
 }
 
 void TLAS::UpdateInst(uint32_t id, mat4& m, bool visible) {
     auto& inst = inst_list[id];
-    inst.transform = vkMatrix(m);
-    inst.mask = visible ? 0xff : 0;
+    VkTransformMatrixKHR transform = vkMatrix(m);
+    uint8_t mask = visible ? 0xff : 0;
+    if(inst.mask == mask && memcmp(&inst.transform, &transform, sizeof(transform)) == 0) return;  // unchanged
+    inst.transform = transform;
+    inst.mask = mask;
+    pending[id] = 0xFF;
+    ++version;
 }
 
-void TLAS::Build(CCmd& cmd, bool onHost) {
-    bool update = !!topAS.structure;
-    uint32_t count = inst_list.size();
-    //VkDeviceSize SizeInBytes = count * sizeof(VkAccelerationStructureInstanceKHR);  // get total size of inst_list array
-    instances.Clear();
-
-    VkDeviceSize ASIsize = sizeof(VkAccelerationStructureInstanceKHR);
-    VkFlags usage = VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR;
-    instances.Data(inst_list.data(), count, ASIsize, usage);
+VkDeviceAddress TLAS::WriteInstances() {
+    uint32_t count = (uint32_t)inst_list.size();
+    VkDeviceSize array_size = count * sizeof(VkAccelerationStructureInstanceKHR);
+    uint32_t ring = default_allocator->frames_in_flight;
+    if(instances.Count() != ring || instances.Stride() != array_size) {  // (re)create, and write every slot
+        VkFlags usage = VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+        if(instances.Count()) Retire().instances = std::move(instances);
+        instances.Data(0, ring, (uint32_t)array_size, usage, VMA_MEMORY_USAGE_CPU_TO_GPU, &instances.mapped);
+        for(auto& p : pending) p = 0xFF;
+    }
+    slot = (slot + 1) % ring;
+    auto* dst = (VkAccelerationStructureInstanceKHR*)((char*)instances.mapped + slot * array_size);
+    uint32_t written = 0;
+    repeat(count) {
+        if(pending[i] > ring) pending[i] = ring;
+        if(!pending[i]) continue;
+        dst[i] = inst_list[i];
+        --pending[i];
+        ++written;
+    }
+    if(written) instances.Flush();
+    return instances.DeviceAddress() + slot * array_size;
+}
 
-    //mem_barrier(*default_allocator, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR);
-    //--------------------------------------------------------------------------------------------------
+void TLAS::Record(VkCommandBuffer cmd) {
+    uint32_t count = inst_list.size();
+    bool update = topAS.structure && count == built_count && !built_on_host;
 
     // Wrap the instances device pointer into a VkAccelerationStructureGeometryKHR.
     VkAccelerationStructureGeometryKHR topASGeometry{VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR};
     topASGeometry.geometryType            = VK_GEOMETRY_TYPE_INSTANCES_KHR;
     topASGeometry.flags                   = VK_GEOMETRY_OPAQUE_BIT_KHR;
     topASGeometry.geometry.instances      = {VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR};
-    topASGeometry.geometry.instances.data = deviceAddress(device, instances);
+    topASGeometry.geometry.instances.data.deviceAddress = WriteInstances();
     topASGeometry.geometry.instances.arrayOfPointers = VK_FALSE;
 
     // Find sizes
@@ -74,37 +104,131 @@ void TLAS::Build(CCmd& cmd, bool onHost) {
     buildInfo.srcAccelerationStructure = VK_NULL_HANDLE;
     buildInfo.dstAccelerationStructure = VK_NULL_HANDLE;
     VkAccelerationStructureBuildSizesInfoKHR sizeInfo{VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR};
-    if(onHost)vkGetAccelerationStructureBuildSizesKHR(device, VK_ACCELERATION_STRUCTURE_BUILD_TYPE_HOST_KHR, &buildInfo, &count, &sizeInfo);
-    else      vkGetAccelerationStructureBuildSizesKHR(device, VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &buildInfo, &count, &sizeInfo);
+    vkGetAccelerationStructureBuildSizesKHR(device, VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &buildInfo, &count, &sizeInfo);
 
     // Allocate and Create TLAS (unless updating)
-    if(update == false) topAS.Allocate(sizeInfo.accelerationStructureSize, ABO::TLAS);
+    if(update == false) {
+        if(topAS.structure) Retire().as = std::move(topAS);
+        topAS.Allocate(sizeInfo.accelerationStructureSize, ABO::TLAS);
+        built_count = count;
+        built_on_host = false;
+        printf("Tlas size: %d\n", (int)topAS.size());
+    }
 
-    // Allocate the scratch and TLAS buffers
-    SBO scratch;
-    if(update) scratch.Allocate(sizeInfo.updateScratchSize);
-    else       scratch.Allocate(sizeInfo.buildScratchSize);
+    // Scratch is sized for both modes, so it is allocated once
+    VkDeviceSize scratchSize = std::max(sizeInfo.buildScratchSize, sizeInfo.updateScratchSize);
+    if(scratch.size() < scratchSize) {
+        if(scratch.Count()) Retire().scratch = std::move(scratch);
+        scratch.Allocate(scratchSize);
+    }
+    built_version = version;
 
     // Update build information
     buildInfo.srcAccelerationStructure  = update ? topAS.structure : VK_NULL_HANDLE;
     buildInfo.dstAccelerationStructure  = topAS.structure;
     buildInfo.scratchData.deviceAddress = scratch.DeviceAddress();
 
-    // Build the TLAS
+    // Wait for the last frame's build and trace, then build the TLAS, and make it visible to the ray tracing and fragment shaders
+    const VkPipelineStageFlags2 BUILD = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR;
+    const VkAccessFlags2 READ_WRITE = VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+    BarrierBatch batch;
+    topAS  .Barrier(batch, BUILD, READ_WRITE);
+    scratch.Barrier(batch, BUILD, READ_WRITE);
+    batch.Flush(cmd);
+
     VkAccelerationStructureBuildRangeInfoKHR rangeInfo{count, 0,0,0};
     auto* pRangeInfo = &rangeInfo;                                         // Convert offset to pointer-to-offset
-    if(onHost) {
-        vkBuildAccelerationStructuresKHR(device, 0, 1, &buildInfo, &pRangeInfo);  // Build TLAS on Host (Untested: Not supported on Nvidia 1080)
-    }else{
-        cmd.Begin();
-        vkCmdBuildAccelerationStructuresKHR(cmd, 1, &buildInfo, &pRangeInfo);     // Build TLAS on Device
-        cmd.End(true);
+    vkCmdBuildAccelerationStructuresKHR(cmd, 1, &buildInfo, &pRangeInfo);  // Build TLAS on Device
+
+    const VkPipelineStageFlags2 TRACE = VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;  // (ray queries)
+    topAS.Barrier(batch, TRACE, VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR);
+    batch.Flush(cmd);
+}
+
+// Host build: the instances, scratch and TLAS are all in host memory, and instances reference their BLAS by handle.
+void TLAS::HostBuild() {
+    uint32_t count = inst_list.size();
+    bool update = topAS.structure && count == built_count && built_on_host;
+    Timer timer;
+
+    ASInstances host_instances = inst_list;
+    repeat(count) host_instances[i].accelerationStructureReference = (uint64_t)blas_handles[i];
+    VkAccelerationStructureGeometryKHR topASGeometry{VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR};
+    topASGeometry.geometryType            = VK_GEOMETRY_TYPE_INSTANCES_KHR;
+    topASGeometry.flags                   = VK_GEOMETRY_OPAQUE_BIT_KHR;
+    topASGeometry.geometry.instances      = {VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR};
+    topASGeometry.geometry.instances.data.hostAddress = host_instances.data();
+    topASGeometry.geometry.instances.arrayOfPointers  = VK_FALSE;
+
+    VkAccelerationStructureBuildGeometryInfoKHR buildInfo{VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR};
+    buildInfo.flags         = flags;
+    buildInfo.geometryCount = 1;
+    buildInfo.pGeometries   = &topASGeometry;
+    buildInfo.mode = update ? VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR : VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+    buildInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
+    VkAccelerationStructureBuildSizesInfoKHR sizeInfo{VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR};
+    vkGetAccelerationStructureBuildSizesKHR(device, VK_ACCELERATION_STRUCTURE_BUILD_TYPE_HOST_KHR, &buildInfo, &count, &sizeInfo);
+    if(update == false) {
+        if(topAS.structure && !built_on_host) Retire().as = std::move(topAS);
+        topAS.Allocate(sizeInfo.accelerationStructureSize, ABO::TLAS, true);
+        built_count = count;
+        built_on_host = true;
+    }
+    std::vector<uint8_t> scratch_mem(update ? sizeInfo.updateScratchSize : sizeInfo.buildScratchSize);
+    buildInfo.srcAccelerationStructure = update ? topAS.structure : VK_NULL_HANDLE;
+    buildInfo.dstAccelerationStructure = topAS.structure;
+    buildInfo.scratchData.hostAddress  = scratch_mem.data();
+
+    VkAccelerationStructureBuildRangeInfoKHR rangeInfo{count, 0,0,0};
+    auto* pRangeInfo = &rangeInfo;
+    DeferredOps ops(device);
+    ops.Run([&](VkDeferredOperationKHR op) { return vkBuildAccelerationStructuresKHR(device, op, 1, &buildInfo, &pRangeInfo); });
+    uint32_t threads = ops.Threads();
+    VKERRCHECK(ops.Join());
+    printf("Tlas build (host): %u instances on %u thread(s), time: %.2f ms\n", count, threads, timer.Span() * 1000);
+}
+
+void TLAS::Build(CCmd& cmd, bool onHost) {
+    if(onHost) { HostBuild();  return; }
+    cmd.Begin();
+    Record(cmd);
+    cmd.End(true);
+}
+
+void TLAS::Update(VkCommandBuffer cmd) {
+    Collect();
+    bool changed = !topAS.structure || built_on_host || inst_list.size() != built_count || version != built_version;
+    if(changed) Record(cmd);
+}
+
+TLAS::Retired& TLAS::Retire() {
+    Retired& item = retired.emplace_back();
+    item.frames = std::max(default_allocator->frames_in_flight, 1u);
+    return item;
+}
+
+// Called before recording each frame: the frame in flight that last used the oldest buffers is done.
+// (the swapchain waited for it)
+void TLAS::Collect() {
+    for(auto& item : retired) --item.frames;
+    while(!retired.empty() && retired.front().frames == 0) {
+        Retired& item = retired.front();
+        item.as       .Release();
+        item.scratch  .Release();
+        item.instances.Release();
+        retired.erase(retired.begin());
     }
-    if(update == false) printf("Tlas size: %d\n", (int)topAS.size());
 }
 
 void TLAS::Destroy() {
+    retired.clear();  // (waits)
     topAS.Clear();
+    scratch.Clear();
     instances.Clear();
     inst_list.clear();
+    pending.clear();
+    blas_handles.clear();
+    built_count = 0;
+    built_version = 0;
+    built_on_host = false;
 }
@@ -20,6 +20,16 @@ const VkBuildAccelerationStructureFlagsKHR AS_FLAGS = 0
 ;
 
 //----------------------------- TLAS -------------------------------
+// The instance buffer is host-mapped, and kept between builds. It holds one copy of the instance
+// array per frame in flight, so the CPU can write the next frame's instances while the GPU is still
+// building from the last ones. Only instances changed by UpdateInst() are written, into each copy.
+// The scratch buffer is kept too, so a per-frame Update() allocates nothing, and Update() records nothing
+// if no instance (or BLAS) changed since the last build. Buffers replaced by a rebuild are freed once
+// the frames in flight are done with them, without waiting. (see Collect)
+//
+// Build(cmd, true) builds on the host instead, as a deferred operation joined by a worker pool. (see DeferredOps)
+// Host builds reference each BLAS by handle, so they are only valid with BLASes in host memory, and the
+// result is a host-memory TLAS, for CPU-side use. The RT pipeline needs the device build.
 typedef std::vector<VkAccelerationStructureInstanceKHR> ASInstances;
 
 class TLAS {
@@ -28,19 +38,43 @@ class TLAS {
     //VkCommandBuffer  cmd    = VK_NULL_HANDLE;
     VkBuildAccelerationStructureFlagsKHR flags = AS_FLAGS;
 //public:
-    CvkBuffer instances;
-    ABO topAS;
+    CvkBuffer instances;            // ring of instance arrays (one per frame in flight)
+    SBO       scratch;
+    ABO       topAS;
+    uint32_t  slot        = 0;      // instance array the last build read
+    uint32_t  built_count = 0;      // instances in topAS (update only if unchanged)
+    uint32_t  built_version = 0;    // version in topAS
+    bool      built_on_host = false;  // topAS is in host memory
 
-    ASInstances inst_list;
-    uint32_t AddInst(VkAccelerationStructureKHR blas, uint32_t hitGroupIndex, VkGeometryInstanceFlagsKHR flags=GI_FLAGS);
+    std::vector<VkAccelerationStructureKHR> blas_handles;  // per instance (host builds)
+
+    struct Retired {                // buffers replaced by a device build
+        ABO       as;
+        SBO       scratch;
+        CvkBuffer instances;
+        uint32_t  frames = 0;       // Collect() calls left, until no frame in flight uses it
+    };
+    std::vector<Retired> retired;
+    Retired& Retire();              // a new entry
+    void Collect();                 // free the retired buffers of finished frames (once per frame)
+
+    ASInstances          inst_list;
+    std::vector<uint8_t> pending;   // per instance: ring slots that still hold an old copy
+    VkDeviceAddress WriteInstances();   // next ring slot: write changed instances, return its address
+    void Record(VkCommandBuffer cmd);
+    void HostBuild();
 
 public:
+    uint32_t version = 0;           // incremented whenever an instance is added or changed (eg. to restart accumulation)
+
     TLAS(){};
     ~TLAS(){Destroy();};
     void Init(VkPhysicalDevice gpu, VkDevice device);
-    void AddInstances(BLAS& blas);
+    void AddInstances(BLAS& blas);  // one instance per mesh (instances of the same geometry share a BLAS)
+    uint32_t AddInstance(VkAccelerationStructureKHR blas, uint32_t customIndex, uint32_t hitGroupIndex=0, VkGeometryInstanceFlagsKHR flags=GI_FLAGS);
     void UpdateInst(uint32_t id, mat4& m, bool visible=true);
-    void Build(CCmd& cmd, bool onHost=false);
+    void Build(CCmd& cmd, bool onHost=false);  // build or update, and wait (onHost: needs host-memory BLASes)
+    void Update(VkCommandBuffer cmd);          // record the build or update into the frame's command buffer (no wait)
     void Destroy();
 
     VkAccelerationStructureInstanceKHR& operator[](uint32_t i) {return inst_list[i];}
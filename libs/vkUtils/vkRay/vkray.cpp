@@ -1,4 +1,5 @@
 #include "vkray.h"
+#include "vkray_helpers.h"
 
 //extern PFN_vkGetRayTracingShaderGroupHandlesKHR vkGetRayTracingShaderGroupHandlesKHR;
 
@@ -20,6 +21,11 @@ void VKRay::Init(CQueue& queue) {
     LINK( vkCreateRayTracingPipelinesKHR               )
     LINK( vkCmdCopyAccelerationStructureKHR            )
     LINK( vkCmdWriteAccelerationStructuresPropertiesKHR)
+    LINK( vkCmdCopyAccelerationStructureToMemoryKHR    )
+    LINK( vkCmdCopyMemoryToAccelerationStructureKHR    )
+    LINK( vkCopyAccelerationStructureToMemoryKHR       )
+    LINK( vkWriteAccelerationStructuresPropertiesKHR   )
+    LINK( vkGetDeviceAccelerationStructureCompatibilityKHR)
 #undef LINK
 
     blas.Init(gpu, device);
@@ -28,20 +34,22 @@ void VKRay::Init(CQueue& queue) {
 
 uint32_t VKRay::AddImage(CvkImage* img) {  //return image index ()
     if(!img) return -1;
+    if(bindless) return bindless->AddImage(img);
     vkImages.push_back(img);
     return (uint32_t)vkImages.size()-1;
 }
 
 void VKRay::UpdateImage(uint32_t inx, CvkImage& img) {
     //vkDeviceWaitIdle(device);
-    ASSERT(inx < vkImages.size(), "UpdateImage: index out of bounds: %d", inx);
-    *vkImages[inx] = std::move(img);
-    ds.BindImages(6, vkImages);
+    auto& images = Images();
+    ASSERT(inx < images.size(), "UpdateImage: index out of bounds: %d", inx);
+    *images[inx] = std::move(img);
+    ds.BindImages(6, images);
     ds.UpdateSetContents();
 }
 
-uint32_t VKRay::AddMesh(VBO& vbo, IBO& ibo, UBO& ubo) {
-    return blas.AddMesh(vbo,ibo,ubo, true);
+uint32_t VKRay::AddMesh(VBO& vbo, IBO& ibo, UBO& ubo, bool allowUpdate) {
+    return blas.AddMesh(vbo,ibo,ubo, true, allowUpdate);
 }
 
 uint32_t VKRay::AddMesh(MeshObject obj) {
@@ -55,9 +63,21 @@ void VKRay::BuildAS() {
 }
 
 void VKRay::UpdateTLAS() {
+    if(blas.Refit(cmd)) {
+        ++tlas.version;                // same instances, new geometry
+        UpdateSceneTable();            // vertex buffers may have been re-created
+    }
     tlas.Build(cmd, false);
 }
 
+void VKRay::UpdateTLAS(VkCommandBuffer cmd) {
+    if(blas.Refit(cmd)) {
+        ++tlas.version;                // same instances, new geometry
+        UpdateSceneTable();            // vertex buffers may have been re-created
+    }
+    tlas.Update(cmd);
+}
+
 //-------- Descriptor Set --------
 enum SHADER_STAGE {                             //  VkShaderStageFlagBits
     RGEN = VK_SHADER_STAGE_RAYGEN_BIT_KHR,      //= 0x0100
@@ -114,34 +134,58 @@ void VKRay::CreateDescriptorSet() {
 //--------------------------------
 
 void VKRay::CreateDescriptorSet() {    
-    uint32_t objCnt = blas.count();
-    uint32_t imgCnt = vkImages.size();
+    uint32_t imgCnt = Images().size();
 
     ds.AddBinding(0, 1,      VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, RGEN | CHIT       );  // TLAS
     ds.AddBinding(1, 1,      VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,              RGEN              );  // FrameBuf
-    ds.AddBinding(2, 1,      VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,             RGEN | CHIT | MISS);  // Camera
-    ds.AddBinding(3, objCnt, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,             RGEN | CHIT       );  // UBO
-    ds.AddBinding(4, objCnt, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,             RGEN | CHIT       );  // VBO
-    ds.AddBinding(5, objCnt, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,                    CHIT       );  // IBO
+    ds.AddBinding(2, 1,      VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,     RGEN | CHIT | MISS);  // Camera (ring slot: see BindDS)
+    ds.AddBinding(3, 1,      VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,             RGEN | CHIT       );  // Scene table (UBO/VBO/IBO addresses)
     ds.AddBinding(6, imgCnt, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,     RGEN | CHIT | MISS);  // Textures
-    ds.AddBinding(7, 1,      VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,             RGEN | CHIT | MISS);  // Light
+    ds.AddBinding(7, 1,      VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,     RGEN | CHIT | MISS);  // Light  (ring slot)
+    ds.AddBinding(8, 1,      VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,              RGEN              );  // Accumulation
+    ds.AddBinding(9, 1,      VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,              RGEN              );  // Moments
+    ds.AddBinding(10,1,      VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,     RGEN              );  // Sample counter (ring slot)
     ds.Build(device);
     ds.Bind(0, tlas);            // TLAS
-    //ds.Bind(1, m_target);        // FB
+    if(m_target) ds.Bind(1, m_target);  // FB
     ds.Bind(2,*m_camera);        // Camera
-    ds.BindMesh(3,4,5, blas);    // Mesh
-    ds.BindImages(6, vkImages);  // Images
+    UpdateSceneTable();
+    ds.Bind(3, scene);           // Scene table
+    ds.BindImages(6, Images());  // Images
     ds.Bind(7,*m_light);         //light
+    ASSERT(m_accum && m_moments && m_counter, "VKRay: Call SetAccumulation() before CreateDescriptorSet().\n");
+    ds.Bind(8, m_accum);         // Accumulation
+    ds.Bind(9, m_moments);       // Moments
+    BindCounter();               // Sample counter
     ds.UpdateSetContents();
 };
 
 
+// The one descriptor set is shared by the frames in flight, so it is only rewritten when the target changes.
+// (on a resize, after the swapchain has waited for the GPU) Per-frame slots are bind-time offsets. (see BindDS)
 void VKRay::SetRenderTarget(VkImageView target) {
+    if(target == m_target) return;
     m_target = target;
     ds.Bind(1, m_target);
     ds.UpdateSetContents();
 }
 
+void VKRay::BindCounter() {  // one uint per ring slot
+    ds.Bind(10, std::vector<VkDescriptorBufferInfo>{{m_counter, 0, sizeof(uint32_t)}});
+}
+
+// Rebind after the images are resized. (before CreateDescriptorSet, just sets them)
+void VKRay::SetAccumulation(VkImageView accum, VkImageView moments, VkBuffer counter) {
+    m_accum   = accum;
+    m_moments = moments;
+    m_counter = counter;
+    if(!ds.set) return;
+    ds.Bind(8, m_accum);
+    ds.Bind(9, m_moments);
+    BindCounter();
+    ds.UpdateSetContents();
+}
+
 //---Pipeline---
 /*
 VkPipelineLayout VKRay::GetPipelineLayout() {
@@ -164,14 +208,16 @@ VkPipelineLayout VKRay::GetPipelineLayout() {
     // Combine all ds_layouts into one pipeline_layout.
     VkPipelineLayoutCreateInfo layoutCreateInfo = {VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
     layoutCreateInfo.setLayoutCount         = 1;
+    VkPushConstantRange pushRange = {VK_SHADER_STAGE_RAYGEN_BIT_KHR, 0, sizeof(AccumParams)};
     layoutCreateInfo.pSetLayouts            = &ds.layout;
-    layoutCreateInfo.pushConstantRangeCount = 0;
+    layoutCreateInfo.pushConstantRangeCount = 1;
+    layoutCreateInfo.pPushConstantRanges    = &pushRange;
     VkPipelineLayout layout;
     VKERRCHECK(vkCreatePipelineLayout(device, &layoutCreateInfo, NULL, &layout));
     return layout;
 };
 
-void VKRay::CreatePipeline() {
+bool VKRay::CreatePipeline() {
     pipeline.Init(gpu, device);
     pipeline.AddRayGenShader("shaders/spirv/raytrace.rgen.spv");
     pipeline.AddMissShader  ("shaders/spirv/raytrace.rmiss.spv");
@@ -179,20 +225,59 @@ void VKRay::CreatePipeline() {
     pipeline.AddMissShader  ("shaders/spirv/raytrace.shadow.rmiss.spv");
     pipeline.AddHitGroup    ("shaders/spirv/raytrace.rchit.spv",0,0);
     pipeline.AddHitGroup    ("shaders/spirv/raytrace.2.rchit.spv",0,0);
+    bool ok = pipeline.CheckLayout(ds.Bindings());
+    ok &= pipeline.Requires("shaders/spirv/raytrace.rgen.spv", {8, 9, 10}, sizeof(AccumParams));  // accumulation
+    ok &= pipeline.Requires("shaders/spirv/raytrace.rchit.spv",   {3});                              // scene table
+    ok &= pipeline.Requires("shaders/spirv/raytrace.2.rchit.spv", {3});
+    if(!ok) { LOGE("VKRay: The ray tracing shaders don't match the descriptor layout.\n");  return false; }
     auto layout = GetPipelineLayout();
     pipeline.Create(layout);
+    return true;
 };
 
+// Only entries whose addresses changed are uploaded. (by SceneTable::Update, in TraceRays)
+void VKRay::UpdateSceneTable() {
+    uint32_t count = (uint32_t)blas.mesh_list.size();
+    if(scene.Resize(count) && ds.set) {
+        ds.Bind(3, scene);
+        ds.UpdateSetContents();
+    }
+    repeat(count) {
+        MeshObject&  obj  = blas.mesh_list[i];
+        InstanceData data = scene[i];
+        data.vertices = deviceAddress(device, obj.vertexBuffer)  + obj.vertexOffset;
+        data.indices  = deviceAddress(device, obj.indexBuffer)   + obj.indexOffset;
+        data.model    = scene.ModelAddress(i);                  // (the table's own copy: see SetModel)
+        scene.Set(i, data);
+    }
+}
+
+void VKRay::SetModel(uint32_t inst, const ModelData& model) {
+    scene.SetModel(inst, model);
+}
+
+void VKRay::SetMaterial(uint32_t inst, int material) {
+    if(inst >= scene.Count() || scene[inst].material == material) return;
+    InstanceData data = scene[inst];
+    data.material = material;
+    scene.Set(inst, data);
+}
+
 //--------------
 
-void VKRay::BindDS(VkCommandBuffer cmd) {
+void VKRay::BindDS(VkCommandBuffer cmd, uint32_t counter_offset) {
     //vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, pipeline.layout, 0, 1, &ds[0].set, 0, 0);
     //vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, pipeline.layout, 1, 1, &ds[1].set, 0, 0);
 
-    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, pipeline.layout, 0, 1, &ds.set, 0, 0);    
+    uint32_t offsets[] = {(uint32_t)(m_camera->Stride() * m_camera->index),  // binding 2: camera ring slot
+                          (uint32_t)(m_light ->Stride() * m_light ->index),  // binding 7: light ring slot
+                          counter_offset};                                     // binding 10
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, pipeline.layout, 0, 1, &ds.set, 3, offsets);
 };
 
 void VKRay::TraceRays(VkCommandBuffer cmd, VkExtent2D ext) {
+    scene.Update(cmd);  // changed scene table entries
+    vkCmdPushConstants(cmd, pipeline.layout, VK_SHADER_STAGE_RAYGEN_BIT_KHR, 0, sizeof(accum), &accum);
     pipeline.sbt.TraceRays(cmd, ext);
 };
 //--------------
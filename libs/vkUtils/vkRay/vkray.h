@@ -6,6 +6,8 @@
 #include "TLAS.h"
 #include "Descriptor.h"
 #include "RayPipeline.h"
+#include "Bindless.h"
+#include "SceneTable.h"
 //#include "Material.h"
 
 class VKRay {
@@ -23,11 +25,14 @@ public:
     //rtMaterials materials;
 
     std::vector<CvkImage*> vkImages{};  // TODO: move to Allocator
+    BindlessTable* bindless = 0;        // if set, images are registered here instead (texid shared with raster)
+    std::vector<CvkImage*>& Images() { return bindless ? bindless->images : vkImages; }
     //ImageList imagelist;
 
 
     BLAS blas;
     TLAS tlas;
+    SceneTable scene;     // per-instance buffer addresses (binding 3)
     RayDescriptorSet ds;  // descriptor set
     //std::array<RayDescriptorSet, 2> ds;  // 2 descriptor sets
 
@@ -37,21 +42,38 @@ public:
     void Init(CQueue& queue);
     uint32_t AddImage(CvkImage* img);
     void UpdateImage(uint32_t inx, CvkImage& img);
-    uint32_t AddMesh(VBO& vbo, IBO& ibo, UBO& ubo);
+    uint32_t AddMesh(VBO& vbo, IBO& ibo, UBO& ubo, bool allowUpdate=false);
     uint32_t AddMesh(MeshObject obj);
     void BuildAS();
-    void UpdateTLAS();
+    void UpdateTLAS();                     // refits dirty BLASes first, and waits
+    void UpdateTLAS(VkCommandBuffer cmd);  // same, but recorded into the frame's command buffer
+
+    //---- Progressive accumulation ----
+    struct AccumParams {               // pushed to the raygen shader (push constants)
+        uint32_t frame       = 0;      // frames accumulated so far (0: restart)
+        uint32_t min_samples = 16;     // samples a pixel gets before it may be skipped
+        float    noise_limit = 0;      // skip pixels whose relative standard error is below this (0: off)
+    } accum;
+    VkImageView m_accum   = 0;         // running mean (rgb) and sample count (a)
+    VkImageView m_moments = 0;         // per-pixel luminance mean and M2, for the variance
+    VkBuffer    m_counter = 0;         // pixels the raygen shader sampled (a uint per ring slot: see BindDS)
+    //----------------------------------
 
     //---- Descriptor Set ----
     void CreateDescriptorSet();
     void SetRenderTarget(VkImageView target);
+    void SetAccumulation(VkImageView accum, VkImageView moments, VkBuffer counter);
+    void BindCounter();
     //------------------------
 
     //---- Pipeline ----
     VkPipelineLayout GetPipelineLayout();
-    void CreatePipeline();
+    bool CreatePipeline();  // false: the shaders don't match the descriptor set (not created)
+    void UpdateSceneTable();                       // re-read all buffer addresses (eg. after vertex buffers were re-created)
+    void SetModel(uint32_t inst, const ModelData& model);  // world matrix and material, for the hit shaders (uploaded by TraceRays, if changed)
+    void SetMaterial(uint32_t inst, int material); // updates the instance's scene table entry, if changed
     //------------------
-    void BindDS   (VkCommandBuffer cmd);
+    void BindDS   (VkCommandBuffer cmd, uint32_t counter_offset = 0);  // + the current camera and light ring slots
     void TraceRays(VkCommandBuffer cmd, VkExtent2D ext);
 };
 
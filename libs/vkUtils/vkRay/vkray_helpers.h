@@ -25,6 +25,8 @@ static void mem_barrier(VkCommandBuffer cmd, VkAccessFlags src, VkAccessFlags ds
         {VK_ACCESS_TRANSFER_WRITE_BIT,                   VK_PIPELINE_STAGE_TRANSFER_BIT},
         {VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR},
         {VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR,  VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR},
+        {VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR |
+         VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR},
     };
     VkMemoryBarrier barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
     barrier.srcAccessMask = src;